@@ -131,6 +131,12 @@ static void scene_init()
   /* Read XML */
   xml_read_file(options.scene, options.filepath.c_str());
 
+  /* Build a BVH per geometry so they can be read from the cache, only the instances in the
+   * top-level BVH are built for every render then. */
+  if (!options.scene_params.bvh_cache_path.empty()) {
+    options.scene->params.bvh_type = SceneParams::BVH_DYNAMIC;
+  }
+
   /* Camera width/height override? */
   if (!(options.width == 0 || options.height == 0)) {
     options.scene->camera->width = options.width;
@@ -432,6 +438,24 @@ static void options_parse(int argc, const char **argv)
              "--tile-height %d",
              &options.session_params.tile_size.y,
              "Tile height in pixels",
+             "--bvh-cache %s",
+             &options.scene_params.bvh_cache_path,
+             "Directory to cache the BVH of geometry in, to reuse between renders",
+             "--shader-cache %s",
+             &options.scene_params.shader_cache_path,
+             "Directory to cache compiled shaders in, to reuse between renders",
+             "--compact-geometry",
+             &options.scene_params.use_compact_geometry,
+             "Store vertex normals and UV maps in reduced precision",
+             "--texture-cache",
+             &options.scene_params.use_texture_cache,
+             "Load image textures on demand through the OpenImageIO texture cache",
+             "--texture-cache-size %d",
+             &options.scene_params.texture_cache_size,
+             "Maximum memory used by the texture cache in megabytes",
+             "--texture-cache-path %s",
+             &options.scene_params.texture_cache_path,
+             "Directory to store images converted to tiled and mipmapped .tx files in",
              "--list-devices",
              &list,
              "List information about all available devices",
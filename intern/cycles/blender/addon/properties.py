@@ -388,6 +388,19 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         description="Sample all lights (for indirect samples), rather than randomly picking one",
         default=True,
     )
+    use_light_tree: BoolProperty(
+        name="Light Tree",
+        description="Sample lights by their estimated contribution to the shading point, "
+        "reducing noise in scenes with many lights. Only used with Path Tracing",
+        default=False,
+    )
+    use_guiding: BoolProperty(
+        name="Path Guiding",
+        description="Learn the distribution of indirect light while rendering and sample bounces from it, "
+        "reducing noise in scenes with difficult indirect lighting. Final renders use progressive refine "
+        "to learn from passes over the whole image. Only used with Path Tracing on the CPU",
+        default=False,
+    )
     light_sampling_threshold: FloatProperty(
         name="Light Sampling Threshold",
         description="Probabilistically terminate light samples when the light contribution is below this threshold (more noise but faster rendering). "
@@ -691,6 +704,40 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default=0,
         min=0, max=16,
     )
+    shader_cache_directory: StringProperty(
+        name="Shader Cache",
+        description="Directory to store compiled shaders in, to skip compiling them when rendering "
+        "the same materials again. Only used for final renders with SVM shading, "
+        "shaders with images are not cached",
+        default="",
+        subtype='DIR_PATH',
+    )
+    use_compact_geometry: BoolProperty(
+        name="Compact Geometry",
+        description="Store vertex normals and UV maps in reduced precision to save memory, "
+        "at the cost of slightly less accurate shading normals and texture coordinates",
+        default=False,
+    )
+    use_texture_cache: BoolProperty(
+        name="Texture Cache",
+        description="Load image textures on demand, reading only the tiles that are sampled and "
+        "keeping their memory within the cache size. Only used for CPU rendering with SVM shading, "
+        "other images are fully loaded",
+        default=False,
+    )
+    texture_cache_size: IntProperty(
+        name="Cache Size",
+        description="Maximum memory used for tiles of image textures, in megabytes",
+        min=64, soft_max=65536,
+        default=1024,
+    )
+    texture_cache_directory: StringProperty(
+        name="Tiled Textures",
+        description="Directory to store image textures converted to tiled and mipmapped .tx files "
+        "in, which are faster to load on demand. Images are read as they are if empty",
+        default="",
+        subtype='DIR_PATH',
+    )
     tile_order: EnumProperty(
         name="Tile Order",
         description="Tile order for rendering",
@@ -829,7 +876,12 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         items=enum_bvh_layouts,
         default='EMBREE',
     )
-    debug_use_cpu_split_kernel: BoolProperty(name="Split Kernel", default=False)
+    debug_use_cpu_split_kernel: BoolProperty(
+        name="Split Kernel",
+        description="Trace a batch of paths per thread in stages, sorting them by shader before "
+        "shader evaluation, for more coherent memory access with many heavy shaders",
+        default=False,
+    )
 
     debug_use_cuda_adaptive_compile: BoolProperty(name="Adaptive Compile", default=False)
     debug_use_cuda_split_kernel: BoolProperty(name="Split Kernel", default=False)
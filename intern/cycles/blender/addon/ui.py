@@ -315,6 +315,11 @@ class CYCLES_RENDER_PT_sampling_advanced(CyclesButtonsPanel, Panel):
         col.prop(cscene, "min_transparent_bounces")
         col.prop(cscene, "light_sampling_threshold", text="Light Threshold")
 
+        if cscene.progressive == 'PATH' or not use_branched_path(context):
+            col.prop(cscene, "use_light_tree")
+            if use_cpu(context):
+                col.prop(cscene, "use_guiding")
+
         if cscene.progressive != 'PATH' and use_branched_path(context):
             col = layout.column(align=True)
             col.prop(cscene, "sample_all_lights_direct")
@@ -722,6 +727,7 @@ class CYCLES_RENDER_PT_performance_acceleration_structure(CyclesButtonsPanel, Pa
         sub = col.column()
         sub.active = not cscene.debug_use_spatial_splits and not use_embree
         sub.prop(cscene, "debug_bvh_time_steps")
+        col.prop(cscene, "use_compact_geometry")
 
 
 class CYCLES_RENDER_PT_performance_final_render(CyclesButtonsPanel, Panel):
@@ -735,12 +741,17 @@ class CYCLES_RENDER_PT_performance_final_render(CyclesButtonsPanel, Panel):
 
         scene = context.scene
         rd = scene.render
+        cscene = scene.cycles
 
         col = layout.column()
 
         col.prop(rd, "use_save_buffers")
         col.prop(rd, "use_persistent_data", text="Persistent Images")
 
+        sub = col.column()
+        sub.active = not cscene.shading_system
+        sub.prop(cscene, "shader_cache_directory")
+
 
 class CYCLES_RENDER_PT_performance_viewport(CyclesButtonsPanel, Panel):
     bl_label = "Viewport"
@@ -760,6 +771,34 @@ class CYCLES_RENDER_PT_performance_viewport(CyclesButtonsPanel, Panel):
         col.prop(cscene, "preview_start_resolution", text="Start Pixels")
 
 
+class CYCLES_RENDER_PT_performance_texture_cache(CyclesButtonsPanel, Panel):
+    bl_label = "Texture Cache"
+    bl_parent_id = "CYCLES_RENDER_PT_performance"
+    bl_options = {'DEFAULT_CLOSED'}
+
+    def draw_header(self, context):
+        layout = self.layout
+        scene = context.scene
+        cscene = scene.cycles
+
+        layout.active = use_cpu(context) and not cscene.shading_system
+        layout.prop(cscene, "use_texture_cache", text="")
+
+    def draw(self, context):
+        layout = self.layout
+        layout.use_property_split = True
+        layout.use_property_decorate = False
+
+        scene = context.scene
+        cscene = scene.cycles
+
+        layout.active = cscene.use_texture_cache and use_cpu(context) and not cscene.shading_system
+
+        col = layout.column()
+        col.prop(cscene, "texture_cache_size")
+        col.prop(cscene, "texture_cache_directory")
+
+
 class CYCLES_RENDER_PT_filter(CyclesButtonsPanel, Panel):
     bl_label = "Filter"
     bl_options = {'DEFAULT_CLOSED'}
@@ -2313,6 +2352,7 @@ classes = (
     CYCLES_RENDER_PT_performance_acceleration_structure,
     CYCLES_RENDER_PT_performance_final_render,
     CYCLES_RENDER_PT_performance_viewport,
+    CYCLES_RENDER_PT_performance_texture_cache,
     CYCLES_RENDER_PT_passes,
     CYCLES_RENDER_PT_passes_data,
     CYCLES_RENDER_PT_passes_light,
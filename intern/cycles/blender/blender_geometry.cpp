@@ -25,6 +25,7 @@
 #include "blender/blender_util.h"
 
 #include "util/util_foreach.h"
+#include "util/util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -136,18 +137,33 @@ Geometry *BlenderSync::sync_geometry(BL::Depsgraph &b_depsgraph,
 
   geom->name = ustring(b_ob_data.name().c_str());
 
-  if (geom_type == Geometry::HAIR) {
-    Hair *hair = static_cast<Hair *>(geom);
-    sync_hair(b_depsgraph, b_ob, hair, used_shaders);
-  }
-  else if (geom_type == Geometry::VOLUME) {
-    Volume *volume = static_cast<Volume *>(geom);
-    sync_volume(b_ob, volume, used_shaders);
-  }
-  else {
-    Mesh *mesh = static_cast<Mesh *>(geom);
-    sync_mesh(b_depsgraph, b_ob, mesh, used_shaders);
-  }
+  /* The geometry is always updated, object sync relies on this flag before the deferred
+   * conversion below tags the geometry itself. */
+  geom->need_update = true;
+
+  /* Convert the geometry later in parallel with other objects. The instance object is used
+   * since an instanced b_ob is only valid during the iteration over object instances. */
+  BL::Object b_ob_sync = b_ob_instance;
+  geometry_sync_tasks[b_ob_sync.ptr.data].push_back(
+      [this, b_depsgraph, b_ob_sync, geom, geom_type, used_shaders]() {
+        if (progress.get_cancel()) {
+          return;
+        }
+
+        if (geom_type == Geometry::HAIR) {
+          Hair *hair = static_cast<Hair *>(geom);
+          sync_hair(b_depsgraph, b_ob_sync, hair, used_shaders);
+        }
+        else if (geom_type == Geometry::VOLUME) {
+          Volume *volume = static_cast<Volume *>(geom);
+          BL::Object b_ob_volume = b_ob_sync;
+          sync_volume(b_ob_volume, volume, used_shaders);
+        }
+        else {
+          Mesh *mesh = static_cast<Mesh *>(geom);
+          sync_mesh(b_depsgraph, b_ob_sync, mesh, used_shaders);
+        }
+      });
 
   return geom;
 }
@@ -179,15 +195,47 @@ void BlenderSync::sync_geometry_motion(BL::Depsgraph &b_depsgraph,
 
   if (b_ob.type() == BL::Object::type_HAIR || use_particle_hair) {
     Hair *hair = static_cast<Hair *>(geom);
-    sync_hair_motion(b_depsgraph, b_ob, hair, motion_step);
+    geometry_sync_tasks[b_ob.ptr.data].push_back([this, b_depsgraph, b_ob, hair, motion_step]() {
+      if (!progress.get_cancel()) {
+        sync_hair_motion(b_depsgraph, b_ob, hair, motion_step);
+      }
+    });
   }
   else if (b_ob.type() == BL::Object::type_VOLUME || object_fluid_gas_domain_find(b_ob)) {
     /* No volume motion blur support yet. */
   }
   else {
     Mesh *mesh = static_cast<Mesh *>(geom);
-    sync_mesh_motion(b_depsgraph, b_ob, mesh, motion_step);
+    geometry_sync_tasks[b_ob.ptr.data].push_back([this, b_depsgraph, b_ob, mesh, motion_step]() {
+      if (!progress.get_cancel()) {
+        sync_mesh_motion(b_depsgraph, b_ob, mesh, motion_step);
+      }
+    });
+  }
+}
+
+void BlenderSync::sync_geometry_deferred()
+{
+  if (geometry_sync_tasks.empty()) {
+    return;
   }
+
+  progress.set_sync_status("Synchronizing geometry");
+
+  /* Objects are converted in parallel, the geometries of a single object one after the other.
+   * Only the geometry itself is modified here, other scene data was already synced. */
+  TaskPool pool;
+  for (auto &it : geometry_sync_tasks) {
+    vector<function<void()>> &tasks = it.second;
+    pool.push([&tasks]() {
+      foreach (function<void()> &task, tasks) {
+        task();
+      }
+    });
+  }
+  pool.wait_work();
+
+  geometry_sync_tasks.clear();
 }
 
 CCL_NAMESPACE_END
@@ -32,6 +32,7 @@
 #include "util/util_foreach.h"
 #include "util/util_hash.h"
 #include "util/util_logging.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -198,7 +199,7 @@ Object *BlenderSync::sync_object(BL::Depsgraph &b_depsgraph,
 
       /* mesh deformation */
       if (object->geometry)
-        sync_geometry_motion(b_depsgraph, b_ob, object, motion_time, use_particle_hair);
+        sync_geometry_motion(b_depsgraph, b_ob_instance, object, motion_time, use_particle_hair);
     }
 
     return object;
@@ -350,6 +351,7 @@ void BlenderSync::sync_objects(BL::Depsgraph &b_depsgraph,
   BlenderObjectCulling culling(scene, b_scene);
 
   /* object loop */
+  scoped_timer objects_timer;
   bool cancel = false;
   bool use_portal = false;
   const bool show_lights = BlenderViewportParameters(b_v3d).use_scene_lights;
@@ -399,6 +401,18 @@ void BlenderSync::sync_objects(BL::Depsgraph &b_depsgraph,
     cancel = progress.get_cancel();
   }
 
+  const double objects_time = objects_timer.get_time();
+
+  /* Geometry must be converted before removing unused geometry below. */
+  scoped_timer geometry_timer;
+  sync_geometry_deferred();
+  cancel = progress.get_cancel();
+
+  if (!motion) {
+    sync_stats.add_entry({"objects", objects_time});
+    sync_stats.add_entry({"geometry", geometry_timer.get_time()});
+  }
+
   progress.set_sync_status("");
 
   if (!cancel && !motion) {
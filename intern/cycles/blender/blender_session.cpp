@@ -121,7 +121,7 @@ void BlenderSession::create_session()
 {
   SessionParams session_params = BlenderSync::get_session_params(
       b_engine, b_userpref, b_scene, background);
-  SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+  SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
   bool session_pause = BlenderSync::get_session_pause(b_scene, background);
 
   /* reset status/progress */
@@ -210,7 +210,7 @@ void BlenderSession::reset_session(BL::BlendData &b_data, BL::Depsgraph &b_depsg
 
   SessionParams session_params = BlenderSync::get_session_params(
       b_engine, b_userpref, b_scene, background);
-  SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+  SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
 
   if (scene->params.modified(scene_params) || session->params.modified(session_params) ||
       !scene_params.persistent_data) {
@@ -573,6 +573,7 @@ void BlenderSession::render(BL::Depsgraph &b_depsgraph_)
     if (!b_engine.is_preview() && background && print_render_stats) {
       RenderStats stats;
       session->collect_statistics(&stats);
+      sync->collect_statistics(&stats);
       printf("Render statistics:\n%s\n", stats.full_report().c_str());
     }
 
@@ -779,7 +780,7 @@ void BlenderSession::synchronize(BL::Depsgraph &b_depsgraph_)
   /* on session/scene parameter changes, we recreate session entirely */
   SessionParams session_params = BlenderSync::get_session_params(
       b_engine, b_userpref, b_scene, background);
-  SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+  SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
   bool session_pause = BlenderSync::get_session_pause(b_scene, background);
 
   if (session->params.modified(session_params) || scene->params.modified(scene_params)) {
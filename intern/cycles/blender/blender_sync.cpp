@@ -222,21 +222,40 @@ void BlenderSync::sync_data(BL::RenderSettings &b_render,
 {
   scoped_timer timer;
 
+  sync_stats = NamedTimeStats();
+
   BL::ViewLayer b_view_layer = b_depsgraph.view_layer_eval();
 
-  sync_view_layer(b_v3d, b_view_layer);
-  sync_integrator();
-  sync_film(b_v3d);
-  sync_shaders(b_depsgraph, b_v3d);
-  sync_images();
+  {
+    scoped_callback_timer phase_timer(
+        [this](double time) { sync_stats.add_entry({"settings", time}); });
+    sync_view_layer(b_v3d, b_view_layer);
+    sync_integrator();
+    sync_film(b_v3d);
+  }
+  {
+    scoped_callback_timer phase_timer(
+        [this](double time) { sync_stats.add_entry({"shaders", time}); });
+    sync_shaders(b_depsgraph, b_v3d);
+  }
+  {
+    scoped_callback_timer phase_timer(
+        [this](double time) { sync_stats.add_entry({"images", time}); });
+    sync_images();
+  }
 
   geometry_synced.clear(); /* use for objects and motion sync */
 
+  /* Adds its own timings for objects and geometry. */
   if (scene->need_motion() == Scene::MOTION_PASS || scene->need_motion() == Scene::MOTION_NONE ||
       scene->camera->motion_position == Camera::MOTION_POSITION_CENTER) {
     sync_objects(b_depsgraph, b_v3d);
   }
-  sync_motion(b_render, b_depsgraph, b_v3d, b_override, width, height, python_thread_state);
+  {
+    scoped_callback_timer phase_timer(
+        [this](double time) { sync_stats.add_entry({"motion", time}); });
+    sync_motion(b_render, b_depsgraph, b_v3d, b_override, width, height, python_thread_state);
+  }
 
   geometry_synced.clear();
 
@@ -247,6 +266,12 @@ void BlenderSync::sync_data(BL::RenderSettings &b_render,
   free_data_after_sync(b_depsgraph);
 
   VLOG(1) << "Total time spent synchronizing data: " << timer.get_time();
+  VLOG(2) << "Synchronization statistics:\n" << sync_stats.full_report(1);
+}
+
+void BlenderSync::collect_statistics(RenderStats *stats)
+{
+  stats->sync = sync_stats;
 }
 
 /* Integrator */
@@ -312,6 +337,14 @@ void BlenderSync::sync_integrator()
   integrator->sample_all_lights_direct = get_boolean(cscene, "sample_all_lights_direct");
   integrator->sample_all_lights_indirect = get_boolean(cscene, "sample_all_lights_indirect");
   integrator->light_sampling_threshold = get_float(cscene, "light_sampling_threshold");
+  integrator->use_light_tree = get_boolean(cscene, "use_light_tree");
+  integrator->use_guiding = get_boolean(cscene, "use_guiding");
+
+  /* The light tree is built along with the light distribution. */
+  if (integrator->use_light_tree != previntegrator.use_light_tree ||
+      integrator->method != previntegrator.method) {
+    scene->light_manager->tag_update(scene);
+  }
 
   if (RNA_boolean_get(&cscene, "use_adaptive_sampling")) {
     integrator->sampling_pattern = SAMPLING_PATTERN_PMJ;
@@ -755,7 +788,9 @@ void BlenderSync::free_data_after_sync(BL::Depsgraph &b_depsgraph)
 
 /* Scene Parameters */
 
-SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene, bool background)
+SceneParams BlenderSync::get_scene_params(BL::BlendData &b_data,
+                                          BL::Scene &b_scene,
+                                          bool background)
 {
   BL::RenderSettings r = b_scene.render();
   SceneParams params;
@@ -802,6 +837,21 @@ SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene, bool background)
 
   params.bvh_layout = DebugFlags().cpu.bvh_layout;
 
+  /* Compiled shaders are always cached in memory, on disk only for final renders as well. */
+  const string shader_cache_path = get_string(cscene, "shader_cache_directory");
+  if (background && !shader_cache_path.empty()) {
+    params.shader_cache_path = blender_absolute_path(b_data, b_scene, shader_cache_path);
+  }
+
+  params.use_compact_geometry = get_boolean(cscene, "use_compact_geometry");
+
+  params.use_texture_cache = get_boolean(cscene, "use_texture_cache");
+  params.texture_cache_size = get_int(cscene, "texture_cache_size");
+  const string texture_cache_path = get_string(cscene, "texture_cache_directory");
+  if (!texture_cache_path.empty()) {
+    params.texture_cache_path = blender_absolute_path(b_data, b_scene, texture_cache_path);
+  }
+
   params.background = background;
 
   return params;
@@ -924,6 +974,13 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine &b_engine,
   BL::RenderSettings b_r = b_scene.render();
   params.progressive_refine = b_engine.is_preview() ||
                               get_boolean(cscene, "use_progressive_refine");
+
+  /* Path guiding learns from passes over the whole image. */
+  if (get_boolean(cscene, "use_guiding") && params.device.type == DEVICE_CPU &&
+      get_enum(cscene, "progressive") == Integrator::PATH) {
+    params.progressive_refine = true;
+  }
+
   if (b_r.use_save_buffers())
     params.progressive_refine = false;
 
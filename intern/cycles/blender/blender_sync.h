@@ -27,7 +27,9 @@
 
 #include "render/scene.h"
 #include "render/session.h"
+#include "render/stats.h"
 
+#include "util/util_function.h"
 #include "util/util_map.h"
 #include "util/util_set.h"
 #include "util/util_transform.h"
@@ -94,7 +96,7 @@ class BlenderSync {
   }
 
   /* get parameters */
-  static SceneParams get_scene_params(BL::Scene &b_scene, bool background);
+  static SceneParams get_scene_params(BL::BlendData &b_data, BL::Scene &b_scene, bool background);
   static SessionParams get_session_params(
       BL::RenderEngine &b_engine,
       BL::Preferences &b_userpref,
@@ -113,6 +115,9 @@ class BlenderSync {
   static PassType get_pass_type(BL::RenderPass &b_pass);
   static int get_denoising_pass(BL::RenderPass &b_pass);
 
+  /* Add timings of the last data synchronization to the statistics. */
+  void collect_statistics(RenderStats *stats);
+
  private:
   static DenoiseParams get_denoise_params(BL::Scene &b_scene,
                                           BL::ViewLayer &b_view_layer,
@@ -183,6 +188,7 @@ class BlenderSync {
                             Object *object,
                             float motion_time,
                             bool use_particle_hair);
+  void sync_geometry_deferred();
 
   /* Light */
   void sync_light(BL::Object &b_parent,
@@ -223,6 +229,10 @@ class BlenderSync {
   id_map<ParticleSystemKey, ParticleSystem> particle_system_map;
   set<Geometry *> geometry_synced;
   set<Geometry *> geometry_motion_synced;
+  /* Geometry conversion queued by sync_geometry, run in parallel once all objects are synced.
+   * Grouped by Blender object, since evaluating an object to a mesh is not thread safe. */
+  map<void *, vector<function<void()>>> geometry_sync_tasks;
+  NamedTimeStats sync_stats;
   set<float> motion_times;
   void *world_map;
   bool world_recalc;
@@ -33,6 +33,11 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* Rebuild a refitted BVH once its SAH cost grew by this factor compared to the build. */
+#define BVH_REFIT_MAX_SAH_RATIO 1.5f
+/* Without a SAH cost to compare against, rebuild after this many refits. */
+#define BVH_REFIT_MAX_COUNT 16
+
 /* BVH Parameters. */
 
 const char *bvh_layout_name(BVHLayout layout)
@@ -92,7 +97,12 @@ int BVHStackEntry::encodeIdx() const
 BVH::BVH(const BVHParams &params_,
          const vector<Geometry *> &geometry_,
          const vector<Object *> &objects_)
-    : params(params_), geometry(geometry_), objects(objects_)
+    : params(params_),
+      geometry(geometry_),
+      objects(objects_),
+      build_sah_cost(0.0f),
+      refit_sah_cost(0.0f),
+      num_refits(0)
 {
 }
 
@@ -174,6 +184,10 @@ void BVH::build(Progress &progress, Stats *)
   progress.set_substatus("Packing BVH nodes");
   pack_nodes(root);
 
+  build_sah_cost = root->computeSubtreeSAHCost(params);
+  refit_sah_cost = 0.0f;
+  num_refits = 0;
+
   /* free build nodes */
   root->deleteSubtree();
 }
@@ -190,6 +204,18 @@ void BVH::refit(Progress &progress)
 
   progress.set_substatus("Refitting BVH nodes");
   refit_nodes();
+  num_refits++;
+}
+
+bool BVH::refit_degraded() const
+{
+  if (num_refits == 0) {
+    return false;
+  }
+  if (build_sah_cost > 0.0f && refit_sah_cost > 0.0f) {
+    return refit_sah_cost > build_sah_cost * BVH_REFIT_MAX_SAH_RATIO;
+  }
+  return num_refits > BVH_REFIT_MAX_COUNT;
 }
 
 void BVH::refit_primitives(int start, int end, BoundBox &bbox, uint &visibility)
@@ -87,6 +87,13 @@ class BVH {
   vector<Geometry *> geometry;
   vector<Object *> objects;
 
+  /* SAH cost of the hierarchy when it was built and after the last refit, zero for layouts
+   * which do not expose their nodes. */
+  float build_sah_cost;
+  float refit_sah_cost;
+  /* Number of refits since the hierarchy was built. */
+  int num_refits;
+
   static BVH *create(const BVHParams &params,
                      const vector<Geometry *> &geometry,
                      const vector<Object *> &objects,
@@ -101,6 +108,9 @@ class BVH {
   }
 
   void refit(Progress &progress);
+  /* Refitting keeps the topology of the hierarchy, which gets less efficient as primitives
+   * move away from each other. True when it should be rebuilt instead. */
+  bool refit_degraded() const;
 
  protected:
   BVH(const BVHParams &params,
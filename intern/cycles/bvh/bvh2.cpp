@@ -241,10 +241,16 @@ void BVH2::refit_nodes()
 
   BoundBox bbox = BoundBox::empty;
   uint visibility = 0;
-  refit_node(0, (pack.root_index == -1) ? true : false, bbox, visibility);
+  float sah_cost = 0.0f;
+  refit_node(0, (pack.root_index == -1) ? true : false, bbox, visibility, sah_cost);
+
+  /* Same cost as BVHNode::computeSubtreeSAHCost(), so it can be compared to the build. */
+  const float root_area = bbox.safe_area();
+  refit_sah_cost = (root_area > 0.0f) ? sah_cost / root_area : 0.0f;
 }
 
-void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
+/* Refit the node and its children, accumulating their SAH cost weighted by surface area. */
+void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility, float &sah_cost)
 {
   if (leaf) {
     /* refit leaf node */
@@ -254,6 +260,7 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     const int c1 = data[0].y;
 
     BVH::refit_primitives(c0, c1, bbox, visibility);
+    sah_cost += bbox.safe_area() * params.cost(0, c1 - c0);
 
     /* TODO(sergey): De-duplicate with pack_leaf(). */
     float4 leaf_data[BVH_NODE_LEAF_SIZE];
@@ -274,8 +281,8 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     BoundBox bbox0 = BoundBox::empty, bbox1 = BoundBox::empty;
     uint visibility0 = 0, visibility1 = 0;
 
-    refit_node((c0 < 0) ? -c0 - 1 : c0, (c0 < 0), bbox0, visibility0);
-    refit_node((c1 < 0) ? -c1 - 1 : c1, (c1 < 0), bbox1, visibility1);
+    refit_node((c0 < 0) ? -c0 - 1 : c0, (c0 < 0), bbox0, visibility0, sah_cost);
+    refit_node((c1 < 0) ? -c1 - 1 : c1, (c1 < 0), bbox1, visibility1, sah_cost);
 
     if (is_unaligned) {
       Transform aligned_space = transform_identity();
@@ -289,6 +296,7 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     bbox.grow(bbox0);
     bbox.grow(bbox1);
     visibility = visibility0 | visibility1;
+    sah_cost += bbox.safe_area() * params.cost(2, 0);
   }
 }
 
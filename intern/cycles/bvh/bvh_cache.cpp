@@ -0,0 +1,274 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bvh/bvh_cache.h"
+#include "bvh/bvh.h"
+#include "bvh/bvh_params.h"
+
+#include "render/attribute.h"
+#include "render/hair.h"
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+CCL_NAMESPACE_BEGIN
+
+/* Increase when changing the file format or the way BVHs are built. */
+#define BVH_CACHE_VERSION 2
+
+static const char bvh_cache_magic[8] = {'C', 'Y', 'C', 'L', 'B', 'V', 'H', '\0'};
+
+/* Key */
+
+template<typename T> static void bvh_cache_hash(MD5Hash &md5, const T &value)
+{
+  md5.append((const uint8_t *)&value, sizeof(value));
+}
+
+template<typename T> static void bvh_cache_hash_array(MD5Hash &md5, const array<T> &data)
+{
+  bvh_cache_hash(md5, (uint64_t)data.size());
+
+  /* Appending takes an int size. */
+  const size_t chunk_size = 64 * 1024 * 1024;
+  const uint8_t *bytes = (const uint8_t *)data.data();
+  const size_t num_bytes = data.size() * sizeof(T);
+  for (size_t start = 0; start < num_bytes; start += chunk_size) {
+    md5.append(bytes + start, (int)std::min(chunk_size, num_bytes - start));
+  }
+}
+
+/* Only hash the x, y and z components, the fourth component of float3 is not initialized by
+ * all arithmetic. */
+static void bvh_cache_hash_float3(MD5Hash &md5, const float3 *data, size_t size)
+{
+  const size_t chunk_size = 1024;
+  float chunk[chunk_size * 3];
+
+  bvh_cache_hash(md5, (uint64_t)size);
+
+  for (size_t start = 0; start < size; start += chunk_size) {
+    const size_t end = std::min(start + chunk_size, size);
+    for (size_t i = start; i < end; i++) {
+      chunk[(i - start) * 3 + 0] = data[i].x;
+      chunk[(i - start) * 3 + 1] = data[i].y;
+      chunk[(i - start) * 3 + 2] = data[i].z;
+    }
+    md5.append((const uint8_t *)chunk, (end - start) * 3 * sizeof(float));
+  }
+}
+
+static void bvh_cache_hash_motion(MD5Hash &md5, const Geometry *geom, size_t num_verts)
+{
+  bvh_cache_hash(md5, geom->has_motion_blur());
+  if (!geom->has_motion_blur()) {
+    return;
+  }
+
+  bvh_cache_hash(md5, (uint)geom->motion_steps);
+  const Attribute *attr_mP = geom->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
+  bvh_cache_hash_float3(md5, attr_mP->data_float3(), num_verts * (geom->motion_steps - 1));
+}
+
+static void bvh_cache_hash_params(MD5Hash &md5, const BVHParams &params)
+{
+  bvh_cache_hash(md5, params.use_spatial_split);
+  bvh_cache_hash(md5, params.spatial_split_alpha);
+  bvh_cache_hash(md5, params.unaligned_split_threshold);
+  bvh_cache_hash(md5, params.sah_node_cost);
+  bvh_cache_hash(md5, params.sah_primitive_cost);
+  bvh_cache_hash(md5, params.min_leaf_size);
+  bvh_cache_hash(md5, params.max_triangle_leaf_size);
+  bvh_cache_hash(md5, params.max_motion_triangle_leaf_size);
+  bvh_cache_hash(md5, params.max_curve_leaf_size);
+  bvh_cache_hash(md5, params.max_motion_curve_leaf_size);
+  bvh_cache_hash(md5, params.top_level);
+  bvh_cache_hash(md5, params.bvh_layout);
+  bvh_cache_hash(md5, params.use_unaligned_nodes);
+  bvh_cache_hash(md5, params.num_motion_curve_steps);
+  bvh_cache_hash(md5, params.num_motion_triangle_steps);
+  bvh_cache_hash(md5, params.bvh_type);
+  bvh_cache_hash(md5, params.curve_subdivisions);
+}
+
+/* Packing stores the tracing visibility of the objects in the primitives and nodes, and the
+ * index of the object in the primitives. */
+static void bvh_cache_hash_objects(MD5Hash &md5, const vector<Object *> &objects)
+{
+  bvh_cache_hash(md5, (uint64_t)objects.size());
+  foreach (const Object *object, objects) {
+    bvh_cache_hash(md5, object->visibility_for_tracing());
+  }
+}
+
+string BVHCache::key(const Geometry *geom,
+                     const vector<Object *> &objects,
+                     const BVHParams &params)
+{
+  if (params.bvh_layout != BVH_LAYOUT_BVH2 || params.top_level) {
+    return "";
+  }
+
+  MD5Hash md5;
+  bvh_cache_hash(md5, (int)BVH_CACHE_VERSION);
+  bvh_cache_hash_params(md5, params);
+  bvh_cache_hash_objects(md5, objects);
+  bvh_cache_hash(md5, (int)geom->type);
+
+  if (geom->type == Geometry::HAIR) {
+    const Hair *hair = static_cast<const Hair *>(geom);
+    bvh_cache_hash(md5, (int)hair->curve_shape);
+    bvh_cache_hash_float3(md5, hair->curve_keys.data(), hair->curve_keys.size());
+    bvh_cache_hash_array(md5, hair->curve_radius);
+    bvh_cache_hash_array(md5, hair->curve_first_key);
+    bvh_cache_hash_motion(md5, hair, hair->curve_keys.size());
+  }
+  else {
+    const Mesh *mesh = static_cast<const Mesh *>(geom);
+    bvh_cache_hash_float3(md5, mesh->verts.data(), mesh->verts.size());
+    bvh_cache_hash_array(md5, mesh->triangles);
+    bvh_cache_hash_motion(md5, mesh, mesh->verts.size());
+  }
+
+  return md5.get_hex();
+}
+
+/* Read and Write */
+
+BVHCache::BVHCache(const string &directory) : directory(directory)
+{
+}
+
+string BVHCache::filepath(const string &key) const
+{
+  return path_join(directory, key + ".bvh");
+}
+
+template<typename T> static bool bvh_cache_write_array(FILE *f, const array<T> &data)
+{
+  const uint64_t size = data.size();
+  if (fwrite(&size, sizeof(size), 1, f) != 1) {
+    return false;
+  }
+  return (size == 0) || (fwrite(data.data(), sizeof(T), size, f) == size);
+}
+
+template<typename T> static bool bvh_cache_read_array(FILE *f, array<T> &data)
+{
+  uint64_t size;
+  if (fread(&size, sizeof(size), 1, f) != 1) {
+    return false;
+  }
+  /* Read directly into the array, the cache can be large. */
+  data.resize(size);
+  return (size == 0) || (fread(data.data(), sizeof(T), size, f) == size);
+}
+
+bool BVHCache::read(const string &key, PackedBVH &pack) const
+{
+  const string path = filepath(key);
+  FILE *f = path_fopen(path, "rb");
+  if (!f) {
+    return false;
+  }
+
+  char magic[sizeof(bvh_cache_magic)];
+  int version;
+  bool ok = fread(magic, sizeof(magic), 1, f) == 1 &&
+            memcmp(magic, bvh_cache_magic, sizeof(magic)) == 0 &&
+            fread(&version, sizeof(version), 1, f) == 1 && version == BVH_CACHE_VERSION &&
+            fread(&pack.root_index, sizeof(pack.root_index), 1, f) == 1;
+
+  ok = ok && bvh_cache_read_array(f, pack.nodes);
+  ok = ok && bvh_cache_read_array(f, pack.leaf_nodes);
+  ok = ok && bvh_cache_read_array(f, pack.object_node);
+  ok = ok && bvh_cache_read_array(f, pack.prim_tri_index);
+  ok = ok && bvh_cache_read_array(f, pack.prim_tri_verts);
+  ok = ok && bvh_cache_read_array(f, pack.prim_type);
+  ok = ok && bvh_cache_read_array(f, pack.prim_visibility);
+  ok = ok && bvh_cache_read_array(f, pack.prim_index);
+  ok = ok && bvh_cache_read_array(f, pack.prim_object);
+  ok = ok && bvh_cache_read_array(f, pack.prim_time);
+
+  fclose(f);
+
+  if (!ok) {
+    VLOG(1) << "Failed to read cached BVH " << path << ", rebuilding.";
+    pack = PackedBVH();
+    return false;
+  }
+
+  VLOG(2) << "Read cached BVH " << path << ".";
+  return true;
+}
+
+bool BVHCache::write(const string &key, const PackedBVH &pack) const
+{
+  const string path = filepath(key);
+  path_create_directories(path);
+
+  /* Write to a temporary file first, so other renders using the same cache directory never
+   * read a partially written BVH. */
+  std::random_device random;
+  const string temp_path = string_printf("%s.%08x.tmp", path.c_str(), random());
+
+  FILE *f = path_fopen(temp_path, "wb");
+  if (!f) {
+    VLOG(1) << "Failed to open " << temp_path << " for writing BVH cache.";
+    return false;
+  }
+
+  const int version = BVH_CACHE_VERSION;
+  bool ok = fwrite(bvh_cache_magic, sizeof(bvh_cache_magic), 1, f) == 1 &&
+            fwrite(&version, sizeof(version), 1, f) == 1 &&
+            fwrite(&pack.root_index, sizeof(pack.root_index), 1, f) == 1;
+
+  ok = ok && bvh_cache_write_array(f, pack.nodes);
+  ok = ok && bvh_cache_write_array(f, pack.leaf_nodes);
+  ok = ok && bvh_cache_write_array(f, pack.object_node);
+  ok = ok && bvh_cache_write_array(f, pack.prim_tri_index);
+  ok = ok && bvh_cache_write_array(f, pack.prim_tri_verts);
+  ok = ok && bvh_cache_write_array(f, pack.prim_type);
+  ok = ok && bvh_cache_write_array(f, pack.prim_visibility);
+  ok = ok && bvh_cache_write_array(f, pack.prim_index);
+  ok = ok && bvh_cache_write_array(f, pack.prim_object);
+  ok = ok && bvh_cache_write_array(f, pack.prim_time);
+
+  ok = (fclose(f) == 0) && ok;
+
+  /* Renaming fails on some platforms when another render already wrote the same BVH, which is
+   * fine since it is identical. */
+  if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+    path_remove(temp_path);
+    if (!ok) {
+      VLOG(1) << "Failed to write BVH cache " << path << ".";
+    }
+    return false;
+  }
+
+  VLOG(2) << "Wrote cached BVH " << path << ".";
+  return true;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BVH_CACHE_H__
+#define __BVH_CACHE_H__
+
+#include "util/util_string.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class BVHParams;
+class Geometry;
+class Object;
+struct PackedBVH;
+
+/* BVH Cache
+ *
+ * Stores the packed BVH of geometry in a directory on disk, keyed by a hash of the geometry,
+ * the objects it is packed for and the build parameters, so rendering the same geometry again
+ * can skip building it. Only the BVH2 layout is stored, Embree and OptiX build their own
+ * acceleration structures. */
+
+class BVHCache {
+ public:
+  explicit BVHCache(const string &directory);
+
+  /* Key identifying the BVH built for the geometry and objects, empty if it can not be
+   * cached. */
+  static string key(const Geometry *geom,
+                    const vector<Object *> &objects,
+                    const BVHParams &params);
+
+  /* Read the BVH into pack, returns false if it is not in the cache or can not be read. */
+  bool read(const string &key, PackedBVH &pack) const;
+  /* Write the BVH to the cache, replacing any previous one with the same key. */
+  bool write(const string &key, const PackedBVH &pack) const;
+
+ protected:
+  string filepath(const string &key) const;
+
+  string directory;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __BVH_CACHE_H__ */
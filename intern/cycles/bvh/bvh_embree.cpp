@@ -924,7 +924,8 @@ void BVHEmbree::pack_nodes(const BVHNode *)
 
 void BVHEmbree::refit_nodes()
 {
-  /* Update all vertex buffers, then tell Embree to rebuild/-fit the BVHs. */
+  /* Update all vertex buffers, then tell Embree to refit the BVHs. Only the vertex positions
+   * changed, so triangle BVHs are refitted instead of being rebuilt. */
   unsigned geom_id = 0;
   foreach (Object *ob, objects) {
     if (!params.top_level || (ob->is_traceable() && !ob->geometry->is_instanced())) {
@@ -933,8 +934,10 @@ void BVHEmbree::refit_nodes()
       if (geom->type == Geometry::MESH || geom->type == Geometry::VOLUME) {
         Mesh *mesh = static_cast<Mesh *>(geom);
         if (mesh->num_triangles() > 0) {
-          update_tri_vertex_buffer(rtcGetGeometry(scene, geom_id), mesh);
-          rtcCommitGeometry(rtcGetGeometry(scene, geom_id));
+          RTCGeometry rtc_geom = rtcGetGeometry(scene, geom_id);
+          update_tri_vertex_buffer(rtc_geom, mesh);
+          rtcSetGeometryBuildQuality(rtc_geom, RTC_BUILD_QUALITY_REFIT);
+          rtcCommitGeometry(rtc_geom);
         }
       }
       else if (geom->type == Geometry::HAIR) {
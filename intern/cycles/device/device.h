@@ -371,6 +371,13 @@ class Device {
     return NULL;
   }
 
+  /* OpenImageIO texture system for images loaded on demand, only for CPU device. Returns false
+   * if the device can't use it, in which case images must be fully loaded. */
+  virtual bool set_texture_system(void * /*texture_system*/)
+  {
+    return false;
+  }
+
   /* Device specific pointer for BVH creation. Currently only used by Embree. */
   virtual void *bvh_device() const
   {
@@ -309,6 +309,7 @@ class CPUDevice : public Device {
 #ifdef WITH_OSL
     kernel_globals.osl = &osl_globals;
 #endif
+    kernel_globals.texture_system = NULL;
 #ifdef WITH_EMBREE
     embree_device = rtcNewDevice("verbose=0");
 #endif
@@ -528,6 +529,12 @@ class CPUDevice : public Device {
     }
   }
 
+  virtual bool set_texture_system(void *texture_system) override
+  {
+    kernel_globals.texture_system = texture_system;
+    return true;
+  }
+
   virtual void *osl_memory() override
   {
 #ifdef WITH_OSL
@@ -1455,6 +1462,7 @@ class CPUDevice : public Device {
     }
     kg.decoupled_volume_steps_index = 0;
     kg.coverage_asset = kg.coverage_object = kg.coverage_material = NULL;
+    kg.texture_thread_info = NULL;
 #ifdef WITH_OSL
     OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
@@ -1597,7 +1605,10 @@ int2 CPUSplitKernel::split_kernel_global_size(device_memory & /*kg*/,
                                               device_memory & /*data*/,
                                               DeviceTask & /*task*/)
 {
-  return make_int2(1, 1);
+  /* Number of paths each thread traces together, matching one shader sort block. Enough for
+   * sorting rays by shader to make shader evaluation coherent, while the state of all paths
+   * stays small enough for the caches of a single core. */
+  return make_int2(64, SHADER_SORT_BLOCK_SIZE / 64);
 }
 
 uint64_t CPUSplitKernel::state_buffer_size(device_memory &kernel_globals,
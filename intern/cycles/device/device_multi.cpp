@@ -252,6 +252,15 @@ class MultiDevice : public Device {
     return devices.front().device->osl_memory();
   }
 
+  virtual bool set_texture_system(void *texture_system)
+  {
+    bool result = true;
+    foreach (SubDevice &sub, devices) {
+      result &= sub.device->set_texture_system(texture_system);
+    }
+    return result;
+  }
+
   bool is_resident(device_ptr key, Device *sub_device)
   {
     foreach (SubDevice &sub, devices) {
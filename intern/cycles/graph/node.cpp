@@ -511,6 +511,24 @@ void float3_array_hash(const Node *node, const SocketType &socket, MD5Hash &md5)
   }
 }
 
+/* Hash the string contents rather than the ustring pointer, so hashes are the same across
+ * processes. */
+void ustring_hash(const Node *node, const SocketType &socket, MD5Hash &md5)
+{
+  const ustring &value = *(const ustring *)(((char *)node) + socket.struct_offset);
+  md5.append(value.string());
+  md5.append((const uint8_t *)"", 1);
+}
+
+void ustring_array_hash(const Node *node, const SocketType &socket, MD5Hash &md5)
+{
+  const array<ustring> &a = *(const array<ustring> *)(((char *)node) + socket.struct_offset);
+  for (size_t i = 0; i < a.size(); i++) {
+    md5.append(a[i].string());
+    md5.append((const uint8_t *)"", 1);
+  }
+}
+
 }  // namespace
 
 void Node::hash(MD5Hash &md5)
@@ -551,7 +569,7 @@ void Node::hash(MD5Hash &md5)
       case SocketType::CLOSURE:
         break;
       case SocketType::STRING:
-        value_hash<ustring>(this, socket, md5);
+        ustring_hash(this, socket, md5);
         break;
       case SocketType::ENUM:
         value_hash<int>(this, socket, md5);
@@ -588,7 +606,7 @@ void Node::hash(MD5Hash &md5)
         array_hash<float2>(this, socket, md5);
         break;
       case SocketType::STRING_ARRAY:
-        array_hash<ustring>(this, socket, md5);
+        ustring_array_hash(this, socket, md5);
         break;
       case SocketType::TRANSFORM_ARRAY:
         array_hash<Transform>(this, socket, md5);
@@ -88,6 +88,30 @@ ccl_device_inline AttributeDescriptor find_attribute(KernelGlobals *kg,
   return desc;
 }
 
+/* Float2 attribute element, which may be stored as two half floats packed into the float
+ * attribute texture to save memory. Half floats are written flushing denormals to zero. */
+
+ccl_device_inline float attribute_half_to_float(uint h)
+{
+  const uint sign = (h & 0x8000) << 16;
+  if ((h & 0x7C00) == 0) {
+    return __uint_as_float(sign);
+  }
+  return __uint_as_float(sign | (((h & 0x7FFF) + 0x1C000) << 13));
+}
+
+ccl_device_inline float2 attribute_float2_fetch(KernelGlobals *kg,
+                                                const AttributeDescriptor desc,
+                                                int index)
+{
+  if (desc.flags & ATTR_HALF_FLOAT) {
+    const uint packed = __float_as_uint(kernel_tex_fetch(__attributes_float, index));
+    return make_float2(attribute_half_to_float(packed & 0xFFFF),
+                       attribute_half_to_float(packed >> 16));
+  }
+  return kernel_tex_fetch(__attributes_float2, index);
+}
+
 /* Transform matrix attribute on meshes */
 
 ccl_device Transform primitive_attribute_matrix(KernelGlobals *kg,
@@ -96,7 +96,7 @@ ccl_device float2 curve_attribute_float2(KernelGlobals *kg,
       *dy = make_float2(0.0f, 0.0f);
 #  endif
 
-    return kernel_tex_fetch(__attributes_float2, desc.offset + sd->prim);
+    return attribute_float2_fetch(kg, desc, desc.offset + sd->prim);
   }
   else if (desc.element == ATTR_ELEMENT_CURVE_KEY ||
            desc.element == ATTR_ELEMENT_CURVE_KEY_MOTION) {
@@ -104,8 +104,8 @@ ccl_device float2 curve_attribute_float2(KernelGlobals *kg,
     int k0 = __float_as_int(curvedata.x) + PRIMITIVE_UNPACK_SEGMENT(sd->type);
     int k1 = k0 + 1;
 
-    float2 f0 = kernel_tex_fetch(__attributes_float2, desc.offset + k0);
-    float2 f1 = kernel_tex_fetch(__attributes_float2, desc.offset + k1);
+    float2 f0 = attribute_float2_fetch(kg, desc, desc.offset + k0);
+    float2 f1 = attribute_float2_fetch(kg, desc, desc.offset + k1);
 
 #  ifdef __RAY_DIFFERENTIALS__
     if (dx)
@@ -124,7 +124,7 @@ ccl_device float2 curve_attribute_float2(KernelGlobals *kg,
       *dy = make_float2(0.0f, 0.0f);
 #  endif
 
-    return kernel_tex_fetch(__attributes_float2, desc.offset);
+    return attribute_float2_fetch(kg, desc, desc.offset);
   }
   else {
 #  ifdef __RAY_DIFFERENTIALS__
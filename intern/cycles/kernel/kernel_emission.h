@@ -98,6 +98,22 @@ ccl_device_noinline_cpu float3 direct_emissive_eval(KernelGlobals *kg,
   return eval;
 }
 
+/* Evaluate the BSDF for a light sample, weighted against the pdf bounces are sampled with. */
+ccl_device_inline void direct_emission_bsdf_eval(KernelGlobals *kg,
+                                                 ShaderData *sd,
+                                                 LightSample *ls,
+                                                 BsdfEval *eval)
+{
+#ifdef __PATH_GUIDING__
+  if (kernel_data.integrator.use_guiding) {
+    guiding_bsdf_eval(kg, sd, ls->D, eval, ls->pdf, ls->shader & SHADER_USE_MIS);
+    return;
+  }
+#endif
+
+  shader_bsdf_eval(kg, sd, ls->D, eval, ls->pdf, ls->shader & SHADER_USE_MIS);
+}
+
 ccl_device_noinline_cpu bool direct_emission(KernelGlobals *kg,
                                              ShaderData *sd,
                                              ShaderData *emission_sd,
@@ -126,7 +142,7 @@ ccl_device_noinline_cpu bool direct_emission(KernelGlobals *kg,
 
 #ifdef __VOLUME__
   if (sd->prim != PRIM_NONE)
-    shader_bsdf_eval(kg, sd, ls->D, eval, ls->pdf, ls->shader & SHADER_USE_MIS);
+    direct_emission_bsdf_eval(kg, sd, ls, eval);
   else {
     float bsdf_pdf;
     shader_volume_phase_eval(kg, sd, ls->D, eval, &bsdf_pdf);
@@ -137,7 +153,7 @@ ccl_device_noinline_cpu bool direct_emission(KernelGlobals *kg,
     }
   }
 #else
-  shader_bsdf_eval(kg, sd, ls->D, eval, ls->pdf, ls->shader & SHADER_USE_MIS);
+  direct_emission_bsdf_eval(kg, sd, ls, eval);
 #endif
 
   bsdf_eval_mul3(eval, light_eval / ls->pdf);
@@ -64,6 +64,11 @@ typedef struct KernelGlobals {
   OSLThreadData *osl_tdata;
 #  endif
 
+  /* OpenImageIO texture system for images loaded on demand, and the per-thread data it uses
+   * for lookups from this thread. */
+  void *texture_system;
+  void *texture_thread_info;
+
   /* **** Run-time data ****  */
 
   /* Heap-allocated storage for transparent shadows intersections. */
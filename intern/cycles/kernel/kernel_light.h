@@ -15,6 +15,7 @@
  */
 
 #include "kernel_light_background.h"
+#include "kernel_light_tree.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -35,6 +36,66 @@ typedef struct LightSample {
   LightType type; /* type of light */
 } LightSample;
 
+/* Light Selection */
+
+/* Index of a lamp in the light distribution, lamps follow the mesh light triangles. */
+ccl_device_inline int light_distribution_lamp_index(KernelGlobals *kg, int lamp)
+{
+  return kernel_data.integrator.num_distribution - kernel_data.integrator.num_all_lights + lamp;
+}
+
+/* Index of a mesh light triangle in the light distribution, which is sorted by object and
+ * primitive. */
+ccl_device int light_distribution_triangle_index(KernelGlobals *kg, int object, int prim)
+{
+  int first = 0;
+  int len = kernel_data.integrator.num_distribution - kernel_data.integrator.num_all_lights;
+
+  while (len > 0) {
+    int half_len = len >> 1;
+    int middle = first + half_len;
+    const ccl_global KernelLightDistribution *kdistribution = &kernel_tex_fetch(
+        __light_distribution, middle);
+    int middle_object = kdistribution->mesh_light.object_id;
+
+    if (middle_object < object || (middle_object == object && kdistribution->prim < prim)) {
+      first = middle + 1;
+      len = len - half_len - 1;
+    }
+    else {
+      len = half_len;
+    }
+  }
+
+  return first;
+}
+
+/* Probability of selecting the lamp when sampling a single light for a shading point at P. */
+ccl_device_inline float lamp_light_select_pdf(KernelGlobals *kg,
+                                              int lamp,
+                                              LightType type,
+                                              float3 P)
+{
+  if (kernel_data.integrator.use_light_tree && type != LIGHT_DISTANT &&
+      type != LIGHT_BACKGROUND) {
+    return light_tree_pdf(kg, P, light_distribution_lamp_index(kg, lamp));
+  }
+
+  return kernel_data.integrator.pdf_lights;
+}
+
+/* Probability of selecting the triangle when sampling a single light for a shading point at P,
+ * with the area of the triangle the light distribution was built from. */
+ccl_device_inline float triangle_light_select_pdf(
+    KernelGlobals *kg, int object, int prim, float area, float3 P)
+{
+  if (kernel_data.integrator.use_light_tree) {
+    return light_tree_pdf(kg, P, light_distribution_triangle_index(kg, object, prim));
+  }
+
+  return area * kernel_data.integrator.pdf_triangles;
+}
+
 /* Regular Light */
 
 ccl_device_inline bool lamp_light_sample(
@@ -153,8 +214,7 @@ ccl_device_inline bool lamp_light_sample(
     }
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
-
+  /* The probability of selecting the lamp is applied by light_sample. */
   return (ls->pdf > 0.0f);
 }
 
@@ -291,7 +351,7 @@ ccl_device bool lamp_light_eval(
     return false;
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= lamp_light_select_pdf(kg, lamp, type, P);
 
   return true;
 }
@@ -328,12 +388,12 @@ ccl_device_inline bool triangle_world_space_vertices(
   return has_motion;
 }
 
-ccl_device_inline float triangle_light_pdf_area(KernelGlobals *kg,
-                                                const float3 Ng,
+/* Convert a pdf over the area of the triangle to solid angle. */
+ccl_device_inline float triangle_light_pdf_area(const float3 Ng,
                                                 const float3 I,
-                                                float t)
+                                                float t,
+                                                float pdf)
 {
-  float pdf = kernel_data.integrator.pdf_triangles;
   float cos_pi = fabsf(dot(Ng, I));
 
   if (cos_pi == 0.0f)
@@ -358,10 +418,11 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
   const float3 N = cross(e0, e1);
   const float distance_to_plane = fabsf(dot(N, sd->I * t)) / dot(N, N);
 
+  /* sd contains the point on the light source
+   * calculate Px, the point that we're shading */
+  const float3 Px = sd->P + sd->I * t;
+
   if (longest_edge_squared > distance_to_plane * distance_to_plane) {
-    /* sd contains the point on the light source
-     * calculate Px, the point that we're shading */
-    const float3 Px = sd->P + sd->I * t;
     const float3 v0_p = V[0] - Px;
     const float3 v1_p = V[1] - Px;
     const float3 v2_p = V[2] - Px;
@@ -389,12 +450,21 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
       else {
         area = 0.5f * len(N);
       }
-      const float pdf = area * kernel_data.integrator.pdf_triangles;
+      const float pdf = triangle_light_select_pdf(kg, sd->object, sd->prim, area, Px);
       return pdf / solid_angle;
     }
   }
+  else if (kernel_data.integrator.use_light_tree) {
+    const float area = 0.5f * len(N);
+    if (UNLIKELY(area == 0.0f)) {
+      return 0.0f;
+    }
+    const float pdf = light_tree_pdf(
+        kg, Px, light_distribution_triangle_index(kg, sd->object, sd->prim));
+    return triangle_light_pdf_area(sd->Ng, sd->I, t, pdf / area);
+  }
   else {
-    float pdf = triangle_light_pdf_area(kg, sd->Ng, sd->I, t);
+    float pdf = triangle_light_pdf_area(sd->Ng, sd->I, t, kernel_data.integrator.pdf_triangles);
     if (has_motion) {
       const float area = 0.5f * len(N);
       if (UNLIKELY(area == 0.0f)) {
@@ -418,7 +488,8 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg,
                                                   float randv,
                                                   float time,
                                                   LightSample *ls,
-                                                  const float3 P)
+                                                  const float3 P,
+                                                  float tree_pdf)
 {
   /* A naive heuristic to decide between costly solid angle sampling
    * and simple area sampling, comparing the distance to the triangle plane
@@ -542,7 +613,9 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg,
         triangle_world_space_vertices(kg, object, prim, -1.0f, V);
         area = triangle_area(V[0], V[1], V[2]);
       }
-      const float pdf = area * kernel_data.integrator.pdf_triangles;
+      const float pdf = kernel_data.integrator.use_light_tree ?
+                            tree_pdf :
+                            area * kernel_data.integrator.pdf_triangles;
       ls->pdf = pdf / solid_angle;
     }
   }
@@ -564,14 +637,21 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg,
     ls->P = u * V[0] + v * V[1] + t * V[2];
     /* compute incoming direction, distance and pdf */
     ls->D = normalize_len(ls->P - P, &ls->t);
-    ls->pdf = triangle_light_pdf_area(kg, ls->Ng, -ls->D, ls->t);
-    if (has_motion && area != 0.0f) {
-      /* scale the PDF.
-       * area = the area the sample was taken from
-       * area_pre = the are from which pdf_triangles was calculated from */
-      triangle_world_space_vertices(kg, object, prim, -1.0f, V);
-      const float area_pre = triangle_area(V[0], V[1], V[2]);
-      ls->pdf = ls->pdf * area_pre / area;
+    if (kernel_data.integrator.use_light_tree) {
+      ls->pdf = (area != 0.0f) ? triangle_light_pdf_area(ls->Ng, -ls->D, ls->t, tree_pdf / area) :
+                                 0.0f;
+    }
+    else {
+      ls->pdf = triangle_light_pdf_area(
+          ls->Ng, -ls->D, ls->t, kernel_data.integrator.pdf_triangles);
+      if (has_motion && area != 0.0f) {
+        /* scale the PDF.
+         * area = the area the sample was taken from
+         * area_pre = the are from which pdf_triangles was calculated from */
+        triangle_world_space_vertices(kg, object, prim, -1.0f, V);
+        const float area_pre = triangle_area(V[0], V[1], V[2]);
+        ls->pdf = ls->pdf * area_pre / area;
+      }
     }
     ls->u = u;
     ls->v = v;
@@ -632,9 +712,21 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
                                       int bounce,
                                       LightSample *ls)
 {
+  /* Probability of selecting the light, lamps without the light tree all have the same. */
+  float select_pdf = kernel_data.integrator.pdf_lights;
+
   if (lamp < 0) {
     /* sample index */
-    int index = light_distribution_sample(kg, &randu);
+    int index;
+    if (kernel_data.integrator.use_light_tree) {
+      index = light_tree_sample(kg, P, &randu, &select_pdf);
+      if (index < 0) {
+        return false;
+      }
+    }
+    else {
+      index = light_distribution_sample(kg, &randu);
+    }
 
     /* fetch light data */
     const ccl_global KernelLightDistribution *kdistribution = &kernel_tex_fetch(
@@ -645,7 +737,7 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
       int object = kdistribution->mesh_light.object_id;
       int shader_flag = kdistribution->mesh_light.shader_flag;
 
-      triangle_light_sample(kg, prim, object, randu, randv, time, ls, P);
+      triangle_light_sample(kg, prim, object, randu, randv, time, ls, P, select_pdf);
       ls->shader |= shader_flag;
       return (ls->pdf > 0.0f);
     }
@@ -657,7 +749,12 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
     return false;
   }
 
-  return lamp_light_sample(kg, lamp, randu, randv, P, ls);
+  if (!lamp_light_sample(kg, lamp, randu, randv, P, ls)) {
+    return false;
+  }
+
+  ls->pdf *= select_pdf;
+  return (ls->pdf > 0.0f);
 }
 
 ccl_device_inline int light_select_num_samples(KernelGlobals *kg, int index)
@@ -0,0 +1,259 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree
+ *
+ * Chooses an emitter proportional to an estimate of its contribution to the shading point,
+ * using a bounding volume hierarchy over all lamps and mesh light triangles, as described in
+ * "Importance Sampling of Many Lights with Adaptive Tree Splitting" by Conty Estevez and Kulla.
+ *
+ * Distant and background lights are not in the tree, they are picked uniformly with a fixed
+ * probability of pdf_lights each, before traversing the tree. */
+
+/* Estimate of the light emitted by the bounds towards P, conservative in that it is only zero
+ * when no emitter inside the bounds can illuminate P. */
+ccl_device float light_tree_importance(const ccl_global KernelLightTreeNode *knode, float3 P)
+{
+  const float3 bbox_min = make_float3(
+      knode->bounding_box_min[0], knode->bounding_box_min[1], knode->bounding_box_min[2]);
+  const float3 bbox_max = make_float3(
+      knode->bounding_box_max[0], knode->bounding_box_max[1], knode->bounding_box_max[2]);
+  const float3 axis = make_float3(knode->axis[0], knode->axis[1], knode->axis[2]);
+
+  const float3 centroid = 0.5f * (bbox_min + bbox_max);
+  const float radius_sq = 0.25f * len_squared(bbox_max - bbox_min);
+
+  float dist;
+  const float3 D = normalize_len(P - centroid, &dist);
+  const float dist_sq = dist * dist;
+
+  /* Angle between the cone axis and the direction to P, reduced by the angles of the cone and
+   * of the bounds as seen from P. */
+  float theta_prime = 0.0f;
+  if (dist_sq > radius_sq) {
+    const float theta = fast_acosf(dot(axis, D));
+    const float theta_u = fast_asinf(sqrtf(radius_sq / dist_sq));
+    theta_prime = max(theta - knode->theta_o - theta_u, 0.0f);
+  }
+
+  if (theta_prime >= knode->theta_e) {
+    return 0.0f;
+  }
+
+  /* Clamp the distance to the size of the bounds, the estimate is meaningless inside them. */
+  return knode->energy * fast_cosf(theta_prime) / max(max(dist_sq, radius_sq), 1e-8f);
+}
+
+ccl_device_inline float light_tree_emitter_importance(KernelGlobals *kg, uint index, float3 P)
+{
+  const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters,
+                                                                        index);
+  return light_tree_importance(&kemitter->bounds, P);
+}
+
+/* Probability of taking the first child of an interior node. */
+ccl_device_inline float light_tree_child_probability(KernelGlobals *kg,
+                                                     int node_index,
+                                                     const ccl_global KernelLightTreeNode *knode,
+                                                     float3 P)
+{
+  const float first_importance = light_tree_importance(
+      &kernel_tex_fetch(__light_tree_nodes, node_index + 1), P);
+  const float second_importance = light_tree_importance(
+      &kernel_tex_fetch(__light_tree_nodes, knode->child_index), P);
+  const float total_importance = first_importance + second_importance;
+
+  /* The bounds of the children are tighter than those of their parent, so neither may be able
+   * to illuminate P while the parent can. Pick either then, for the probabilities of all
+   * emitters to still sum to one. */
+  if (!(total_importance > 0.0f)) {
+    return 0.5f;
+  }
+
+  return first_importance / total_importance;
+}
+
+/* Whether any emitter of the tree may illuminate P. */
+ccl_device_inline bool light_tree_root_illuminates(KernelGlobals *kg, float3 P)
+{
+  return light_tree_importance(&kernel_tex_fetch(__light_tree_nodes, 0), P) > 0.0f;
+}
+
+/* Sample an emitter from the tree, returning its index in the light distribution. The random
+ * number is rescaled to be reused for sampling a position on the emitter. */
+ccl_device int light_tree_sample_tree(KernelGlobals *kg, float3 P, float *randu, float *pdf)
+{
+  int node_index = 0;
+  float u = *randu;
+  float tree_pdf = 1.0f;
+
+  if (!light_tree_root_illuminates(kg, P)) {
+    return -1;
+  }
+
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, 0);
+
+  while (knode->num_emitters == 0) {
+    const float first_prob = light_tree_child_probability(kg, node_index, knode, P);
+
+    /* Rescale the random number, keeping it below one against rounding errors. */
+    if (u < first_prob) {
+      node_index = node_index + 1;
+      u = min(u / first_prob, 1.0f - FLT_EPSILON);
+      tree_pdf *= first_prob;
+    }
+    else {
+      node_index = knode->child_index;
+      u = min((u - first_prob) / (1.0f - first_prob), 1.0f - FLT_EPSILON);
+      tree_pdf *= 1.0f - first_prob;
+    }
+
+    knode = &kernel_tex_fetch(__light_tree_nodes, node_index);
+  }
+
+  /* Pick an emitter in the leaf proportional to its own importance. */
+  const int first_emitter = knode->child_index;
+  const int num_emitters = knode->num_emitters;
+
+  float total_importance = 0.0f;
+  for (int i = 0; i < num_emitters; i++) {
+    const uint index = kernel_tex_fetch(__light_tree_leaf_emitters, first_emitter + i);
+    total_importance += light_tree_emitter_importance(kg, index, P);
+  }
+
+  if (!(total_importance > 0.0f)) {
+    /* None of the emitters can illuminate P, though the leaf might, pick one uniformly. */
+    const int i = min((int)(u * num_emitters), num_emitters - 1);
+    *randu = min(u * num_emitters - i, 1.0f - FLT_EPSILON);
+    *pdf = tree_pdf / num_emitters;
+    return kernel_tex_fetch(__light_tree_leaf_emitters, first_emitter + i);
+  }
+
+  const float threshold = u * total_importance;
+  float cdf = 0.0f;
+  int selected = -1;
+  float selected_importance = 0.0f, selected_cdf = 0.0f;
+
+  for (int i = 0; i < num_emitters; i++) {
+    const uint index = kernel_tex_fetch(__light_tree_leaf_emitters, first_emitter + i);
+    const float importance = light_tree_emitter_importance(kg, index, P);
+
+    if (importance == 0.0f) {
+      continue;
+    }
+
+    /* Falls back to the last emitter with importance, for float rounding errors. */
+    selected = index;
+    selected_importance = importance;
+    selected_cdf = cdf;
+
+    if (threshold < cdf + importance) {
+      break;
+    }
+    cdf += importance;
+  }
+
+  if (selected != -1) {
+    *randu = clamp((threshold - selected_cdf) / selected_importance, 0.0f, 1.0f - FLT_EPSILON);
+    *pdf = tree_pdf * selected_importance / total_importance;
+  }
+
+  return selected;
+}
+
+/* Probability of sampling the emitter at the given light distribution index from the tree. */
+ccl_device float light_tree_pdf_tree(KernelGlobals *kg, float3 P, int distribution_index)
+{
+  const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters,
+                                                                        distribution_index);
+  uint bit_trail = kemitter->bit_trail;
+  int node_index = 0;
+  float tree_pdf = 1.0f;
+
+  if (!light_tree_root_illuminates(kg, P)) {
+    return 0.0f;
+  }
+
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, 0);
+
+  while (knode->num_emitters == 0) {
+    const float first_prob = light_tree_child_probability(kg, node_index, knode, P);
+
+    if (bit_trail & 1) {
+      node_index = knode->child_index;
+      tree_pdf *= 1.0f - first_prob;
+    }
+    else {
+      node_index = node_index + 1;
+      tree_pdf *= first_prob;
+    }
+
+    bit_trail >>= 1;
+    knode = &kernel_tex_fetch(__light_tree_nodes, node_index);
+  }
+
+  const int first_emitter = knode->child_index;
+  const int num_emitters = knode->num_emitters;
+
+  float total_importance = 0.0f;
+  for (int i = 0; i < num_emitters; i++) {
+    const uint index = kernel_tex_fetch(__light_tree_leaf_emitters, first_emitter + i);
+    total_importance += light_tree_emitter_importance(kg, index, P);
+  }
+
+  if (!(total_importance > 0.0f)) {
+    return tree_pdf / num_emitters;
+  }
+
+  return tree_pdf * light_tree_emitter_importance(kg, distribution_index, P) / total_importance;
+}
+
+/* Select a light for a shading point at P, returning its index in the light distribution or -1
+ * if no light can illuminate P. */
+ccl_device int light_tree_sample(KernelGlobals *kg, float3 P, float *randu, float *pdf)
+{
+  const int num_infinite = kernel_data.integrator.light_tree_num_infinite;
+  const int num_local = kernel_data.integrator.num_distribution - num_infinite;
+  const float infinite_prob = kernel_data.integrator.pdf_lights * num_infinite;
+  float u = *randu;
+
+  if (u < infinite_prob || num_local == 0) {
+    /* Distant and background lights, stored after the emitters of the tree. */
+    u = u / infinite_prob;
+    const int i = min((int)(u * num_infinite), num_infinite - 1);
+    *randu = min(u * num_infinite - i, 1.0f - FLT_EPSILON);
+    *pdf = kernel_data.integrator.pdf_lights;
+    return kernel_tex_fetch(__light_tree_leaf_emitters, num_local + i);
+  }
+
+  *randu = (u - infinite_prob) / (1.0f - infinite_prob);
+  const int index = light_tree_sample_tree(kg, P, randu, pdf);
+  *pdf *= 1.0f - infinite_prob;
+  return index;
+}
+
+/* Probability of light_tree_sample selecting a lamp or mesh light triangle, which is not a
+ * distant or background light. */
+ccl_device float light_tree_pdf(KernelGlobals *kg, float3 P, int distribution_index)
+{
+  const float infinite_prob = kernel_data.integrator.pdf_lights *
+                              kernel_data.integrator.light_tree_num_infinite;
+  return (1.0f - infinite_prob) * light_tree_pdf_tree(kg, P, distribution_index);
+}
+
+CCL_NAMESPACE_END
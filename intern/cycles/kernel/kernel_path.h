@@ -45,6 +45,9 @@
 
 #include "kernel/kernel_path_state.h"
 #include "kernel/kernel_shadow.h"
+#ifdef __PATH_GUIDING__
+#  include "kernel/kernel_path_guiding.h"
+#endif
 #include "kernel/kernel_emission.h"
 #include "kernel/kernel_path_common.h"
 #include "kernel/kernel_path_surface.h"
@@ -519,6 +522,13 @@ ccl_device_forceinline void kernel_path_integrate(KernelGlobals *kg,
   /* Shader data memory used for both volumes and surfaces, saves stack space. */
   ShaderData sd;
 
+#  ifdef __PATH_GUIDING__
+  /* Vertices to record the incident radiance at for learning the guiding distribution. */
+  PathGuidingState guiding;
+  guiding_path_init(&guiding);
+  const bool use_guiding_training = kernel_data.integrator.use_guiding_training;
+#  endif
+
 #  ifdef __SUBSURFACE__
   SubsurfaceIndirectRays ss_indirect;
   kernel_path_subsurface_init_indirect(&ss_indirect);
@@ -621,9 +631,22 @@ ccl_device_forceinline void kernel_path_integrate(KernelGlobals *kg,
       }
 #  endif
 
+#  ifdef __PATH_GUIDING__
+      float3 guiding_L_sum = make_float3(0.0f, 0.0f, 0.0f);
+      if (use_guiding_training) {
+        guiding_L_sum = guiding_path_radiance_sum(kg, L);
+      }
+#  endif
+
       /* compute direct lighting and next bounce */
       if (!kernel_path_surface_bounce(kg, &sd, &throughput, state, &L->state, ray))
         break;
+
+#  ifdef __PATH_GUIDING__
+      if (use_guiding_training) {
+        guiding_path_add_vertex(kg, &guiding, &sd, state, ray, throughput, guiding_L_sum);
+      }
+#  endif
     }
 
 #  ifdef __SUBSURFACE__
@@ -638,6 +661,12 @@ ccl_device_forceinline void kernel_path_integrate(KernelGlobals *kg,
     }
   }
 #  endif /* __SUBSURFACE__ */
+
+#  ifdef __PATH_GUIDING__
+  if (use_guiding_training) {
+    guiding_path_record(kg, &guiding, L);
+  }
+#  endif
 }
 
 ccl_device void kernel_path_trace(
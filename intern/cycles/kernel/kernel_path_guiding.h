@@ -0,0 +1,397 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_atomic.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Path Guiding
+ *
+ * Samples bounce directions from a distribution of the light arriving at the shading point,
+ * learned from the paths traced in previous passes, as described in "Practical Path Guiding
+ * for Efficient Light-Transport Simulation" by Müller et al. A binary tree over the scene
+ * bounds holds quadtrees over the directions at its leaves, one to sample from and one to
+ * record the radiance of the current pass in, which the host turns into the next distribution.
+ *
+ * Directions are mapped to the unit square by the cylindrical projection (cos theta, phi), which
+ * preserves area so densities over the square and the sphere only differ by a factor 4 pi.
+ * Quadrant 0 is the lower half in both dimensions, bit 0 of the quadrant is set for the upper
+ * half of cos theta and bit 1 for the upper half of phi. */
+
+#define GUIDING_MAX_PATH_VERTICES 16
+
+ccl_device_inline float2 guiding_direction_to_square(const float3 D)
+{
+  const float cos_theta = clamp(D.z, -1.0f, 1.0f);
+  float phi = atan2f(D.y, D.x);
+  if (phi < 0.0f) {
+    phi += M_2PI_F;
+  }
+
+  return make_float2(min(0.5f * (cos_theta + 1.0f), 1.0f - FLT_EPSILON),
+                     min(phi * M_1_2PI_F, 1.0f - FLT_EPSILON));
+}
+
+ccl_device_inline float3 guiding_square_to_direction(const float2 p)
+{
+  const float cos_theta = 2.0f * p.x - 1.0f;
+  const float sin_theta = safe_sqrtf(1.0f - cos_theta * cos_theta);
+  const float phi = M_2PI_F * p.y;
+
+  return make_float3(sin_theta * cosf(phi), sin_theta * sinf(phi), cos_theta);
+}
+
+/* Quadrant of the point, which is then transformed to the unit square of the quadrant. */
+ccl_device_inline int guiding_quadrant(float2 *p)
+{
+  int quadrant = 0;
+
+  if (p->x >= 0.5f) {
+    quadrant |= 1;
+    p->x -= 0.5f;
+  }
+  if (p->y >= 0.5f) {
+    quadrant |= 2;
+    p->y -= 0.5f;
+  }
+
+  p->x *= 2.0f;
+  p->y *= 2.0f;
+
+  return quadrant;
+}
+
+ccl_device int guiding_spatial_leaf(KernelGlobals *kg, const float3 P)
+{
+  int index = 0;
+  const ccl_global KernelGuidingSpatialNode *knode = &kernel_tex_fetch(__guiding_spatial_nodes,
+                                                                       index);
+
+  while (knode->axis != -1) {
+    const float p = (knode->axis == 0) ? P.x : (knode->axis == 1) ? P.y : P.z;
+    index = knode->child + ((p >= knode->split) ? 1 : 0);
+    knode = &kernel_tex_fetch(__guiding_spatial_nodes, index);
+  }
+
+  return index;
+}
+
+/* Probability density over the sphere of sampling direction D from the tree at root. */
+ccl_device float guiding_directional_pdf(KernelGlobals *kg, int root, const float3 D)
+{
+  float2 p = guiding_direction_to_square(D);
+  float pdf = 1.0f;
+  int index = root;
+
+  while (true) {
+    const ccl_global KernelGuidingDirectionalNode *knode = &kernel_tex_fetch(
+        __guiding_directional_nodes, index);
+    const float total = knode->energy[0] + knode->energy[1] + knode->energy[2] +
+                        knode->energy[3];
+    const int quadrant = guiding_quadrant(&p);
+
+    if (!(total > 0.0f)) {
+      return 0.0f;
+    }
+
+    /* Quadrants are a quarter of the area of their node. */
+    pdf *= 4.0f * knode->energy[quadrant] / total;
+
+    if (knode->child[quadrant] == 0) {
+      break;
+    }
+    index = knode->child[quadrant];
+  }
+
+  return pdf * M_1_PI_F * 0.25f;
+}
+
+/* Sample a direction from the tree at root, proportional to the recorded energy and uniform
+ * within the quadrants without children. The random numbers are reused at every level. */
+ccl_device float3 guiding_directional_sample(
+    KernelGlobals *kg, int root, float randu, float randv, float *pdf)
+{
+  float2 origin = make_float2(0.0f, 0.0f);
+  float size = 1.0f;
+  float square_pdf = 1.0f;
+  int index = root;
+
+  while (true) {
+    const ccl_global KernelGuidingDirectionalNode *knode = &kernel_tex_fetch(
+        __guiding_directional_nodes, index);
+    const float *energy = knode->energy;
+    const float total = energy[0] + energy[1] + energy[2] + energy[3];
+
+    /* Pick the half in cos theta, then the quadrant in that half. */
+    const float lower = energy[0] + energy[2];
+    int quadrant = 0;
+
+    if (randu * total < lower) {
+      randu = randu * total / lower;
+    }
+    else {
+      randu = (randu * total - lower) / (total - lower);
+      quadrant |= 1;
+    }
+
+    const float half = energy[quadrant] + energy[quadrant | 2];
+    if (randv * half < energy[quadrant]) {
+      randv = randv * half / energy[quadrant];
+    }
+    else {
+      randv = (randv * half - energy[quadrant]) / energy[quadrant | 2];
+      quadrant |= 2;
+    }
+
+    randu = clamp(randu, 0.0f, 1.0f - FLT_EPSILON);
+    randv = clamp(randv, 0.0f, 1.0f - FLT_EPSILON);
+
+    square_pdf *= 4.0f * energy[quadrant] / total;
+    size *= 0.5f;
+    origin.x += (quadrant & 1) ? size : 0.0f;
+    origin.y += (quadrant & 2) ? size : 0.0f;
+
+    if (knode->child[quadrant] == 0) {
+      break;
+    }
+    index = knode->child[quadrant];
+  }
+
+  *pdf = square_pdf * M_1_PI_F * 0.25f;
+  return guiding_square_to_direction(origin + make_float2(randu, randv) * size);
+}
+
+/* Label of a guided direction, which isn't from any particular closure. Directions at shaders
+ * with a diffuse closure count as diffuse bounces, others as glossy ones. */
+ccl_device int guiding_bsdf_label(const ShaderData *sd, const float3 omega_in)
+{
+  int label = (dot(sd->Ng, omega_in) > 0.0f) ? LABEL_REFLECT : LABEL_TRANSMIT;
+
+  for (int i = 0; i < sd->num_closure; i++) {
+    if (CLOSURE_IS_BSDF_DIFFUSE(sd->closure[i].type)) {
+      return label | LABEL_DIFFUSE;
+    }
+  }
+
+  return label | LABEL_GLOSSY;
+}
+
+/* Sample a bounce direction from the BSDF or from the learned distribution of incident light,
+ * with the one-sample model weighting both by their combined pdf. Singular closures can only be
+ * sampled from the BSDF. */
+ccl_device int guiding_bsdf_sample(KernelGlobals *kg,
+                                   ShaderData *sd,
+                                   float randu,
+                                   float randv,
+                                   BsdfEval *bsdf_eval,
+                                   float3 *omega_in,
+                                   differential3 *domega_in,
+                                   float *pdf)
+{
+  const int leaf = guiding_spatial_leaf(kg, sd->P);
+  const int root = kernel_tex_fetch(__guiding_spatial_nodes, leaf).sampling_root;
+
+  if (root == -1) {
+    return shader_bsdf_sample(kg, sd, randu, randv, bsdf_eval, omega_in, domega_in, pdf);
+  }
+
+  const float bsdf_fraction = kernel_data.integrator.guiding_bsdf_fraction;
+
+  if (randu < bsdf_fraction) {
+    const int label = shader_bsdf_sample(
+        kg, sd, randu / bsdf_fraction, randv, bsdf_eval, omega_in, domega_in, pdf);
+
+    if (*pdf != 0.0f) {
+      if (label & (LABEL_SINGULAR | LABEL_TRANSPARENT)) {
+        *pdf *= bsdf_fraction;
+      }
+      else {
+        *pdf = bsdf_fraction * (*pdf) +
+               (1.0f - bsdf_fraction) * guiding_directional_pdf(kg, root, *omega_in);
+      }
+    }
+
+    return label;
+  }
+
+  PROFILING_INIT(kg, PROFILING_CLOSURE_EVAL);
+
+  float guiding_pdf;
+  *omega_in = guiding_directional_sample(
+      kg, root, (randu - bsdf_fraction) / (1.0f - bsdf_fraction), randv, &guiding_pdf);
+#ifdef __RAY_DIFFERENTIALS__
+  *domega_in = differential3_zero();
+#endif
+
+  float bsdf_pdf;
+  bsdf_eval_init(
+      bsdf_eval, NBUILTIN_CLOSURES, make_float3(0.0f, 0.0f, 0.0f), kernel_data.film.use_light_pass);
+  _shader_bsdf_multi_eval(kg, sd, *omega_in, &bsdf_pdf, NULL, bsdf_eval, 0.0f, 0.0f);
+
+  *pdf = bsdf_fraction * bsdf_pdf + (1.0f - bsdf_fraction) * guiding_pdf;
+  return guiding_bsdf_label(sd, *omega_in);
+}
+
+/* Same as shader_bsdf_eval(), but with the multiple importance weight against the pdf of the
+ * mixture that guiding_bsdf_sample() samples bounces at the shading point from, so the weights
+ * of light samples and of hitting the light with a bounce still sum to one. */
+ccl_device void guiding_bsdf_eval(KernelGlobals *kg,
+                                  ShaderData *sd,
+                                  const float3 omega_in,
+                                  BsdfEval *eval,
+                                  float light_pdf,
+                                  bool use_mis)
+{
+  int root = -1;
+  if (sd->flag & SD_BSDF_HAS_EVAL) {
+    const int leaf = guiding_spatial_leaf(kg, sd->P);
+    root = kernel_tex_fetch(__guiding_spatial_nodes, leaf).sampling_root;
+  }
+
+  if (root == -1) {
+    shader_bsdf_eval(kg, sd, omega_in, eval, light_pdf, use_mis);
+    return;
+  }
+
+  PROFILING_INIT(kg, PROFILING_CLOSURE_EVAL);
+
+  float bsdf_pdf;
+  bsdf_eval_init(
+      eval, NBUILTIN_CLOSURES, make_float3(0.0f, 0.0f, 0.0f), kernel_data.film.use_light_pass);
+  _shader_bsdf_multi_eval(kg, sd, omega_in, &bsdf_pdf, NULL, eval, 0.0f, 0.0f);
+
+  if (use_mis) {
+    const float bsdf_fraction = kernel_data.integrator.guiding_bsdf_fraction;
+    const float pdf = bsdf_fraction * bsdf_pdf +
+                      (1.0f - bsdf_fraction) * guiding_directional_pdf(kg, root, omega_in);
+    bsdf_eval_mis(eval, power_heuristic(light_pdf, pdf));
+  }
+}
+
+/* Training
+ *
+ * Path vertices are kept until the path is complete, then the radiance that arrived at each of
+ * them from its bounce direction is recorded in the leaf of the spatial tree containing it. */
+
+typedef struct PathGuidingVertex {
+  float3 omega_in;
+  /* Throughput after the bounce, and the radiance of the path before it. */
+  float3 throughput;
+  float3 L_sum;
+  float pdf;
+  int leaf;
+} PathGuidingVertex;
+
+typedef struct PathGuidingState {
+  PathGuidingVertex vertices[GUIDING_MAX_PATH_VERTICES];
+  int num_vertices;
+} PathGuidingState;
+
+/* Radiance of the path so far, without the clamping and modifications of
+ * path_radiance_clamp_and_sum. */
+ccl_device_inline float3 guiding_path_radiance_sum(KernelGlobals *kg, PathRadiance *L)
+{
+#ifdef __PASSES__
+  if (L->use_light_pass) {
+    float3 L_sum = L->emission + L->direct_emission + L->indirect + L->direct_diffuse +
+                   L->direct_glossy + L->direct_transmission + L->direct_volume +
+                   L->indirect_diffuse + L->indirect_glossy + L->indirect_transmission +
+                   L->indirect_volume;
+
+    if (!kernel_data.background.transparent) {
+      L_sum += L->background;
+    }
+
+    return L_sum;
+  }
+#endif
+
+  return L->emission;
+}
+
+ccl_device_inline void guiding_path_init(PathGuidingState *guiding)
+{
+  guiding->num_vertices = 0;
+}
+
+/* Remember the vertex after bouncing off the surface, unless the bounce was singular or
+ * transparent, which guiding does not apply to. */
+ccl_device_inline void guiding_path_add_vertex(KernelGlobals *kg,
+                                               PathGuidingState *guiding,
+                                               const ShaderData *sd,
+                                               const PathState *state,
+                                               const Ray *ray,
+                                               const float3 throughput,
+                                               const float3 L_sum)
+{
+  if (guiding->num_vertices == GUIDING_MAX_PATH_VERTICES || !(sd->flag & SD_BSDF_HAS_EVAL) ||
+      (state->flag & (PATH_RAY_TRANSPARENT | PATH_RAY_SINGULAR))) {
+    return;
+  }
+
+  PathGuidingVertex *vertex = &guiding->vertices[guiding->num_vertices++];
+  vertex->omega_in = ray->D;
+  vertex->throughput = throughput;
+  vertex->L_sum = L_sum;
+  vertex->pdf = state->ray_pdf;
+  vertex->leaf = guiding_spatial_leaf(kg, sd->P);
+}
+
+/* Add the energy arriving from direction D to the training tree of the leaf. Energies are
+ * radiance divided by the pdf of the direction, so summed over a quadrant they estimate the
+ * integral of the radiance over it. */
+ccl_device void guiding_record(KernelGlobals *kg, int leaf, const float3 D, float energy)
+{
+  atomic_fetch_and_inc_uint32(&kernel_tex_array(__guiding_training_samples)[leaf]);
+
+  if (!(energy > 0.0f)) {
+    return;
+  }
+
+  float2 p = guiding_direction_to_square(D);
+  int index = kernel_tex_fetch(__guiding_spatial_nodes, leaf).training_root;
+
+  while (true) {
+    const int quadrant = guiding_quadrant(&p);
+    const int child = kernel_tex_fetch(__guiding_directional_nodes, index).child[quadrant];
+
+    if (child == 0) {
+      atomic_add_and_fetch_float(
+          &kernel_tex_array(__guiding_training_radiance)[index * 4 + quadrant], energy);
+      return;
+    }
+    index = child;
+  }
+}
+
+ccl_device void guiding_path_record(KernelGlobals *kg, PathGuidingState *guiding, PathRadiance *L)
+{
+  const float3 L_sum = guiding_path_radiance_sum(kg, L);
+
+  for (int i = 0; i < guiding->num_vertices; i++) {
+    const PathGuidingVertex *vertex = &guiding->vertices[i];
+    const float3 L_in = safe_divide_color(L_sum - vertex->L_sum, vertex->throughput);
+    const float radiance = average(L_in);
+
+    if (!isfinite_safe(radiance) || !(vertex->pdf > 0.0f)) {
+      continue;
+    }
+
+    guiding_record(kg, vertex->leaf, vertex->omega_in, max(radiance, 0.0f) / vertex->pdf);
+  }
+}
+
+CCL_NAMESPACE_END
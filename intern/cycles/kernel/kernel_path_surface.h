@@ -287,8 +287,17 @@ ccl_device bool kernel_path_surface_bounce(KernelGlobals *kg,
     path_state_rng_2D(kg, state, PRNG_BSDF_U, &bsdf_u, &bsdf_v);
     int label;
 
-    label = shader_bsdf_sample(
-        kg, sd, bsdf_u, bsdf_v, &bsdf_eval, &bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+#ifdef __PATH_GUIDING__
+    if (kernel_data.integrator.use_guiding && (sd->flag & SD_BSDF_HAS_EVAL)) {
+      label = guiding_bsdf_sample(
+          kg, sd, bsdf_u, bsdf_v, &bsdf_eval, &bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+    }
+    else
+#endif
+    {
+      label = shader_bsdf_sample(
+          kg, sd, bsdf_u, bsdf_v, &bsdf_eval, &bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+    }
 
     if (bsdf_pdf == 0.0f || bsdf_eval_is_zero(&bsdf_eval))
       return false;
@@ -43,6 +43,7 @@ KERNEL_TEX(DecomposedTransform, __camera_motion)
 /* triangles */
 KERNEL_TEX(uint, __tri_shader)
 KERNEL_TEX(float4, __tri_vnormal)
+KERNEL_TEX(uint, __tri_vnormal_oct)
 KERNEL_TEX(uint4, __tri_vindex)
 KERNEL_TEX(uint, __tri_patch)
 KERNEL_TEX(float2, __tri_patch_uv)
@@ -66,6 +67,15 @@ KERNEL_TEX(KernelLightDistribution, __light_distribution)
 KERNEL_TEX(KernelLight, __lights)
 KERNEL_TEX(float2, __light_background_marginal_cdf)
 KERNEL_TEX(float2, __light_background_conditional_cdf)
+KERNEL_TEX(KernelLightTreeNode, __light_tree_nodes)
+KERNEL_TEX(KernelLightTreeEmitter, __light_tree_emitters)
+KERNEL_TEX(uint, __light_tree_leaf_emitters)
+
+/* path guiding */
+KERNEL_TEX(KernelGuidingSpatialNode, __guiding_spatial_nodes)
+KERNEL_TEX(KernelGuidingDirectionalNode, __guiding_directional_nodes)
+KERNEL_TEX(float, __guiding_training_radiance)
+KERNEL_TEX(uint, __guiding_training_samples)
 
 /* particles */
 KERNEL_TEX(KernelParticle, __particles)
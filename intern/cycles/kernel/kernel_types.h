@@ -128,6 +128,7 @@ CCL_NAMESPACE_BEGIN
 #  endif
 #  define __VOLUME_DECOUPLED__
 #  define __VOLUME_RECORD_ALL__
+#  define __PATH_GUIDING__
 #endif /* __KERNEL_CPU__ */
 
 #ifdef __KERNEL_CUDA__
@@ -782,6 +783,8 @@ typedef enum AttributeStandard {
 typedef enum AttributeFlag {
   ATTR_FINAL_SIZE = (1 << 0),
   ATTR_SUBDIVIDED = (1 << 1),
+  /* Float2 stored as two half floats in the float attribute texture. */
+  ATTR_HALF_FLOAT = (1 << 2),
 } AttributeFlag;
 
 typedef struct AttributeDescriptor {
@@ -1389,7 +1392,15 @@ typedef struct KernelIntegrator {
 
   int max_closures;
 
-  int pad1, pad2;
+  /* light tree */
+  int use_light_tree;
+  int light_tree_num_infinite;
+
+  /* path guiding */
+  int use_guiding;
+  int use_guiding_training;
+  float guiding_bsdf_fraction;
+  int pad1;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
 
@@ -1413,6 +1424,9 @@ typedef struct KernelBVH {
   int bvh_layout;
   int use_bvh_steps;
   int curve_subdivisions;
+  /* Vertex normals are octahedral encoded in __tri_vnormal_oct. */
+  int use_compact_normals;
+  int pad3, pad4, pad5;
 
   /* Custom BVH */
 #ifdef __KERNEL_OPTIX__
@@ -1548,6 +1562,57 @@ typedef struct KernelLightDistribution {
 } KernelLightDistribution;
 static_assert_align(KernelLightDistribution, 16);
 
+/* Bounds of a light tree node, or of a single emitter. The orientation cone holds the normals
+ * of the emitters (axis, theta_o), plus the angle over which they emit (theta_e). */
+typedef struct KernelLightTreeNode {
+  float bounding_box_min[3];
+  float energy;
+  float bounding_box_max[3];
+  float theta_o;
+  float axis[3];
+  float theta_e;
+  /* Interior nodes: index of the second child, the first child directly follows the node.
+   * Leaf nodes: index of the first emitter in __light_tree_leaf_emitters. */
+  int child_index;
+  /* Zero for interior nodes. */
+  int num_emitters;
+  int pad1, pad2;
+} KernelLightTreeNode;
+static_assert_align(KernelLightTreeNode, 16);
+
+typedef struct KernelLightTreeEmitter {
+  KernelLightTreeNode bounds;
+  /* Path from the root to the leaf holding the emitter, one bit per level starting at the
+   * least significant bit, set when the second child is taken. */
+  uint bit_trail;
+  int pad1, pad2, pad3;
+} KernelLightTreeEmitter;
+static_assert_align(KernelLightTreeEmitter, 16);
+
+/* Node of the binary tree over the scene bounds used for path guiding. */
+typedef struct KernelGuidingSpatialNode {
+  /* Interior nodes: split axis and position, the children are at child and child + 1.
+   * Leaf nodes: axis is -1. */
+  int axis;
+  float split;
+  int child;
+  /* Leaf nodes: root of the directional tree to sample directions from, -1 if nothing was
+   * learned for the leaf yet, and root of the directional tree to record radiance in. */
+  int sampling_root;
+  int training_root;
+  int pad1, pad2, pad3;
+} KernelGuidingSpatialNode;
+static_assert_align(KernelGuidingSpatialNode, 16);
+
+/* Node of a quadtree over directions used for path guiding, see kernel_path_guiding.h for the
+ * mapping of directions to quadrants. */
+typedef struct KernelGuidingDirectionalNode {
+  /* Energy in each of the four quadrants and the node subdividing it, 0 for none. */
+  float energy[4];
+  int child[4];
+} KernelGuidingDirectionalNode;
+static_assert_align(KernelGuidingDirectionalNode, 16);
+
 typedef struct KernelParticle {
   int index;
   float age;
@@ -19,6 +19,17 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* Lookup of an image loaded on demand through the OpenImageIO texture system. Implemented in
+ * kernel_texture_cache.cpp, so the kernels don't depend on OpenImageIO headers. The derivatives
+ * of the coordinates in screen space X and Y select the mipmap level, zero uses full resolution. */
+void kernel_tex_image_texture_cache(KernelGlobals *kg,
+                                    const TextureInfo &info,
+                                    float x,
+                                    float y,
+                                    float2 dx,
+                                    float2 dy,
+                                    float result[4]);
+
 /* Make template functions private so symbols don't conflict between kernels with different
  * instruction sets. */
 namespace {
@@ -491,6 +502,12 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, fl
       return TextureInterpolator<ushort4>::interp(info, x, y);
     case IMAGE_DATA_TYPE_FLOAT4:
       return TextureInterpolator<float4>::interp(info, x, y);
+    case IMAGE_DATA_TYPE_TEXTURE_CACHE: {
+      float result[4];
+      kernel_tex_image_texture_cache(
+          kg, info, x, y, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f), result);
+      return make_float4(result[0], result[1], result[2], result[3]);
+    }
     default:
       assert(0);
       return make_float4(
@@ -498,6 +515,22 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, fl
   }
 }
 
+/* Same as above, with derivatives of the coordinates for images that have mipmaps. Only images
+ * loaded through the texture cache have them, others are always sampled at full resolution. */
+ccl_device float4 kernel_tex_image_interp_derivs(
+    KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy)
+{
+  const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
+
+  if (info.data_type == IMAGE_DATA_TYPE_TEXTURE_CACHE) {
+    float result[4];
+    kernel_tex_image_texture_cache(kg, info, x, y, dx, dy, result);
+    return make_float4(result[0], result[1], result[2], result[3]);
+  }
+
+  return kernel_tex_image_interp(kg, id, x, y);
+}
+
 ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg,
                                              int id,
                                              float3 P,
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Image lookups through the OpenImageIO texture system, for images that are loaded on demand
+ * in tiles instead of fully into memory. This is compiled once rather than for every
+ * instruction set, the filtering is done by OpenImageIO. */
+
+// clang-format off
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+// clang-format on
+
+#include <OpenImageIO/texture.h>
+
+CCL_NAMESPACE_BEGIN
+
+void kernel_tex_image_texture_cache(KernelGlobals *kg,
+                                    const TextureInfo &info,
+                                    float x,
+                                    float y,
+                                    float2 dx,
+                                    float2 dy,
+                                    float result[4])
+{
+  OIIO::TextureSystem *ts = (OIIO::TextureSystem *)kg->texture_system;
+  OIIO::TextureSystem::TextureHandle *handle = *(OIIO::TextureSystem::TextureHandle **)info.data;
+
+  /* Thread data is looked up once per kernel thread, to avoid the thread local storage lookup
+   * in every call. */
+  if (kg->texture_thread_info == NULL) {
+    kg->texture_thread_info = ts->get_perthread_info();
+  }
+
+  OIIO::TextureOpt options;
+
+  switch (info.interpolation) {
+    case INTERPOLATION_CLOSEST:
+      options.interpmode = OIIO::TextureOpt::InterpClosest;
+      break;
+    case INTERPOLATION_CUBIC:
+      options.interpmode = OIIO::TextureOpt::InterpBicubic;
+      break;
+    case INTERPOLATION_SMART:
+      options.interpmode = OIIO::TextureOpt::InterpSmartBicubic;
+      break;
+    default:
+      options.interpmode = OIIO::TextureOpt::InterpBilinear;
+      break;
+  }
+
+  switch (info.extension) {
+    case EXTENSION_EXTEND:
+      options.swrap = options.twrap = OIIO::TextureOpt::WrapClamp;
+      break;
+    case EXTENSION_CLIP:
+      options.swrap = options.twrap = OIIO::TextureOpt::WrapBlack;
+      break;
+    default:
+      options.swrap = options.twrap = OIIO::TextureOpt::WrapPeriodic;
+      break;
+  }
+
+  /* Opaque alpha for images without alpha channel, gray images are expanded to RGB by the
+   * texture system. */
+  options.fill = 1.0f;
+
+  /* The derivatives select the mipmap level, without them the lookup uses the highest
+   * resolution. Cycles images have their origin at the bottom left, OpenImageIO at the top
+   * left, which flips the sign of the T derivatives. */
+  if (!ts->texture(handle,
+                   (OIIO::TextureSystem::Perthread *)kg->texture_thread_info,
+                   options,
+                   x,
+                   1.0f - y,
+                   dx.x,
+                   -dx.y,
+                   dy.x,
+                   -dy.y,
+                   4,
+                   result)) {
+    /* Clear the error message, so they don't accumulate. */
+    ts->geterror();
+
+    result[0] = TEX_IMAGE_MISSING_R;
+    result[1] = TEX_IMAGE_MISSING_G;
+    result[2] = TEX_IMAGE_MISSING_B;
+    result[3] = TEX_IMAGE_MISSING_A;
+    return;
+  }
+
+  /* Same as for fully loaded images, avoid artifacts caused by fully changed hue. */
+  if (!isfinite_safe(result[0]) || !isfinite_safe(result[1]) || !isfinite_safe(result[2]) ||
+      !isfinite_safe(result[3])) {
+    result[0] = 0.0f;
+    result[1] = 0.0f;
+    result[2] = 0.0f;
+    result[3] = 0.0f;
+  }
+}
+
+CCL_NAMESPACE_END
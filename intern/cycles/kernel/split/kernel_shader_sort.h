@@ -54,7 +54,6 @@ ccl_device void kernel_shader_sort(KernelGlobals *kg, ccl_local_param ShaderSort
   }
   ccl_barrier(CCL_LOCAL_MEM_FENCE);
 
-  /* skip sorting for cpu split kernel */
 #  ifdef __KERNEL_OPENCL__
 
   /* bitonic sort */
@@ -77,6 +76,42 @@ ccl_device void kernel_shader_sort(KernelGlobals *kg, ccl_local_param ShaderSort
       }
     }
   }
+#  elif defined(__KERNEL_CPU__)
+
+  /* The CPU runs a single thread per block, so merge sort it sequentially. The sort is stable
+   * so rays with the same shader keep their order, entries past the end of the queue are empty
+   * and already last. */
+  const int num_values = min((int)(qsize - offset), SHADER_SORT_BLOCK_SIZE);
+  ccl_local ushort *src = local_index;
+  ccl_local ushort *dst = &locals->local_temp[0];
+
+  for (int width = 1; width < num_values; width <<= 1) {
+    for (int start = 0; start < num_values; start += 2 * width) {
+      const int middle = min(start + width, num_values);
+      const int end = min(start + 2 * width, num_values);
+      int a = start, b = middle, k = start;
+
+      while (a < middle && b < end) {
+        dst[k++] = (local_value[src[b]] < local_value[src[a]]) ? src[b++] : src[a++];
+      }
+      while (a < middle) {
+        dst[k++] = src[a++];
+      }
+      while (b < end) {
+        dst[k++] = src[b++];
+      }
+    }
+
+    ccl_local ushort *tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  if (src != local_index) {
+    for (int i = 0; i < num_values; i++) {
+      local_index[i] = src[i];
+    }
+  }
 #  endif /* __KERNEL_OPENCL__ */
 
   /* copy to destination */
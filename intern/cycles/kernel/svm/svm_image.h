@@ -16,14 +16,21 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint flags)
+/* Derivatives of the coordinates are only used by images with mipmaps on the CPU, pass zero
+ * when they are not known. */
+ccl_device float4 svm_image_texture(
+    KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy, uint flags)
 {
   if (id == -1) {
     return make_float4(
         TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
   }
 
+#ifdef __KERNEL_CPU__
+  float4 r = kernel_tex_image_interp_derivs(kg, id, x, y, dx, dy);
+#else
   float4 r = kernel_tex_image_interp(kg, id, x, y);
+#endif
   const float alpha = r.w;
 
   if ((flags & NODE_IMAGE_ALPHA_UNASSOCIATE) && alpha != 1.0f && alpha != 0.0f) {
@@ -48,21 +55,33 @@ ccl_device void svm_node_tex_image(
     KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node, int *offset)
 {
   uint co_offset, out_offset, alpha_offset, flags;
+  uint projection, co_dx_offset, co_dy_offset, unused;
 
   svm_unpack_node_uchar4(node.z, &co_offset, &out_offset, &alpha_offset, &flags);
+  svm_unpack_node_uchar4(node.w, &projection, &co_dx_offset, &co_dy_offset, &unused);
 
   float3 co = stack_load_float3(stack, co_offset);
   float2 tex_co;
-  if (node.w == NODE_IMAGE_PROJ_SPHERE) {
+  float2 tex_co_dx = make_float2(0.0f, 0.0f);
+  float2 tex_co_dy = make_float2(0.0f, 0.0f);
+  if (projection == NODE_IMAGE_PROJ_SPHERE) {
     co = texco_remap_square(co);
     tex_co = map_to_sphere(co);
   }
-  else if (node.w == NODE_IMAGE_PROJ_TUBE) {
+  else if (projection == NODE_IMAGE_PROJ_TUBE) {
     co = texco_remap_square(co);
     tex_co = map_to_tube(co);
   }
   else {
     tex_co = make_float2(co.x, co.y);
+
+    /* Coordinates evaluated at the ray differential offsets, when the compiler added them. */
+    if (stack_valid(co_dx_offset) && stack_valid(co_dy_offset)) {
+      const float3 co_dx = stack_load_float3(stack, co_dx_offset);
+      const float3 co_dy = stack_load_float3(stack, co_dy_offset);
+      tex_co_dx = make_float2(co_dx.x - co.x, co_dx.y - co.y);
+      tex_co_dy = make_float2(co_dy.x - co.x, co_dy.y - co.y);
+    }
   }
 
   /* TODO(lukas): Consider moving tile information out of the SVM node.
@@ -108,7 +127,7 @@ ccl_device void svm_node_tex_image(
     id = -num_nodes;
   }
 
-  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, flags);
+  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, tex_co_dx, tex_co_dy, flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -198,15 +217,18 @@ ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float
   /* Map so that no textures are flipped, rotation is somewhat arbitrary. */
   if (weight.x > 0.0f) {
     float2 uv = make_float2((signed_N.x < 0.0f) ? 1.0f - co.y : co.y, co.z);
-    f += weight.x * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.x * svm_image_texture(
+        kg, id, uv.x, uv.y, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f), flags);
   }
   if (weight.y > 0.0f) {
     float2 uv = make_float2((signed_N.y > 0.0f) ? 1.0f - co.x : co.x, co.z);
-    f += weight.y * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.y * svm_image_texture(
+        kg, id, uv.x, uv.y, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f), flags);
   }
   if (weight.z > 0.0f) {
     float2 uv = make_float2((signed_N.z > 0.0f) ? 1.0f - co.y : co.y, co.x);
-    f += weight.z * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.z * svm_image_texture(
+        kg, id, uv.x, uv.y, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f), flags);
   }
 
   if (stack_valid(out_offset))
@@ -236,7 +258,8 @@ ccl_device void svm_node_tex_environment(KernelGlobals *kg,
   else
     uv = direction_to_mirrorball(co);
 
-  float4 f = svm_image_texture(kg, id, uv.x, uv.y, flags);
+  float4 f = svm_image_texture(
+      kg, id, uv.x, uv.y, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f), flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
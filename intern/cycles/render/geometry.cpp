@@ -16,6 +16,7 @@
 
 #include "bvh/bvh.h"
 #include "bvh/bvh_build.h"
+#include "bvh/bvh_cache.h"
 #include "bvh/bvh_embree.h"
 
 #include "device/device.h"
@@ -39,8 +40,10 @@
 #include "kernel/osl/osl_globals.h"
 
 #include "util/util_foreach.h"
+#include "util/util_half.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
+#include "util/util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -193,15 +196,25 @@ void Geometry::compute_bvh(
     vector<Object *> objects;
     objects.push_back(&object);
 
-    if (bvh && !need_update_rebuild) {
+    bool need_rebuild = (bvh == NULL || need_update_rebuild);
+
+    if (!need_rebuild) {
+      /* Only vertex positions changed, keep the topology of the BVH. */
       progress->set_status(msg, "Refitting BVH");
 
       bvh->geometry = geometry;
       bvh->objects = objects;
 
       bvh->refit(*progress);
+
+      if (bvh->refit_degraded()) {
+        VLOG(2) << "Rebuilding BVH of " << name << " after " << bvh->num_refits
+                << " refits, SAH cost " << bvh->build_sah_cost << " -> " << bvh->refit_sah_cost;
+        need_rebuild = true;
+      }
     }
-    else {
+
+    if (need_rebuild) {
       progress->set_status(msg, "Building BVH");
 
       BVHParams bparams;
@@ -216,7 +229,23 @@ void Geometry::compute_bvh(
 
       delete bvh;
       bvh = BVH::create(bparams, geometry, objects, device);
-      MEM_GUARDED_CALL(progress, bvh->build, *progress);
+
+      /* Reuse a BVH built for identical geometry in an earlier render. */
+      const string cache_key = (params->bvh_cache_path.empty()) ?
+                                   "" :
+                                   BVHCache::key(this, objects, bparams);
+      BVHCache cache(params->bvh_cache_path);
+
+      if (!cache_key.empty() && cache.read(cache_key, bvh->pack)) {
+        progress->set_status(msg, "Loaded cached BVH");
+      }
+      else {
+        MEM_GUARDED_CALL(progress, bvh->build, *progress);
+
+        if (!cache_key.empty() && !progress->get_cancel()) {
+          cache.write(cache_key, bvh->pack);
+        }
+      }
     }
   }
 
@@ -264,6 +293,8 @@ GeometryManager::GeometryManager()
 {
   need_update = true;
   need_flags_update = true;
+  num_compact_normals = 0;
+  num_compact_float2 = 0;
 }
 
 GeometryManager::~GeometryManager()
@@ -473,13 +504,23 @@ void GeometryManager::update_svm_attributes(Device *,
   dscene->attributes_map.copy_to_device();
 }
 
+/* With compact geometry, float2 attributes of triangles and curves are stored as two half
+ * floats in the float array. Subdivision patch evaluation always reads full floats. */
+static bool attribute_use_half_float(Attribute *mattr, AttributePrimitive prim, bool compact)
+{
+  return compact && prim == ATTR_PRIM_GEOMETRY && mattr->type == TypeFloat2 &&
+         !(mattr->flags & ATTR_SUBDIVIDED);
+}
+
 static void update_attribute_element_size(Geometry *geom,
                                           Attribute *mattr,
                                           AttributePrimitive prim,
+                                          bool compact,
                                           size_t *attr_float_size,
                                           size_t *attr_float2_size,
                                           size_t *attr_float3_size,
-                                          size_t *attr_uchar4_size)
+                                          size_t *attr_uchar4_size,
+                                          size_t *attr_half_float2_size)
 {
   if (mattr) {
     size_t size = mattr->element_size(geom, prim);
@@ -490,6 +531,10 @@ static void update_attribute_element_size(Geometry *geom,
     else if (mattr->element == ATTR_ELEMENT_CORNER_BYTE) {
       *attr_uchar4_size += size;
     }
+    else if (attribute_use_half_float(mattr, prim, compact)) {
+      *attr_float_size += size;
+      *attr_half_float2_size += size;
+    }
     else if (mattr->type == TypeDesc::TypeFloat) {
       *attr_float_size += size;
     }
@@ -516,6 +561,7 @@ static void update_attribute_element_offset(Geometry *geom,
                                             size_t &attr_uchar4_offset,
                                             Attribute *mattr,
                                             AttributePrimitive prim,
+                                            bool compact,
                                             TypeDesc &type,
                                             AttributeDescriptor &desc)
 {
@@ -546,6 +592,19 @@ static void update_attribute_element_offset(Geometry *geom,
       }
       attr_uchar4_offset += size;
     }
+    else if (attribute_use_half_float(mattr, prim, compact)) {
+      float2 *data = mattr->data_float2();
+      offset = attr_float_offset;
+      desc.flags = (AttributeFlag)(desc.flags | ATTR_HALF_FLOAT);
+
+      assert(attr_float.size() >= offset + size);
+      for (size_t k = 0; k < size; k++) {
+        const uint x = float_to_half(data[k].x);
+        const uint y = float_to_half(data[k].y);
+        attr_float[offset + k] = __uint_as_float(x | (y << 16));
+      }
+      attr_float_offset += size;
+    }
     else if (mattr->type == TypeDesc::TypeFloat) {
       float *data = mattr->data_float();
       offset = attr_float_offset;
@@ -659,10 +718,12 @@ void GeometryManager::device_update_attributes(Device *device,
   /* Pre-allocate attributes to avoid arrays re-allocation which would
    * take 2x of overall attribute memory usage.
    */
+  const bool compact = scene->params.use_compact_geometry;
   size_t attr_float_size = 0;
   size_t attr_float2_size = 0;
   size_t attr_float3_size = 0;
   size_t attr_uchar4_size = 0;
+  size_t attr_half_float2_size = 0;
   for (size_t i = 0; i < scene->geometry.size(); i++) {
     Geometry *geom = scene->geometry[i];
     AttributeRequestSet &attributes = geom_attributes[i];
@@ -672,10 +733,12 @@ void GeometryManager::device_update_attributes(Device *device,
       update_attribute_element_size(geom,
                                     attr,
                                     ATTR_PRIM_GEOMETRY,
+                                    compact,
                                     &attr_float_size,
                                     &attr_float2_size,
                                     &attr_float3_size,
-                                    &attr_uchar4_size);
+                                    &attr_uchar4_size,
+                                    &attr_half_float2_size);
 
       if (geom->type == Geometry::MESH) {
         Mesh *mesh = static_cast<Mesh *>(geom);
@@ -684,14 +747,18 @@ void GeometryManager::device_update_attributes(Device *device,
         update_attribute_element_size(mesh,
                                       subd_attr,
                                       ATTR_PRIM_SUBD,
+                                      compact,
                                       &attr_float_size,
                                       &attr_float2_size,
                                       &attr_float3_size,
-                                      &attr_uchar4_size);
+                                      &attr_uchar4_size,
+                                      &attr_half_float2_size);
       }
     }
   }
 
+  num_compact_float2 = attr_half_float2_size;
+
   dscene->attributes_float.alloc(attr_float_size);
   dscene->attributes_float2.alloc(attr_float2_size);
   dscene->attributes_float3.alloc(attr_float3_size);
@@ -722,6 +789,7 @@ void GeometryManager::device_update_attributes(Device *device,
                                       attr_uchar4_offset,
                                       attr,
                                       ATTR_PRIM_GEOMETRY,
+                                      compact,
                                       req.type,
                                       req.desc);
 
@@ -740,6 +808,7 @@ void GeometryManager::device_update_attributes(Device *device,
                                         attr_uchar4_offset,
                                         subd_attr,
                                         ATTR_PRIM_SUBD,
+                                        compact,
                                         req.subd_type,
                                         req.subd_desc);
       }
@@ -905,13 +974,19 @@ void GeometryManager::device_update_mesh(
     }
   }
 
+  /* Vertex normals are octahedral encoded into a single uint with compact geometry. */
+  const bool compact_normals = scene->params.use_compact_geometry;
+  dscene->data.bvh.use_compact_normals = compact_normals;
+  num_compact_normals = (compact_normals) ? vert_size : 0;
+
   /* Fill in all the arrays. */
   if (tri_size != 0) {
     /* normals */
     progress.set_status("Updating Mesh", "Computing normals");
 
     uint *tri_shader = dscene->tri_shader.alloc(tri_size);
-    float4 *vnormal = dscene->tri_vnormal.alloc(vert_size);
+    float4 *vnormal = (compact_normals) ? NULL : dscene->tri_vnormal.alloc(vert_size);
+    uint *vnormal_oct = (compact_normals) ? dscene->tri_vnormal_oct.alloc(vert_size) : NULL;
     uint4 *tri_vindex = dscene->tri_vindex.alloc(tri_size);
     uint *tri_patch = dscene->tri_patch.alloc(tri_size);
     float2 *tri_patch_uv = dscene->tri_patch_uv.alloc(vert_size);
@@ -920,7 +995,12 @@ void GeometryManager::device_update_mesh(
       if (geom->type == Geometry::MESH || geom->type == Geometry::VOLUME) {
         Mesh *mesh = static_cast<Mesh *>(geom);
         mesh->pack_shaders(scene, &tri_shader[mesh->prim_offset]);
-        mesh->pack_normals(&vnormal[mesh->vert_offset]);
+        if (compact_normals) {
+          mesh->pack_normals_compact(&vnormal_oct[mesh->vert_offset]);
+        }
+        else {
+          mesh->pack_normals(&vnormal[mesh->vert_offset]);
+        }
         mesh->pack_verts(tri_prim_index,
                          &tri_vindex[mesh->prim_offset],
                          &tri_patch[mesh->prim_offset],
@@ -936,7 +1016,14 @@ void GeometryManager::device_update_mesh(
     progress.set_status("Updating Mesh", "Copying Mesh to device");
 
     dscene->tri_shader.copy_to_device();
-    dscene->tri_vnormal.copy_to_device();
+    if (compact_normals) {
+      dscene->tri_vnormal.free();
+      dscene->tri_vnormal_oct.copy_to_device();
+    }
+    else {
+      dscene->tri_vnormal_oct.free();
+      dscene->tri_vnormal.copy_to_device();
+    }
     dscene->tri_vindex.copy_to_device();
     dscene->tri_patch.copy_to_device();
     dscene->tri_patch_uv.copy_to_device();
@@ -1290,6 +1377,9 @@ void GeometryManager::device_update(Device *device,
     Camera *dicing_camera = scene->dicing_camera;
     dicing_camera->update(scene);
 
+    /* Meshes are tessellated independently, in parallel. */
+    TaskPool pool;
+
     size_t i = 0;
     foreach (Geometry *geom, scene->geometry) {
       if (!(geom->need_update && geom->type == Geometry::MESH)) {
@@ -1306,18 +1396,27 @@ void GeometryManager::device_update(Device *device,
           msg += string_printf(
               "%s %u/%u", mesh->name.c_str(), (uint)(i + 1), (uint)total_tess_needed);
 
-        progress.set_status("Updating Mesh", msg);
-
         mesh->subd_params->camera = dicing_camera;
-        DiagSplit dsplit(*mesh->subd_params);
-        mesh->tessellate(&dsplit);
 
-        i++;
+        pool.push([mesh, msg, &progress] {
+          if (progress.get_cancel()) {
+            return;
+          }
 
-        if (progress.get_cancel())
-          return;
+          progress.set_status("Updating Mesh", msg);
+
+          DiagSplit dsplit(*mesh->subd_params);
+          mesh->tessellate(&dsplit);
+        });
+
+        i++;
       }
     }
+
+    pool.wait_work();
+
+    if (progress.get_cancel())
+      return;
   }
 
   /* Update images needed for true displacement. */
@@ -1374,23 +1473,25 @@ void GeometryManager::device_update(Device *device,
       }
     });
 
+    /* Evaluate the displacement of all meshes in a single shader evaluation. */
+    vector<Mesh *> displace_meshes;
+
     foreach (Geometry *geom, scene->geometry) {
       if (geom->need_update) {
         if (geom->type == Geometry::MESH) {
-          Mesh *mesh = static_cast<Mesh *>(geom);
-          if (displace(device, dscene, scene, mesh, progress)) {
-            displacement_done = true;
-          }
+          displace_meshes.push_back(static_cast<Mesh *>(geom));
         }
 
         if (geom->need_build_bvh(bvh_layout)) {
           num_bvh++;
         }
       }
-
-      if (progress.get_cancel())
-        return;
     }
+
+    displacement_done = displace(device, dscene, scene, displace_meshes, progress);
+
+    if (progress.get_cancel())
+      return;
   }
 
   /* Device re-update after displacement. */
@@ -1513,6 +1614,7 @@ void GeometryManager::device_free(Device *device, DeviceScene *dscene)
   dscene->prim_time.free();
   dscene->tri_shader.free();
   dscene->tri_vnormal.free();
+  dscene->tri_vnormal_oct.free();
   dscene->tri_vindex.free();
   dscene->tri_patch.free();
   dscene->tri_patch_uv.free();
@@ -1553,6 +1655,13 @@ void GeometryManager::collect_statistics(const Scene *scene, RenderStats *stats)
     stats->mesh.geometry.add_entry(
         NamedSizeEntry(string(geometry->name.c_str()), geometry->get_total_size_in_bytes()));
   }
+
+  if (scene->params.use_compact_geometry) {
+    stats->mesh.compact_savings.add_entry(NamedSizeEntry(
+        "Vertex normals", num_compact_normals * (sizeof(float4) - sizeof(uint))));
+    stats->mesh.compact_savings.add_entry(NamedSizeEntry(
+        "Float2 attributes", num_compact_float2 * (sizeof(float2) - sizeof(float))));
+  }
 }
 
 CCL_NAMESPACE_END
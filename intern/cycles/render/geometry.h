@@ -166,7 +166,16 @@ class GeometryManager {
   void collect_statistics(const Scene *scene, RenderStats *stats);
 
  protected:
-  bool displace(Device *device, DeviceScene *dscene, Scene *scene, Mesh *mesh, Progress &progress);
+  /* Number of vertex normals and float2 attribute elements in compact storage. */
+  size_t num_compact_normals;
+  size_t num_compact_float2;
+
+  bool displace(Device *device,
+                DeviceScene *dscene,
+                Scene *scene,
+                const vector<Mesh *> &meshes,
+                Progress &progress);
+  void displace_apply(Scene *scene, Mesh *mesh, const float4 *offset);
 
   void create_volume_mesh(Volume *volume, Progress &progress);
 
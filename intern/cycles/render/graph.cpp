@@ -383,6 +383,12 @@ void ShaderGraph::finalize(Scene *scene, bool do_bump, bool do_simplify, bool bu
     if (do_bump)
       bump_from_displacement(bump_in_object_space);
 
+    /* Only images read through the texture cache have mipmaps to pick from. */
+    if (scene->params.use_texture_cache && !scene->shader_manager->use_osl() &&
+        scene->device->info.type == DEVICE_CPU) {
+      refine_image_derivatives();
+    }
+
     ShaderInput *surface_in = output()->input("Surface");
     ShaderInput *volume_in = output()->input("Volume");
 
@@ -953,6 +959,52 @@ void ShaderGraph::refine_bump_nodes()
   }
 }
 
+void ShaderGraph::refine_image_derivatives()
+{
+  /* similar to refine_bump_nodes(), the sub-graph defined from the "Vector" input of
+   * image texture nodes is copied to the "VectorDx" and "VectorDy" inputs, with texture
+   * coordinates shifted by ray differentials. The difference of these is the footprint
+   * of the lookup, which selects the mipmap level. */
+
+  foreach (ShaderNode *node, nodes) {
+    if (node->type != ImageTextureNode::node_type) {
+      continue;
+    }
+
+    /* Nodes that are themselves shifted for bump mapping already sample a slightly
+     * different position, there is no need for their derivatives. */
+    ImageTextureNode *image_node = static_cast<ImageTextureNode *>(node);
+    ShaderInput *vector_input = node->input("Vector");
+    if (image_node->projection != NODE_IMAGE_PROJ_FLAT || !vector_input->link ||
+        node->bump == SHADER_BUMP_DX || node->bump == SHADER_BUMP_DY) {
+      continue;
+    }
+
+    ShaderNodeSet nodes_vector;
+    ShaderNodeMap nodes_dx;
+    ShaderNodeMap nodes_dy;
+
+    find_dependencies(nodes_vector, vector_input);
+
+    copy_nodes(nodes_vector, nodes_dx);
+    copy_nodes(nodes_vector, nodes_dy);
+
+    foreach (NodePair &pair, nodes_dx)
+      pair.second->bump = SHADER_BUMP_DX;
+    foreach (NodePair &pair, nodes_dy)
+      pair.second->bump = SHADER_BUMP_DY;
+
+    ShaderOutput *out = vector_input->link;
+    connect(nodes_dx[out->parent]->output(out->name()), node->input("VectorDx"));
+    connect(nodes_dy[out->parent]->output(out->name()), node->input("VectorDy"));
+
+    foreach (NodePair &pair, nodes_dx)
+      add(pair.second);
+    foreach (NodePair &pair, nodes_dy)
+      add(pair.second);
+  }
+}
+
 void ShaderGraph::bump_from_displacement(bool use_object_space)
 {
   /* generate bump mapping automatically from displacement. bump mapping is
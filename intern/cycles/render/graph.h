@@ -220,6 +220,12 @@ class ShaderNode : public Node {
   {
     return false;
   }
+  /* Compiling the node acquires images or other resources from the scene, so its compiled
+   * code is only valid for this node instance. */
+  virtual bool has_scene_resources()
+  {
+    return false;
+  }
   vector<ShaderInput *> inputs;
   vector<ShaderOutput *> outputs;
 
@@ -373,6 +379,7 @@ class ShaderGraph : public NodeOwner {
   void break_cycles(ShaderNode *node, vector<bool> &visited, vector<bool> &on_stack);
   void bump_from_displacement(bool use_object_space);
   void refine_bump_nodes();
+  void refine_image_derivatives();
   void expand();
   void default_inputs(bool do_osl);
   void transform_multi_closure(ShaderNode *node, ShaderOutput *weight_out, bool volume);
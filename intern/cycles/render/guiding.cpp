@@ -0,0 +1,543 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/guiding.h"
+#include "render/integrator.h"
+#include "render/object.h"
+#include "render/scene.h"
+
+#include "device/device.h"
+
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Leaves are split when more path vertices than this times the square root of the samples per
+ * pixel of the iteration were recorded in them, the value suggested in the paper. */
+#define GUIDING_SPATIAL_THRESHOLD 12000.0f
+#define GUIDING_MAX_SPATIAL_DEPTH 24
+/* Quadrants are subdivided when they hold more than this fraction of the energy. */
+#define GUIDING_DIRECTIONAL_THRESHOLD 0.01f
+#define GUIDING_MAX_DIRECTIONAL_DEPTH 20
+/* Fraction of the bounce directions sampled from the BSDF rather than the learned distribution,
+ * which keeps the variance bounded where the distribution is poor. */
+#define GUIDING_BSDF_FRACTION 0.5f
+
+/* Same as guiding_direction_to_square() in the kernel. */
+static float2 guiding_direction_to_square(const float3 &D)
+{
+  const float cos_theta = clamp(D.z, -1.0f, 1.0f);
+  float phi = atan2f(D.y, D.x);
+  if (phi < 0.0f) {
+    phi += M_2PI_F;
+  }
+
+  return make_float2(min(0.5f * (cos_theta + 1.0f), 1.0f - FLT_EPSILON),
+                     min(phi * M_1_2PI_F, 1.0f - FLT_EPSILON));
+}
+
+static int guiding_quadrant(float2 &p)
+{
+  int quadrant = 0;
+
+  if (p.x >= 0.5f) {
+    quadrant |= 1;
+    p.x -= 0.5f;
+  }
+  if (p.y >= 0.5f) {
+    quadrant |= 2;
+    p.y -= 0.5f;
+  }
+
+  p.x *= 2.0f;
+  p.y *= 2.0f;
+
+  return quadrant;
+}
+
+static KernelGuidingDirectionalNode guiding_directional_node(const float energy[4])
+{
+  KernelGuidingDirectionalNode node;
+  for (int i = 0; i < 4; i++) {
+    node.energy[i] = energy[i];
+    node.child[i] = 0;
+  }
+  return node;
+}
+
+/* Directional Tree */
+
+GuidingDirectionalTree::GuidingDirectionalTree()
+{
+  const float energy[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  nodes.push_back(guiding_directional_node(energy));
+}
+
+float GuidingDirectionalTree::energy() const
+{
+  const KernelGuidingDirectionalNode &root = nodes[0];
+  return root.energy[0] + root.energy[1] + root.energy[2] + root.energy[3];
+}
+
+void GuidingDirectionalTree::record(const float3 &D, float energy)
+{
+  float2 p = guiding_direction_to_square(D);
+  int index = 0;
+
+  while (true) {
+    const int quadrant = guiding_quadrant(p);
+    const int child = nodes[index].child[quadrant];
+
+    if (child == 0) {
+      nodes[index].energy[quadrant] += energy;
+      return;
+    }
+    index = child;
+  }
+}
+
+void GuidingDirectionalTree::build_sums()
+{
+  build_sums_recursive(0);
+}
+
+float GuidingDirectionalTree::build_sums_recursive(int index)
+{
+  float sum = 0.0f;
+
+  for (int quadrant = 0; quadrant < 4; quadrant++) {
+    const int child = nodes[index].child[quadrant];
+    if (child != 0) {
+      nodes[index].energy[quadrant] = build_sums_recursive(child);
+    }
+    sum += nodes[index].energy[quadrant];
+  }
+
+  return sum;
+}
+
+GuidingDirectionalTree GuidingDirectionalTree::refine(float fraction, int max_depth) const
+{
+  GuidingDirectionalTree result;
+
+  const float total = energy();
+  if (total > 0.0f) {
+    refine_recursive(result, 0, 0, nodes[0].energy, fraction * total, 1, max_depth);
+  }
+
+  return result;
+}
+
+/* Subdivide the quadrants of node result_index in the result, which covers the same directions
+ * as node index of this tree with the given energies, or as a quadrant without children of this
+ * tree if index is -1. */
+void GuidingDirectionalTree::refine_recursive(GuidingDirectionalTree &result,
+                                              int result_index,
+                                              int index,
+                                              const float energy[4],
+                                              float threshold,
+                                              int depth,
+                                              int max_depth) const
+{
+  if (depth >= max_depth) {
+    return;
+  }
+
+  for (int quadrant = 0; quadrant < 4; quadrant++) {
+    if (!(energy[quadrant] > threshold)) {
+      continue;
+    }
+
+    /* Quadrants without children are assumed to have their energy spread evenly. */
+    const int child = (index != -1) ? nodes[index].child[quadrant] : 0;
+    float child_energy[4];
+    for (int i = 0; i < 4; i++) {
+      child_energy[i] = (child != 0) ? nodes[child].energy[i] : 0.25f * energy[quadrant];
+    }
+
+    const int result_child = result.nodes.size();
+    const float zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    result.nodes.push_back(guiding_directional_node(zero));
+    result.nodes[result_index].child[quadrant] = result_child;
+
+    refine_recursive(result,
+                     result_child,
+                     (child != 0) ? child : -1,
+                     child_energy,
+                     threshold,
+                     depth + 1,
+                     max_depth);
+  }
+}
+
+float GuidingDirectionalTree::pdf(const float3 &D) const
+{
+  float2 p = guiding_direction_to_square(D);
+  float pdf = 1.0f;
+  int index = 0;
+
+  while (true) {
+    const KernelGuidingDirectionalNode &node = nodes[index];
+    const float total = node.energy[0] + node.energy[1] + node.energy[2] + node.energy[3];
+    const int quadrant = guiding_quadrant(p);
+
+    if (!(total > 0.0f)) {
+      return 0.0f;
+    }
+
+    pdf *= 4.0f * node.energy[quadrant] / total;
+
+    if (node.child[quadrant] == 0) {
+      break;
+    }
+    index = node.child[quadrant];
+  }
+
+  return pdf * M_1_PI_F * 0.25f;
+}
+
+/* Spatial Tree */
+
+GuidingSpatialNode::GuidingSpatialNode(const BoundBox &bounds, int depth)
+    : bounds(bounds),
+      depth(depth),
+      axis(-1),
+      child(-1),
+      has_sampling(false),
+      num_samples(0),
+      training_offset(0)
+{
+}
+
+GuidingTree::GuidingTree(const BoundBox &scene_bounds)
+{
+  /* Cube around the scene, so splitting the axes in turn keeps the leaves from getting thin. */
+  BoundBox bounds = scene_bounds;
+  if (!bounds.valid()) {
+    bounds = BoundBox(make_float3(-1.0f, -1.0f, -1.0f), make_float3(1.0f, 1.0f, 1.0f));
+  }
+
+  const float3 center = bounds.center();
+  const float3 size = bounds.size();
+  const float half_size = max(0.5f * max(max(size.x, size.y), size.z) * 1.01f, 1e-4f);
+  const float3 extent = make_float3(half_size, half_size, half_size);
+
+  nodes.push_back(GuidingSpatialNode(BoundBox(center - extent, center + extent), 0));
+}
+
+int GuidingTree::find_leaf(const float3 &P) const
+{
+  int index = 0;
+
+  while (nodes[index].axis != -1) {
+    const GuidingSpatialNode &node = nodes[index];
+    const float split = 0.5f * (node.bounds.min[node.axis] + node.bounds.max[node.axis]);
+    index = node.child + ((P[node.axis] >= split) ? 1 : 0);
+  }
+
+  return index;
+}
+
+void GuidingTree::record(const float3 &P, const float3 &D, float energy)
+{
+  GuidingSpatialNode &leaf = nodes[find_leaf(P)];
+  leaf.num_samples++;
+
+  if (energy > 0.0f) {
+    leaf.training.record(D, energy);
+  }
+}
+
+void GuidingTree::update(int iteration_samples)
+{
+  const float threshold = GUIDING_SPATIAL_THRESHOLD * sqrtf((float)max(iteration_samples, 1));
+  const size_t num_nodes = nodes.size();
+
+  for (size_t i = 0; i < num_nodes; i++) {
+    GuidingSpatialNode &node = nodes[i];
+    if (node.axis != -1) {
+      continue;
+    }
+
+    /* Keep the previous distribution where nothing was recorded. */
+    node.training.build_sums();
+    if (node.training.energy() > 0.0f) {
+      node.sampling = node.training;
+      node.has_sampling = true;
+    }
+
+    node.training = node.sampling.refine(GUIDING_DIRECTIONAL_THRESHOLD,
+                                         GUIDING_MAX_DIRECTIONAL_DEPTH);
+
+    /* Children are added at the end, after the nodes this loop visits. */
+    split_recursive(i, threshold);
+  }
+}
+
+void GuidingTree::split_recursive(int index, float threshold)
+{
+  if (nodes[index].num_samples <= threshold || nodes[index].depth >= GUIDING_MAX_SPATIAL_DEPTH) {
+    nodes[index].num_samples = 0;
+    return;
+  }
+
+  /* Split at the middle along the axes in turn, children start with the distributions of their
+   * parent and assume the samples were divided evenly between them. */
+  GuidingSpatialNode parent = nodes[index];
+  const int axis = parent.depth % 3;
+  const float split = 0.5f * (parent.bounds.min[axis] + parent.bounds.max[axis]);
+
+  const int child = nodes.size();
+  for (int i = 0; i < 2; i++) {
+    BoundBox bounds = parent.bounds;
+    if (i == 0) {
+      bounds.max[axis] = split;
+    }
+    else {
+      bounds.min[axis] = split;
+    }
+
+    GuidingSpatialNode node(bounds, parent.depth + 1);
+    node.has_sampling = parent.has_sampling;
+    node.sampling = parent.sampling;
+    node.training = parent.training;
+    node.num_samples = parent.num_samples / 2;
+    nodes.push_back(node);
+  }
+
+  GuidingSpatialNode &node = nodes[index];
+  node.axis = axis;
+  node.child = child;
+  node.has_sampling = false;
+  node.sampling = GuidingDirectionalTree();
+  node.training = GuidingDirectionalTree();
+  node.num_samples = 0;
+
+  split_recursive(child, threshold);
+  split_recursive(child + 1, threshold);
+}
+
+bool GuidingTree::has_sampling() const
+{
+  foreach (const GuidingSpatialNode &node, nodes) {
+    if (node.has_sampling) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t GuidingTree::num_kernel_directional_nodes() const
+{
+  size_t num_nodes = 0;
+  foreach (const GuidingSpatialNode &node, nodes) {
+    if (node.axis == -1) {
+      num_nodes += node.training.nodes.size();
+      if (node.has_sampling) {
+        num_nodes += node.sampling.nodes.size();
+      }
+    }
+  }
+  return num_nodes;
+}
+
+/* Append the nodes of the tree with child indices offset to their position in the array. */
+static int guiding_pack_directional(const GuidingDirectionalTree &tree,
+                                    KernelGuidingDirectionalNode *kdirectional,
+                                    int &offset)
+{
+  const int root = offset;
+
+  foreach (const KernelGuidingDirectionalNode &node, tree.nodes) {
+    KernelGuidingDirectionalNode &knode = kdirectional[offset++];
+    knode = node;
+    for (int i = 0; i < 4; i++) {
+      if (knode.child[i] != 0) {
+        knode.child[i] += root;
+      }
+    }
+  }
+
+  return root;
+}
+
+void GuidingTree::pack(KernelGuidingSpatialNode *kspatial,
+                       KernelGuidingDirectionalNode *kdirectional)
+{
+  int offset = 0;
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    GuidingSpatialNode &node = nodes[i];
+    KernelGuidingSpatialNode &knode = kspatial[i];
+    memset(&knode, 0, sizeof(knode));
+
+    knode.axis = node.axis;
+    knode.child = node.child;
+    knode.sampling_root = -1;
+    knode.training_root = -1;
+
+    if (node.axis != -1) {
+      knode.split = 0.5f * (node.bounds.min[node.axis] + node.bounds.max[node.axis]);
+      continue;
+    }
+
+    if (node.has_sampling) {
+      knode.sampling_root = guiding_pack_directional(node.sampling, kdirectional, offset);
+    }
+    node.training_offset = guiding_pack_directional(node.training, kdirectional, offset);
+    knode.training_root = node.training_offset;
+
+    /* Energy is recorded separately, the training tree only provides the structure. */
+    for (size_t j = 0; j < node.training.nodes.size(); j++) {
+      for (int quadrant = 0; quadrant < 4; quadrant++) {
+        kdirectional[node.training_offset + j].energy[quadrant] = 0.0f;
+      }
+    }
+  }
+}
+
+void GuidingTree::read_training(const float *radiance, const uint *num_samples)
+{
+  for (size_t i = 0; i < nodes.size(); i++) {
+    GuidingSpatialNode &node = nodes[i];
+    if (node.axis != -1) {
+      continue;
+    }
+
+    node.num_samples = num_samples[i];
+
+    for (size_t j = 0; j < node.training.nodes.size(); j++) {
+      const float *energy = radiance + (node.training_offset + j) * 4;
+      for (int quadrant = 0; quadrant < 4; quadrant++) {
+        node.training.nodes[j].energy[quadrant] = energy[quadrant];
+      }
+    }
+  }
+}
+
+/* Manager */
+
+GuidingManager::GuidingManager() : iteration(0), iteration_start_sample(0), training(false)
+{
+}
+
+GuidingManager::~GuidingManager()
+{
+}
+
+static BoundBox guiding_scene_bounds(Scene *scene)
+{
+  BoundBox bounds = BoundBox::empty;
+  foreach (Object *object, scene->objects) {
+    if (object->bounds.valid()) {
+      bounds.grow(object->bounds);
+    }
+  }
+  return bounds;
+}
+
+void GuidingManager::update_pass(
+    Device *device, DeviceScene *dscene, Scene *scene, int sample, int num_samples)
+{
+  const bool use_guiding = scene->integrator->use_guiding &&
+                           scene->integrator->method == Integrator::PATH &&
+                           device->info.type == DEVICE_CPU;
+
+  if (!use_guiding) {
+    if (tree) {
+      device_free(device, dscene);
+      device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
+    }
+    return;
+  }
+
+  /* Learn from scratch for every render, the scene may have changed since the previous. */
+  if (sample == 0 || !tree) {
+    tree.reset(new GuidingTree(guiding_scene_bounds(scene)));
+    iteration = 0;
+    iteration_start_sample = sample;
+    training = true;
+    device_update_tree(device, dscene);
+    return;
+  }
+
+  const int iteration_samples = 1 << iteration;
+  if (!training || sample < iteration_start_sample + iteration_samples) {
+    return;
+  }
+
+  /* The CPU kernel recorded the radiance in host memory. */
+  tree->read_training(dscene->guiding_training_radiance.data(),
+                      dscene->guiding_training_samples.data());
+  tree->update(iteration_samples);
+
+  iteration++;
+  iteration_start_sample = sample;
+  training = (num_samples - sample) / 2 >= (1 << iteration);
+
+  device_update_tree(device, dscene);
+
+  VLOG(1) << "Path guiding iteration " << iteration << " after " << sample << " samples, "
+          << tree->nodes.size() << " spatial nodes, " << tree->num_kernel_directional_nodes()
+          << " directional nodes" << (training ? "." : ", done learning.");
+}
+
+void GuidingManager::device_update_tree(Device *device, DeviceScene *dscene)
+{
+  const size_t num_spatial_nodes = tree->nodes.size();
+  const size_t num_directional_nodes = tree->num_kernel_directional_nodes();
+
+  KernelGuidingSpatialNode *kspatial = dscene->guiding_spatial_nodes.alloc(num_spatial_nodes);
+  KernelGuidingDirectionalNode *kdirectional = dscene->guiding_directional_nodes.alloc(
+      num_directional_nodes);
+  tree->pack(kspatial, kdirectional);
+
+  float *radiance = dscene->guiding_training_radiance.alloc(num_directional_nodes * 4);
+  memset(radiance, 0, sizeof(float) * num_directional_nodes * 4);
+  uint *samples = dscene->guiding_training_samples.alloc(num_spatial_nodes);
+  memset(samples, 0, sizeof(uint) * num_spatial_nodes);
+
+  dscene->guiding_spatial_nodes.copy_to_device();
+  dscene->guiding_directional_nodes.copy_to_device();
+  dscene->guiding_training_radiance.copy_to_device();
+  dscene->guiding_training_samples.copy_to_device();
+
+  KernelIntegrator *kintegrator = &dscene->data.integrator;
+  kintegrator->use_guiding = tree->has_sampling();
+  kintegrator->use_guiding_training = training;
+  kintegrator->guiding_bsdf_fraction = GUIDING_BSDF_FRACTION;
+
+  device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
+}
+
+void GuidingManager::device_free(Device *, DeviceScene *dscene)
+{
+  /* The recorded radiance is freed along with the tree structure, so start learning over. */
+  tree.reset();
+
+  dscene->guiding_spatial_nodes.free();
+  dscene->guiding_directional_nodes.free();
+  dscene->guiding_training_radiance.free();
+  dscene->guiding_training_samples.free();
+
+  KernelIntegrator *kintegrator = &dscene->data.integrator;
+  kintegrator->use_guiding = false;
+  kintegrator->use_guiding_training = false;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GUIDING_H__
+#define __GUIDING_H__
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_types.h"
+#include "util/util_unique_ptr.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class Device;
+class DeviceScene;
+class Scene;
+
+/* Quadtree over the directions at a region of the scene, with the same mapping of directions
+ * to quadrants as the kernel. Holds the energy of the light arriving from each quadrant. */
+class GuidingDirectionalTree {
+ public:
+  GuidingDirectionalTree();
+
+  /* Total energy of all quadrants. */
+  float energy() const;
+  /* Add energy to the quadrant without children containing direction D. */
+  void record(const float3 &D, float energy);
+  /* Set the energy of quadrants with children to the sum of their children, after recording
+   * energy in the quadrants without. */
+  void build_sums();
+  /* Tree with quadrants subdivided where they hold more than the fraction of the total energy
+   * and merged where they hold less, and all energies zero. */
+  GuidingDirectionalTree refine(float fraction, int max_depth) const;
+
+  /* Probability density over the sphere of sampling direction D proportional to the energy. */
+  float pdf(const float3 &D) const;
+
+  /* Root first, a child index of 0 marks a quadrant without children. */
+  vector<KernelGuidingDirectionalNode> nodes;
+
+ protected:
+  float build_sums_recursive(int index);
+  void refine_recursive(GuidingDirectionalTree &result,
+                        int result_index,
+                        int index,
+                        const float energy[4],
+                        float threshold,
+                        int depth,
+                        int max_depth) const;
+};
+
+struct GuidingSpatialNode {
+  BoundBox bounds;
+  int depth;
+
+  /* Split axis and index of the first of both children, -1 for leaves. */
+  int axis;
+  int child;
+
+  /* Leaves: distribution to sample from, if anything was learned yet, and the tree to record
+   * the radiance of the current iteration in. */
+  bool has_sampling;
+  GuidingDirectionalTree sampling;
+  GuidingDirectionalTree training;
+  /* Number of path vertices recorded in the current iteration. */
+  uint num_samples;
+  /* Index of the training tree in the kernel directional nodes. */
+  int training_offset;
+
+  explicit GuidingSpatialNode(const BoundBox &bounds, int depth);
+};
+
+/* Spatial-directional tree (SD-tree) of the light arriving at surfaces in the scene, as in
+ * "Practical Path Guiding for Efficient Light-Transport Simulation" by Müller et al. A binary
+ * tree over the scene bounds, split where many path vertices were recorded, holds directional
+ * quadtrees at its leaves. It is learned in iterations, each using the distribution learned in
+ * the previous one for sampling and recording radiance for the next one. */
+class GuidingTree {
+ public:
+  explicit GuidingTree(const BoundBox &bounds);
+
+  int find_leaf(const float3 &P) const;
+  /* Record energy arriving at P from direction D, like the kernel does during rendering. */
+  void record(const float3 &P, const float3 &D, float energy);
+
+  /* Sample with the energy recorded in the iteration that ends, and refine the tree for
+   * recording in the next one. The iteration had iteration_samples samples per pixel. */
+  void update(int iteration_samples);
+  bool has_sampling() const;
+
+  /* Kernel data, for which pack() also stores the training tree offsets that
+   * read_training() reads the recorded energy with. */
+  size_t num_kernel_directional_nodes() const;
+  void pack(KernelGuidingSpatialNode *kspatial, KernelGuidingDirectionalNode *kdirectional);
+  void read_training(const float *radiance, const uint *num_samples);
+
+  vector<GuidingSpatialNode> nodes;
+
+ protected:
+  void split_recursive(int index, float threshold);
+};
+
+/* Learns the tree between the passes of progressive rendering on the CPU. */
+class GuidingManager {
+ public:
+  GuidingManager();
+  ~GuidingManager();
+
+  /* Called before rendering each pass, with the number of samples rendered before it and the
+   * total number of samples. Iterations of learning double in length, and learning stops once
+   * the remaining samples are fewer than twice those of the next iteration. */
+  void update_pass(Device *device, DeviceScene *dscene, Scene *scene, int sample, int num_samples);
+  void device_free(Device *device, DeviceScene *dscene);
+
+ protected:
+  void device_update_tree(Device *device, DeviceScene *dscene);
+
+  unique_ptr<GuidingTree> tree;
+  int iteration;
+  int iteration_start_sample;
+  bool training;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __GUIDING_H__ */
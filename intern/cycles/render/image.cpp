@@ -21,6 +21,7 @@
 #include "render/image_vdb.h"
 #include "render/scene.h"
 #include "render/stats.h"
+#include "render/texture_cache.h"
 
 #include "util/util_foreach.h"
 #include "util/util_image.h"
@@ -73,6 +74,8 @@ const char *name_from_type(ImageDataType type)
       return "ushort4";
     case IMAGE_DATA_TYPE_USHORT:
       return "ushort";
+    case IMAGE_DATA_TYPE_TEXTURE_CACHE:
+      return "texture_cache";
     case IMAGE_DATA_NUM_TYPES:
       assert(!"System enumerator type, should never be used");
       return "";
@@ -295,6 +298,7 @@ ImageManager::ImageManager(const DeviceInfo &info)
 {
   need_update = true;
   osl_texture_system = NULL;
+  texture_cache = NULL;
   animation_frame = 0;
 
   /* Set image limits */
@@ -305,6 +309,8 @@ ImageManager::~ImageManager()
 {
   for (size_t slot = 0; slot < images.size(); slot++)
     assert(!images[slot]);
+
+  delete texture_cache;
 }
 
 void ImageManager::set_osl_texture_system(void *texture_system)
@@ -656,9 +662,6 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
   load_image_metadata(img);
   ImageDataType type = img->metadata.type;
 
-  /* Name for debugging. */
-  img->mem_name = string_printf("__tex_image_%s_%03d", name_from_type(type), slot);
-
   /* Free previous texture in slot. */
   if (img->mem) {
     thread_scoped_lock device_lock(device_mutex);
@@ -666,13 +669,28 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     img->mem = NULL;
   }
 
+  /* Images loaded on demand only store a handle for the kernel. */
+  void *cache_handle = (texture_cache) ? texture_cache_handle(img) : NULL;
+  if (cache_handle) {
+    type = IMAGE_DATA_TYPE_TEXTURE_CACHE;
+  }
+
+  /* Name for debugging. */
+  img->mem_name = string_printf("__tex_image_%s_%03d", name_from_type(type), slot);
+
   img->mem = new device_texture(
       device, img->mem_name.c_str(), slot, type, img->params.interpolation, img->params.extension);
   img->mem->info.use_transform_3d = img->metadata.use_transform_3d;
   img->mem->info.transform_3d = img->metadata.transform_3d;
 
   /* Create new texture. */
-  if (type == IMAGE_DATA_TYPE_FLOAT4) {
+  if (type == IMAGE_DATA_TYPE_TEXTURE_CACHE) {
+    thread_scoped_lock device_lock(device_mutex);
+    void **handle = (void **)img->mem->alloc(1, 1);
+
+    handle[0] = cache_handle;
+  }
+  else if (type == IMAGE_DATA_TYPE_FLOAT4) {
     if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
@@ -774,6 +792,10 @@ void ImageManager::device_free_image(Device *, int slot)
     return;
   }
 
+  if (texture_cache && img->mem && img->mem->info.data_type == IMAGE_DATA_TYPE_TEXTURE_CACHE) {
+    texture_cache->invalidate(img->loader->osl_filepath().string());
+  }
+
   if (osl_texture_system) {
 #ifdef WITH_OSL
     ustring filepath = img->loader->osl_filepath();
@@ -805,6 +827,8 @@ void ImageManager::device_update(Device *device, Scene *scene, Progress &progres
     }
   });
 
+  device_update_texture_cache(device, scene);
+
   TaskPool pool;
   for (size_t slot = 0; slot < images.size(); slot++) {
     Image *img = images[slot];
@@ -871,6 +895,57 @@ void ImageManager::device_free(Device *device)
     device_free_image(device, slot);
   }
   images.clear();
+
+  if (texture_cache) {
+    device->set_texture_system(NULL);
+    delete texture_cache;
+    texture_cache = NULL;
+  }
+}
+
+void ImageManager::device_update_texture_cache(Device *device, Scene *scene)
+{
+  /* With OSL, images are read through the texture system of OSL instead. */
+  if (texture_cache || !scene->params.use_texture_cache || osl_texture_system) {
+    return;
+  }
+
+  /* Check if the device can use it before creating the texture system. */
+  if (!device->set_texture_system(NULL)) {
+    VLOG(1) << "Texture cache not supported by device, loading images fully.";
+    return;
+  }
+
+  texture_cache = new TextureCache(scene->params);
+  device->set_texture_system(texture_cache->get_texture_system());
+}
+
+void *ImageManager::texture_cache_handle(Image *img)
+{
+  /* Only images read from files, packed and generated images are in memory already. */
+  const ustring filepath = img->loader->osl_filepath();
+  if (filepath.empty()) {
+    return NULL;
+  }
+
+  /* 2D images, like the texture system. */
+  const ImageMetaData &metadata = img->metadata;
+  if (metadata.depth > 1 || metadata.channels < 1 || metadata.channels > 4) {
+    return NULL;
+  }
+
+  /* The texture system can't convert to scene linear, sRGB is converted in the kernel. */
+  if (metadata.colorspace != u_colorspace_raw && metadata.colorspace != u_colorspace_srgb) {
+    return NULL;
+  }
+
+  /* The texture system always associates alpha. */
+  const bool has_alpha = (metadata.channels == 2 || metadata.channels == 4);
+  if (has_alpha && !image_associate_alpha(img)) {
+    return NULL;
+  }
+
+  return texture_cache->get_handle(filepath.string());
 }
 
 void ImageManager::collect_statistics(RenderStats *stats)
@@ -879,6 +954,10 @@ void ImageManager::collect_statistics(RenderStats *stats)
     stats->image.textures.add_entry(
         NamedSizeEntry(image->loader->name(), image->mem->memory_size()));
   }
+
+  if (texture_cache) {
+    texture_cache->collect_statistics(&stats->image);
+  }
 }
 
 CCL_NAMESPACE_END
@@ -39,6 +39,7 @@ class Progress;
 class RenderStats;
 class Scene;
 class ColorSpaceProcessor;
+class TextureCache;
 class VDBImageLoader;
 
 /* Image Parameters */
@@ -216,6 +217,7 @@ class ImageManager {
 
   vector<Image *> images;
   void *osl_texture_system;
+  TextureCache *texture_cache;
 
   int add_image_slot(ImageLoader *loader, const ImageParams &params, const bool builtin);
   void add_image_user(int slot);
@@ -229,6 +231,9 @@ class ImageManager {
   void device_load_image(Device *device, Scene *scene, int slot, Progress *progress);
   void device_free_image(Device *device, int slot);
 
+  void device_update_texture_cache(Device *device, Scene *scene);
+  void *texture_cache_handle(Image *img);
+
   friend class ImageHandle;
 };
 
@@ -79,6 +79,8 @@ NODE_DEFINE(Integrator)
   SOCKET_BOOLEAN(sample_all_lights_direct, "Sample All Lights Direct", true);
   SOCKET_BOOLEAN(sample_all_lights_indirect, "Sample All Lights Indirect", true);
   SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+  SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
+  SOCKET_BOOLEAN(use_guiding, "Use Guiding", false);
 
   static NodeEnum method_enum;
   method_enum.insert("path", PATH);
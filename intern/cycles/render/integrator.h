@@ -74,6 +74,8 @@ class Integrator : public Node {
   bool sample_all_lights_direct;
   bool sample_all_lights_indirect;
   float light_sampling_threshold;
+  bool use_light_tree;
+  bool use_guiding;
 
   int adaptive_min_samples;
   float adaptive_threshold;
@@ -20,6 +20,7 @@
 #include "render/film.h"
 #include "render/graph.h"
 #include "render/integrator.h"
+#include "render/light_tree.h"
 #include "render/mesh.h"
 #include "render/nodes.h"
 #include "render/object.h"
@@ -30,6 +31,7 @@
 #include "util/util_foreach.h"
 #include "util/util_hash.h"
 #include "util/util_logging.h"
+#include "util/util_map.h"
 #include "util/util_path.h"
 #include "util/util_progress.h"
 #include "util/util_task.h"
@@ -528,6 +530,176 @@ void LightManager::device_update_distribution(Device *,
   }
 }
 
+/* Rough estimate of the power of a shader, for the light tree. */
+static float light_tree_shader_energy(Shader *shader, map<Shader *, float> &shader_energy)
+{
+  map<Shader *, float>::iterator it = shader_energy.find(shader);
+  if (it != shader_energy.end()) {
+    return it->second;
+  }
+
+  /* Textured or otherwise varying emission is assumed to be of unit strength. */
+  float3 emission;
+  const float energy = (shader->is_constant_emission(&emission)) ? fabsf(average(emission)) :
+                                                                    1.0f;
+  shader_energy[shader] = energy;
+  return energy;
+}
+
+void LightManager::device_update_tree(Device *,
+                                      DeviceScene *dscene,
+                                      Scene *scene,
+                                      Progress &progress)
+{
+  KernelIntegrator *kintegrator = &dscene->data.integrator;
+
+  kintegrator->use_light_tree = false;
+  kintegrator->light_tree_num_infinite = 0;
+
+  /* Lights are selected by a fixed distribution when sampling all lights. */
+  if (!kintegrator->use_direct_light || !scene->integrator->use_light_tree ||
+      scene->integrator->method != Integrator::PATH) {
+    return;
+  }
+
+  progress.set_status("Updating Lights", "Building light tree");
+
+  vector<Light *> enabled_lights;
+  foreach (Light *light, scene->lights) {
+    if (light->is_enabled) {
+      enabled_lights.push_back(light);
+    }
+  }
+
+  const int num_distribution = kintegrator->num_distribution;
+  const KernelLightDistribution *distribution = dscene->light_distribution.data();
+  vector<LightTreePrimitive> primitives;
+  vector<uint> infinite_lights;
+  map<Shader *, float> shader_energy;
+
+  primitives.reserve(num_distribution);
+
+  for (int index = 0; index < num_distribution; index++) {
+    const KernelLightDistribution &kdistribution = distribution[index];
+    LightTreePrimitive prim;
+    prim.distribution_index = index;
+    prim.bbox = BoundBox::empty;
+
+    if (kdistribution.prim >= 0) {
+      /* Mesh light triangle, emitting from both sides. */
+      Object *object = scene->objects[kdistribution.mesh_light.object_id];
+      Mesh *mesh = static_cast<Mesh *>(object->geometry);
+      const size_t i = kdistribution.prim - mesh->prim_offset;
+      Mesh::Triangle t = mesh->get_triangle(i);
+      if (!t.valid(&mesh->verts[0])) {
+        continue;
+      }
+
+      float3 p1 = mesh->verts[t.v[0]];
+      float3 p2 = mesh->verts[t.v[1]];
+      float3 p3 = mesh->verts[t.v[2]];
+
+      if (!mesh->transform_applied) {
+        p1 = transform_point(&object->tfm, p1);
+        p2 = transform_point(&object->tfm, p2);
+        p3 = transform_point(&object->tfm, p3);
+      }
+
+      int shader_index = mesh->shader[i];
+      Shader *shader = (shader_index < mesh->used_shaders.size()) ?
+                           mesh->used_shaders[shader_index] :
+                           scene->default_surface;
+
+      prim.bbox.grow(p1);
+      prim.bbox.grow(p2);
+      prim.bbox.grow(p3);
+      prim.cone = LightTreeCone::omnidirectional();
+      prim.energy = light_tree_shader_energy(shader, shader_energy) * M_PI_F *
+                    triangle_area(p1, p2, p3);
+    }
+    else {
+      Light *light = enabled_lights[~kdistribution.prim];
+      Shader *shader = (light->shader) ? light->shader : scene->default_light;
+      const float strength = fabsf(average(light->strength)) *
+                             light_tree_shader_energy(shader, shader_energy);
+
+      if (light->type == LIGHT_DISTANT || light->type == LIGHT_BACKGROUND) {
+        /* Not in the tree, picked with a fixed probability instead. */
+        infinite_lights.push_back(index);
+        continue;
+      }
+      else if (light->type == LIGHT_AREA) {
+        /* One sided quad or ellipse. */
+        const float3 axisu = light->axisu * (light->sizeu * light->size);
+        const float3 axisv = light->axisv * (light->sizev * light->size);
+        prim.bbox.grow(light->co - 0.5f * axisu - 0.5f * axisv);
+        prim.bbox.grow(light->co + 0.5f * axisu - 0.5f * axisv);
+        prim.bbox.grow(light->co - 0.5f * axisu + 0.5f * axisv);
+        prim.bbox.grow(light->co + 0.5f * axisu + 0.5f * axisv);
+        prim.cone = LightTreeCone(safe_normalize(light->dir), 0.0f, M_PI_2_F);
+        prim.energy = strength * M_PI_4_F;
+      }
+      else {
+        /* Point or spot light with a radius. */
+        prim.bbox.grow(light->co, light->size);
+        if (light->type == LIGHT_SPOT) {
+          prim.cone = LightTreeCone(
+              safe_normalize(light->dir), 0.0f, min(0.5f * light->spot_angle, M_PI_2_F));
+        }
+        else {
+          prim.cone = LightTreeCone::omnidirectional();
+        }
+        prim.energy = strength;
+      }
+    }
+
+    primitives.push_back(prim);
+  }
+
+  const int num_infinite = infinite_lights.size();
+  if (progress.get_cancel() || (primitives.empty() && num_infinite == 0))
+    return;
+
+  LightTree tree(primitives, 8);
+
+  /* Distant and background lights get half of the samples if there are other lights. */
+  kintegrator->use_light_tree = true;
+  kintegrator->light_tree_num_infinite = num_infinite;
+  kintegrator->pdf_lights = 0.0f;
+  if (num_infinite) {
+    kintegrator->pdf_lights = ((primitives.empty()) ? 1.0f : 0.5f) / num_infinite;
+  }
+
+  if (!tree.nodes.empty()) {
+    KernelLightTreeNode *knodes = dscene->light_tree_nodes.alloc(tree.nodes.size());
+    memcpy(knodes, tree.nodes.data(), sizeof(KernelLightTreeNode) * tree.nodes.size());
+  }
+
+  KernelLightTreeEmitter *kemitters = dscene->light_tree_emitters.alloc(num_distribution);
+  memset(kemitters, 0, sizeof(KernelLightTreeEmitter) * num_distribution);
+  foreach (const LightTreePrimitive &prim, primitives) {
+    KernelLightTreeEmitter *kemitter = &kemitters[prim.distribution_index];
+    light_tree_bounds_to_kernel(&kemitter->bounds, prim.bbox, prim.cone, prim.energy);
+    kemitter->bit_trail = tree.bit_trails[prim.distribution_index];
+  }
+
+  /* Emitters of the leaves, followed by the distant and background lights. These are stored at
+   * the end so the kernel finds them without knowing about skipped degenerate triangles. */
+  uint *kleaf_emitters = dscene->light_tree_leaf_emitters.alloc(num_distribution);
+  memset(kleaf_emitters, 0, sizeof(uint) * num_distribution);
+  std::copy(tree.leaf_emitters.begin(), tree.leaf_emitters.end(), kleaf_emitters);
+  std::copy(infinite_lights.begin(),
+            infinite_lights.end(),
+            kleaf_emitters + num_distribution - num_infinite);
+
+  VLOG(1) << "Light tree with " << tree.nodes.size() << " nodes, " << primitives.size()
+          << " emitters and " << num_infinite << " distant or background lights.";
+
+  dscene->light_tree_nodes.copy_to_device();
+  dscene->light_tree_emitters.copy_to_device();
+  dscene->light_tree_leaf_emitters.copy_to_device();
+}
+
 static void background_cdf(
     int start, int end, int res_x, int res_y, const vector<float3> *pixels, float2 *cond_cdf)
 {
@@ -985,6 +1157,10 @@ void LightManager::device_update(Device *device,
   if (progress.get_cancel())
     return;
 
+  device_update_tree(device, dscene, scene, progress);
+  if (progress.get_cancel())
+    return;
+
   if (need_update_background) {
     device_update_background(device, dscene, scene, progress);
     if (progress.get_cancel())
@@ -1007,6 +1183,9 @@ void LightManager::device_update(Device *device,
 void LightManager::device_free(Device *, DeviceScene *dscene, const bool free_background)
 {
   dscene->light_distribution.free();
+  dscene->light_tree_nodes.free();
+  dscene->light_tree_emitters.free();
+  dscene->light_tree_leaf_emitters.free();
   dscene->lights.free();
   if (free_background) {
     dscene->light_background_marginal_cdf.free();
@@ -119,6 +119,7 @@ class LightManager {
                                   DeviceScene *dscene,
                                   Scene *scene,
                                   Progress &progress);
+  void device_update_tree(Device *device, DeviceScene *dscene, Scene *scene, Progress &progress);
   void device_update_background(Device *device,
                                 DeviceScene *dscene,
                                 Scene *scene,
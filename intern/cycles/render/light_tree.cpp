@@ -0,0 +1,281 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/light_tree.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Number of buckets per axis for finding the best split. */
+#define LIGHT_TREE_NUM_BUCKETS 12
+
+/* Cone */
+
+void LightTreeCone::grow(const LightTreeCone &other)
+{
+  const LightTreeCone *a = this;
+  const LightTreeCone *b = &other;
+  LightTreeCone result;
+
+  /* Grow the wider cone to contain the narrower one. */
+  if (b->theta_o > a->theta_o) {
+    swap(a, b);
+  }
+
+  result.theta_e = max(a->theta_e, b->theta_e);
+
+  const float theta_d = safe_acosf(dot(a->axis, b->axis));
+  if (min(theta_d + b->theta_o, M_PI_F) <= a->theta_o) {
+    result.axis = a->axis;
+    result.theta_o = a->theta_o;
+  }
+  else {
+    result.theta_o = 0.5f * (a->theta_o + theta_d + b->theta_o);
+
+    /* Rotate the axis of the wider cone towards the other one. */
+    const float3 ortho = b->axis - a->axis * dot(a->axis, b->axis);
+    const float ortho_len = len(ortho);
+
+    if (result.theta_o >= M_PI_F || ortho_len < 1e-6f) {
+      result.axis = a->axis;
+      result.theta_o = M_PI_F;
+    }
+    else {
+      const float theta_r = result.theta_o - a->theta_o;
+      result.axis = normalize(a->axis * cosf(theta_r) + ortho * (sinf(theta_r) / ortho_len));
+    }
+  }
+
+  *this = result;
+}
+
+float LightTreeCone::measure() const
+{
+  const float theta_w = min(theta_o + theta_e, M_PI_F);
+  const float sin_o = sinf(theta_o);
+  const float cos_o = cosf(theta_o);
+
+  return M_2PI_F * (1.0f - cos_o) +
+         M_PI_2_F * (2.0f * theta_w * sin_o - cosf(theta_o - 2.0f * theta_w) -
+                     2.0f * theta_o * sin_o + cos_o);
+}
+
+void light_tree_bounds_to_kernel(KernelLightTreeNode *knode,
+                                 const BoundBox &bbox,
+                                 const LightTreeCone &cone,
+                                 float energy)
+{
+  knode->bounding_box_min[0] = bbox.min.x;
+  knode->bounding_box_min[1] = bbox.min.y;
+  knode->bounding_box_min[2] = bbox.min.z;
+  knode->bounding_box_max[0] = bbox.max.x;
+  knode->bounding_box_max[1] = bbox.max.y;
+  knode->bounding_box_max[2] = bbox.max.z;
+  knode->axis[0] = cone.axis.x;
+  knode->axis[1] = cone.axis.y;
+  knode->axis[2] = cone.axis.z;
+  knode->theta_o = cone.theta_o;
+  knode->theta_e = cone.theta_e;
+  knode->energy = energy;
+}
+
+/* Tree */
+
+LightTree::LightTree(vector<LightTreePrimitive> &primitives, int max_emitters_in_leaf)
+    : primitives(primitives), max_emitters_in_leaf(max_emitters_in_leaf)
+{
+  if (primitives.empty()) {
+    return;
+  }
+
+  int num_distribution = 0;
+  foreach (const LightTreePrimitive &prim, primitives) {
+    num_distribution = max(num_distribution, prim.distribution_index + 1);
+  }
+
+  nodes.reserve(2 * primitives.size() / max(max_emitters_in_leaf / 2, 1) + 1);
+  leaf_emitters.reserve(primitives.size());
+  bit_trails.resize(num_distribution, 0);
+
+  recursive_build(0, primitives.size(), 0, 0);
+}
+
+int LightTree::recursive_build(int start, int end, uint bit_trail, int depth)
+{
+  const int node_index = nodes.size();
+  nodes.push_back(KernelLightTreeNode());
+
+  BoundBox bbox = BoundBox::empty;
+  BoundBox centroid_bbox = BoundBox::empty;
+  LightTreeCone cone = primitives[start].cone;
+  float energy = 0.0f;
+
+  for (int i = start; i < end; i++) {
+    const LightTreePrimitive &prim = primitives[i];
+    bbox.grow(prim.bbox);
+    centroid_bbox.grow(prim.centroid());
+    cone.grow(prim.cone);
+    energy += prim.energy;
+  }
+
+  KernelLightTreeNode knode;
+  memset(&knode, 0, sizeof(knode));
+  light_tree_bounds_to_kernel(&knode, bbox, cone, energy);
+
+  const int num_emitters = end - start;
+  int middle = -1;
+
+  if (num_emitters > max_emitters_in_leaf && depth < LIGHT_TREE_MAX_DEPTH - 1) {
+    middle = split(start, end, centroid_bbox);
+  }
+
+  if (middle == -1) {
+    /* Leaf. */
+    knode.child_index = leaf_emitters.size();
+    knode.num_emitters = num_emitters;
+
+    for (int i = start; i < end; i++) {
+      const int index = primitives[i].distribution_index;
+      leaf_emitters.push_back(index);
+      bit_trails[index] = bit_trail;
+    }
+
+    nodes[node_index] = knode;
+    return node_index;
+  }
+
+  nodes[node_index] = knode;
+
+  recursive_build(start, middle, bit_trail, depth + 1);
+  const int second_child = recursive_build(middle, end, bit_trail | (1u << depth), depth + 1);
+
+  nodes[node_index].child_index = second_child;
+
+  return node_index;
+}
+
+/* Partition the primitives, returning the start of the second half or -1 if they can't be
+ * split. */
+int LightTree::split(int start, int end, const BoundBox &centroid_bbox)
+{
+  struct Bucket {
+    BoundBox bbox = BoundBox::empty;
+    LightTreeCone cone;
+    float energy = 0.0f;
+    int count = 0;
+
+    void add(const BoundBox &other_bbox,
+             const LightTreeCone &other_cone,
+             float other_energy,
+             int other_count)
+    {
+      if (other_count == 0) {
+        return;
+      }
+      if (count == 0) {
+        cone = other_cone;
+      }
+      else {
+        cone.grow(other_cone);
+      }
+      bbox.grow(other_bbox);
+      energy += other_energy;
+      count += other_count;
+    }
+
+    void add(const Bucket &other)
+    {
+      add(other.bbox, other.cone, other.energy, other.count);
+    }
+
+    float cost() const
+    {
+      return (count == 0) ? 0.0f : energy * bbox.area() * cone.measure();
+    }
+  };
+
+  const float3 extent = centroid_bbox.size();
+  const float max_extent = max(extent.x, max(extent.y, extent.z));
+
+  if (max_extent == 0.0f) {
+    /* All centroids coincide, split in the middle. */
+    return (end - start > max_emitters_in_leaf) ? start + (end - start) / 2 : -1;
+  }
+
+  float min_cost = FLT_MAX;
+  int min_axis = -1, min_bucket = -1;
+
+  for (int axis = 0; axis < 3; axis++) {
+    if (extent[axis] == 0.0f) {
+      continue;
+    }
+
+    Bucket buckets[LIGHT_TREE_NUM_BUCKETS];
+    const float inv_extent = 1.0f / extent[axis];
+
+    for (int i = start; i < end; i++) {
+      const LightTreePrimitive &prim = primitives[i];
+      const float t = (prim.centroid()[axis] - centroid_bbox.min[axis]) * inv_extent;
+      const int b = clamp((int)(t * LIGHT_TREE_NUM_BUCKETS), 0, LIGHT_TREE_NUM_BUCKETS - 1);
+      buckets[b].add(prim.bbox, prim.cone, prim.energy, 1);
+    }
+
+    /* Penalize splitting thin boxes along their short axis. */
+    const float regularization = max_extent * inv_extent;
+
+    for (int split = 1; split < LIGHT_TREE_NUM_BUCKETS; split++) {
+      Bucket left, right;
+      for (int b = 0; b < split; b++) {
+        left.add(buckets[b]);
+      }
+      for (int b = split; b < LIGHT_TREE_NUM_BUCKETS; b++) {
+        right.add(buckets[b]);
+      }
+
+      if (left.count == 0 || right.count == 0) {
+        continue;
+      }
+
+      const float cost = regularization * (left.cost() + right.cost());
+      if (cost < min_cost) {
+        min_cost = cost;
+        min_axis = axis;
+        min_bucket = split;
+      }
+    }
+  }
+
+  if (min_axis == -1) {
+    return (end - start > max_emitters_in_leaf) ? start + (end - start) / 2 : -1;
+  }
+
+  const float min_axis_start = centroid_bbox.min[min_axis];
+  const float inv_extent = 1.0f / extent[min_axis];
+
+  LightTreePrimitive *middle = std::partition(
+      &primitives[start], &primitives[end - 1] + 1, [&](const LightTreePrimitive &prim) {
+        const float t = (prim.centroid()[min_axis] - min_axis_start) * inv_extent;
+        const int b = clamp((int)(t * LIGHT_TREE_NUM_BUCKETS), 0, LIGHT_TREE_NUM_BUCKETS - 1);
+        return b < min_bucket;
+      });
+
+  return middle - &primitives[0];
+}
+
+CCL_NAMESPACE_END
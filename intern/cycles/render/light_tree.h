@@ -0,0 +1,102 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Bit trails have one bit per level, which limits the number of levels of the tree. */
+#define LIGHT_TREE_MAX_DEPTH 32
+
+/* Orientation bounds of emitters: the cone of their normals (axis, theta_o) and the angle
+ * around the normals over which they emit light (theta_e). */
+struct LightTreeCone {
+  float3 axis;
+  float theta_o;
+  float theta_e;
+
+  LightTreeCone() : axis(make_float3(0.0f, 0.0f, 1.0f)), theta_o(0.0f), theta_e(0.0f)
+  {
+  }
+
+  LightTreeCone(const float3 &axis, float theta_o, float theta_e)
+      : axis(axis), theta_o(theta_o), theta_e(theta_e)
+  {
+  }
+
+  /* Emitting in all directions. */
+  static LightTreeCone omnidirectional()
+  {
+    return LightTreeCone(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F);
+  }
+
+  void grow(const LightTreeCone &other);
+  /* Solid angle measure of the cone, used for the cost of splits. */
+  float measure() const;
+};
+
+/* Lamp or mesh light triangle to build the tree from. */
+struct LightTreePrimitive {
+  BoundBox bbox;
+  LightTreeCone cone;
+  float energy;
+  /* Index in the light distribution. */
+  int distribution_index;
+
+  float3 centroid() const
+  {
+    return bbox.center();
+  }
+};
+
+/* Bounding volume hierarchy over the lamps and mesh light triangles, for picking lights by
+ * their estimated contribution to a shading point. Built with the surface area orientation
+ * heuristic from "Importance Sampling of Many Lights with Adaptive Tree Splitting". */
+class LightTree {
+ public:
+  LightTree(vector<LightTreePrimitive> &primitives, int max_emitters_in_leaf);
+
+  /* Depth first, the first child of an interior node directly follows it. */
+  vector<KernelLightTreeNode> nodes;
+  /* Light distribution indices of the emitters of the leaves. */
+  vector<uint> leaf_emitters;
+  /* Path from the root to the leaf of every primitive, by light distribution index. */
+  vector<uint> bit_trails;
+
+ protected:
+  int recursive_build(int start, int end, uint bit_trail, int depth);
+  int split(int start, int end, const BoundBox &centroid_bbox);
+
+  vector<LightTreePrimitive> &primitives;
+  int max_emitters_in_leaf;
+};
+
+/* Fill kernel bounds from a bounding box, cone and energy. */
+void light_tree_bounds_to_kernel(KernelLightTreeNode *knode,
+                                 const BoundBox &bbox,
+                                 const LightTreeCone &cone,
+                                 float energy);
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
@@ -607,6 +607,30 @@ void Mesh::pack_normals(float4 *vnormal)
   }
 }
 
+void Mesh::pack_normals_compact(uint *vnormal)
+{
+  Attribute *attr_vN = attributes.find(ATTR_STD_VERTEX_NORMAL);
+  if (attr_vN == NULL) {
+    /* Happens on objects with just hair. */
+    return;
+  }
+
+  bool do_transform = transform_applied;
+  Transform ntfm = transform_normal;
+
+  float3 *vN = attr_vN->data_float3();
+  size_t verts_size = verts.size();
+
+  for (size_t i = 0; i < verts_size; i++) {
+    float3 vNi = vN[i];
+
+    if (do_transform)
+      vNi = safe_normalize(transform_direction(&ntfm, vNi));
+
+    vnormal[i] = normal_octahedral_encode(vNi);
+  }
+}
+
 void Mesh::pack_verts(const vector<uint> &tri_prim_index,
                       uint4 *tri_vindex,
                       uint *tri_patch,
@@ -193,6 +193,7 @@ class Mesh : public Geometry {
 
   void pack_shaders(Scene *scene, uint *shader);
   void pack_normals(float4 *vnormal);
+  void pack_normals_compact(uint *vnormal);
   void pack_verts(const vector<uint> &tri_prim_index,
                   uint4 *tri_vindex,
                   uint *tri_patch,
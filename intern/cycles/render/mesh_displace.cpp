@@ -25,6 +25,7 @@
 #include "util/util_map.h"
 #include "util/util_progress.h"
 #include "util/util_set.h"
+#include "util/util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -43,32 +44,15 @@ static float3 compute_face_normal(const Mesh::Triangle &t, float3 *verts)
   return norm / normlen;
 }
 
-bool GeometryManager::displace(
-    Device *device, DeviceScene *dscene, Scene *scene, Mesh *mesh, Progress &progress)
+/* Fill in shader evaluation inputs for the vertices of triangles with a displacement shader,
+ * returns the number of inputs. */
+static size_t fill_shader_input(Scene *scene,
+                                const Mesh *mesh,
+                                size_t object_index,
+                                uint4 *d_input_data)
 {
-  /* verify if we have a displacement shader */
-  if (!mesh->has_true_displacement()) {
-    return false;
-  }
-
-  string msg = string_printf("Computing Displacement %s", mesh->name.c_str());
-  progress.set_status("Updating Mesh", msg);
-
-  /* find object index. todo: is arbitrary */
-  size_t object_index = OBJECT_NONE;
-
-  for (size_t i = 0; i < scene->objects.size(); i++) {
-    if (scene->objects[i]->geometry == mesh) {
-      object_index = i;
-      break;
-    }
-  }
-
-  /* setup input for device task */
   const size_t num_verts = mesh->verts.size();
   vector<bool> done(num_verts, false);
-  device_vector<uint4> d_input(device, "displace_input", MEM_READ_ONLY);
-  uint4 *d_input_data = d_input.alloc(num_verts);
   size_t d_input_size = 0;
 
   size_t num_triangles = mesh->num_triangles();
@@ -115,46 +99,19 @@ bool GeometryManager::displace(
     }
   }
 
-  if (d_input_size == 0)
-    return false;
-
-  /* run device task */
-  device_vector<float4> d_output(device, "displace_output", MEM_READ_WRITE);
-  d_output.alloc(d_input_size);
-  d_output.zero_to_device();
-  d_input.copy_to_device();
-
-  /* needs to be up to data for attribute access */
-  device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
-
-  DeviceTask task(DeviceTask::SHADER);
-  task.shader_input = d_input.device_pointer;
-  task.shader_output = d_output.device_pointer;
-  task.shader_eval_type = SHADER_EVAL_DISPLACE;
-  task.shader_x = 0;
-  task.shader_w = d_output.size();
-  task.num_samples = 1;
-  task.get_cancel = function_bind(&Progress::get_cancel, &progress);
-
-  device->task_add(task);
-  device->task_wait();
-
-  if (progress.get_cancel()) {
-    d_input.free();
-    d_output.free();
-    return false;
-  }
+  return d_input_size;
+}
 
-  d_output.copy_from_device(0, 1, d_output.size());
-  d_input.free();
+/* Offset vertices by the evaluated displacement and update normals. */
+void GeometryManager::displace_apply(Scene *scene, Mesh *mesh, const float4 *offset)
+{
+  const size_t num_verts = mesh->verts.size();
+  const size_t num_triangles = mesh->num_triangles();
 
   /* read result */
-  done.clear();
-  done.resize(num_verts, false);
+  vector<bool> done(num_verts, false);
   int k = 0;
 
-  float4 *offset = d_output.data();
-
   Attribute *attr_mP = mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
   for (size_t i = 0; i < num_triangles; i++) {
     Mesh::Triangle t = mesh->get_triangle(i);
@@ -184,8 +141,6 @@ bool GeometryManager::displace(
     }
   }
 
-  d_output.free();
-
   /* stitch */
   unordered_set<int> stitch_keys;
   for (pair<int, int> i : mesh->vert_to_stitching_key_map) {
@@ -390,8 +345,113 @@ bool GeometryManager::displace(
       }
     }
   }
+}
+
+bool GeometryManager::displace(Device *device,
+                               DeviceScene *dscene,
+                               Scene *scene,
+                               const vector<Mesh *> &meshes,
+                               Progress &progress)
+{
+  /* verify if we have a displacement shader */
+  vector<Mesh *> displaced_meshes;
+  size_t num_verts = 0;
+
+  foreach (Mesh *mesh, meshes) {
+    if (mesh->has_true_displacement()) {
+      displaced_meshes.push_back(mesh);
+      num_verts += mesh->verts.size();
+    }
+  }
+
+  if (displaced_meshes.empty()) {
+    return false;
+  }
+
+  string msg = (displaced_meshes.size() == 1) ?
+                   string_printf("Computing Displacement %s",
+                                 displaced_meshes[0]->name.c_str()) :
+                   string_printf("Computing Displacement of %u meshes",
+                                 (uint)displaced_meshes.size());
+  progress.set_status("Updating Mesh", msg);
+
+  /* find object index. todo: is arbitrary */
+  unordered_map<const Geometry *, size_t> object_index_map;
+
+  for (size_t i = 0; i < scene->objects.size(); i++) {
+    object_index_map.insert({scene->objects[i]->geometry, i});
+  }
+
+  /* setup input for a single device task evaluating all meshes */
+  device_vector<uint4> d_input(device, "displace_input", MEM_READ_ONLY);
+  uint4 *d_input_data = d_input.alloc(num_verts);
+  size_t d_input_size = 0;
+  vector<size_t> d_input_offset(displaced_meshes.size() + 1);
+
+  for (size_t i = 0; i < displaced_meshes.size(); i++) {
+    const Mesh *mesh = displaced_meshes[i];
+    auto it = object_index_map.find(mesh);
+    const size_t object_index = (it != object_index_map.end()) ? it->second : OBJECT_NONE;
+
+    d_input_offset[i] = d_input_size;
+    d_input_size += fill_shader_input(scene, mesh, object_index, d_input_data + d_input_size);
+  }
+  d_input_offset[displaced_meshes.size()] = d_input_size;
+
+  if (d_input_size == 0)
+    return false;
+
+  /* run device task */
+  device_vector<float4> d_output(device, "displace_output", MEM_READ_WRITE);
+  d_output.alloc(d_input_size);
+  d_output.zero_to_device();
+  d_input.copy_to_device();
+
+  /* needs to be up to data for attribute access */
+  device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
+
+  DeviceTask task(DeviceTask::SHADER);
+  task.shader_input = d_input.device_pointer;
+  task.shader_output = d_output.device_pointer;
+  task.shader_eval_type = SHADER_EVAL_DISPLACE;
+  task.shader_x = 0;
+  task.shader_w = d_output.size();
+  task.num_samples = 1;
+  task.get_cancel = function_bind(&Progress::get_cancel, &progress);
+
+  device->task_add(task);
+  device->task_wait();
+
+  if (progress.get_cancel()) {
+    d_input.free();
+    d_output.free();
+    return false;
+  }
+
+  d_output.copy_from_device(0, 1, d_output.size());
+  d_input.free();
+
+  /* Displace vertices and update normals, independently per mesh. */
+  const float4 *offset = d_output.data();
+  TaskPool pool;
+  bool displacement_done = false;
+
+  for (size_t i = 0; i < displaced_meshes.size(); i++) {
+    if (d_input_offset[i + 1] == d_input_offset[i]) {
+      /* No triangles using the displacement shader. */
+      continue;
+    }
+
+    Mesh *mesh = displaced_meshes[i];
+    const float4 *mesh_offset = offset + d_input_offset[i];
+    pool.push([this, scene, mesh, mesh_offset] { displace_apply(scene, mesh, mesh_offset); });
+    displacement_done = true;
+  }
+
+  pool.wait_work();
+  d_output.free();
 
-  return true;
+  return displacement_done;
 }
 
 CCL_NAMESPACE_END
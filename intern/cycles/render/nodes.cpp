@@ -249,6 +249,10 @@ NODE_DEFINE(ImageTextureNode)
 
   SOCKET_IN_POINT(vector, "Vector", make_float3(0.0f, 0.0f, 0.0f), SocketType::LINK_TEXTURE_UV);
 
+  /* Vector at the ray differential offsets, see ShaderGraph::refine_image_derivatives(). */
+  SOCKET_IN_POINT(vector_dx, "VectorDx", make_float3(0.0f, 0.0f, 0.0f), SocketType::SVM_INTERNAL);
+  SOCKET_IN_POINT(vector_dy, "VectorDy", make_float3(0.0f, 0.0f, 0.0f), SocketType::SVM_INTERNAL);
+
   SOCKET_OUT_COLOR(color, "Color");
   SOCKET_OUT_FLOAT(alpha, "Alpha");
 
@@ -390,6 +394,16 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
   }
 
   if (projection != NODE_IMAGE_PROJ_BOX) {
+    ShaderInput *vector_dx_in = input("VectorDx");
+    ShaderInput *vector_dy_in = input("VectorDy");
+    int vector_dx_offset = SVM_STACK_INVALID;
+    int vector_dy_offset = SVM_STACK_INVALID;
+
+    if (vector_dx_in->link && vector_dy_in->link) {
+      vector_dx_offset = tex_mapping.compile_begin(compiler, vector_dx_in);
+      vector_dy_offset = tex_mapping.compile_begin(compiler, vector_dy_in);
+    }
+
     /* If there only is one image (a very common case), we encode it as a negative value. */
     int num_nodes;
     if (handle.num_tiles() == 1) {
@@ -405,7 +419,7 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
                                              compiler.stack_assign_if_linked(color_out),
                                              compiler.stack_assign_if_linked(alpha_out),
                                              flags),
-                      projection);
+                      compiler.encode_uchar4(projection, vector_dx_offset, vector_dy_offset));
 
     if (num_nodes > 0) {
       for (int i = 0; i < num_nodes; i++) {
@@ -423,6 +437,11 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
         compiler.add_node(node.x, node.y, node.z, node.w);
       }
     }
+
+    if (vector_dx_in->link && vector_dy_in->link) {
+      tex_mapping.compile_end(compiler, vector_dx_in, vector_dx_offset);
+      tex_mapping.compile_end(compiler, vector_dy_in, vector_dy_offset);
+    }
   }
   else {
     assert(handle.num_tiles() == 1);
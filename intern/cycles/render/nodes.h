@@ -80,6 +80,11 @@ class ImageSlotTextureNode : public TextureNode {
     special_type = SHADER_SPECIAL_TYPE_IMAGE_SLOT;
   }
 
+  virtual bool has_scene_resources()
+  {
+    return true;
+  }
+
   virtual bool equals(const ShaderNode &other)
   {
     const ImageSlotTextureNode &other_node = (const ImageSlotTextureNode &)other;
@@ -117,6 +122,8 @@ class ImageTextureNode : public ImageSlotTextureNode {
   float projection_blend;
   bool animated;
   float3 vector;
+  float3 vector_dx;
+  float3 vector_dy;
   ccl::vector<int> tiles;
 
  protected:
@@ -163,6 +170,10 @@ class SkyTextureNode : public TextureNode {
   {
     return NODE_GROUP_LEVEL_2;
   }
+  bool has_scene_resources()
+  {
+    return type == NODE_SKY_NISHITA;
+  }
 
   NodeSkyType type;
   float3 sun_direction;
@@ -207,6 +218,11 @@ class OutputAOVNode : public ShaderNode {
  public:
   SHADER_NODE_CLASS(OutputAOVNode)
   virtual void simplify_settings(Scene *scene);
+  /* The slot depends on the passes of the film. */
+  bool has_scene_resources()
+  {
+    return true;
+  }
 
   float value;
   float3 color;
@@ -375,6 +391,10 @@ class PointDensityTextureNode : public ShaderNode {
   {
     return true;
   }
+  bool has_scene_resources()
+  {
+    return true;
+  }
 
   /* Parameters. */
   ustring filename;
@@ -405,6 +425,10 @@ class IESLightNode : public TextureNode {
   {
     return NODE_GROUP_LEVEL_2;
   }
+  bool has_scene_resources()
+  {
+    return true;
+  }
 
   ustring filename;
   ustring ies;
@@ -1518,6 +1542,10 @@ class OSLNode : public ShaderNode {
   {
     return true;
   }
+  bool has_scene_resources()
+  {
+    return true;
+  }
   bool has_volume_support()
   {
     return true;
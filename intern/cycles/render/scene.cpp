@@ -22,6 +22,7 @@
 #include "render/camera.h"
 #include "render/curves.h"
 #include "render/film.h"
+#include "render/guiding.h"
 #include "render/integrator.h"
 #include "render/light.h"
 #include "render/mesh.h"
@@ -55,6 +56,7 @@ DeviceScene::DeviceScene(Device *device)
       prim_time(device, "__prim_time", MEM_GLOBAL),
       tri_shader(device, "__tri_shader", MEM_GLOBAL),
       tri_vnormal(device, "__tri_vnormal", MEM_GLOBAL),
+      tri_vnormal_oct(device, "__tri_vnormal_oct", MEM_GLOBAL),
       tri_vindex(device, "__tri_vindex", MEM_GLOBAL),
       tri_patch(device, "__tri_patch", MEM_GLOBAL),
       tri_patch_uv(device, "__tri_patch_uv", MEM_GLOBAL),
@@ -76,6 +78,13 @@ DeviceScene::DeviceScene(Device *device)
       lights(device, "__lights", MEM_GLOBAL),
       light_background_marginal_cdf(device, "__light_background_marginal_cdf", MEM_GLOBAL),
       light_background_conditional_cdf(device, "__light_background_conditional_cdf", MEM_GLOBAL),
+      light_tree_nodes(device, "__light_tree_nodes", MEM_GLOBAL),
+      light_tree_emitters(device, "__light_tree_emitters", MEM_GLOBAL),
+      light_tree_leaf_emitters(device, "__light_tree_leaf_emitters", MEM_GLOBAL),
+      guiding_spatial_nodes(device, "__guiding_spatial_nodes", MEM_GLOBAL),
+      guiding_directional_nodes(device, "__guiding_directional_nodes", MEM_GLOBAL),
+      guiding_training_radiance(device, "__guiding_training_radiance", MEM_GLOBAL),
+      guiding_training_samples(device, "__guiding_training_samples", MEM_GLOBAL),
       particles(device, "__particles", MEM_GLOBAL),
       svm_nodes(device, "__svm_nodes", MEM_GLOBAL),
       shaders(device, "__shaders", MEM_GLOBAL),
@@ -112,6 +121,7 @@ Scene::Scene(const SceneParams &params_, Device *device)
   image_manager = new ImageManager(device->info);
   particle_system_manager = new ParticleSystemManager();
   bake_manager = new BakeManager();
+  guiding_manager = new GuidingManager();
   kernels_loaded = false;
 
   /* TODO(sergey): Check if it's indeed optimal value for the split kernel. */
@@ -166,6 +176,7 @@ void Scene::free_memory(bool final)
     particle_system_manager->device_free(device, &dscene);
 
     bake_manager->device_free(device, &dscene);
+    guiding_manager->device_free(device, &dscene);
 
     if (!params.persistent_data || final)
       image_manager->device_free(device);
@@ -189,6 +200,7 @@ void Scene::free_memory(bool final)
     delete particle_system_manager;
     delete image_manager;
     delete bake_manager;
+    delete guiding_manager;
     delete update_stats;
   }
 }
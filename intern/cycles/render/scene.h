@@ -42,6 +42,7 @@ class Camera;
 class Device;
 class DeviceInfo;
 class Film;
+class GuidingManager;
 class Integrator;
 class Light;
 class LightManager;
@@ -81,6 +82,7 @@ class DeviceScene {
   /* mesh */
   device_vector<uint> tri_shader;
   device_vector<float4> tri_vnormal;
+  device_vector<uint> tri_vnormal_oct;
   device_vector<uint4> tri_vindex;
   device_vector<uint> tri_patch;
   device_vector<float2> tri_patch_uv;
@@ -112,6 +114,15 @@ class DeviceScene {
   device_vector<KernelLight> lights;
   device_vector<float2> light_background_marginal_cdf;
   device_vector<float2> light_background_conditional_cdf;
+  device_vector<KernelLightTreeNode> light_tree_nodes;
+  device_vector<KernelLightTreeEmitter> light_tree_emitters;
+  device_vector<uint> light_tree_leaf_emitters;
+
+  /* path guiding */
+  device_vector<KernelGuidingSpatialNode> guiding_spatial_nodes;
+  device_vector<KernelGuidingDirectionalNode> guiding_directional_nodes;
+  device_vector<float> guiding_training_radiance;
+  device_vector<uint> guiding_training_samples;
 
   /* particles */
   device_vector<KernelParticle> particles;
@@ -176,6 +187,21 @@ class SceneParams {
   CurveShapeType hair_shape;
   bool persistent_data;
   int texture_limit;
+  /* Directory to cache the BVH of geometry in, empty to disable. Only BVHs of geometry with
+   * the BVH2 layout are cached, which is all geometry with a dynamic BVH type and instanced
+   * geometry otherwise. The top-level BVH is always built. */
+  string bvh_cache_path;
+  /* Directory to cache compiled SVM shaders in, empty to only cache them in memory. */
+  string shader_cache_path;
+  /* Store vertex normals and float2 attributes in reduced precision. */
+  bool use_compact_geometry;
+  /* Load image textures on demand through the OpenImageIO texture cache, CPU only. */
+  bool use_texture_cache;
+  /* Maximum memory used by the texture cache, in megabytes. */
+  int texture_cache_size;
+  /* Directory to store images converted to tiled and mipmapped .tx files in, empty to read
+   * images as they are. */
+  string texture_cache_path;
 
   bool background;
 
@@ -191,6 +217,9 @@ class SceneParams {
     hair_shape = CURVE_RIBBON;
     persistent_data = false;
     texture_limit = 0;
+    use_compact_geometry = false;
+    use_texture_cache = false;
+    texture_cache_size = 1024;
     background = true;
   }
 
@@ -202,7 +231,13 @@ class SceneParams {
              use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes &&
              num_bvh_time_steps == params.num_bvh_time_steps &&
              hair_subdivisions == params.hair_subdivisions && hair_shape == params.hair_shape &&
-             persistent_data == params.persistent_data && texture_limit == params.texture_limit);
+             persistent_data == params.persistent_data && texture_limit == params.texture_limit &&
+             bvh_cache_path == params.bvh_cache_path &&
+             shader_cache_path == params.shader_cache_path &&
+             use_compact_geometry == params.use_compact_geometry &&
+             use_texture_cache == params.use_texture_cache &&
+             texture_cache_size == params.texture_cache_size &&
+             texture_cache_path == params.texture_cache_path);
   }
 
   int curve_subdivisions()
@@ -243,6 +278,7 @@ class Scene : public NodeOwner {
   ObjectManager *object_manager;
   ParticleSystemManager *particle_system_manager;
   BakeManager *bake_manager;
+  GuidingManager *guiding_manager;
 
   /* default shaders */
   Shader *default_surface;
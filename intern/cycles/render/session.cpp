@@ -22,6 +22,7 @@
 #include "render/buffers.h"
 #include "render/camera.h"
 #include "render/graph.h"
+#include "render/guiding.h"
 #include "render/integrator.h"
 #include "render/light.h"
 #include "render/mesh.h"
@@ -940,13 +941,18 @@ bool Session::update_scene()
   }
 
   bool kernel_switch_needed = false;
-  if (scene->update(progress, kernel_switch_needed)) {
-    if (kernel_switch_needed) {
-      reset(tile_manager.params, params.samples);
-    }
-    return true;
+  const bool scene_updated = scene->update(progress, kernel_switch_needed);
+  if (scene_updated && kernel_switch_needed) {
+    reset(tile_manager.params, params.samples);
   }
-  return false;
+
+  /* Path guiding learns from the passes over the whole image of progressive rendering. */
+  if (params.progressive) {
+    scene->guiding_manager->update_pass(
+        device, &scene->dscene, scene, tile_manager.state.sample, tile_manager.num_samples);
+  }
+
+  return scene_updated;
 }
 
 void Session::update_status_time(bool show_pause, bool show_done)
@@ -235,6 +235,44 @@ string MeshStats::full_report(int indent_level)
   const string indent(indent_level * kIndentNumSpaces, ' ');
   string result = "";
   result += indent + "Geometry:\n" + geometry.full_report(indent_level + 1);
+  if (!compact_savings.entries.empty()) {
+    result += indent + "Compact storage savings:\n" + compact_savings.full_report(indent_level + 1);
+  }
+  return result;
+}
+
+/* Texture cache statistics. */
+
+TextureCacheStats::TextureCacheStats()
+    : num_files(0),
+      num_converted(0),
+      num_tiles_loaded(0),
+      bytes_read(0),
+      files_size(0),
+      memory_used(0),
+      memory_limit(0)
+{
+}
+
+string TextureCacheStats::full_report(int indent_level)
+{
+  const string indent(indent_level * kIndentNumSpaces, ' ');
+  string result = "";
+  result += string_printf("%sFiles: %d (%d converted to .tx)\n",
+                          indent.c_str(),
+                          num_files,
+                          num_converted);
+  result += string_printf("%sTiles loaded: %s\n",
+                          indent.c_str(),
+                          string_human_readable_number(num_tiles_loaded).c_str());
+  result += string_printf("%sRead from disk: %s of %s\n",
+                          indent.c_str(),
+                          string_human_readable_size(bytes_read).c_str(),
+                          string_human_readable_size(files_size).c_str());
+  result += string_printf("%sMemory: %s of %s\n",
+                          indent.c_str(),
+                          string_human_readable_size(memory_used).c_str(),
+                          string_human_readable_size(memory_limit).c_str());
   return result;
 }
 
@@ -249,6 +287,9 @@ string ImageStats::full_report(int indent_level)
   const string indent(indent_level * kIndentNumSpaces, ' ');
   string result = "";
   result += indent + "Textures:\n" + textures.full_report(indent_level + 1);
+  if (texture_cache.num_files > 0) {
+    result += indent + "Texture cache:\n" + texture_cache.full_report(indent_level + 1);
+  }
   return result;
 }
 
@@ -332,6 +373,9 @@ void RenderStats::collect_profiling(Scene *scene, Profiler &prof)
 string RenderStats::full_report()
 {
   string result = "";
+  if (!sync.entries.empty()) {
+    result += "Synchronization statistics:\n" + sync.full_report(1);
+  }
   result += "Mesh statistics:\n" + mesh.full_report(1);
   result += "Image statistics:\n" + image.full_report(1);
   if (has_profiling) {
@@ -154,6 +154,29 @@ class MeshStats {
    * memory like BVH.
    */
   NamedSizeStats geometry;
+
+  /* Memory saved by storing normals and attributes in reduced precision. */
+  NamedSizeStats compact_savings;
+};
+
+/* Statistics about images loaded on demand through the texture cache. */
+class TextureCacheStats {
+ public:
+  TextureCacheStats();
+
+  /* Generate full human-readable report. */
+  string full_report(int indent_level = 0);
+
+  /* Images read through the cache, and how many of them were converted to .tx files. */
+  int num_files;
+  int num_converted;
+  /* Tiles read from disk, more than fit in memory when tiles were evicted from a full cache. */
+  uint64_t num_tiles_loaded;
+  uint64_t bytes_read;
+  /* Total size of the image files, as a reference for the amount read. */
+  uint64_t files_size;
+  uint64_t memory_used;
+  uint64_t memory_limit;
 };
 
 /* Statistics about images held in memory. */
@@ -165,6 +188,7 @@ class ImageStats {
   string full_report(int indent_level = 0);
 
   NamedSizeStats textures;
+  TextureCacheStats texture_cache;
 };
 
 /* Render process statistics. */
@@ -180,6 +204,8 @@ class RenderStats {
 
   bool has_profiling;
 
+  /* Time spent in the phases of synchronizing the scene from the host application. */
+  NamedTimeStats sync;
   MeshStats mesh;
   ImageStats image;
   NamedNestedSampleStats kernel;
@@ -62,6 +62,7 @@ void SVMShaderManager::device_update_shader(Scene *scene,
   SVMCompiler::Summary summary;
   SVMCompiler compiler(scene);
   compiler.background = (shader == scene->background->get_shader(scene));
+  compiler.cache = &cache;
   compiler.compile(shader, *svm_nodes, 0, &summary);
 
   VLOG(2) << "Compilation summary:\n"
@@ -92,7 +93,9 @@ void SVMShaderManager::device_update(Device *device,
   /* test if we need to update */
   device_free(device, dscene, scene);
 
-  /* Build all shaders. */
+  /* Build all shaders, reusing the compiled nodes of unchanged ones. */
+  cache.set_directory(scene->params.shader_cache_path);
+
   TaskPool task_pool;
   vector<array<int4>> shader_svm_nodes(num_shaders);
   for (int i = 0; i < num_shaders; i++) {
@@ -105,6 +108,8 @@ void SVMShaderManager::device_update(Device *device,
   }
   task_pool.wait_work();
 
+  cache.remove_unused();
+
   if (progress.get_cancel()) {
     return;
   }
@@ -181,6 +186,7 @@ SVMCompiler::SVMCompiler(Scene *scene) : scene(scene)
   current_shader = NULL;
   current_graph = NULL;
   background = false;
+  cache = NULL;
   mix_weight_offset = SVM_STACK_INVALID;
   compile_failed = false;
 }
@@ -408,7 +414,18 @@ void SVMCompiler::add_node(const float4 &f)
 
 uint SVMCompiler::attribute(ustring name)
 {
-  return scene->shader_manager->get_attribute_id(name);
+  const uint id = scene->shader_manager->get_attribute_id(name);
+
+  /* IDs of named attributes depend on the order they are first used in, so they are stored with
+   * the cached nodes to verify they are still the same. */
+  for (const pair<ustring, uint> &attribute : used_attributes) {
+    if (attribute.first == name) {
+      return id;
+    }
+  }
+  used_attributes.push_back(std::make_pair(name, id));
+
+  return id;
 }
 
 uint SVMCompiler::attribute(AttributeStandard std)
@@ -854,6 +871,25 @@ void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Sum
 
   current_shader = shader;
 
+  /* Reuse the nodes compiled for an identical graph. */
+  string cache_key;
+  if (cache != NULL) {
+    cache_key = SVMShaderCache::key(shader, background, has_bump);
+
+    SVMCachedShader cached;
+    if (!cache_key.empty() && cache->find(cache_key, cached) &&
+        compile_from_cache(cached, svm_nodes, index)) {
+      if (summary != NULL) {
+        summary->time_total = time_dt() - time_start;
+        summary->num_svm_nodes = svm_nodes.size() - start_num_svm_nodes;
+        summary->cached = true;
+      }
+      return;
+    }
+  }
+
+  used_attributes.clear();
+
   shader->has_surface = false;
   shader->has_surface_emission = false;
   shader->has_surface_transparent = false;
@@ -903,6 +939,21 @@ void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Sum
     svm_nodes.append(current_svm_nodes);
   }
 
+  if (!cache_key.empty()) {
+    SVMCachedShader cached;
+    const int num_nodes = svm_nodes.size() - start_num_svm_nodes;
+    cached.svm_nodes.resize(num_nodes);
+    if (num_nodes > 0) {
+      memcpy(cached.svm_nodes.data(), &svm_nodes[start_num_svm_nodes], sizeof(int4) * num_nodes);
+    }
+    cached.jump_offset[0] = svm_nodes[index].y - start_num_svm_nodes;
+    cached.jump_offset[1] = svm_nodes[index].z - start_num_svm_nodes;
+    cached.jump_offset[2] = svm_nodes[index].w - start_num_svm_nodes;
+    cached.get_shader_flags(shader);
+    cached.attributes = used_attributes;
+    cache->add(cache_key, cached);
+  }
+
   /* Fill in summary information. */
   if (summary != NULL) {
     summary->time_total = time_dt() - time_start;
@@ -911,6 +962,28 @@ void SVMCompiler::compile(Shader *shader, array<int4> &svm_nodes, int index, Sum
   }
 }
 
+bool SVMCompiler::compile_from_cache(const SVMCachedShader &cached,
+                                     array<int4> &svm_nodes,
+                                     int index)
+{
+  /* Attributes first used by other shaders in this scene may have gotten different IDs. */
+  foreach (const auto &attribute, cached.attributes) {
+    if (scene->shader_manager->get_attribute_id(attribute.first) != attribute.second) {
+      return false;
+    }
+  }
+
+  const int start_num_svm_nodes = svm_nodes.size();
+  svm_nodes[index].y = start_num_svm_nodes + cached.jump_offset[0];
+  svm_nodes[index].z = start_num_svm_nodes + cached.jump_offset[1];
+  svm_nodes[index].w = start_num_svm_nodes + cached.jump_offset[2];
+  svm_nodes.append(cached.svm_nodes);
+
+  cached.set_shader_flags(current_shader);
+
+  return true;
+}
+
 /* Compiler summary implementation. */
 
 SVMCompiler::Summary::Summary()
@@ -921,7 +994,8 @@ SVMCompiler::Summary::Summary()
       time_generate_bump(0.0),
       time_generate_volume(0.0),
       time_generate_displacement(0.0),
-      time_total(0.0)
+      time_total(0.0),
+      cached(false)
 {
 }
 
@@ -941,6 +1015,7 @@ string SVMCompiler::Summary::full_report() const
                           time_generate_surface + time_generate_bump + time_generate_volume +
                               time_generate_displacement);
   report += string_printf("Total:               %f\n", time_total);
+  report += string_printf("Cached:              %s\n", cached ? "yes" : "no");
 
   return report;
 }
@@ -20,6 +20,7 @@
 #include "render/attribute.h"
 #include "render/graph.h"
 #include "render/shader.h"
+#include "render/svm_cache.h"
 
 #include "util/util_array.h"
 #include "util/util_set.h"
@@ -54,6 +55,9 @@ class SVMShaderManager : public ShaderManager {
                             Shader *shader,
                             Progress *progress,
                             array<int4> *svm_nodes);
+
+  /* Compiled shaders, reused for shaders that did not change. */
+  SVMShaderCache cache;
 };
 
 /* Graph Compiler */
@@ -87,6 +91,9 @@ class SVMCompiler {
     /* Total time spent on all routines. */
     double time_total;
 
+    /* Whether the SVM nodes were reused from the cache instead of generated. */
+    bool cached;
+
     /* A full multi-line description of the state of the compiler after compilation. */
     string full_report() const;
   };
@@ -124,6 +131,8 @@ class SVMCompiler {
   Scene *scene;
   ShaderGraph *current_graph;
   bool background;
+  /* Optional cache to reuse and store the compiled nodes in. */
+  SVMShaderCache *cache;
 
  protected:
   /* stack */
@@ -212,6 +221,9 @@ class SVMCompiler {
   /* compile */
   void compile_type(Shader *shader, ShaderGraph *graph, ShaderType type);
 
+  /* cache */
+  bool compile_from_cache(const SVMCachedShader &cached, array<int4> &svm_nodes, int index);
+
   array<int4> current_svm_nodes;
   ShaderType current_type;
   Shader *current_shader;
@@ -219,6 +231,8 @@ class SVMCompiler {
   int max_stack_use;
   uint mix_weight_offset;
   bool compile_failed;
+  /* Named attributes used by the compiled nodes, with their IDs. */
+  vector<pair<ustring, uint>> used_attributes;
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,322 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/svm_cache.h"
+#include "render/graph.h"
+#include "render/shader.h"
+
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
+#include "util/util_version.h"
+
+#include <cstdio>
+#include <random>
+
+CCL_NAMESPACE_BEGIN
+
+/* Increase when changing the file format or the code generated by the compiler. */
+#define SVM_CACHE_VERSION 1
+
+static const char svm_cache_magic[8] = {'C', 'Y', 'C', 'L', 'S', 'V', 'M', '\0'};
+
+/* Cached Shader */
+
+SVMCachedShader::SVMCachedShader() : flags(0)
+{
+  jump_offset[0] = jump_offset[1] = jump_offset[2] = 0;
+}
+
+enum SVMCachedShaderFlag {
+  SVM_CACHED_HAS_SURFACE = (1 << 0),
+  SVM_CACHED_HAS_SURFACE_EMISSION = (1 << 1),
+  SVM_CACHED_HAS_SURFACE_TRANSPARENT = (1 << 2),
+  SVM_CACHED_HAS_SURFACE_BSSRDF = (1 << 3),
+  SVM_CACHED_HAS_BUMP = (1 << 4),
+  SVM_CACHED_HAS_BSSRDF_BUMP = (1 << 5),
+  SVM_CACHED_HAS_VOLUME = (1 << 6),
+  SVM_CACHED_HAS_DISPLACEMENT = (1 << 7),
+  SVM_CACHED_HAS_SURFACE_SPATIAL_VARYING = (1 << 8),
+  SVM_CACHED_HAS_VOLUME_SPATIAL_VARYING = (1 << 9),
+  SVM_CACHED_HAS_VOLUME_ATTRIBUTE_DEPENDENCY = (1 << 10),
+  SVM_CACHED_HAS_INTEGRATOR_DEPENDENCY = (1 << 11),
+};
+
+void SVMCachedShader::get_shader_flags(const Shader *shader)
+{
+  flags = 0;
+  flags |= (shader->has_surface) ? SVM_CACHED_HAS_SURFACE : 0;
+  flags |= (shader->has_surface_emission) ? SVM_CACHED_HAS_SURFACE_EMISSION : 0;
+  flags |= (shader->has_surface_transparent) ? SVM_CACHED_HAS_SURFACE_TRANSPARENT : 0;
+  flags |= (shader->has_surface_bssrdf) ? SVM_CACHED_HAS_SURFACE_BSSRDF : 0;
+  flags |= (shader->has_bump) ? SVM_CACHED_HAS_BUMP : 0;
+  flags |= (shader->has_bssrdf_bump) ? SVM_CACHED_HAS_BSSRDF_BUMP : 0;
+  flags |= (shader->has_volume) ? SVM_CACHED_HAS_VOLUME : 0;
+  flags |= (shader->has_displacement) ? SVM_CACHED_HAS_DISPLACEMENT : 0;
+  flags |= (shader->has_surface_spatial_varying) ? SVM_CACHED_HAS_SURFACE_SPATIAL_VARYING : 0;
+  flags |= (shader->has_volume_spatial_varying) ? SVM_CACHED_HAS_VOLUME_SPATIAL_VARYING : 0;
+  flags |= (shader->has_volume_attribute_dependency) ?
+               SVM_CACHED_HAS_VOLUME_ATTRIBUTE_DEPENDENCY :
+               0;
+  flags |= (shader->has_integrator_dependency) ? SVM_CACHED_HAS_INTEGRATOR_DEPENDENCY : 0;
+}
+
+void SVMCachedShader::set_shader_flags(Shader *shader) const
+{
+  shader->has_surface = (flags & SVM_CACHED_HAS_SURFACE) != 0;
+  shader->has_surface_emission = (flags & SVM_CACHED_HAS_SURFACE_EMISSION) != 0;
+  shader->has_surface_transparent = (flags & SVM_CACHED_HAS_SURFACE_TRANSPARENT) != 0;
+  shader->has_surface_bssrdf = (flags & SVM_CACHED_HAS_SURFACE_BSSRDF) != 0;
+  shader->has_bump = (flags & SVM_CACHED_HAS_BUMP) != 0;
+  shader->has_bssrdf_bump = (flags & SVM_CACHED_HAS_BSSRDF_BUMP) != 0;
+  shader->has_volume = (flags & SVM_CACHED_HAS_VOLUME) != 0;
+  shader->has_displacement = (flags & SVM_CACHED_HAS_DISPLACEMENT) != 0;
+  shader->has_surface_spatial_varying = (flags & SVM_CACHED_HAS_SURFACE_SPATIAL_VARYING) != 0;
+  shader->has_volume_spatial_varying = (flags & SVM_CACHED_HAS_VOLUME_SPATIAL_VARYING) != 0;
+  shader->has_volume_attribute_dependency = (flags & SVM_CACHED_HAS_VOLUME_ATTRIBUTE_DEPENDENCY) !=
+                                            0;
+  shader->has_integrator_dependency = (flags & SVM_CACHED_HAS_INTEGRATOR_DEPENDENCY) != 0;
+}
+
+/* Key */
+
+template<typename T> static void svm_cache_hash(MD5Hash &md5, const T &value)
+{
+  md5.append((const uint8_t *)&value, sizeof(value));
+}
+
+string SVMShaderCache::key(Shader *shader, bool background, bool has_bump)
+{
+  ShaderGraph *graph = shader->graph;
+
+  MD5Hash md5;
+  svm_cache_hash(md5, (int)SVM_CACHE_VERSION);
+  md5.append(CYCLES_VERSION_STRING);
+  svm_cache_hash(md5, background);
+  svm_cache_hash(md5, has_bump);
+  svm_cache_hash(md5, (int)shader->displacement_method);
+
+  foreach (ShaderNode *node, graph->nodes) {
+    if (node->has_scene_resources()) {
+      return "";
+    }
+
+    node->hash(md5);
+    svm_cache_hash(md5, node->id);
+    svm_cache_hash(md5, (int)node->bump);
+    svm_cache_hash(md5, (int)node->special_type);
+
+    foreach (ShaderInput *input, node->inputs) {
+      const int link_id = (input->link) ? input->link->parent->id : -1;
+      svm_cache_hash(md5, link_id);
+      if (input->link) {
+        md5.append(input->link->name().string());
+      }
+    }
+  }
+
+  return md5.get_hex();
+}
+
+/* Find and Add */
+
+SVMShaderCache::SVMShaderCache() : num_found(0), num_added(0)
+{
+}
+
+void SVMShaderCache::set_directory(const string &directory_)
+{
+  thread_scoped_lock lock(mutex);
+  directory = directory_;
+}
+
+bool SVMShaderCache::find(const string &key, SVMCachedShader &entry)
+{
+  string cache_directory;
+  {
+    thread_scoped_lock lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+      it->second.used = true;
+      entry = it->second.shader;
+      num_found++;
+      return true;
+    }
+    cache_directory = directory;
+  }
+
+  if (cache_directory.empty() || !read(key, entry)) {
+    return false;
+  }
+
+  thread_scoped_lock lock(mutex);
+  Entry &cached = entries[key];
+  cached.shader = entry;
+  cached.used = true;
+  num_found++;
+  return true;
+}
+
+void SVMShaderCache::add(const string &key, const SVMCachedShader &entry)
+{
+  bool use_directory;
+  {
+    thread_scoped_lock lock(mutex);
+    Entry &cached = entries[key];
+    cached.shader = entry;
+    cached.used = true;
+    num_added++;
+    use_directory = !directory.empty();
+  }
+
+  if (use_directory) {
+    write(key, entry);
+  }
+}
+
+void SVMShaderCache::remove_unused()
+{
+  thread_scoped_lock lock(mutex);
+
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (it->second.used) {
+      it->second.used = false;
+      ++it;
+    }
+    else {
+      it = entries.erase(it);
+    }
+  }
+
+  VLOG(1) << "SVM shader cache: reused " << num_found << " compiled shaders, added "
+          << num_added << ", " << entries.size() << " in memory.";
+
+  num_found = 0;
+  num_added = 0;
+}
+
+/* Read and Write */
+
+string SVMShaderCache::filepath(const string &key) const
+{
+  return path_join(directory, key + ".svm");
+}
+
+bool SVMShaderCache::read(const string &key, SVMCachedShader &entry) const
+{
+  const string path = filepath(key);
+  FILE *f = path_fopen(path, "rb");
+  if (!f) {
+    return false;
+  }
+
+  char magic[sizeof(svm_cache_magic)];
+  int version;
+  uint64_t num_attributes = 0, num_nodes = 0;
+  bool ok = fread(magic, sizeof(magic), 1, f) == 1 &&
+            memcmp(magic, svm_cache_magic, sizeof(magic)) == 0 &&
+            fread(&version, sizeof(version), 1, f) == 1 && version == SVM_CACHE_VERSION &&
+            fread(&entry.flags, sizeof(entry.flags), 1, f) == 1 &&
+            fread(entry.jump_offset, sizeof(entry.jump_offset), 1, f) == 1 &&
+            fread(&num_attributes, sizeof(num_attributes), 1, f) == 1;
+
+  entry.attributes.clear();
+  for (uint64_t i = 0; ok && i < num_attributes; i++) {
+    uint64_t name_length;
+    uint id;
+    ok = fread(&name_length, sizeof(name_length), 1, f) == 1 && name_length < 4096;
+    if (ok) {
+      string name(name_length, '\0');
+      ok = (name_length == 0 || fread(&name[0], name_length, 1, f) == 1) &&
+           fread(&id, sizeof(id), 1, f) == 1;
+      entry.attributes.push_back(std::make_pair(ustring(name), id));
+    }
+  }
+
+  ok = ok && fread(&num_nodes, sizeof(num_nodes), 1, f) == 1;
+  if (ok) {
+    entry.svm_nodes.resize(num_nodes);
+    ok = (num_nodes == 0) || (fread(entry.svm_nodes.data(), sizeof(int4), num_nodes, f) ==
+                              num_nodes);
+  }
+
+  fclose(f);
+
+  if (!ok) {
+    VLOG(1) << "Failed to read cached shader " << path << ", compiling.";
+    entry = SVMCachedShader();
+    return false;
+  }
+
+  VLOG(3) << "Read cached shader " << path << ".";
+  return true;
+}
+
+bool SVMShaderCache::write(const string &key, const SVMCachedShader &entry) const
+{
+  const string path = filepath(key);
+  path_create_directories(path);
+
+  /* Write to a temporary file first, so other renders using the same cache directory never
+   * read a partially written shader. */
+  std::random_device random;
+  const string temp_path = string_printf("%s.%08x.tmp", path.c_str(), random());
+
+  FILE *f = path_fopen(temp_path, "wb");
+  if (!f) {
+    VLOG(1) << "Failed to open " << temp_path << " for writing shader cache.";
+    return false;
+  }
+
+  const int version = SVM_CACHE_VERSION;
+  const uint64_t num_attributes = entry.attributes.size();
+  bool ok = fwrite(svm_cache_magic, sizeof(svm_cache_magic), 1, f) == 1 &&
+            fwrite(&version, sizeof(version), 1, f) == 1 &&
+            fwrite(&entry.flags, sizeof(entry.flags), 1, f) == 1 &&
+            fwrite(entry.jump_offset, sizeof(entry.jump_offset), 1, f) == 1 &&
+            fwrite(&num_attributes, sizeof(num_attributes), 1, f) == 1;
+
+  for (size_t i = 0; ok && i < entry.attributes.size(); i++) {
+    const string &name = entry.attributes[i].first.string();
+    const uint64_t name_length = name.size();
+    ok = fwrite(&name_length, sizeof(name_length), 1, f) == 1 &&
+         (name_length == 0 || fwrite(name.data(), name_length, 1, f) == 1) &&
+         fwrite(&entry.attributes[i].second, sizeof(uint), 1, f) == 1;
+  }
+
+  const uint64_t num_nodes = entry.svm_nodes.size();
+  ok = ok && fwrite(&num_nodes, sizeof(num_nodes), 1, f) == 1;
+  ok = ok && ((num_nodes == 0) ||
+              (fwrite(entry.svm_nodes.data(), sizeof(int4), num_nodes, f) == num_nodes));
+
+  ok = (fclose(f) == 0) && ok;
+
+  /* Renaming fails on some platforms when another render already wrote the same shader, which
+   * is fine since it is identical. */
+  if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+    path_remove(temp_path);
+    if (!ok) {
+      VLOG(1) << "Failed to write shader cache " << path << ".";
+    }
+    return false;
+  }
+
+  VLOG(3) << "Wrote cached shader " << path << ".";
+  return true;
+}
+
+CCL_NAMESPACE_END
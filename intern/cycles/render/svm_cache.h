@@ -0,0 +1,94 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SVM_CACHE_H__
+#define __SVM_CACHE_H__
+
+#include "util/util_array.h"
+#include "util/util_map.h"
+#include "util/util_param.h"
+#include "util/util_string.h"
+#include "util/util_thread.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class Shader;
+
+/* Compiled SVM code of a shader, along with the shader flags set by compiling it. */
+struct SVMCachedShader {
+  SVMCachedShader();
+
+  /* Nodes following the jump node of the shader. */
+  array<int4> svm_nodes;
+  /* Bump/surface, volume and displacement offsets of the jump node, relative to svm_nodes. */
+  int jump_offset[3];
+  /* Bitmask of the has_* flags of the shader. */
+  uint flags;
+  /* Named attributes used by the nodes, with the IDs they were compiled with. */
+  vector<pair<ustring, uint>> attributes;
+
+  void get_shader_flags(const Shader *shader);
+  void set_shader_flags(Shader *shader) const;
+};
+
+/* SVM Shader Cache
+ *
+ * Stores compiled SVM code in memory and optionally in a directory on disk, keyed by a hash of
+ * the finalized shader graph and the shader settings, so unchanged shaders are not compiled
+ * again. Graphs with nodes that acquire images or other scene resources are not cached. */
+
+class SVMShaderCache {
+ public:
+  SVMShaderCache();
+
+  /* Directory to store compiled shaders in, empty to only keep them in memory. */
+  void set_directory(const string &directory);
+
+  /* Key identifying the compiled code of the shader, empty if it can not be cached. */
+  static string key(Shader *shader, bool background, bool has_bump);
+
+  /* Find compiled code in memory or on disk, returns false if it is not in the cache. */
+  bool find(const string &key, SVMCachedShader &entry);
+  /* Add compiled code to the cache, replacing any previous code with the same key. */
+  void add(const string &key, const SVMCachedShader &entry);
+
+  /* Remove shaders from memory that were not found or added since the previous call, so memory
+   * usage follows the shaders in the scene. */
+  void remove_unused();
+
+ protected:
+  struct Entry {
+    SVMCachedShader shader;
+    bool used;
+  };
+
+  string filepath(const string &key) const;
+  bool read(const string &key, SVMCachedShader &entry) const;
+  bool write(const string &key, const SVMCachedShader &entry) const;
+
+  thread_mutex mutex;
+  unordered_map<string, Entry> entries;
+  string directory;
+
+  int num_found;
+  int num_added;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __SVM_CACHE_H__ */
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/texture_cache.h"
+#include "render/scene.h"
+#include "render/stats.h"
+
+#include "util/util_logging.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
+#include "util/util_time.h"
+
+#include <OpenImageIO/imagebufalgo.h>
+
+#include <random>
+#include <sstream>
+
+CCL_NAMESPACE_BEGIN
+
+/* Tile size of images that are tiled in memory or converted to .tx files. */
+#define TEXTURE_CACHE_TILE_SIZE 64
+
+TextureCache::TextureCache(const SceneParams &params)
+    : directory(params.texture_cache_path), num_converted(0)
+{
+  /* Not shared with OSL or other renders, so the cache size and statistics are for this render
+   * only. */
+  texture_system = OIIO::TextureSystem::create(false);
+
+  texture_system->attribute("max_memory_MB", (float)max(params.texture_cache_size, 1));
+  texture_system->attribute("autotile", TEXTURE_CACHE_TILE_SIZE);
+  texture_system->attribute("automip", 1);
+  texture_system->attribute("gray_to_rgb", 1);
+
+  /* Match the simplify texture limit by skipping mip levels larger than it. */
+  if (params.texture_limit > 0) {
+    texture_system->attribute("max_mip_res", params.texture_limit);
+  }
+}
+
+TextureCache::~TextureCache()
+{
+  VLOG(1) << "Texture cache statistics:\n" << texture_system->getstats(2);
+
+  texture_system->invalidate_all(true);
+  OIIO::TextureSystem::destroy(texture_system);
+}
+
+void *TextureCache::get_handle(const string &filepath)
+{
+  const string path = converted_filepath(filepath);
+
+  OIIO::TextureSystem::TextureHandle *handle = texture_system->get_texture_handle(ustring(path));
+  if (handle == NULL || !texture_system->good(handle)) {
+    VLOG(1) << "Failed to open " << path
+            << " in texture cache: " << texture_system->geterror();
+    return NULL;
+  }
+
+  return handle;
+}
+
+void TextureCache::invalidate(const string &filepath)
+{
+  thread_scoped_lock lock(convert_mutex);
+
+  unordered_map<string, string>::iterator it = converted.find(filepath);
+  if (it != converted.end()) {
+    texture_system->invalidate(ustring(it->second));
+    /* Check if the converted image is outdated again the next time it is used. */
+    converted.erase(it);
+  }
+  else {
+    texture_system->invalidate(ustring(filepath));
+  }
+}
+
+void *TextureCache::get_texture_system()
+{
+  return texture_system;
+}
+
+/* Conversion to .tx */
+
+string TextureCache::tx_filepath(const string &filepath) const
+{
+  /* Hash of the full path, so images with the same name in different directories don't
+   * overwrite each others converted images. */
+  const string filename = path_filename(filepath);
+  const string name = filename.substr(0, filename.rfind('.'));
+  const string hash = util_md5_string(filepath).substr(0, 8);
+
+  return path_join(directory, name + "-" + hash + ".tx");
+}
+
+string TextureCache::converted_filepath(const string &filepath)
+{
+  if (directory.empty()) {
+    return filepath;
+  }
+
+  /* Already tiled and mipmapped. */
+  const size_t extension_start = filepath.rfind('.');
+  if (extension_start != string::npos) {
+    const string extension = filepath.substr(extension_start);
+    if (string_iequals(extension, ".tx") || string_iequals(extension, ".tex")) {
+      return filepath;
+    }
+  }
+
+  thread_scoped_lock lock(convert_mutex);
+
+  unordered_map<string, string>::iterator it = converted.find(filepath);
+  if (it != converted.end()) {
+    return it->second;
+  }
+
+  const string tx_path = tx_filepath(filepath);
+
+  /* Reuse images converted by previous renders, unless the image was modified since. */
+  if (path_exists(tx_path) && path_modified_time(tx_path) >= path_modified_time(filepath)) {
+    VLOG(2) << "Using converted image " << tx_path << " for " << filepath << ".";
+    converted[filepath] = tx_path;
+    return tx_path;
+  }
+
+  path_create_directories(tx_path);
+
+  /* Write to a temporary file first, so other renders using the same cache directory never
+   * read a partially written image. It keeps the .tx extension to get the right file format. */
+  std::random_device random;
+  const string temp_path = string_printf(
+      "%s.%08x.tmp.tx", tx_path.substr(0, tx_path.size() - 3).c_str(), random());
+
+  OIIO::ImageSpec config;
+  config.tile_width = TEXTURE_CACHE_TILE_SIZE;
+  config.tile_height = TEXTURE_CACHE_TILE_SIZE;
+  config.attribute("compression", "zip");
+
+  const double start_time = time_dt();
+  std::stringstream messages;
+  bool ok = OIIO::ImageBufAlgo::make_texture(
+      OIIO::ImageBufAlgo::MakeTxTexture, filepath, temp_path, config, &messages);
+
+  /* Renaming fails on some platforms when another render already converted the same image,
+   * which is fine since it is identical. */
+  if (ok && rename(temp_path.c_str(), tx_path.c_str()) != 0) {
+    ok = path_exists(tx_path);
+  }
+  path_remove(temp_path);
+
+  if (!ok) {
+    VLOG(1) << "Failed to convert " << filepath << " to " << tx_path << ", reading it as is: "
+            << messages.str();
+    converted[filepath] = filepath;
+    return filepath;
+  }
+
+  VLOG(1) << "Converted " << filepath << " to " << tx_path << " in " << time_dt() - start_time
+          << " seconds.";
+  num_converted++;
+  converted[filepath] = tx_path;
+  return tx_path;
+}
+
+/* Statistics */
+
+void TextureCache::collect_statistics(ImageStats *stats)
+{
+  TextureCacheStats &cache_stats = stats->texture_cache;
+
+  int num_files = 0, num_tiles = 0;
+  long long bytes_read = 0, files_size = 0, memory_used = 0;
+  float memory_limit_mb = 0.0f;
+
+  texture_system->getattribute("stat:unique_files", num_files);
+  texture_system->getattribute("stat:tiles_created", num_tiles);
+  texture_system->getattribute("stat:bytes_read", OIIO::TypeDesc::INT64, &bytes_read);
+  texture_system->getattribute("stat:files_totalsize", OIIO::TypeDesc::INT64, &files_size);
+  texture_system->getattribute("stat:cache_memory_used", OIIO::TypeDesc::INT64, &memory_used);
+  texture_system->getattribute("max_memory_MB", memory_limit_mb);
+
+  cache_stats.num_files = num_files;
+  cache_stats.num_converted = num_converted;
+  cache_stats.num_tiles_loaded = num_tiles;
+  cache_stats.bytes_read = bytes_read;
+  cache_stats.files_size = files_size;
+  cache_stats.memory_used = memory_used;
+  cache_stats.memory_limit = (size_t)(memory_limit_mb * 1024.0f * 1024.0f);
+}
+
+CCL_NAMESPACE_END
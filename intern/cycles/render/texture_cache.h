@@ -0,0 +1,69 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TEXTURE_CACHE_H__
+#define __TEXTURE_CACHE_H__
+
+#include "util/util_map.h"
+#include "util/util_string.h"
+#include "util/util_thread.h"
+
+#include <OpenImageIO/texture.h>
+
+CCL_NAMESPACE_BEGIN
+
+class ImageStats;
+class SceneParams;
+
+/* Texture Cache
+ *
+ * Image textures loaded on demand through the OpenImageIO texture system, so only the tiles
+ * that are actually sampled are read from disk and kept in memory, up to a maximum cache size.
+ * Images can be converted to tiled and mipmapped .tx files in a cache directory first, which
+ * makes reading individual tiles much cheaper. Only used for rendering on the CPU. */
+
+class TextureCache {
+ public:
+  explicit TextureCache(const SceneParams &params);
+  ~TextureCache();
+
+  /* Handle for lookups of the image in the kernel, NULL if it can't be read. */
+  void *get_handle(const string &filepath);
+  /* Release cached tiles of the image, when it is removed or modified. */
+  void invalidate(const string &filepath);
+
+  void *get_texture_system();
+
+  void collect_statistics(ImageStats *stats);
+
+ protected:
+  string tx_filepath(const string &filepath) const;
+  string converted_filepath(const string &filepath);
+
+  OIIO::TextureSystem *texture_system;
+
+  /* Directory to store converted images in, empty to read images as they are. */
+  string directory;
+
+  /* Conversions are done one at a time, OpenImageIO uses multiple threads for them already. */
+  thread_mutex convert_mutex;
+  unordered_map<string, string> converted;
+  int num_converted;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __TEXTURE_CACHE_H__ */
@@ -48,6 +48,13 @@ void EdgeDice::reserve(int num_verts, int num_triangles)
   mesh->resize_mesh(mesh->verts.size() + num_verts, mesh->num_triangles());
   mesh->reserve_mesh(mesh->verts.size() + num_verts, mesh->num_triangles() + num_triangles);
 
+  /* Triangles are written by index, so subpatches can be diced in parallel. */
+  const size_t num_mesh_triangles = tri_offset + num_triangles;
+  mesh->triangles.resize(num_mesh_triangles * 3);
+  mesh->shader.resize(num_mesh_triangles);
+  mesh->smooth.resize(num_mesh_triangles);
+  mesh->triangle_patch.resize(num_mesh_triangles);
+
   Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
 
   mesh_P = mesh->verts.data() + vert_offset;
@@ -69,14 +76,19 @@ void EdgeDice::set_vert(Patch *patch, int index, float2 uv)
   params.mesh->vert_patch_uv[index + vert_offset] = make_float2(uv.x, uv.y);
 }
 
-void EdgeDice::add_triangle(Patch *patch, int v0, int v1, int v2)
+void EdgeDice::add_triangle(Subpatch &sub, int v0, int v1, int v2)
 {
   Mesh *mesh = params.mesh;
+  const size_t index = tri_offset + sub.triangle_offset++;
 
-  mesh->add_triangle(v0 + vert_offset, v1 + vert_offset, v2 + vert_offset, patch->shader, true);
-  params.mesh->triangle_patch[params.mesh->num_triangles() - 1] = patch->patch_index;
+  assert(index < mesh->num_triangles());
 
-  tri_offset++;
+  mesh->triangles[index * 3 + 0] = v0 + vert_offset;
+  mesh->triangles[index * 3 + 1] = v1 + vert_offset;
+  mesh->triangles[index * 3 + 2] = v2 + vert_offset;
+  mesh->shader[index] = sub.patch->shader;
+  mesh->smooth[index] = true;
+  mesh->triangle_patch[index] = sub.patch->patch_index;
 }
 
 void EdgeDice::stitch_triangles(Subpatch &sub, int edge)
@@ -122,7 +134,7 @@ void EdgeDice::stitch_triangles(Subpatch &sub, int edge)
         v2 = sub.get_vert_along_grid_edge(edge, ++i);
     }
 
-    add_triangle(sub.patch, v1, v0, v2);
+    add_triangle(sub, v1, v0, v2);
   }
 }
 
@@ -157,7 +169,10 @@ void QuadDice::set_vert(Subpatch &sub, int index, float u, float v)
   EdgeDice::set_vert(sub.patch, index, map_uv(sub, u, v));
 }
 
-void QuadDice::set_side(Subpatch &sub, int edge)
+void QuadDice::set_side(Subpatch &sub,
+                        int edge,
+                        int subpatch_index,
+                        const vector<int> &edge_vert_owner)
 {
   int t = sub.edges[edge].T;
 
@@ -186,7 +201,10 @@ void QuadDice::set_side(Subpatch &sub, int edge)
         break;
     }
 
-    set_vert(sub, sub.get_vert_along_edge(edge, i), u, v);
+    const int vert = sub.get_vert_along_edge(edge, i);
+    if (edge_vert_owner[vert] == subpatch_index) {
+      set_vert(sub, vert, u, v);
+    }
   }
 }
 
@@ -243,14 +261,14 @@ void QuadDice::add_grid(Subpatch &sub, int Mu, int Mv, int offset)
         int i3 = offset + i + j * (Mu - 1);
         int i4 = offset + (i - 1) + j * (Mu - 1);
 
-        add_triangle(sub.patch, i1, i2, i3);
-        add_triangle(sub.patch, i1, i3, i4);
+        add_triangle(sub, i1, i2, i3);
+        add_triangle(sub, i1, i3, i4);
       }
     }
   }
 }
 
-void QuadDice::dice(Subpatch &sub)
+void QuadDice::dice_grid(Subpatch &sub, int subpatch_index, const vector<int> &edge_vert_owner)
 {
   /* compute inner grid size with scale factor */
   int Mu = max(sub.edge_u0.T, sub.edge_u1.T);
@@ -269,11 +287,14 @@ void QuadDice::dice(Subpatch &sub)
   add_grid(sub, Mu, Mv, sub.inner_grid_vert_offset);
 
   /* sides */
-  set_side(sub, 0);
-  set_side(sub, 1);
-  set_side(sub, 2);
-  set_side(sub, 3);
+  set_side(sub, 0, subpatch_index, edge_vert_owner);
+  set_side(sub, 1, subpatch_index, edge_vert_owner);
+  set_side(sub, 2, subpatch_index, edge_vert_owner);
+  set_side(sub, 3, subpatch_index, edge_vert_owner);
+}
 
+void QuadDice::dice_stitch(Subpatch &sub)
+{
   stitch_triangles(sub, 0);
   stitch_triangles(sub, 1);
   stitch_triangles(sub, 2);
@@ -72,7 +72,7 @@ class EdgeDice {
   void reserve(int num_verts, int num_triangles);
 
   void set_vert(Patch *patch, int index, float2 uv);
-  void add_triangle(Patch *patch, int v0, int v1, int v2);
+  void add_triangle(Subpatch &sub, int v0, int v1, int v2);
 
   void stitch_triangles(Subpatch &sub, int edge);
 };
@@ -90,12 +90,18 @@ class QuadDice : public EdgeDice {
 
   void add_grid(Subpatch &sub, int Mu, int Mv, int offset);
 
-  void set_side(Subpatch &sub, int edge);
+  void set_side(Subpatch &sub, int edge, int subpatch_index, const vector<int> &edge_vert_owner);
 
   float quad_area(const float3 &a, const float3 &b, const float3 &c, const float3 &d);
   float scale_factor(Subpatch &sub, int Mu, int Mv);
 
-  void dice(Subpatch &sub);
+  /* Dicing is done in two passes over all subpatches, each of which may run in parallel. The
+   * first evaluates vertices and adds the inner grid triangles, the second stitches the grid to
+   * the edges, which needs the edge vertices of neighboring subpatches. Edge vertices are shared
+   * between subpatches and only evaluated by their owner, so the result does not depend on the
+   * order in which subpatches are diced. */
+  void dice_grid(Subpatch &sub, int subpatch_index, const vector<int> &edge_vert_owner);
+  void dice_stitch(Subpatch &sub);
 };
 
 CCL_NAMESPACE_END
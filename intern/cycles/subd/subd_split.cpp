@@ -25,6 +25,7 @@
 #include "util/util_foreach.h"
 #include "util/util_hash.h"
 #include "util/util_math.h"
+#include "util/util_tbb.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -723,12 +724,17 @@ void DiagSplit::post_split()
 
   for (size_t i = 0; i < subpatches.size(); i++) {
     subpatches[i].inner_grid_vert_offset = num_verts;
+    subpatches[i].triangle_offset = num_triangles;
     num_verts += subpatches[i].calc_num_inner_verts();
     num_triangles += subpatches[i].calc_num_triangles();
   }
 
   dice.reserve(num_verts, num_triangles);
 
+  /* Edge vertices are shared by neighboring subpatches, which may evaluate them to slightly
+   * different positions. Assign each to the last subpatch using it, matching sequential dicing. */
+  vector<int> edge_vert_owner(num_alloced_verts, -1);
+
   for (size_t i = 0; i < subpatches.size(); i++) {
     Subpatch &sub = subpatches[i];
 
@@ -737,9 +743,30 @@ void DiagSplit::post_split()
     sub.edge_v0.T = max(sub.edge_v0.T, 1);
     sub.edge_v1.T = max(sub.edge_v1.T, 1);
 
-    dice.dice(sub);
+    for (int edge = 0; edge < 4; edge++) {
+      for (int j = 0; j < sub.edges[edge].T; j++) {
+        edge_vert_owner[sub.get_vert_along_edge(edge, j)] = i;
+      }
+    }
   }
 
+  /* Dice in parallel, with grain size to avoid threading overhead for small subpatches. */
+  static const int SUBPATCHES_PER_TASK = 64;
+
+  parallel_for(blocked_range<size_t>(0, subpatches.size(), SUBPATCHES_PER_TASK),
+               [&](const blocked_range<size_t> &r) {
+                 for (size_t i = r.begin(); i != r.end(); i++) {
+                   dice.dice_grid(subpatches[i], i, edge_vert_owner);
+                 }
+               });
+
+  parallel_for(blocked_range<size_t>(0, subpatches.size(), SUBPATCHES_PER_TASK),
+               [&](const blocked_range<size_t> &r) {
+                 for (size_t i = r.begin(); i != r.end(); i++) {
+                   dice.dice_stitch(subpatches[i]);
+                 }
+               });
+
   /* Cleanup */
   subpatches.clear();
   edges.clear();
@@ -28,6 +28,8 @@ class Subpatch {
  public:
   class Patch *patch; /* Patch this is a subpatch of. */
   int inner_grid_vert_offset;
+  /* Start of the triangles of this subpatch, advanced as they are added while dicing. */
+  int triangle_offset;
 
   struct edge_t {
     int T;
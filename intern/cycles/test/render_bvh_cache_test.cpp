@@ -0,0 +1,185 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "bvh/bvh.h"
+#include "bvh/bvh_cache.h"
+#include "bvh/bvh_params.h"
+
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "util/util_path.h"
+#include "util/util_progress.h"
+#include "util/util_string.h"
+#include "util/util_unique_ptr.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+static string test_directory(const char *name)
+{
+  return path_join(::testing::TempDir(), string_printf("cycles_bvh_cache_%s", name));
+}
+
+/* Wavy grid of triangles, enough of them for a BVH with several levels. */
+static void build_grid(Mesh *mesh, int resolution, float height)
+{
+  mesh->reserve_mesh((resolution + 1) * (resolution + 1), resolution * resolution * 2);
+
+  for (int y = 0; y <= resolution; y++) {
+    for (int x = 0; x <= resolution; x++) {
+      mesh->add_vertex(make_float3((float)x, (float)y, height * sinf(x * 0.7f + y * 0.3f)));
+    }
+  }
+
+  for (int y = 0; y < resolution; y++) {
+    for (int x = 0; x < resolution; x++) {
+      const int v0 = y * (resolution + 1) + x;
+      const int v1 = v0 + 1;
+      const int v2 = v0 + resolution + 1;
+      const int v3 = v2 + 1;
+      mesh->add_triangle(v0, v1, v3, 0, false);
+      mesh->add_triangle(v0, v3, v2, 0, false);
+    }
+  }
+
+  mesh->compute_bounds();
+}
+
+static BVHParams bvh2_params()
+{
+  BVHParams params;
+  params.bvh_layout = BVH_LAYOUT_BVH2;
+  params.top_level = false;
+  return params;
+}
+
+/* Geometry and the object it is packed for, as Geometry::compute_bvh() builds its BVH. */
+class CacheGeometry {
+ public:
+  CacheGeometry(int resolution, float height)
+  {
+    build_grid(&mesh, resolution, height);
+    object.geometry = &mesh;
+    geometry.push_back(&mesh);
+    objects.push_back(&object);
+  }
+
+  string key(const BVHParams &params) const
+  {
+    return BVHCache::key(&mesh, objects, params);
+  }
+
+  BVH *build(const BVHParams &params)
+  {
+    Progress progress;
+    BVH *bvh = BVH::create(params, geometry, objects, NULL);
+    bvh->build(progress);
+    return bvh;
+  }
+
+  Mesh mesh;
+  Object object;
+  vector<Geometry *> geometry;
+  vector<Object *> objects;
+};
+
+template<typename T> static void expect_array_eq(const array<T> &a, const array<T> &b)
+{
+  ASSERT_EQ(a.size(), b.size());
+  EXPECT_EQ(memcmp(a.data(), b.data(), sizeof(T) * a.size()), 0);
+}
+
+}  // namespace
+
+TEST(render_bvh_cache, round_trip)
+{
+  const string directory = test_directory("round_trip");
+  const BVHParams params = bvh2_params();
+
+  CacheGeometry geom(32, 1.0f);
+  unique_ptr<BVH> bvh(geom.build(params));
+  const PackedBVH &pack = bvh->pack;
+  ASSERT_FALSE(pack.nodes.empty());
+
+  const string key = geom.key(params);
+  ASSERT_FALSE(key.empty());
+
+  BVHCache cache(directory);
+  ASSERT_TRUE(cache.write(key, pack));
+
+  PackedBVH read_pack;
+  ASSERT_TRUE(cache.read(key, read_pack));
+
+  EXPECT_EQ(read_pack.root_index, pack.root_index);
+  expect_array_eq(read_pack.nodes, pack.nodes);
+  expect_array_eq(read_pack.leaf_nodes, pack.leaf_nodes);
+  expect_array_eq(read_pack.object_node, pack.object_node);
+  expect_array_eq(read_pack.prim_tri_index, pack.prim_tri_index);
+  expect_array_eq(read_pack.prim_tri_verts, pack.prim_tri_verts);
+  expect_array_eq(read_pack.prim_type, pack.prim_type);
+  expect_array_eq(read_pack.prim_visibility, pack.prim_visibility);
+  expect_array_eq(read_pack.prim_index, pack.prim_index);
+  expect_array_eq(read_pack.prim_object, pack.prim_object);
+  expect_array_eq(read_pack.prim_time, pack.prim_time);
+
+  /* Unknown keys are not found. */
+  EXPECT_FALSE(cache.read(CacheGeometry(8, 1.0f).key(params), read_pack));
+}
+
+TEST(render_bvh_cache, key)
+{
+  const BVHParams params = bvh2_params();
+
+  CacheGeometry geom(16, 1.0f);
+  const string key = geom.key(params);
+
+  /* Identical geometry. */
+  EXPECT_EQ(CacheGeometry(16, 1.0f).key(params), key);
+
+  /* Different vertices or topology. */
+  EXPECT_NE(CacheGeometry(16, 0.5f).key(params), key);
+  EXPECT_NE(CacheGeometry(15, 1.0f).key(params), key);
+
+  /* Visibility of the object is packed into the primitives and nodes. */
+  CacheGeometry invisible(16, 1.0f);
+  invisible.object.visibility &= ~PATH_RAY_CAMERA;
+  EXPECT_NE(invisible.key(params), key);
+
+  CacheGeometry shadow_catcher(16, 1.0f);
+  shadow_catcher.object.is_shadow_catcher = true;
+  EXPECT_NE(shadow_catcher.key(params), key);
+
+  /* Build parameters. */
+  BVHParams spatial_split_params = params;
+  spatial_split_params.use_spatial_split = true;
+  EXPECT_NE(geom.key(spatial_split_params), key);
+
+  /* Only BVH2 object BVHs are cached. */
+  BVHParams embree_params = params;
+  embree_params.bvh_layout = BVH_LAYOUT_EMBREE;
+  EXPECT_TRUE(geom.key(embree_params).empty());
+
+  BVHParams top_level_params = params;
+  top_level_params.top_level = true;
+  EXPECT_TRUE(geom.key(top_level_params).empty());
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Tests of the light tree builder, and of sampling it with the kernel functions on the CPU. */
+
+#include "testing/testing.h"
+
+#include "render/light_tree.h"
+
+#include "util/util_foreach.h"
+#include "util/util_math.h"
+#include "util/util_vector.h"
+
+// clang-format off
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+#include "kernel/kernel_light_tree.h"
+// clang-format on
+
+#include <random>
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+static float random_float(std::mt19937 &rng, float min, float max)
+{
+  return std::uniform_real_distribution<float>(min, max)(rng);
+}
+
+static float3 random_point(std::mt19937 &rng, float extent)
+{
+  return make_float3(random_float(rng, -extent, extent),
+                     random_float(rng, -extent, extent),
+                     random_float(rng, -extent, extent));
+}
+
+static float3 random_direction(std::mt19937 &rng)
+{
+  const float z = random_float(rng, -1.0f, 1.0f);
+  const float r = sqrtf(max(1.0f - z * z, 0.0f));
+  const float phi = random_float(rng, 0.0f, M_2PI_F);
+  return make_float3(r * cosf(phi), r * sinf(phi), z);
+}
+
+/* Point, spot and area lamps and mesh light triangles, the same way LightManager makes the
+ * primitives of the tree from them, followed in the light distribution by distant lights. */
+static vector<LightTreePrimitive> mixed_primitives(std::mt19937 &rng,
+                                                   int num_lamps,
+                                                   int num_triangles)
+{
+  vector<LightTreePrimitive> primitives;
+
+  for (int i = 0; i < num_lamps; i++) {
+    LightTreePrimitive prim;
+    prim.distribution_index = primitives.size();
+    prim.bbox = BoundBox::empty;
+
+    const float3 co = random_point(rng, 10.0f);
+    const float3 dir = random_direction(rng);
+    const float strength = random_float(rng, 0.1f, 100.0f);
+
+    switch (i % 3) {
+      case 0:
+        /* Point light. */
+        prim.bbox.grow(co, random_float(rng, 0.0f, 0.5f));
+        prim.cone = LightTreeCone::omnidirectional();
+        prim.energy = strength;
+        break;
+      case 1:
+        /* Spot light. */
+        prim.bbox.grow(co, random_float(rng, 0.0f, 0.5f));
+        prim.cone = LightTreeCone(dir, 0.0f, random_float(rng, 0.1f, M_PI_2_F));
+        prim.energy = strength;
+        break;
+      default: {
+        /* Area light. */
+        float3 axisu, axisv;
+        make_orthonormals(dir, &axisu, &axisv);
+        axisu *= random_float(rng, 0.1f, 2.0f);
+        axisv *= random_float(rng, 0.1f, 2.0f);
+        prim.bbox.grow(co - 0.5f * axisu - 0.5f * axisv);
+        prim.bbox.grow(co + 0.5f * axisu - 0.5f * axisv);
+        prim.bbox.grow(co - 0.5f * axisu + 0.5f * axisv);
+        prim.bbox.grow(co + 0.5f * axisu + 0.5f * axisv);
+        prim.cone = LightTreeCone(dir, 0.0f, M_PI_2_F);
+        prim.energy = strength * M_PI_4_F;
+        break;
+      }
+    }
+
+    primitives.push_back(prim);
+  }
+
+  for (int i = 0; i < num_triangles; i++) {
+    LightTreePrimitive prim;
+    prim.distribution_index = primitives.size();
+    prim.bbox = BoundBox::empty;
+
+    const float3 p1 = random_point(rng, 10.0f);
+    const float3 p2 = p1 + random_point(rng, 0.5f);
+    const float3 p3 = p1 + random_point(rng, 0.5f);
+    prim.bbox.grow(p1);
+    prim.bbox.grow(p2);
+    prim.bbox.grow(p3);
+    prim.cone = LightTreeCone::omnidirectional();
+    prim.energy = random_float(rng, 0.1f, 10.0f) * M_PI_F * triangle_area(p1, p2, p3);
+
+    primitives.push_back(prim);
+  }
+
+  return primitives;
+}
+
+/* Kernel data of a light tree, as filled in by LightManager::device_update_light_tree. */
+class LightTreeKernelData {
+ public:
+  LightTreeKernelData(const LightTree &tree,
+                      const vector<LightTreePrimitive> &primitives,
+                      int num_infinite)
+  {
+    const int num_local = primitives.size();
+    const int num_distribution = num_local + num_infinite;
+
+    nodes = tree.nodes;
+
+    emitters.resize(num_distribution);
+    memset(emitters.data(), 0, sizeof(KernelLightTreeEmitter) * num_distribution);
+    foreach (const LightTreePrimitive &prim, primitives) {
+      KernelLightTreeEmitter *kemitter = &emitters[prim.distribution_index];
+      light_tree_bounds_to_kernel(&kemitter->bounds, prim.bbox, prim.cone, prim.energy);
+      kemitter->bit_trail = tree.bit_trails[prim.distribution_index];
+    }
+
+    leaf_emitters = tree.leaf_emitters;
+    for (int i = 0; i < num_infinite; i++) {
+      leaf_emitters.push_back(num_local + i);
+    }
+
+    kg.__light_tree_nodes.data = nodes.data();
+    kg.__light_tree_nodes.width = nodes.size();
+    kg.__light_tree_emitters.data = emitters.data();
+    kg.__light_tree_emitters.width = emitters.size();
+    kg.__light_tree_leaf_emitters.data = leaf_emitters.data();
+    kg.__light_tree_leaf_emitters.width = leaf_emitters.size();
+
+    kg.__data.integrator.num_distribution = num_distribution;
+    kg.__data.integrator.use_light_tree = true;
+    kg.__data.integrator.light_tree_num_infinite = num_infinite;
+    kg.__data.integrator.pdf_lights = (num_infinite) ? 0.5f / num_infinite : 0.0f;
+  }
+
+  KernelGlobals kg;
+
+ protected:
+  vector<KernelLightTreeNode> nodes;
+  vector<KernelLightTreeEmitter> emitters;
+  vector<uint> leaf_emitters;
+};
+
+/* Walks the tree, checking the depth of every node and that the bit trail of every emitter
+ * leads to the leaf holding it. Returns the number of emitters in the leaves. */
+static int check_subtree(
+    const LightTree &tree, int node_index, int depth, uint bit_trail, int *max_depth)
+{
+  EXPECT_LT(depth, LIGHT_TREE_MAX_DEPTH);
+  if (depth >= LIGHT_TREE_MAX_DEPTH) {
+    return 0;
+  }
+  *max_depth = max(*max_depth, depth);
+
+  const KernelLightTreeNode &knode = tree.nodes[node_index];
+
+  if (knode.num_emitters > 0) {
+    for (int i = 0; i < knode.num_emitters; i++) {
+      const uint index = tree.leaf_emitters[knode.child_index + i];
+      EXPECT_EQ(tree.bit_trails[index], bit_trail);
+    }
+    return knode.num_emitters;
+  }
+
+  return check_subtree(tree, node_index + 1, depth + 1, bit_trail, max_depth) +
+         check_subtree(tree, knode.child_index, depth + 1, bit_trail | (1u << depth), max_depth);
+}
+
+}  // namespace
+
+TEST(render_light_tree, pdf_matches_sample)
+{
+  std::mt19937 rng(1);
+  vector<LightTreePrimitive> primitives = mixed_primitives(rng, 60, 300);
+  LightTree tree(primitives, 8);
+  LightTreeKernelData data(tree, primitives, 2);
+  KernelGlobals *kg = &data.kg;
+
+  const int num_local = primitives.size();
+  int num_tree_samples = 0;
+
+  for (int i = 0; i < 1000; i++) {
+    const float3 P = random_point(rng, 12.0f);
+    float randu = random_float(rng, 0.0f, 1.0f);
+    float pdf = 0.0f;
+
+    const int index = light_tree_sample(kg, P, &randu, &pdf);
+    ASSERT_GE(index, 0);
+    ASSERT_LT(index, num_local + 2);
+    EXPECT_GE(randu, 0.0f);
+    EXPECT_LT(randu, 1.0f);
+
+    if (index >= num_local) {
+      EXPECT_EQ(pdf, kernel_data.integrator.pdf_lights);
+    }
+    else {
+      EXPECT_GT(pdf, 0.0f);
+      EXPECT_NEAR(light_tree_pdf(kg, P, index), pdf, 1e-5f * pdf);
+      num_tree_samples++;
+    }
+  }
+
+  /* Half the samples are for the lights in the tree. */
+  EXPECT_GT(num_tree_samples, 400);
+}
+
+TEST(render_light_tree, pdf_sums_to_one)
+{
+  std::mt19937 rng(1);
+  vector<LightTreePrimitive> primitives = mixed_primitives(rng, 60, 300);
+  LightTree tree(primitives, 8);
+  LightTreeKernelData data(tree, primitives, 2);
+  KernelGlobals *kg = &data.kg;
+
+  for (int i = 0; i < 1000; i++) {
+    const float3 P = random_point(rng, 12.0f);
+
+    double sum = 2.0 * kernel_data.integrator.pdf_lights;
+    foreach (const LightTreePrimitive &prim, primitives) {
+      sum += light_tree_pdf(kg, P, prim.distribution_index);
+    }
+
+    EXPECT_NEAR(sum, 1.0, 1e-4);
+  }
+}
+
+TEST(render_light_tree, bit_trails_lead_to_leaves)
+{
+  std::mt19937 rng(3);
+  vector<LightTreePrimitive> primitives = mixed_primitives(rng, 60, 300);
+  LightTree tree(primitives, 8);
+
+  int max_depth = 0;
+  EXPECT_EQ(check_subtree(tree, 0, 0, 0, &max_depth), (int)primitives.size());
+  EXPECT_EQ(tree.leaf_emitters.size(), primitives.size());
+}
+
+TEST(render_light_tree, max_depth)
+{
+  /* Emitters along a line with every distance 13 times the previous one. Only the farthest
+   * emitter is outside the first of the buckets of a split, so every level splits off a single
+   * emitter, and without a limit the tree would be as deep as there are emitters. */
+  const int num_emitters = LIGHT_TREE_MAX_DEPTH + 2;
+  vector<LightTreePrimitive> primitives;
+  float x = 1.0f;
+
+  for (int i = 0; i < num_emitters; i++) {
+    LightTreePrimitive prim;
+    prim.distribution_index = i;
+    prim.bbox = BoundBox::empty;
+    prim.bbox.grow(make_float3(x, 0.0f, 0.0f), 0.5f);
+    prim.cone = LightTreeCone::omnidirectional();
+    /* Small, so the split costs of the huge bounds stay finite. */
+    prim.energy = 1e-6f;
+    primitives.push_back(prim);
+    x *= 13.0f;
+  }
+
+  LightTree tree(primitives, 1);
+
+  int max_depth = 0;
+  EXPECT_EQ(check_subtree(tree, 0, 0, 0, &max_depth), num_emitters);
+  EXPECT_EQ(max_depth, LIGHT_TREE_MAX_DEPTH - 1);
+}
+
+CCL_NAMESPACE_END
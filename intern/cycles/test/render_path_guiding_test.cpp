@@ -0,0 +1,404 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Tests of the path guiding tree, and a comparison of rendering with and without path guiding.
+ * The comparison scene is a closed room lit only through a small opening in its ceiling, where
+ * neither BSDF nor light sampling easily finds the light. Renders with guiding must converge to
+ * the same image as without it, and have less noise at equal samples. Noise is measured as the
+ * variance between two renders with different seeds.
+ *
+ * Render time depends on the machine and its load, so the comparison at equal time and against
+ * a high sample count reference only runs as a benchmark. Pass for example
+ *
+ *   cycles_test --gtest_filter=render_path_guiding.* --cycles_guiding_benchmark
+ *               --cycles_guiding_size=256 --cycles_guiding_samples=256
+ *               --cycles_guiding_reference_samples=4096
+ *
+ * for more precise numbers. */
+
+#include "testing/testing.h"
+
+#include "render_session_test.h"
+
+#include "render/camera.h"
+#include "render/graph.h"
+#include "render/guiding.h"
+#include "render/integrator.h"
+#include "render/light.h"
+#include "render/mesh.h"
+#include "render/nodes.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/shader.h"
+
+#include "util/util_math.h"
+#include "util/util_transform.h"
+#include "util/util_vector.h"
+
+#include <random>
+
+DEFINE_int32(cycles_guiding_size, 64, "Width and height of the guiding comparison renders.");
+DEFINE_int32(cycles_guiding_samples, 64, "Samples per pixel of the guiding comparison renders.");
+DEFINE_bool(cycles_guiding_benchmark,
+            false,
+            "Compare noise at equal render time, and against a reference render.");
+DEFINE_int32(cycles_guiding_reference_samples,
+             1024,
+             "Samples per pixel of the benchmark reference render without guiding.");
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Random direction within the cone around +Z with the given cosine of its angle. */
+static float3 random_cone_direction(std::mt19937 &rng, float cos_angle)
+{
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  const float cos_theta = 1.0f - uniform(rng) * (1.0f - cos_angle);
+  const float sin_theta = sqrtf(max(1.0f - cos_theta * cos_theta, 0.0f));
+  const float phi = M_2PI_F * uniform(rng);
+  return make_float3(sin_theta * cosf(phi), sin_theta * sinf(phi), cos_theta);
+}
+
+/* Integral of the pdf over the sphere, with the midpoints of a grid over the area preserving
+ * cylindrical mapping. */
+static float directional_pdf_integral(const GuidingDirectionalTree &tree, int resolution)
+{
+  double sum = 0.0;
+  for (int y = 0; y < resolution; y++) {
+    for (int x = 0; x < resolution; x++) {
+      const float cos_theta = 2.0f * (x + 0.5f) / resolution - 1.0f;
+      const float sin_theta = sqrtf(max(1.0f - cos_theta * cos_theta, 0.0f));
+      const float phi = M_2PI_F * (y + 0.5f) / resolution;
+      sum += tree.pdf(make_float3(sin_theta * cosf(phi), sin_theta * sinf(phi), cos_theta));
+    }
+  }
+  return (float)(sum * 4.0 * M_PI / ((double)resolution * resolution));
+}
+
+static void add_quad(Mesh *mesh, float3 p0, float3 p1, float3 p2, float3 p3)
+{
+  const int start = mesh->verts.size();
+  mesh->add_vertex(p0);
+  mesh->add_vertex(p1);
+  mesh->add_vertex(p2);
+  mesh->add_vertex(p3);
+  mesh->add_triangle(start, start + 1, start + 2, 0, false);
+  mesh->add_triangle(start, start + 2, start + 3, 0, false);
+}
+
+/* Room of 4x4x4 around the camera, with a hole of the given size in the middle of the ceiling
+ * and a bright sky outside. Rendered with the given guiding and seed settings. */
+static void guiding_build_scene(Scene *scene, int size, float hole, bool use_guiding, int seed)
+{
+  scene->integrator->use_guiding = use_guiding;
+  scene->integrator->seed = seed;
+  scene->integrator->tag_update(scene);
+
+  scene->camera->width = size;
+  scene->camera->height = size;
+  scene->camera->matrix = transform_identity();
+  scene->camera->compute_auto_viewplane();
+  scene->camera->need_update = true;
+
+  ShaderGraph *background_graph = new ShaderGraph();
+  BackgroundNode *background = new BackgroundNode();
+  background->color = make_float3(1.0f, 1.0f, 1.0f);
+  background->strength = 20.0f;
+  background_graph->add(background);
+  background_graph->connect(background->output("Background"),
+                            background_graph->output()->input("Surface"));
+  scene->default_background->set_graph(background_graph);
+  scene->default_background->tag_update(scene);
+
+  /* Sample the sky as a light too, so light samples are weighted against guided bounces. */
+  Light *light = new Light();
+  light->type = LIGHT_BACKGROUND;
+  light->shader = scene->default_background;
+  light->map_resolution = 64;
+  light->use_mis = true;
+  scene->lights.push_back(light);
+
+  Mesh *mesh = new Mesh();
+  mesh->used_shaders.push_back(scene->default_surface);
+
+  const float r = 2.0f;
+  const float h = 0.5f * hole;
+
+  /* Floor and walls. */
+  add_quad(mesh,
+           make_float3(-r, -r, -r),
+           make_float3(r, -r, -r),
+           make_float3(r, -r, r),
+           make_float3(-r, -r, r));
+  add_quad(mesh,
+           make_float3(-r, -r, r),
+           make_float3(r, -r, r),
+           make_float3(r, r, r),
+           make_float3(-r, r, r));
+  add_quad(mesh,
+           make_float3(-r, -r, -r),
+           make_float3(-r, r, -r),
+           make_float3(r, r, -r),
+           make_float3(r, -r, -r));
+  add_quad(mesh,
+           make_float3(-r, -r, -r),
+           make_float3(-r, -r, r),
+           make_float3(-r, r, r),
+           make_float3(-r, r, -r));
+  add_quad(mesh,
+           make_float3(r, -r, -r),
+           make_float3(r, r, -r),
+           make_float3(r, r, r),
+           make_float3(r, -r, r));
+
+  /* Ceiling around the hole. */
+  add_quad(mesh,
+           make_float3(-r, r, -r),
+           make_float3(-r, r, r),
+           make_float3(-h, r, r),
+           make_float3(-h, r, -r));
+  add_quad(mesh,
+           make_float3(h, r, -r),
+           make_float3(h, r, r),
+           make_float3(r, r, r),
+           make_float3(r, r, -r));
+  add_quad(mesh,
+           make_float3(-h, r, -r),
+           make_float3(-h, r, -h),
+           make_float3(h, r, -h),
+           make_float3(h, r, -r));
+  add_quad(mesh,
+           make_float3(-h, r, h),
+           make_float3(-h, r, r),
+           make_float3(h, r, r),
+           make_float3(h, r, h));
+
+  scene->geometry.push_back(mesh);
+
+  Object *object = new Object();
+  object->geometry = mesh;
+  object->tfm = transform_identity();
+  scene->objects.push_back(object);
+}
+
+/* Render the room with or without guiding. Guiding learns between passes over the whole
+ * image. */
+static TestRender guiding_render(bool use_guiding, int seed, int samples)
+{
+  const int size = max(FLAGS_cycles_guiding_size, 8);
+
+  SessionParams session_params;
+  session_params.progressive = true;
+  session_params.progressive_refine = true;
+  session_params.samples = samples;
+
+  return test_render(session_params,
+                     size,
+                     function_bind(&guiding_build_scene, _1, size, 0.4f, use_guiding, seed));
+}
+
+}  // namespace
+
+TEST(render_path_guiding, directional_tree_pdf)
+{
+  std::mt19937 rng(0);
+
+  /* Learn a lobe around +Z twice, the second time with the refined tree. */
+  GuidingDirectionalTree tree;
+  for (int iteration = 0; iteration < 2; iteration++) {
+    for (int i = 0; i < 10000; i++) {
+      tree.record(random_cone_direction(rng, 0.8f), 1.0f);
+    }
+    tree.build_sums();
+    EXPECT_NEAR(tree.energy(), 10000.0f, 1.0f);
+
+    if (iteration == 0) {
+      tree = tree.refine(0.01f, 20);
+      EXPECT_GT(tree.nodes.size(), 1);
+      EXPECT_EQ(tree.energy(), 0.0f);
+    }
+  }
+
+  EXPECT_NEAR(directional_pdf_integral(tree, 512), 1.0f, 0.01f);
+
+  /* Uniform over the lobe, which covers a tenth of the sphere, and nothing outside of it. */
+  EXPECT_NEAR(tree.pdf(make_float3(0.0f, 0.0f, 1.0f)), 10.0f * M_1_PI_F * 0.25f, 0.2f);
+  EXPECT_EQ(tree.pdf(make_float3(0.0f, 0.0f, -1.0f)), 0.0f);
+  EXPECT_EQ(tree.pdf(make_float3(1.0f, 0.0f, 0.0f)), 0.0f);
+}
+
+TEST(render_path_guiding, spatial_tree_split)
+{
+  GuidingTree tree(BoundBox(make_float3(-1.0f, -1.0f, -1.0f), make_float3(1.0f, 1.0f, 1.0f)));
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+  /* Many vertices in the negative X half, light from +Z. */
+  for (int i = 0; i < 50000; i++) {
+    const float3 P = make_float3(-fabsf(uniform(rng)), uniform(rng), uniform(rng));
+    tree.record(P, random_cone_direction(rng, 0.5f), 1.0f);
+  }
+  tree.update(1);
+
+  EXPECT_GT(tree.nodes.size(), 1);
+  EXPECT_TRUE(tree.has_sampling());
+
+  const int left = tree.find_leaf(make_float3(-0.5f, 0.0f, 0.0f));
+  const int right = tree.find_leaf(make_float3(0.5f, 0.0f, 0.0f));
+  EXPECT_NE(left, right);
+  EXPECT_TRUE(tree.nodes[left].has_sampling);
+  EXPECT_GT(tree.nodes[left].sampling.pdf(make_float3(0.0f, 0.0f, 1.0f)), M_1_PI_F * 0.25f);
+
+  /* Kernel nodes find the same leaves, which sample from the distribution learned before the
+   * split. */
+  vector<KernelGuidingSpatialNode> kspatial(tree.nodes.size());
+  vector<KernelGuidingDirectionalNode> kdirectional(tree.num_kernel_directional_nodes());
+  tree.pack(kspatial.data(), kdirectional.data());
+
+  const float3 P = make_float3(-0.5f, 0.0f, 0.0f);
+  int index = 0;
+  while (kspatial[index].axis != -1) {
+    index = kspatial[index].child + ((P[kspatial[index].axis] >= kspatial[index].split) ? 1 : 0);
+  }
+  EXPECT_EQ(index, left);
+  EXPECT_NE(kspatial[left].sampling_root, -1);
+  EXPECT_NE(kspatial[left].training_root, -1);
+  EXPECT_NE(kspatial[right].sampling_root, -1);
+
+  /* Energy recorded by the kernel is read back into the training tree. */
+  vector<float> radiance(kdirectional.size() * 4, 0.0f);
+  vector<uint> num_samples(kspatial.size(), 0);
+  radiance[kspatial[left].training_root * 4] = 2.0f;
+  num_samples[left] = 7;
+  tree.read_training(radiance.data(), num_samples.data());
+
+  EXPECT_EQ(tree.nodes[left].num_samples, 7);
+  EXPECT_EQ(tree.nodes[left].training.nodes[0].energy[0], 2.0f);
+  EXPECT_EQ(tree.nodes[right].num_samples, 0);
+}
+
+TEST(render_path_guiding, equal_samples_noise)
+{
+  const int samples = max(FLAGS_cycles_guiding_samples, 1);
+
+  const TestRender bsdf_a = guiding_render(false, 0, samples);
+  const TestRender bsdf_b = guiding_render(false, 1, samples);
+  const TestRender guided_a = guiding_render(true, 0, samples);
+  const TestRender guided_b = guiding_render(true, 1, samples);
+
+  const float bsdf_mean = 0.5f *
+                          (test_image_mean(bsdf_a.pixels) + test_image_mean(bsdf_b.pixels));
+  const float guided_mean = 0.5f * (test_image_mean(guided_a.pixels) +
+                                    test_image_mean(guided_b.pixels));
+
+  const float bsdf_variance = test_image_variance(bsdf_a.pixels, bsdf_b.pixels);
+  const float guided_variance = test_image_variance(guided_a.pixels, guided_b.pixels);
+
+  printf("%dx%d, %d samples:\n"
+         "  BSDF sampling: mean %.4f, variance %.6f\n"
+         "  Path guiding:  mean %.4f, variance %.6f (%.2fx less)\n",
+         FLAGS_cycles_guiding_size,
+         FLAGS_cycles_guiding_size,
+         samples,
+         bsdf_mean,
+         bsdf_variance,
+         guided_mean,
+         guided_variance,
+         (guided_variance > 0.0f) ? bsdf_variance / guided_variance : 0.0f);
+
+  EXPECT_GT(bsdf_mean, 0.0f);
+  EXPECT_GT(guided_variance, 0.0f);
+
+  /* Both are unbiased, so the image means agree within a few standard deviations, estimated
+   * from the pixel variance and assuming independent pixels. */
+  const float num_values = bsdf_a.pixels.size();
+  const float tolerance = 4.0f * sqrtf(0.5f * (bsdf_variance + guided_variance) / num_values) +
+                          0.005f * bsdf_mean;
+  EXPECT_NEAR(guided_mean, bsdf_mean, tolerance);
+
+  /* Guiding finds the opening more often. */
+  EXPECT_LT(guided_variance, bsdf_variance);
+}
+
+TEST(render_path_guiding, time_equal_noise)
+{
+  if (!FLAGS_cycles_guiding_benchmark) {
+    return;
+  }
+
+  const int samples = max(FLAGS_cycles_guiding_samples, 1);
+  const int reference_samples = max(FLAGS_cycles_guiding_reference_samples, samples);
+
+  const TestRender reference = guiding_render(false, 2, reference_samples);
+  const TestRender bsdf_a = guiding_render(false, 0, samples);
+  const TestRender bsdf_b = guiding_render(false, 1, samples);
+  const TestRender guided_a = guiding_render(true, 0, samples);
+  const TestRender guided_b = guiding_render(true, 1, samples);
+
+  const float reference_mean = test_image_mean(reference.pixels);
+  const float bsdf_mean = 0.5f *
+                          (test_image_mean(bsdf_a.pixels) + test_image_mean(bsdf_b.pixels));
+  const float guided_mean = 0.5f * (test_image_mean(guided_a.pixels) +
+                                    test_image_mean(guided_b.pixels));
+
+  const float bsdf_variance = test_image_variance(bsdf_a.pixels, bsdf_b.pixels);
+  const float guided_variance = test_image_variance(guided_a.pixels, guided_b.pixels);
+
+  /* Variance times render time is the variance at equal time, as variance decreases linearly
+   * with the number of samples. */
+  const double bsdf_time = 0.5 * (bsdf_a.render_time + bsdf_b.render_time);
+  const double guided_time = 0.5 * (guided_a.render_time + guided_b.render_time);
+  const double bsdf_noise = bsdf_variance * bsdf_time;
+  const double guided_noise = guided_variance * guided_time;
+
+  printf("%dx%d, %d samples, reference %.4f with %d samples:\n"
+         "  BSDF sampling: mean %.4f, %.3fs, time-equal variance %.6f\n"
+         "  Path guiding:  mean %.4f, %.3fs, time-equal variance %.6f (%.2fx less)\n",
+         FLAGS_cycles_guiding_size,
+         FLAGS_cycles_guiding_size,
+         samples,
+         reference_mean,
+         reference_samples,
+         bsdf_mean,
+         bsdf_time,
+         bsdf_noise,
+         guided_mean,
+         guided_time,
+         guided_noise,
+         (guided_noise > 0.0) ? bsdf_noise / guided_noise : 0.0);
+
+  EXPECT_GT(reference_mean, 0.0f);
+  EXPECT_GT(guided_noise, 0.0);
+
+  /* Both converge to the reference, with the reference variance scaled from the renders
+   * without guiding. */
+  const float num_values = reference.pixels.size();
+  const float reference_variance = bsdf_variance * samples / reference_samples;
+  const float bsdf_tolerance = 4.0f * sqrtf((0.5f * bsdf_variance + reference_variance) /
+                                            num_values) +
+                               0.005f * reference_mean;
+  const float guided_tolerance = 4.0f * sqrtf((0.5f * guided_variance + reference_variance) /
+                                              num_values) +
+                                 0.005f * reference_mean;
+  EXPECT_NEAR(bsdf_mean, reference_mean, bsdf_tolerance);
+  EXPECT_NEAR(guided_mean, reference_mean, guided_tolerance);
+
+  /* Guiding is worth its overhead. */
+  EXPECT_LT(guided_noise, bsdf_noise);
+}
+
+CCL_NAMESPACE_END
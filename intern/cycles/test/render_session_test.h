@@ -0,0 +1,134 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Utilities for tests that render a scene with a session on the CPU, and compare the images. */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+
+#include "render/buffers.h"
+#include "render/film.h"
+#include "render/scene.h"
+#include "render/session.h"
+
+#include "util/util_foreach.h"
+#include "util/util_function.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct TestRender {
+  /* RGB of the combined pass, in rows from the bottom. */
+  vector<float> pixels;
+  double render_time;
+};
+
+inline void test_render_write_tile(TestRender *result, int size, RenderTile &rtile)
+{
+  RenderBuffers *buffers = rtile.buffers;
+  if (!buffers->copy_from_device()) {
+    return;
+  }
+
+  vector<float> tile_pixels(rtile.w * rtile.h * 4);
+  if (!buffers->get_pass_rect("Combined", 1.0f, rtile.sample, 4, tile_pixels.data())) {
+    return;
+  }
+
+  for (int y = 0; y < rtile.h; y++) {
+    for (int x = 0; x < rtile.w; x++) {
+      const float *in = &tile_pixels[(y * rtile.w + x) * 4];
+      float *out = &result->pixels[((rtile.y + y) * size + rtile.x + x) * 3];
+      out[0] = in[0];
+      out[1] = in[1];
+      out[2] = in[2];
+    }
+  }
+}
+
+/* Render a square image on the first CPU device. The device, background and tile size of the
+ * session parameters are filled in, build_scene() adds the scene contents and settings, a combined
+ * pass is added after it. */
+inline TestRender test_render(SessionParams session_params,
+                              int size,
+                              const function<void(Scene *scene)> &build_scene)
+{
+  vector<DeviceInfo> devices = Device::available_devices(DEVICE_MASK_CPU);
+  EXPECT_FALSE(devices.empty());
+
+  session_params.device = devices[0];
+  session_params.background = true;
+  session_params.tile_size = make_int2(32, 32);
+
+  TestRender result;
+  result.pixels.resize(size * size * 3, 0.0f);
+  result.render_time = 0.0;
+
+  Session *session = new Session(session_params);
+  session->write_render_tile_cb = function_bind(&test_render_write_tile, &result, size, _1);
+
+  SceneParams scene_params;
+  session->scene = new Scene(scene_params, session->device);
+  build_scene(session->scene);
+  Pass::add(PASS_COMBINED, session->scene->passes, "Combined");
+
+  BufferParams buffer_params;
+  buffer_params.width = buffer_params.full_width = size;
+  buffer_params.height = buffer_params.full_height = size;
+  buffer_params.passes = session->scene->passes;
+
+  session->reset(buffer_params, session_params.samples);
+  session->start();
+  session->wait();
+
+  double total_time;
+  session->progress.get_time(total_time, result.render_time);
+  delete session;
+
+  return result;
+}
+
+inline float test_image_mean(const vector<float> &pixels)
+{
+  double sum = 0.0;
+  foreach (float value, pixels) {
+    sum += value;
+  }
+  return (float)(sum / pixels.size());
+}
+
+inline float test_image_mean_difference(const vector<float> &a, const vector<float> &b)
+{
+  double sum = 0.0;
+  for (size_t i = 0; i < a.size(); i++) {
+    sum += fabsf(a[i] - b[i]);
+  }
+  return (float)(sum / a.size());
+}
+
+/* Variance of the pixels of a render, from the difference between two independent renders. */
+inline float test_image_variance(const vector<float> &a, const vector<float> &b)
+{
+  double sum = 0.0;
+  for (size_t i = 0; i < a.size(); i++) {
+    const double diff = a[i] - b[i];
+    sum += 0.5 * diff * diff;
+  }
+  return (float)(sum / a.size());
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,323 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Tests of the CPU split kernel, which traces a wavefront of paths per thread and sorts them by
+ * shader before evaluating shaders.
+ *
+ * The shader sort kernel is run directly on a queue of rays, and a scene with many shaders is
+ * rendered with both the megakernel and the split kernel, comparing the images and printing the
+ * throughput of each. The scene is a grid of quads with many different procedural shaders, so
+ * neighboring paths rarely share a shader. With the default flags the render is small enough to
+ * run as part of the regular test suite, pass for example
+ *
+ *   cycles_test --gtest_filter=render_split_kernel.* --cycles_benchmark_size=512
+ *               --cycles_benchmark_samples=16 --cycles_benchmark_shaders=256
+ *
+ * to get meaningful numbers. */
+
+#include "testing/testing.h"
+
+#include "render_session_test.h"
+
+#include "render/camera.h"
+#include "render/graph.h"
+#include "render/mesh.h"
+#include "render/nodes.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/shader.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_atomic.h"
+#include "util/util_debug.h"
+#include "util/util_transform.h"
+#include "util/util_vector.h"
+
+// clang-format off
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+#include "kernel/split/kernel_shader_sort.h"
+// clang-format on
+
+#include <random>
+
+DEFINE_int32(cycles_benchmark_size, 64, "Width and height of the benchmark render.");
+DEFINE_int32(cycles_benchmark_samples, 4, "Samples per pixel of the benchmark render.");
+DEFINE_int32(cycles_benchmark_shaders, 32, "Number of different shaders in the scene.");
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Diffuse shader with fractal noise for its color and roughness, so shader evaluation is a
+ * significant part of the render time. */
+static Shader *benchmark_add_shader(Scene *scene, int index)
+{
+  ShaderGraph *graph = new ShaderGraph();
+
+  NoiseTextureNode *noise = new NoiseTextureNode();
+  noise->scale = 2.0f + index;
+  noise->detail = 8.0f;
+  noise->tex_mapping.translation = make_float3(0.37f * index, 0.0f, 0.0f);
+  graph->add(noise);
+
+  DiffuseBsdfNode *diffuse = new DiffuseBsdfNode();
+  graph->add(diffuse);
+
+  graph->connect(noise->output("Color"), diffuse->input("Color"));
+  graph->connect(noise->output("Fac"), diffuse->input("Roughness"));
+  graph->connect(diffuse->output("BSDF"), graph->output()->input("Surface"));
+
+  Shader *shader = new Shader();
+  shader->name = string_printf("benchmark_%d", index);
+  shader->set_graph(graph);
+  scene->shaders.push_back(shader);
+  shader->tag_update(scene);
+
+  return shader;
+}
+
+static void benchmark_build_scene(Scene *scene, int width, int height, int num_shaders)
+{
+  /* Camera looking down the Z axis at the grid. */
+  scene->camera->width = width;
+  scene->camera->height = height;
+  scene->camera->matrix = transform_identity();
+  scene->camera->compute_auto_viewplane();
+  scene->camera->need_update = true;
+
+  /* White background to light the scene. */
+  ShaderGraph *background_graph = new ShaderGraph();
+  BackgroundNode *background = new BackgroundNode();
+  background->color = make_float3(1.0f, 1.0f, 1.0f);
+  background->strength = 1.0f;
+  background_graph->add(background);
+  background_graph->connect(background->output("Background"),
+                            background_graph->output()->input("Surface"));
+  scene->default_background->set_graph(background_graph);
+  scene->default_background->tag_update(scene);
+
+  Mesh *mesh = new Mesh();
+  for (int i = 0; i < num_shaders; i++) {
+    mesh->used_shaders.push_back(benchmark_add_shader(scene, i));
+  }
+
+  /* Grid of quads covering the view, scattering the shaders over them. */
+  const int resolution = 64;
+  const float size = 5.0f;
+  const float depth = 5.0f;
+
+  mesh->reserve_mesh((resolution + 1) * (resolution + 1), resolution * resolution * 2);
+  for (int y = 0; y <= resolution; y++) {
+    for (int x = 0; x <= resolution; x++) {
+      mesh->add_vertex(make_float3(size * ((float)x / resolution - 0.5f),
+                                   size * ((float)y / resolution - 0.5f),
+                                   depth));
+    }
+  }
+  for (int y = 0; y < resolution; y++) {
+    for (int x = 0; x < resolution; x++) {
+      const int v0 = y * (resolution + 1) + x;
+      const int v1 = v0 + 1;
+      const int v2 = v0 + resolution + 1;
+      const int v3 = v2 + 1;
+      const int shader = (x * 7 + y * 13) % num_shaders;
+      mesh->add_triangle(v0, v1, v3, shader, false);
+      mesh->add_triangle(v0, v3, v2, shader, false);
+    }
+  }
+  scene->geometry.push_back(mesh);
+
+  Object *object = new Object();
+  object->geometry = mesh;
+  object->tfm = transform_identity();
+  scene->objects.push_back(object);
+}
+
+struct BenchmarkRender {
+  vector<float> pixels;
+  double samples_per_second;
+};
+
+/* Render the scene with a fixed seed, returning the image and the number of pixel samples per
+ * second. */
+static BenchmarkRender benchmark_render(bool use_split_kernel)
+{
+  const int size = max(FLAGS_cycles_benchmark_size, 1);
+  const int samples = max(FLAGS_cycles_benchmark_samples, 1);
+  const int num_shaders = max(FLAGS_cycles_benchmark_shaders, 1);
+
+  /* Read by the CPU device when it is created. */
+  DebugFlags().cpu.split_kernel = use_split_kernel;
+
+  SessionParams session_params;
+  session_params.samples = samples;
+
+  const TestRender render = test_render(
+      session_params, size, function_bind(&benchmark_build_scene, _1, size, size, num_shaders));
+
+  DebugFlags().cpu.split_kernel = false;
+
+  BenchmarkRender result;
+  result.pixels = render.pixels;
+  result.samples_per_second = (render.render_time > 0.0) ?
+                                  (double)size * size * samples / render.render_time :
+                                  0.0;
+  return result;
+}
+
+/* Shader of a ray in the queue, as the sort kernel reads it. */
+static uint sort_key(KernelGlobals *kg, int ray_index)
+{
+  return kernel_split_sd(sd, ray_index)->shader & SHADER_MASK;
+}
+
+}  // namespace
+
+TEST(render_split_kernel, shader_sort_groups_rays)
+{
+  std::mt19937 rng(0);
+
+  /* Two full sort blocks and a partial one. */
+  const int num_rays = SHADER_SORT_BLOCK_SIZE * 2 + 300;
+  const int num_blocks = divide_up(num_rays, SHADER_SORT_BLOCK_SIZE);
+  const int num_keys = 37;
+
+  KernelGlobals kernel_globals;
+  KernelGlobals *kg = &kernel_globals;
+  kernel_data.integrator.max_closures = 1;
+
+  vector<int> queue_data(NUM_QUEUES * num_rays, QUEUE_EMPTY_SLOT);
+  vector<int> queue_index(NUM_QUEUES, 0);
+  vector<char> ray_state(num_rays);
+  vector<ShaderData> sd(num_rays);
+
+  kernel_split_state.queue_data = queue_data.data();
+  kernel_split_state.ray_state = ray_state.data();
+  kernel_split_state._sd = sd.data();
+  kernel_split_params.queue_index = queue_index.data();
+  kernel_split_params.queue_size = num_rays;
+
+  /* Rays in random order with random shaders, and flags which the sort must ignore. Some rays
+   * are inactive and some slots of the queue are empty. */
+  vector<int> input(num_rays);
+  for (int i = 0; i < num_rays; i++) {
+    input[i] = i;
+  }
+  std::shuffle(input.begin(), input.end(), rng);
+
+  for (int i = 0; i < num_rays; i++) {
+    sd[i].shader = (rng() % num_keys) | ((rng() % 2) ? SHADER_CAST_SHADOW : 0);
+    ray_state[i] = (rng() % 8) ? RAY_ACTIVE : RAY_INACTIVE;
+    if (rng() % 10 == 0) {
+      input[i] = QUEUE_EMPTY_SLOT;
+    }
+  }
+
+  std::copy(input.begin(),
+            input.end(),
+            queue_data.begin() + QUEUE_ACTIVE_AND_REGENERATED_RAYS * num_rays);
+  queue_index[QUEUE_ACTIVE_AND_REGENERATED_RAYS] = num_rays;
+
+  /* One thread per block, as in the CPU split kernel. */
+  ShaderSortLocals locals;
+  kg->global_size = make_int2(num_blocks, 1);
+  for (int block = 0; block < num_blocks; block++) {
+    kg->global_id = make_int2(block, 0);
+    kernel_shader_sort(kg, &locals);
+  }
+
+  EXPECT_EQ(queue_index[QUEUE_SHADER_SORTED_RAYS], num_rays);
+
+  /* Within each block the active rays are grouped by shader, keeping their order for the same
+   * shader, and followed by empty slots. */
+  const int *output = &queue_data[QUEUE_SHADER_SORTED_RAYS * num_rays];
+
+  for (int block = 0; block < num_blocks; block++) {
+    const int start = block * SHADER_SORT_BLOCK_SIZE;
+    const int end = min(start + SHADER_SORT_BLOCK_SIZE, num_rays);
+
+    vector<int> expected;
+    for (int i = start; i < end; i++) {
+      if (IS_STATE(ray_state, input[i], RAY_ACTIVE)) {
+        expected.push_back(input[i]);
+      }
+    }
+    std::stable_sort(expected.begin(), expected.end(), [kg](int a, int b) {
+      return sort_key(kg, a) < sort_key(kg, b);
+    });
+
+    for (int i = 0; i < end - start; i++) {
+      const int ray_index = output[start + i];
+      if (i < (int)expected.size()) {
+        EXPECT_EQ(ray_index, expected[i]);
+      }
+      else {
+        EXPECT_EQ(ray_index, QUEUE_EMPTY_SLOT);
+      }
+    }
+
+    /* Each shader is one run of rays. */
+    int num_runs = 0, num_shaders = 0;
+    vector<bool> seen(num_keys, false);
+    for (int i = 0; i < (int)expected.size(); i++) {
+      const uint key = sort_key(kg, output[start + i]);
+      if (i == 0 || key != sort_key(kg, output[start + i - 1])) {
+        num_runs++;
+      }
+      if (!seen[key]) {
+        seen[key] = true;
+        num_shaders++;
+      }
+    }
+    EXPECT_EQ(num_runs, num_shaders);
+  }
+}
+
+TEST(render_split_kernel, shader_sorting)
+{
+  const BenchmarkRender megakernel = benchmark_render(false);
+  const BenchmarkRender split_kernel = benchmark_render(true);
+
+  printf("%dx%d, %d samples, %d shaders:\n"
+         "  Megakernel:   %.0f samples/s\n"
+         "  Split kernel: %.0f samples/s (%.2fx)\n",
+         FLAGS_cycles_benchmark_size,
+         FLAGS_cycles_benchmark_size,
+         FLAGS_cycles_benchmark_samples,
+         FLAGS_cycles_benchmark_shaders,
+         megakernel.samples_per_second,
+         split_kernel.samples_per_second,
+         (megakernel.samples_per_second > 0.0) ?
+             split_kernel.samples_per_second / megakernel.samples_per_second :
+             0.0);
+
+  EXPECT_GT(megakernel.samples_per_second, 0.0);
+  EXPECT_GT(split_kernel.samples_per_second, 0.0);
+
+  /* Sorting only changes the order in which paths are shaded. Both kernels use the same random
+   * numbers for every pixel, so the images only differ by rounding, which can rarely change the
+   * course of a path. Independent noise would differ by far more. */
+  const float mean = test_image_mean(megakernel.pixels);
+  EXPECT_GT(mean, 0.0f);
+  EXPECT_NEAR(test_image_mean(split_kernel.pixels), mean, 1e-3f * mean);
+  EXPECT_LT(test_image_mean_difference(split_kernel.pixels, megakernel.pixels), 1e-2f * mean);
+}
+
+CCL_NAMESPACE_END
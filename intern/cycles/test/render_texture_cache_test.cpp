@@ -0,0 +1,189 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/scene.h"
+#include "render/stats.h"
+#include "render/texture_cache.h"
+
+#include "util/util_path.h"
+#include "util/util_string.h"
+#include "util/util_unique_ptr.h"
+#include "util/util_vector.h"
+
+// clang-format off
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+#include "kernel/kernels/cpu/kernel_cpu_image.h"
+// clang-format on
+
+#include <OpenImageIO/imageio.h>
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int image_size = 256;
+
+static bool write_image(const string &filepath, const vector<float> &pixels)
+{
+  unique_ptr<OIIO::ImageOutput> out(OIIO::ImageOutput::create(filepath));
+  if (!out) {
+    return false;
+  }
+
+  OIIO::ImageSpec spec(image_size, image_size, 3, OIIO::TypeDesc::FLOAT);
+  return out->open(filepath, spec) && out->write_image(OIIO::TypeDesc::FLOAT, pixels.data()) &&
+         out->close();
+}
+
+/* Write an RGB image with the X coordinate in red and the Y coordinate from the top in green. */
+static bool write_gradient_image(const string &filepath)
+{
+  vector<float> pixels(image_size * image_size * 3);
+  for (int y = 0; y < image_size; y++) {
+    for (int x = 0; x < image_size; x++) {
+      float *pixel = &pixels[(y * image_size + x) * 3];
+      pixel[0] = (x + 0.5f) / image_size;
+      pixel[1] = (y + 0.5f) / image_size;
+      pixel[2] = 0.0f;
+    }
+  }
+
+  return write_image(filepath, pixels);
+}
+
+/* Write a checkerboard of single black and white pixels, all of its mipmap levels below the
+ * full resolution are uniform gray. */
+static bool write_checker_image(const string &filepath)
+{
+  vector<float> pixels(image_size * image_size * 3);
+  for (int y = 0; y < image_size; y++) {
+    for (int x = 0; x < image_size; x++) {
+      float *pixel = &pixels[(y * image_size + x) * 3];
+      pixel[0] = pixel[1] = pixel[2] = ((x + y) % 2) ? 1.0f : 0.0f;
+    }
+  }
+
+  return write_image(filepath, pixels);
+}
+
+static string test_directory(const char *name)
+{
+  return path_join(::testing::TempDir(), string_printf("cycles_texture_cache_%s", name));
+}
+
+static float4 texture_cache_lookup(TextureCache &cache,
+                                   void *handle,
+                                   float x,
+                                   float y,
+                                   float2 dx = make_float2(0.0f, 0.0f),
+                                   float2 dy = make_float2(0.0f, 0.0f))
+{
+  KernelGlobals kg;
+  kg.texture_system = cache.get_texture_system();
+  kg.texture_thread_info = NULL;
+
+  TextureInfo info;
+  memset(&info, 0, sizeof(info));
+  info.data = (uint64_t)&handle;
+  info.data_type = IMAGE_DATA_TYPE_TEXTURE_CACHE;
+  info.interpolation = INTERPOLATION_CLOSEST;
+  info.extension = EXTENSION_EXTEND;
+
+  float result[4];
+  kernel_tex_image_texture_cache(&kg, info, x, y, dx, dy, result);
+  return make_float4(result[0], result[1], result[2], result[3]);
+}
+
+}  // namespace
+
+TEST(render_texture_cache, lookup_converted_image)
+{
+  const string directory = test_directory("lookup");
+  const string filepath = path_join(directory, "gradient.tif");
+  path_create_directories(filepath);
+  ASSERT_TRUE(write_gradient_image(filepath));
+
+  SceneParams params;
+  params.use_texture_cache = true;
+  params.texture_cache_path = path_join(directory, "tx");
+
+  TextureCache cache(params);
+  void *handle = cache.get_handle(filepath);
+  ASSERT_NE(handle, (void *)NULL);
+
+  /* Cycles images have their origin at the bottom left. */
+  const float4 color = texture_cache_lookup(cache, handle, 0.25f, 0.25f);
+  EXPECT_NEAR(color.x, 0.25f, 2.0f / image_size);
+  EXPECT_NEAR(color.y, 0.75f, 2.0f / image_size);
+  EXPECT_NEAR(color.z, 0.0f, 1e-6f);
+  EXPECT_NEAR(color.w, 1.0f, 1e-6f);
+
+  ImageStats stats;
+  cache.collect_statistics(&stats);
+  EXPECT_EQ(stats.texture_cache.num_files, 1);
+  EXPECT_EQ(stats.texture_cache.num_converted, 1);
+  EXPECT_GT(stats.texture_cache.num_tiles_loaded, 0);
+  EXPECT_TRUE(path_is_directory(params.texture_cache_path));
+}
+
+TEST(render_texture_cache, lookup_mipmap_level)
+{
+  const string directory = test_directory("mipmap");
+  const string filepath = path_join(directory, "checker.tif");
+  path_create_directories(filepath);
+  ASSERT_TRUE(write_checker_image(filepath));
+
+  SceneParams params;
+  params.use_texture_cache = true;
+  params.texture_cache_path = path_join(directory, "tx");
+
+  TextureCache cache(params);
+  void *handle = cache.get_handle(filepath);
+  ASSERT_NE(handle, (void *)NULL);
+
+  /* Without derivatives a single black or white pixel of the full resolution is read. */
+  const float x = 100.5f / image_size;
+  const float y = 60.5f / image_size;
+  const float4 magnified = texture_cache_lookup(cache, handle, x, y);
+  EXPECT_NEAR(fabsf(magnified.x - 0.5f), 0.5f, 1e-6f);
+
+  /* A footprint of 16 pixels reads a lower resolution level, where the checkerboard is
+   * averaged to gray. */
+  const float footprint = 16.0f / image_size;
+  const float4 minified = texture_cache_lookup(
+      cache, handle, x, y, make_float2(footprint, 0.0f), make_float2(0.0f, footprint));
+  EXPECT_NEAR(minified.x, 0.5f, 1e-2f);
+  EXPECT_NEAR(minified.y, 0.5f, 1e-2f);
+  EXPECT_NEAR(minified.z, 0.5f, 1e-2f);
+}
+
+TEST(render_texture_cache, missing_image)
+{
+  SceneParams params;
+  params.use_texture_cache = true;
+
+  TextureCache cache(params);
+  EXPECT_EQ(cache.get_handle(path_join(test_directory("missing"), "missing.tif")),
+            (void *)NULL);
+}
+
+CCL_NAMESPACE_END
@@ -767,6 +767,44 @@ ccl_device_inline float2 map_to_sphere(const float3 co)
   return make_float2(u, v);
 }
 
+/* Octahedral encoding of unit vectors into two 16 bit signed normalized components, as
+ * described in "A Survey of Efficient Representations for Independent Unit Vectors". */
+ccl_device_inline uint normal_octahedral_encode(const float3 N)
+{
+  const float l1 = fabsf(N.x) + fabsf(N.y) + fabsf(N.z);
+  float x = 0.0f, y = 0.0f;
+
+  if (l1 > 0.0f) {
+    x = N.x / l1;
+    y = N.y / l1;
+
+    /* Fold the lower hemisphere over the diagonals. */
+    if (N.z < 0.0f) {
+      const float fx = (1.0f - fabsf(y)) * signf(x);
+      const float fy = (1.0f - fabsf(x)) * signf(y);
+      x = fx;
+      y = fy;
+    }
+  }
+
+  const uint qx = (uint)(clamp(x * 0.5f + 0.5f, 0.0f, 1.0f) * 65535.0f + 0.5f);
+  const uint qy = (uint)(clamp(y * 0.5f + 0.5f, 0.0f, 1.0f) * 65535.0f + 0.5f);
+  return qx | (qy << 16);
+}
+
+ccl_device_inline float3 normal_octahedral_decode(uint packed)
+{
+  const float x = (float)(packed & 0xFFFF) * (2.0f / 65535.0f) - 1.0f;
+  const float y = (float)(packed >> 16) * (2.0f / 65535.0f) - 1.0f;
+  float3 N = make_float3(x, y, 1.0f - fabsf(x) - fabsf(y));
+
+  const float t = max(-N.z, 0.0f);
+  N.x += (N.x >= 0.0f) ? -t : t;
+  N.y += (N.y >= 0.0f) ? -t : t;
+
+  return normalize(N);
+}
+
 /* Compares two floats.
  * Returns true if their absolute difference is smaller than abs_diff (for numbers near zero)
  * or their relative difference is less than ulp_diff ULPs.
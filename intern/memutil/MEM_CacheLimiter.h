@@ -54,6 +54,7 @@
  */
 
 #include "MEM_Allocator.h"
+#include <algorithm>
 #include <list>
 #include <queue>
 #include <vector>
@@ -72,7 +73,7 @@ bool MEM_CacheLimiter_is_disabled(void);
 template<class T> class MEM_CacheLimiterHandle {
  public:
   explicit MEM_CacheLimiterHandle(T *data_, MEM_CacheLimiter<T> *parent_)
-      : data(data_), refcount(0), parent(parent_)
+      : data(data_), refcount(0), size(0), parent(parent_)
   {
   }
 
@@ -133,6 +134,8 @@ template<class T> class MEM_CacheLimiterHandle {
   T *data;
   int refcount;
   int pos;
+  /* Size of data as of the last insert, touch or limit enforcement. */
+  size_t size;
   MEM_CacheLimiter<T> *parent;
 };
 
@@ -142,7 +145,15 @@ template<class T> class MEM_CacheLimiter {
   typedef int (*MEM_CacheLimiter_ItemPriority_Func)(void *item, int default_priority);
   typedef bool (*MEM_CacheLimiter_ItemDestroyable_Func)(void *item);
 
-  MEM_CacheLimiter(MEM_CacheLimiter_DataSize_Func data_size_func) : data_size_func(data_size_func)
+  MEM_CacheLimiter(MEM_CacheLimiter_DataSize_Func data_size_func)
+      : data_size_func(data_size_func),
+        item_priority_func(NULL),
+        item_destroyable_func(NULL),
+        total_size(0),
+        hits(0),
+        misses(0),
+        evictions(0),
+        evicted_size(0)
   {
   }
 
@@ -158,38 +169,41 @@ template<class T> class MEM_CacheLimiter {
   {
     queue.push_back(new MEM_CacheLimiterHandle<T>(elem, this));
     queue.back()->pos = queue.size() - 1;
+    queue.back()->size = get_element_size(queue.back());
+    total_size += queue.back()->size;
     return queue.back();
   }
 
   void unmanage(MEM_CacheLimiterHandle<T> *handle)
   {
     int pos = handle->pos;
+    total_size -= handle->size;
     queue[pos] = queue.back();
     queue[pos]->pos = pos;
     queue.pop_back();
     delete handle;
   }
 
+  /* Sizes are cached per element, so this doesn't need to visit the whole queue. They are
+   * updated on insert, touch and when enforcing the limits. */
   size_t get_memory_in_use()
   {
-    size_t size = 0;
     if (data_size_func) {
-      int i;
-      for (i = 0; i < queue.size(); i++) {
-        size += data_size_func(queue[i]->get()->get_data());
-      }
-    }
-    else {
-      size = MEM_get_memory_in_use();
+      return total_size;
     }
-    return size;
+    return MEM_get_memory_in_use();
+  }
+
+  size_t get_num_elements() const
+  {
+    return queue.size();
   }
 
   void enforce_limits()
   {
     size_t max = MEM_CacheLimiter_get_maximum();
     bool is_disabled = MEM_CacheLimiter_is_disabled();
-    size_t mem_in_use, cur_size;
+    size_t mem_in_use;
 
     if (is_disabled) {
       return;
@@ -199,38 +213,68 @@ template<class T> class MEM_CacheLimiter {
       return;
     }
 
+    /* Data can grow while it's cached without being touched, e.g. when an image gets a float
+     * buffer, so get the actual sizes once here. */
+    if (data_size_func) {
+      update_element_sizes();
+    }
+
     mem_in_use = get_memory_in_use();
 
     if (mem_in_use <= max) {
       return;
     }
 
-    while (!queue.empty() && mem_in_use > max) {
-      MEM_CacheElementPtr elem = get_least_priority_destroyable_element();
+    /* Priorities don't change while elements are freed, so compute them once and free elements
+     * in order from a heap, instead of searching the whole queue for every freed element. */
+    MEM_CacheHeap heap;
+    heap.reserve(queue.size());
 
-      if (!elem)
-        break;
+    for (int i = 0; i < queue.size(); i++) {
+      MEM_CacheElementPtr elem = queue[i];
 
-      if (data_size_func) {
-        cur_size = data_size_func(elem->get()->get_data());
-      }
-      else {
-        cur_size = mem_in_use;
-      }
+      if (!can_destroy_element(elem))
+        continue;
+
+      MEM_CacheHeapItem item;
+      item.priority = get_element_priority(elem, i);
+      item.order = i;
+      item.elem = elem;
+      heap.push_back(item);
+    }
+
+    std::make_heap(heap.begin(), heap.end());
+
+    while (!heap.empty() && mem_in_use > max) {
+      std::pop_heap(heap.begin(), heap.end());
+      MEM_CacheElementPtr elem = heap.back().elem;
+      heap.pop_back();
+
+      /* The handle is gone once destroyed. */
+      size_t cur_size = elem->size;
 
       if (elem->destroy_if_possible()) {
-        if (data_size_func) {
-          mem_in_use -= cur_size;
-        }
-        else {
-          mem_in_use -= cur_size - MEM_get_memory_in_use();
+        if (!data_size_func) {
+          size_t mem_after = MEM_get_memory_in_use();
+          cur_size = (mem_in_use > mem_after) ? mem_in_use - mem_after : 0;
         }
+
+        mem_in_use -= cur_size;
+
+        evictions++;
+        evicted_size += cur_size;
       }
     }
   }
 
   void touch(MEM_CacheLimiterHandle<T> *handle)
   {
+    hits++;
+
+    total_size -= handle->size;
+    handle->size = get_element_size(handle);
+    total_size += handle->size;
+
     /* If we're using custom priority callback re-arranging the queue
      * doesn't make much sense because we'll iterate it all to get
      * least priority element anyway.
@@ -244,6 +288,31 @@ template<class T> class MEM_CacheLimiter {
     }
   }
 
+  void miss()
+  {
+    misses++;
+  }
+
+  size_t get_hits() const
+  {
+    return hits;
+  }
+
+  size_t get_misses() const
+  {
+    return misses;
+  }
+
+  size_t get_evictions() const
+  {
+    return evictions;
+  }
+
+  size_t get_evicted_size() const
+  {
+    return evicted_size;
+  }
+
   void set_item_priority_func(MEM_CacheLimiter_ItemPriority_Func item_priority_func)
   {
     this->item_priority_func = item_priority_func;
@@ -259,6 +328,39 @@ template<class T> class MEM_CacheLimiter {
   typedef std::vector<MEM_CacheElementPtr, MEM_Allocator<MEM_CacheElementPtr>> MEM_CacheQueue;
   typedef typename MEM_CacheQueue::iterator iterator;
 
+  struct MEM_CacheHeapItem {
+    int priority;
+    int order;
+    MEM_CacheElementPtr elem;
+
+    /* Inverted, so the heap has the lowest priority on top. Ties are broken by queue order. */
+    bool operator<(const MEM_CacheHeapItem &other) const
+    {
+      if (priority != other.priority) {
+        return priority > other.priority;
+      }
+      return order > other.order;
+    }
+  };
+  typedef std::vector<MEM_CacheHeapItem, MEM_Allocator<MEM_CacheHeapItem>> MEM_CacheHeap;
+
+  size_t get_element_size(MEM_CacheElementPtr elem)
+  {
+    if (data_size_func && elem->get()) {
+      return data_size_func(elem->get()->get_data());
+    }
+    return 0;
+  }
+
+  void update_element_sizes()
+  {
+    total_size = 0;
+    for (int i = 0; i < queue.size(); i++) {
+      queue[i]->size = get_element_size(queue[i]);
+      total_size += queue[i]->size;
+    }
+  }
+
   /* Check whether element can be destroyed when enforcing cache limits */
   bool can_destroy_element(MEM_CacheElementPtr &elem)
   {
@@ -273,52 +375,34 @@ template<class T> class MEM_CacheLimiter {
     return true;
   }
 
-  MEM_CacheElementPtr get_least_priority_destroyable_element(void)
+  /* Lower priority elements are freed first. */
+  int get_element_priority(MEM_CacheElementPtr elem, int pos)
   {
-    if (queue.empty())
-      return NULL;
-
-    MEM_CacheElementPtr best_match_elem = NULL;
-
     if (!item_priority_func) {
-      for (iterator it = queue.begin(); it != queue.end(); it++) {
-        MEM_CacheElementPtr elem = *it;
-        if (!can_destroy_element(elem))
-          continue;
-        best_match_elem = elem;
-        break;
-      }
-    }
-    else {
-      int best_match_priority = 0;
-      int i;
-
-      for (i = 0; i < queue.size(); i++) {
-        MEM_CacheElementPtr elem = queue[i];
-
-        if (!can_destroy_element(elem))
-          continue;
-
-        /* by default 0 means highest priority element */
-        /* casting a size type to int is questionable,
-           but unlikely to cause problems */
-        int priority = -((int)(queue.size()) - i - 1);
-        priority = item_priority_func(elem->get()->get_data(), priority);
-
-        if (priority < best_match_priority || best_match_elem == NULL) {
-          best_match_priority = priority;
-          best_match_elem = elem;
-        }
-      }
+      /* Least recently used elements are at the front of the queue. */
+      return pos;
     }
 
-    return best_match_elem;
+    /* by default 0 means highest priority element */
+    /* casting a size type to int is questionable,
+     * but unlikely to cause problems */
+    int priority = -((int)(queue.size()) - pos - 1);
+    return item_priority_func(elem->get()->get_data(), priority);
   }
 
   MEM_CacheQueue queue;
   MEM_CacheLimiter_DataSize_Func data_size_func;
   MEM_CacheLimiter_ItemPriority_Func item_priority_func;
   MEM_CacheLimiter_ItemDestroyable_Func item_destroyable_func;
+
+  /* Sum of the cached element sizes. */
+  size_t total_size;
+
+  /* Statistics. */
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+  size_t evicted_size;
 };
 
 #endif  // __MEM_CACHELIMITER_H__
@@ -45,6 +45,19 @@ typedef int (*MEM_CacheLimiter_ItemPriority_Func)(void *, int);
 /* function to check whether item could be destroyed */
 typedef bool (*MEM_CacheLimiter_ItemDestroyable_Func)(void *);
 
+/* counters of a cache limiter, see #MEM_CacheLimiter_get_stats */
+typedef struct MEM_CacheLimiterStats {
+  /* managed objects and the memory they use */
+  size_t num_elements;
+  size_t memory_in_use;
+  /* lookups which found an object (touched it), and which did not */
+  size_t hits;
+  size_t misses;
+  /* objects destructed to satisfy the memory constraints, and the memory they used */
+  size_t evictions;
+  size_t evicted_bytes;
+} MEM_CacheLimiterStats;
+
 #ifndef __MEM_CACHELIMITER_H__
 void MEM_CacheLimiter_set_maximum(size_t m);
 size_t MEM_CacheLimiter_get_maximum(void);
@@ -149,6 +162,23 @@ void MEM_CacheLimiter_ItemDestroyable_Func_set(
 
 size_t MEM_CacheLimiter_get_memory_in_use(MEM_CacheLimiterC *This);
 
+/**
+ * Count a lookup of an object which is not managed (anymore),
+ * lookups which find an object are counted by #MEM_CacheLimiter_touch.
+ *
+ * \param This: "This" pointer.
+ */
+
+void MEM_CacheLimiter_miss(MEM_CacheLimiterC *This);
+
+/**
+ * Get counters, the caller is responsible for locking like for any other access.
+ *
+ * \param This: "This" pointer.
+ */
+
+void MEM_CacheLimiter_get_stats(MEM_CacheLimiterC *This, MEM_CacheLimiterStats *r_stats);
+
 #ifdef __cplusplus
 }
 #endif
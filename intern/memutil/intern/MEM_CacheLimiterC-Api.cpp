@@ -227,3 +227,20 @@ size_t MEM_CacheLimiter_get_memory_in_use(MEM_CacheLimiterC *This)
 {
   return cast(This)->get_cache()->get_memory_in_use();
 }
+
+void MEM_CacheLimiter_miss(MEM_CacheLimiterC *This)
+{
+  cast(This)->get_cache()->miss();
+}
+
+void MEM_CacheLimiter_get_stats(MEM_CacheLimiterC *This, MEM_CacheLimiterStats *r_stats)
+{
+  cache_t *cache = cast(This)->get_cache();
+
+  r_stats->num_elements = cache->get_num_elements();
+  r_stats->memory_in_use = cache->get_memory_in_use();
+  r_stats->hits = cache->get_hits();
+  r_stats->misses = cache->get_misses();
+  r_stats->evictions = cache->get_evictions();
+  r_stats->evicted_bytes = cache->get_evicted_size();
+}
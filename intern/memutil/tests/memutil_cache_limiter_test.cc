@@ -0,0 +1,144 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_CacheLimiterC-Api.h"
+
+namespace {
+
+struct TestItem {
+  size_t size;
+  int priority;
+  bool destroyed;
+};
+
+void item_destruct(void *data)
+{
+  ((TestItem *)data)->destroyed = true;
+}
+
+size_t item_size(void *data)
+{
+  return ((TestItem *)data)->size;
+}
+
+int item_priority(void *data, int /*default_priority*/)
+{
+  return ((TestItem *)data)->priority;
+}
+
+class MemCacheLimiterTest : public ::testing::Test {
+ protected:
+  void SetUp() override
+  {
+    old_maximum = MEM_CacheLimiter_get_maximum();
+    limiter = new_MEM_CacheLimiter(item_destruct, item_size);
+  }
+
+  void TearDown() override
+  {
+    delete_MEM_CacheLimiter(limiter);
+    MEM_CacheLimiter_set_maximum(old_maximum);
+  }
+
+  MEM_CacheLimiterC *limiter;
+  size_t old_maximum;
+};
+
+}  // namespace
+
+TEST_F(MemCacheLimiterTest, EvictLeastRecentlyUsed)
+{
+  TestItem items[4] = {{100, 0, false}, {100, 0, false}, {100, 0, false}, {100, 0, false}};
+  MEM_CacheLimiterHandleC *handles[4];
+
+  MEM_CacheLimiter_set_maximum(250);
+  for (int i = 0; i < 4; i++) {
+    handles[i] = MEM_CacheLimiter_insert(limiter, &items[i]);
+  }
+  EXPECT_EQ(MEM_CacheLimiter_get_memory_in_use(limiter), 400);
+
+  /* The first item is used again and the second one can't be freed. */
+  MEM_CacheLimiter_touch(handles[0]);
+  MEM_CacheLimiter_ref(handles[1]);
+
+  MEM_CacheLimiter_enforce_limits(limiter);
+
+  EXPECT_FALSE(items[0].destroyed);
+  EXPECT_FALSE(items[1].destroyed);
+  EXPECT_TRUE(items[2].destroyed);
+  EXPECT_TRUE(items[3].destroyed);
+  EXPECT_EQ(MEM_CacheLimiter_get_memory_in_use(limiter), 200);
+
+  MEM_CacheLimiter_unref(handles[1]);
+}
+
+TEST_F(MemCacheLimiterTest, EvictLowestPriority)
+{
+  TestItem items[5] = {
+      {100, -1, false}, {100, -4, false}, {100, -2, false}, {100, -5, false}, {100, -3, false}};
+
+  MEM_CacheLimiter_set_maximum(200);
+  MEM_CacheLimiter_ItemPriority_Func_set(limiter, item_priority);
+  for (int i = 0; i < 5; i++) {
+    MEM_CacheLimiter_insert(limiter, &items[i]);
+  }
+
+  MEM_CacheLimiter_enforce_limits(limiter);
+
+  EXPECT_FALSE(items[0].destroyed);
+  EXPECT_TRUE(items[1].destroyed);
+  EXPECT_FALSE(items[2].destroyed);
+  EXPECT_TRUE(items[3].destroyed);
+  EXPECT_TRUE(items[4].destroyed);
+}
+
+TEST_F(MemCacheLimiterTest, SizeChange)
+{
+  TestItem items[2] = {{100, 0, false}, {100, 0, false}};
+  MEM_CacheLimiterHandleC *handles[2];
+
+  MEM_CacheLimiter_set_maximum(250);
+  for (int i = 0; i < 2; i++) {
+    handles[i] = MEM_CacheLimiter_insert(limiter, &items[i]);
+  }
+
+  /* Grows without being touched, only noticed when the limit is enforced. */
+  items[1].size = 200;
+  MEM_CacheLimiter_enforce_limits(limiter);
+
+  EXPECT_TRUE(items[0].destroyed);
+  EXPECT_FALSE(items[1].destroyed);
+  EXPECT_EQ(MEM_CacheLimiter_get_memory_in_use(limiter), 200);
+
+  items[1].size = 50;
+  MEM_CacheLimiter_touch(handles[1]);
+  EXPECT_EQ(MEM_CacheLimiter_get_memory_in_use(limiter), 50);
+}
+
+TEST_F(MemCacheLimiterTest, Stats)
+{
+  TestItem items[3] = {{100, 0, false}, {100, 0, false}, {100, 0, false}};
+  MEM_CacheLimiterHandleC *handles[3];
+
+  MEM_CacheLimiter_set_maximum(150);
+  for (int i = 0; i < 3; i++) {
+    handles[i] = MEM_CacheLimiter_insert(limiter, &items[i]);
+  }
+
+  MEM_CacheLimiter_touch(handles[0]);
+  MEM_CacheLimiter_touch(handles[0]);
+  MEM_CacheLimiter_miss(limiter);
+  MEM_CacheLimiter_enforce_limits(limiter);
+
+  MEM_CacheLimiterStats stats;
+  MEM_CacheLimiter_get_stats(limiter, &stats);
+
+  EXPECT_EQ(stats.num_elements, 1);
+  EXPECT_EQ(stats.memory_in_use, 100);
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.evictions, 2);
+  EXPECT_EQ(stats.evicted_bytes, 200);
+  EXPECT_FALSE(items[0].destroyed);
+}
@@ -652,6 +652,7 @@ class NODE_PT_quality(bpy.types.Panel):
         col = layout.column()
         col.prop(tree, "use_opencl")
         col.prop(tree, "use_groupnode_buffer")
+        col.prop(tree, "use_half_float_buffers")
         col.prop(tree, "use_two_pass")
         col.prop(tree, "use_viewer_border")
         col.separator()
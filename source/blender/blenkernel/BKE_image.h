@@ -242,6 +242,10 @@ void BKE_image_user_id_eval_animation(struct Depsgraph *depsgraph, struct ID *id
 
 /* sets index offset for multilayer files */
 struct RenderPass *BKE_image_multilayer_index(struct RenderResult *rr, struct ImageUser *iuser);
+/* reads the passes of a multilayer image in one go, before they're used one at a time */
+void BKE_image_multilayer_passes_ensure_loaded(struct Image *ima,
+                                               struct RenderPass **passes,
+                                               int tot);
 
 /* sets index offset for multiview files */
 void BKE_image_multiview_index(struct Image *ima, struct ImageUser *iuser);
@@ -365,6 +369,7 @@ void BKE_image_file_format_set(struct Image *image,
 bool BKE_image_has_loaded_ibuf(struct Image *image);
 struct ImBuf *BKE_image_get_ibuf_with_name(struct Image *image, const char *name);
 struct ImBuf *BKE_image_get_first_ibuf(struct Image *image);
+struct ImBuf *BKE_image_get_tiled_ibuf(struct Image *ima, struct ImageUser *iuser);
 
 /* Not to be use directly. */
 struct GPUTexture *BKE_image_create_gpu_texture_from_ibuf(struct Image *image, struct ImBuf *ibuf);
@@ -90,9 +90,14 @@ void BKE_sequence_iterator_end(SeqIterator *iter);
 
 #define SEQ_CURRENT_END SEQ_ALL_END
 
+/* Maximum number of threads rendering frames ahead of the playhead in parallel. */
+#define SEQ_PREFETCH_MAX_WORKERS 8
+
 typedef enum eSeqTaskId {
   SEQ_TASK_MAIN_RENDER,
+  /* Each prefetch worker uses its own ID, starting from this one. */
   SEQ_TASK_PREFETCH_RENDER,
+  SEQ_TASK_MAX = SEQ_TASK_PREFETCH_RENDER + SEQ_PREFETCH_MAX_WORKERS,
 } eSeqTaskId;
 
 typedef struct SeqRenderData {
@@ -320,6 +325,10 @@ void BKE_sequencer_proxy_rebuild(struct SeqIndexBuildContext *context,
                                  short *stop,
                                  short *do_update,
                                  float *progress);
+void BKE_sequencer_proxy_rebuild_queue(ListBase *queue,
+                                       short *stop,
+                                       short *do_update,
+                                       float *progress);
 void BKE_sequencer_proxy_rebuild_finish(struct SeqIndexBuildContext *context, bool stop);
 
 void BKE_sequencer_proxy_set(struct Sequence *seq, bool value);
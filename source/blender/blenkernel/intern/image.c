@@ -3805,6 +3805,17 @@ RenderPass *BKE_image_multilayer_index(RenderResult *rr, ImageUser *iuser)
   return rpass;
 }
 
+void BKE_image_multilayer_passes_ensure_loaded(Image *ima, RenderPass **passes, int tot)
+{
+  BLI_mutex_lock(image_mutex);
+
+  if (ima->rr) {
+    RE_RenderPassesEnsureLoaded(ima->rr, passes, tot);
+  }
+
+  BLI_mutex_unlock(image_mutex);
+}
+
 void BKE_image_multiview_index(Image *ima, ImageUser *iuser)
 {
   if (iuser) {
@@ -4022,6 +4033,44 @@ static void image_create_multilayer(Image *ima, ImBuf *ibuf, int framenr)
   /* set proper views */
   image_init_multilayer_multiview(ima, ima->rr);
 }
+
+/* Opens a multilayer EXR file without reading any pixels, passes are read from the file once an
+ * image buffer is made for them. Returns false when the file is not a multilayer EXR, it's then
+ * loaded as a regular image. */
+static bool image_open_multilayer(Image *ima, const char *filepath, int framenr)
+{
+  if (!BLI_path_extension_check(filepath, ".exr")) {
+    return false;
+  }
+
+  /* Same default as when the file is loaded through imbuf. */
+  if (ima->colorspace_settings.name[0] == '\0') {
+    STRNCPY(ima->colorspace_settings.name,
+            IMB_colormanagement_role_colorspace_name_get(COLOR_ROLE_DEFAULT_FLOAT));
+  }
+
+  const char *colorspace = ima->colorspace_settings.name;
+  bool predivide = (ima->alpha_mode == IMA_ALPHA_PREMUL);
+  RenderResult *rr = RE_MultilayerOpen(filepath, colorspace, predivide);
+
+  if (rr == NULL) {
+    return false;
+  }
+
+  /* only load rr once for multiview */
+  if (ima->rr) {
+    RE_FreeRenderResult(rr);
+  }
+  else {
+    ima->rr = rr;
+    ima->rr->framenr = framenr;
+  }
+
+  /* set proper views */
+  image_init_multilayer_multiview(ima, ima->rr);
+
+  return true;
+}
 #endif /* WITH_OPENEXR */
 
 /* common stuff to do with images after loading */
@@ -4099,6 +4148,13 @@ static ImBuf *load_sequence_single(
   iuser_t.view = view_id;
   BKE_image_user_file_path(&iuser_t, ima, name);
 
+#ifdef WITH_OPENEXR
+  if (image_open_multilayer(ima, name, frame)) {
+    ima->type = IMA_TYPE_MULTILAYER;
+    return NULL;
+  }
+#endif
+
   flag = IB_rect | IB_multilayer | IB_metadata;
   flag |= imbuf_alpha_flags_for_image(ima);
 
@@ -4224,7 +4280,7 @@ static ImBuf *image_load_sequence_multilayer(Image *ima, ImageUser *iuser, int e
   if (ima->rr) {
     RenderPass *rpass = BKE_image_multilayer_index(ima->rr, iuser);
 
-    if (rpass) {
+    if (rpass && RE_RenderPassEnsureLoaded(ima->rr, rpass)) {
       // printf("load from pass %s\n", rpass->name);
       /* since we free  render results, we copy the rect */
       ibuf = IMB_allocImBuf(ima->rr->rectx, ima->rr->recty, 32, 0);
@@ -4424,6 +4480,13 @@ static ImBuf *load_image_single(Image *ima,
 
     BKE_image_user_file_path(&iuser_t, ima, filepath);
 
+#ifdef WITH_OPENEXR
+    if (image_open_multilayer(ima, filepath, cfra)) {
+      ima->type = IMA_TYPE_MULTILAYER;
+      return NULL;
+    }
+#endif
+
     /* read ibuf */
     ibuf = IMB_loadiffname(filepath, flag, ima->colorspace_settings.name);
   }
@@ -4553,7 +4616,7 @@ static ImBuf *image_get_ibuf_multilayer(Image *ima, ImageUser *iuser)
   if (ima->rr) {
     RenderPass *rpass = BKE_image_multilayer_index(ima->rr, iuser);
 
-    if (rpass) {
+    if (rpass && RE_RenderPassEnsureLoaded(ima->rr, rpass)) {
       ibuf = IMB_allocImBuf(ima->rr->rectx, ima->rr->recty, 32, 0);
 
       image_init_after_load(ima, iuser, ibuf);
@@ -4678,6 +4741,8 @@ static ImBuf *image_get_render_result(Image *ima, ImageUser *iuser, void **r_loc
     if (rl) {
       RenderPass *rpass = image_render_pass_get(rl, pass, actview, NULL);
       if (rpass) {
+        /* Passes other than combined may still be in the save buffers file. */
+        RE_RenderPassEnsureLoaded(&rres, rpass);
         rectf = rpass->rect;
         if (pass != 0) {
           channels = rpass->channels;
@@ -4687,6 +4752,7 @@ static ImBuf *image_get_render_result(Image *ima, ImageUser *iuser, void **r_loc
 
       for (rpass = rl->passes.first; rpass; rpass = rpass->next) {
         if (STREQ(rpass->name, RE_PASSNAME_Z) && rpass->view_id == actview) {
+          RE_RenderPassEnsureLoaded(&rres, rpass);
           rectz = rpass->rect;
         }
       }
@@ -5693,6 +5759,68 @@ bool BKE_image_has_loaded_ibuf(Image *image)
   return has_loaded_ibuf;
 }
 
+/**
+ * Opens the tiled and mipmapped version of an image file (a `.tx` file next to it) without
+ * reading any pixels, tiles are read on demand through the imbuf tile cache instead.
+ * Returns NULL when there is no such file, when it has more than 8 bits per channel (the tile
+ * cache would quantize those), which is detected from the file header only, or when the pixels of the image are in memory already, those are
+ * to be used as they may have been modified.
+ * The result is not cached, free it with #IMB_freeImBuf().
+ */
+ImBuf *BKE_image_get_tiled_ibuf(Image *ima, ImageUser *iuser)
+{
+  char filepath[FILE_MAX], filepath_tx[FILE_MAX];
+  ImBuf *ibuf;
+
+  if (!ELEM(ima->source, IMA_SRC_FILE, IMA_SRC_TILED) || ima->type != IMA_TYPE_IMAGE ||
+      BKE_image_has_packedfile(ima) || BKE_image_is_multiview(ima)) {
+    return NULL;
+  }
+
+  BLI_mutex_lock(image_mutex);
+  ibuf = image_get_cached_ibuf(ima, iuser, NULL, NULL);
+  BLI_mutex_unlock(image_mutex);
+
+  if (ibuf) {
+    IMB_freeImBuf(ibuf);
+    return NULL;
+  }
+
+  BKE_image_user_file_path(iuser, ima, filepath);
+
+  /* Same rule as the imbuf loader for picking the `.tx` file. */
+  if (!BLI_path_extension_check(filepath, ".tx")) {
+    STRNCPY(filepath_tx, filepath);
+    if (!BLI_path_extension_replace(filepath_tx, sizeof(filepath_tx), ".tx") ||
+        !BLI_exists(filepath_tx) || !BLI_file_older(filepath, filepath_tx)) {
+      return NULL;
+    }
+  }
+
+  /* Check the header first, other files would be decoded whole only to be thrown away. */
+  int flag = IB_tilecache | imbuf_alpha_flags_for_image(ima);
+  ibuf = IMB_loadiffname(filepath, flag | IB_test, ima->colorspace_settings.name);
+  if (ibuf == NULL) {
+    return NULL;
+  }
+
+  const bool is_tiled_texture = (ibuf->flags & IB_tilecache) != 0;
+  IMB_freeImBuf(ibuf);
+  if (!is_tiled_texture) {
+    return NULL;
+  }
+
+  ibuf = IMB_loadiffname(filepath, flag | IB_rect, ima->colorspace_settings.name);
+
+  if (ibuf && !(ibuf->flags & IB_tilecache)) {
+    /* File changed since the header was checked. */
+    IMB_freeImBuf(ibuf);
+    return NULL;
+  }
+
+  return ibuf;
+}
+
 /**
  * References the result, #BKE_image_release_ibuf is to be called to de-reference.
  * Use lock=NULL when calling #BKE_image_release_ibuf().
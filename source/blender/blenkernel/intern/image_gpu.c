@@ -141,7 +141,10 @@ static GPUTexture *gpu_texture_create_tile_array(Image *ima, ImBuf *main_ibuf)
     ImageUser iuser;
     BKE_imageuser_default(&iuser);
     iuser.tile = tile->tile_number;
-    ImBuf *ibuf = BKE_image_acquire_ibuf(ima, &iuser, NULL);
+
+    /* Only the header of tiled files is read to get the size. */
+    ImBuf *ibuf_tiled = BKE_image_get_tiled_ibuf(ima, &iuser);
+    ImBuf *ibuf = ibuf_tiled ? ibuf_tiled : BKE_image_acquire_ibuf(ima, &iuser, NULL);
 
     if (ibuf) {
       PackTile *packtile = (PackTile *)MEM_callocN(sizeof(PackTile), __func__);
@@ -161,7 +164,12 @@ static GPUTexture *gpu_texture_create_tile_array(Image *ima, ImBuf *main_ibuf)
       float w = packtile->boxpack.w, h = packtile->boxpack.h;
       packtile->pack_score = max_ff(w, h) / min_ff(w, h) * w * h;
 
-      BKE_image_release_ibuf(ima, ibuf, NULL);
+      if (ibuf_tiled) {
+        IMB_freeImBuf(ibuf_tiled);
+      }
+      else {
+        BKE_image_release_ibuf(ima, ibuf, NULL);
+      }
       BLI_addtail(&boxes, packtile);
     }
   }
@@ -210,6 +218,22 @@ static GPUTexture *gpu_texture_create_tile_array(Image *ima, ImBuf *main_ibuf)
     ImageUser iuser;
     BKE_imageuser_default(&iuser);
     iuser.tile = tile->tile_number;
+
+    ImBuf *ibuf_tiled = BKE_image_get_tiled_ibuf(ima, &iuser);
+    if (ibuf_tiled) {
+      const bool store_premultiplied = BKE_image_has_gpu_texture_premultiplied_alpha(ima,
+                                                                                     ibuf_tiled);
+      IMB_update_gpu_texture_tiles(tex,
+                                   ibuf_tiled,
+                                   UNPACK2(tileoffset),
+                                   tilelayer,
+                                   UNPACK2(tilesize),
+                                   use_high_bitdepth,
+                                   store_premultiplied);
+      IMB_freeImBuf(ibuf_tiled);
+      continue;
+    }
+
     ImBuf *ibuf = BKE_image_acquire_ibuf(ima, &iuser, NULL);
 
     if (ibuf) {
@@ -328,6 +352,13 @@ static GPUTexture *image_get_gpu_texture(Image *ima,
 
   /* check if we have a valid image buffer */
   ImBuf *ibuf_intern = ibuf;
+  ImBuf *ibuf_tiled = NULL;
+  if (ibuf_intern == NULL && textarget != TEXTARGET_TILE_MAPPING) {
+    /* Stream huge textures from the tiled version of the file when there is one,
+     * instead of loading the full resolution image into memory. */
+    ibuf_tiled = BKE_image_get_tiled_ibuf(ima, iuser);
+    ibuf_intern = ibuf_tiled;
+  }
   if (ibuf_intern == NULL) {
     ibuf_intern = BKE_image_acquire_ibuf(ima, iuser, NULL);
     if (ibuf_intern == NULL) {
@@ -347,8 +378,18 @@ static GPUTexture *image_get_gpu_texture(Image *ima,
     const bool store_premultiplied = BKE_image_has_gpu_texture_premultiplied_alpha(ima,
                                                                                    ibuf_intern);
 
-    *tex = IMB_create_gpu_texture(
-        ima->id.name + 2, ibuf_intern, use_high_bitdepth, store_premultiplied);
+    if (ibuf_tiled) {
+      const int w = GPU_texture_size_with_limit(ibuf_tiled->x);
+      const int h = GPU_texture_size_with_limit(ibuf_tiled->y);
+
+      *tex = IMB_touch_gpu_texture(ima->id.name + 2, ibuf_tiled, w, h, 0, use_high_bitdepth);
+      IMB_update_gpu_texture_tiles(
+          *tex, ibuf_tiled, 0, 0, 0, w, h, use_high_bitdepth, store_premultiplied);
+    }
+    else {
+      *tex = IMB_create_gpu_texture(
+          ima->id.name + 2, ibuf_intern, use_high_bitdepth, store_premultiplied);
+    }
 
     GPU_texture_wrap_mode(*tex, true, false);
 
@@ -364,13 +405,16 @@ static GPUTexture *image_get_gpu_texture(Image *ima,
     }
   }
 
+  GPU_texture_orig_size_set(*tex, ibuf_intern->x, ibuf_intern->y);
+
   /* if `ibuf` was given, we don't own the `ibuf_intern` */
-  if (ibuf == NULL) {
+  if (ibuf_tiled) {
+    IMB_freeImBuf(ibuf_tiled);
+  }
+  else if (ibuf == NULL) {
     BKE_image_release_ibuf(ima, ibuf_intern, NULL);
   }
 
-  GPU_texture_orig_size_set(*tex, ibuf_intern->x, ibuf_intern->y);
-
   return *tex;
 }
 
@@ -180,6 +180,14 @@ static bool image_save_single(ReportList *reports,
 
   /* we need renderresult for exr and rendered multiview */
   rr = BKE_image_acquire_renderresult(opts->scene, ima);
+  if (rr) {
+    /* Multilayer files only read passes on demand, all of them are written. */
+    if (!RE_RenderResultEnsureLoaded(rr, reports)) {
+      BKE_report(reports, RPT_ERROR, "Did not write, file changed on disk, reload the image");
+      BKE_image_release_ibuf(ima, ibuf, lock);
+      goto cleanup;
+    }
+  }
   bool is_mono = rr ? BLI_listbase_count_at_most(&rr->views, 2) < 2 :
                       BLI_listbase_count_at_most(&ima->views, 2) < 2;
   bool is_exr_rr = rr && ELEM(imf->imtype, R_IMF_IMTYPE_OPENEXR, R_IMF_IMTYPE_MULTILAYER) &&
@@ -35,10 +35,12 @@
 #include "IMB_imbuf_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_dynstr.h"
 #include "BLI_endian_switch.h"
 #include "BLI_fileops.h"
 #include "BLI_fileops_types.h"
 #include "BLI_ghash.h"
+#include "BLI_hash_md5.h"
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_path_util.h"
@@ -81,11 +83,15 @@
  * For each cached non-temp image, image data and supplementary info are written to HDD.
  * Multiple(DCACHE_IMAGES_PER_FILE) images share the same file.
  * Each of these files contains header DiskCacheHeader followed by image data.
- * Zlib compression with user definable level can be used to compress image data(per image)
+ * Zlib compression with user definable level can be used to compress image data(per image).
+ * Without compression, image data is stored raw and read directly into the ImBuf buffer.
+ * Whether an image is compressed is stored per image.
  * Images are written in order in which they are rendered.
  * Overwriting of individual entry is not possible.
  * Stored images are deleted by invalidation, or when size of all files exceeds maximum
  * size specified in user preferences.
+ * Raw images of image and movie strips are stored by hash of their source and settings used to
+ * read them, so they are shared between strips and are not deleted by invalidation.
  * To distinguish 2 blend files with same name, scene->ed->disk_cache_timestamp
  * is used as UID. Blend file can still be copied manually which may cause conflict.
  *
@@ -94,11 +100,16 @@
 /* <cache type>-<resolution X>x<resolution Y>-<rendersize>%(<view_id>)-<frame no>.dcf */
 #define DCACHE_FNAME_FORMAT "%d-%dx%d-%d%%(%d)-%d.dcf"
 #define DCACHE_IMAGES_PER_FILE 100
-#define DCACHE_CURRENT_VERSION 1
+#define DCACHE_CURRENT_VERSION 3
 #define COLORSPACE_NAME_MAX 64 /* XXX: defined in imb intern */
 
+/* DiskCacheHeaderEntry.compression */
+#define DCACHE_COMPRESSION_NONE 0
+#define DCACHE_COMPRESSION_ZLIB 1
+
 typedef struct DiskCacheHeaderEntry {
   unsigned char encoding;
+  unsigned char compression;
   uint64_t frameno;
   uint64_t size_compressed;
   uint64_t size_raw;
@@ -138,7 +149,8 @@ typedef struct SeqCache {
   ThreadMutex iterator_mutex;
   struct BLI_mempool *keys_pool;
   struct BLI_mempool *items_pool;
-  struct SeqCacheKey *last_key;
+  /* Last key stored by each task, used for linking intermediate items to final frame. */
+  struct SeqCacheKey *last_key[SEQ_TASK_MAX];
   size_t memory_used;
   SeqDiskCache *disk_cache;
 } SeqCache;
@@ -172,6 +184,14 @@ static char *seq_disk_cache_base_dir(void)
   return U.sequencer_disk_cache_dir;
 }
 
+static int seq_disk_cache_compression_method(void)
+{
+  if (U.sequencer_disk_cache_compression == USER_SEQ_DISK_CACHE_COMPRESSION_NONE) {
+    return DCACHE_COMPRESSION_NONE;
+  }
+  return DCACHE_COMPRESSION_ZLIB;
+}
+
 static int seq_disk_cache_compression_level(void)
 {
   switch (U.sequencer_disk_cache_compression) {
@@ -343,6 +363,9 @@ static void seq_disk_cache_update_file(SeqDiskCache *disk_cache, char *path)
 
 /* Path format:
  * <cache dir>/<project name>/<scene name>-<timestamp>/<seq name>/DCACHE_FNAME_FORMAT
+ *
+ * Raw images of image and movie strips are stored by content instead:
+ * <cache dir>/<project name>/content/<hash>/DCACHE_FNAME_FORMAT
  */
 
 static void seq_disk_cache_get_project_dir(SeqDiskCache *disk_cache, char *path, size_t path_len)
@@ -370,13 +393,99 @@ static void seq_disk_cache_get_dir(
   BLI_path_append(path, path_len, seq_name);
 }
 
+/* Raw image of image and movie strips only depends on the source file and on settings used to
+ * read it, so such images are identified by hash of these instead of strip name and frame.
+ * Duplicated strips share cached images, and moving, trimming or undoing edits of a strip does
+ * not invalidate them. Files that are no longer used are removed by the cache size limit.
+ *
+ * Returns false if the image can not be identified by content, otherwise `r_frameno` is set to
+ * the frame of the source file.
+ */
+static bool seq_disk_cache_get_content_dir(SeqDiskCache *disk_cache,
+                                           SeqCacheKey *key,
+                                           char *path,
+                                           size_t path_len,
+                                           int *r_frameno)
+{
+  Sequence *seq = key->seq;
+  Scene *scene = key->context.scene;
+
+  if (key->type != SEQ_CACHE_STORE_RAW || !ELEM(seq->type, SEQ_TYPE_IMAGE, SEQ_TYPE_MOVIE) ||
+      seq->strip == NULL || seq->strip->stripdata == NULL) {
+    return false;
+  }
+
+  const float cfra = seq_cache_frame_index_to_cfra(seq, key->nfra);
+  const int nr = (int)BKE_sequencer_give_stripelem_index(seq, cfra);
+  if (nr < 0) {
+    return false;
+  }
+  const int frameno = nr + seq->anim_startofs;
+
+  char dir[FILE_MAX];
+  BLI_strncpy(dir, seq->strip->dir, sizeof(dir));
+  BLI_path_abs(dir, BKE_main_blendfile_path(disk_cache->bmain));
+
+  DynStr *ds = BLI_dynstr_new();
+  BLI_dynstr_appendf(ds, "%d|%s|", seq->type, dir);
+
+  if (seq->type == SEQ_TYPE_MOVIE) {
+    BLI_dynstr_appendf(ds,
+                       "%s|%d|%d|",
+                       seq->strip->stripdata->name,
+                       seq->streamindex,
+                       seq->strip->proxy ? seq->strip->proxy->tc : IMB_TC_RECORD_RUN);
+  }
+  else {
+    /* Only names of images stored in the same file are hashed, so adding or removing images
+     * elsewhere in the strip keeps this file valid. */
+    const int elem_len = MEM_allocN_len(seq->strip->stripdata) / sizeof(StripElem);
+    const int elem_start = frameno - frameno % DCACHE_IMAGES_PER_FILE;
+    const int elem_end = min_ii(elem_start + DCACHE_IMAGES_PER_FILE, elem_len);
+    for (int i = elem_start; i < elem_end; i++) {
+      BLI_dynstr_appendf(ds, "%s|", seq->strip->stripdata[i].name);
+    }
+  }
+
+  BLI_dynstr_appendf(ds,
+                     "%s|%s|%d|%d|%d|%d",
+                     seq->strip->colorspace_settings.name,
+                     scene->sequencer_colorspace_settings.name,
+                     seq->alpha_mode,
+                     seq->flag & (SEQ_FILTERY | SEQ_USE_VIEWS),
+                     seq->views_format,
+                     scene->r.scemode & R_MULTIVIEW);
+
+  char *description = BLI_dynstr_get_cstring(ds);
+  BLI_dynstr_free(ds);
+
+  char digest[16];
+  char hash[33];
+  BLI_hash_md5_buffer(description, strlen(description), digest);
+  BLI_hash_md5_to_hexdigest(digest, hash);
+  MEM_freeN(description);
+
+  seq_disk_cache_get_project_dir(disk_cache, path, path_len);
+  BLI_path_append(path, path_len, "content");
+  BLI_path_append(path, path_len, hash);
+
+  *r_frameno = frameno;
+  return true;
+}
+
+/* Get path of file where image of `key` is stored, and frame number of its header entry. */
 static void seq_disk_cache_get_file_path(SeqDiskCache *disk_cache,
                                          SeqCacheKey *key,
                                          char *path,
-                                         size_t path_len)
+                                         size_t path_len,
+                                         uint64_t *r_frameno)
 {
-  seq_disk_cache_get_dir(disk_cache, key->context.scene, key->seq, path, path_len);
-  int frameno = (int)key->nfra / DCACHE_IMAGES_PER_FILE;
+  int frameno;
+  if (!seq_disk_cache_get_content_dir(disk_cache, key, path, path_len, &frameno)) {
+    seq_disk_cache_get_dir(disk_cache, key->context.scene, key->seq, path, path_len);
+    frameno = (int)key->nfra;
+  }
+
   char cache_filename[FILE_MAXFILE];
   sprintf(cache_filename,
           DCACHE_FNAME_FORMAT,
@@ -385,9 +494,10 @@ static void seq_disk_cache_get_file_path(SeqDiskCache *disk_cache,
           key->context.recty,
           key->context.preview_render_size,
           key->context.view_id,
-          frameno);
+          frameno / DCACHE_IMAGES_PER_FILE);
 
   BLI_path_append(path, path_len, cache_filename);
+  *r_frameno = frameno;
 }
 
 static void seq_disk_cache_create_version_file(char *path)
@@ -474,29 +584,43 @@ static void seq_disk_cache_invalidate(Scene *scene,
   BLI_mutex_unlock(&disk_cache->read_write_mutex);
 }
 
+static void *seq_disk_cache_imbuf_buffer(ImBuf *ibuf)
+{
+  if (ibuf->rect) {
+    return ibuf->rect;
+  }
+  return ibuf->rect_float;
+}
+
 static size_t deflate_imbuf_to_file(ImBuf *ibuf,
                                     FILE *file,
                                     int level,
                                     DiskCacheHeaderEntry *header_entry)
 {
-  if (ibuf->rect) {
-    return BLI_gzip_mem_to_file_at_pos(
-        ibuf->rect, header_entry->size_raw, file, header_entry->offset, level);
+  if (header_entry->compression == DCACHE_COMPRESSION_NONE) {
+    if (fseek(file, header_entry->offset, SEEK_SET) != 0) {
+      return 0;
+    }
+    return fwrite(seq_disk_cache_imbuf_buffer(ibuf), 1, header_entry->size_raw, file);
   }
 
   return BLI_gzip_mem_to_file_at_pos(
-      ibuf->rect_float, header_entry->size_raw, file, header_entry->offset, level);
+      seq_disk_cache_imbuf_buffer(ibuf), header_entry->size_raw, file, header_entry->offset, level);
 }
 
 static size_t inflate_file_to_imbuf(ImBuf *ibuf, FILE *file, DiskCacheHeaderEntry *header_entry)
 {
-  if (ibuf->rect) {
-    return BLI_ungzip_file_to_mem_at_pos(
-        ibuf->rect, header_entry->size_raw, file, header_entry->offset);
+  if (header_entry->compression == DCACHE_COMPRESSION_NONE) {
+    /* Read straight into the image buffer, no intermediate copy. */
+    if (header_entry->size_compressed != header_entry->size_raw ||
+        fseek(file, header_entry->offset, SEEK_SET) != 0) {
+      return 0;
+    }
+    return fread(seq_disk_cache_imbuf_buffer(ibuf), 1, header_entry->size_raw, file);
   }
 
   return BLI_ungzip_file_to_mem_at_pos(
-      ibuf->rect_float, header_entry->size_raw, file, header_entry->offset);
+      seq_disk_cache_imbuf_buffer(ibuf), header_entry->size_raw, file, header_entry->offset);
 }
 
 static void seq_disk_cache_read_header(FILE *file, DiskCacheHeader *header)
@@ -520,7 +644,7 @@ static size_t seq_disk_cache_write_header(FILE *file, DiskCacheHeader *header)
   return fwrite(header, sizeof(*header), 1, file);
 }
 
-static int seq_disk_cache_add_header_entry(SeqCacheKey *key, ImBuf *ibuf, DiskCacheHeader *header)
+static int seq_disk_cache_add_header_entry(uint64_t frameno, ImBuf *ibuf, DiskCacheHeader *header)
 {
   int i;
   uint64_t offset = sizeof(*header);
@@ -553,7 +677,8 @@ static int seq_disk_cache_add_header_entry(SeqCacheKey *key, ImBuf *ibuf, DiskCa
   }
 
   header->entry[i].offset = offset;
-  header->entry[i].frameno = key->nfra;
+  header->entry[i].frameno = frameno;
+  header->entry[i].compression = seq_disk_cache_compression_method();
 
   /* Store colorspace name of ibuf. */
   const char *colorspace_name;
@@ -571,10 +696,10 @@ static int seq_disk_cache_add_header_entry(SeqCacheKey *key, ImBuf *ibuf, DiskCa
   return i;
 }
 
-static int seq_disk_cache_get_header_entry(SeqCacheKey *key, DiskCacheHeader *header)
+static int seq_disk_cache_get_header_entry(uint64_t frameno, DiskCacheHeader *header)
 {
   for (int i = 0; i < DCACHE_IMAGES_PER_FILE; i++) {
-    if (header->entry[i].frameno == key->nfra) {
+    if (header->entry[i].frameno == frameno) {
       return i;
     }
   }
@@ -585,8 +710,9 @@ static int seq_disk_cache_get_header_entry(SeqCacheKey *key, DiskCacheHeader *he
 static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf *ibuf)
 {
   char path[FILE_MAX];
+  uint64_t frameno;
 
-  seq_disk_cache_get_file_path(disk_cache, key, path, sizeof(path));
+  seq_disk_cache_get_file_path(disk_cache, key, path, sizeof(path), &frameno);
   BLI_make_existing_file(path);
 
   FILE *file = BLI_fopen(path, "rb+");
@@ -601,7 +727,7 @@ static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key
   DiskCacheHeader header;
   memset(&header, 0, sizeof(header));
   seq_disk_cache_read_header(file, &header);
-  int entry_index = seq_disk_cache_add_header_entry(key, ibuf, &header);
+  int entry_index = seq_disk_cache_add_header_entry(frameno, ibuf, &header);
   size_t bytes_written = deflate_imbuf_to_file(
       ibuf, file, seq_disk_cache_compression_level(), &header.entry[entry_index]);
 
@@ -624,9 +750,9 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
 {
   char path[FILE_MAX];
   DiskCacheHeader header;
+  uint64_t frameno;
 
-  seq_disk_cache_get_file_path(disk_cache, key, path, sizeof(path));
-  BLI_make_existing_file(path);
+  seq_disk_cache_get_file_path(disk_cache, key, path, sizeof(path), &frameno);
 
   FILE *file = BLI_fopen(path, "rb");
   if (!file) {
@@ -634,7 +760,7 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
   }
 
   seq_disk_cache_read_header(file, &header);
-  int entry_index = seq_disk_cache_get_header_entry(key, &header);
+  int entry_index = seq_disk_cache_get_header_entry(frameno, &header);
 
   /* Item not found. */
   if (entry_index < 0) {
@@ -681,6 +807,8 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
 #undef DCACHE_IMAGES_PER_FILE
 #undef COLORSPACE_NAME_MAX
 #undef DCACHE_CURRENT_VERSION
+#undef DCACHE_COMPRESSION_NONE
+#undef DCACHE_COMPRESSION_ZLIB
 
 static bool seq_cmp_render_data(const SeqRenderData *a, const SeqRenderData *b)
 {
@@ -787,6 +915,11 @@ static void seq_cache_valfree(void *val)
   BLI_mempool_free(item->cache_owner->items_pool, item);
 }
 
+static void seq_cache_reset_last_keys(SeqCache *cache)
+{
+  memset(cache->last_key, 0, sizeof(cache->last_key));
+}
+
 static void seq_cache_put(SeqCache *cache, SeqCacheKey *key, ImBuf *ibuf)
 {
   SeqCacheItem *item;
@@ -796,7 +929,7 @@ static void seq_cache_put(SeqCache *cache, SeqCacheKey *key, ImBuf *ibuf)
 
   if (BLI_ghash_reinsert(cache->hash, key, item, seq_cache_keyfree, seq_cache_valfree)) {
     IMB_refImBuf(ibuf);
-    cache->last_key = key;
+    cache->last_key[key->task_id] = key;
     cache->memory_used += IMB_get_size_in_memory(ibuf);
   }
 }
@@ -1060,7 +1193,7 @@ static void seq_cache_create(Main *bmain, Scene *scene)
     cache->keys_pool = BLI_mempool_create(sizeof(SeqCacheKey), 0, 64, BLI_MEMPOOL_NOP);
     cache->items_pool = BLI_mempool_create(sizeof(SeqCacheItem), 0, 64, BLI_MEMPOOL_NOP);
     cache->hash = BLI_ghash_new(seq_cache_hashhash, seq_cache_hashcmp, "SeqCache hash");
-    cache->last_key = NULL;
+    seq_cache_reset_last_keys(cache);
     cache->bmain = bmain;
     BLI_mutex_init(&cache->iterator_mutex);
     scene->ed->cache = cache;
@@ -1144,7 +1277,7 @@ void BKE_sequencer_cache_cleanup(Scene *scene)
     BLI_ghashIterator_step(&gh_iter);
     BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
   }
-  cache->last_key = NULL;
+  seq_cache_reset_last_keys(cache);
   seq_cache_unlock(scene);
 }
 
@@ -1208,7 +1341,7 @@ void BKE_sequencer_cache_cleanup_sequence(Scene *scene,
       BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
     }
   }
-  cache->last_key = NULL;
+  seq_cache_reset_last_keys(cache);
   seq_cache_unlock(scene);
 }
 
@@ -1303,8 +1436,8 @@ bool BKE_sequencer_cache_put_if_possible(const SeqRenderData *context,
     return true;
   }
 
-  seq_cache_set_temp_cache_linked(scene, scene->ed->cache->last_key);
-  scene->ed->cache->last_key = NULL;
+  seq_cache_set_temp_cache_linked(scene, scene->ed->cache->last_key[context->task_id]);
+  scene->ed->cache->last_key[context->task_id] = NULL;
   return false;
 }
 
@@ -1376,27 +1509,27 @@ void BKE_sequencer_cache_put(const SeqRenderData *context,
   /* Item stored for later use */
   if (flag & type) {
     key->is_temp_cache = false;
-    key->link_prev = cache->last_key;
+    key->link_prev = cache->last_key[key->task_id];
   }
 
-  SeqCacheKey *temp_last_key = cache->last_key;
+  SeqCacheKey *temp_last_key = cache->last_key[key->task_id];
   seq_cache_put(cache, key, i);
 
   /* Restore pointer to previous item as this one will be freed when stack is rendered. */
   if (key->is_temp_cache) {
-    cache->last_key = temp_last_key;
+    cache->last_key[key->task_id] = temp_last_key;
   }
 
   /* Set last_key's reference to this key so we can look up chain backwards.
    * Item is already put in cache, so cache->last_key points to current key.
    */
   if (flag & type && temp_last_key) {
-    temp_last_key->link_next = cache->last_key;
+    temp_last_key->link_next = cache->last_key[key->task_id];
   }
 
   /* Reset linking. */
   if (key->type == SEQ_CACHE_STORE_FINAL_OUT) {
-    cache->last_key = NULL;
+    cache->last_key[key->task_id] = NULL;
   }
 
   seq_cache_unlock(scene);
@@ -1439,7 +1572,7 @@ void BKE_sequencer_cache_iterate(
     interrupt = callback_iter(userdata, key->seq, key->nfra, key->type, key->cost);
   }
 
-  cache->last_key = NULL;
+  seq_cache_reset_last_keys(cache);
   seq_cache_unlock(scene);
 }
 
@@ -35,6 +35,7 @@
 #include "BLI_path_util.h"
 #include "BLI_rect.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
@@ -3668,61 +3669,48 @@ static void do_gaussian_blur_effect_y_cb(const SeqRenderData *context,
   }
 }
 
-typedef struct RenderGaussianBlurEffectInitData {
-  const SeqRenderData *context;
-  Sequence *seq;
-  ImBuf *ibuf;
-  ImBuf *out;
-} RenderGaussianBlurEffectInitData;
+/* Number of lines blurred by one task. */
+#define GAUSSIAN_BLUR_LINES_PER_TASK 64
 
-typedef struct RenderGaussianBlurEffectThread {
+typedef struct RenderGaussianBlurEffectThreadData {
   const SeqRenderData *context;
   Sequence *seq;
   ImBuf *ibuf;
   ImBuf *out;
-  int start_line, tot_line;
-} RenderGaussianBlurEffectThread;
+} RenderGaussianBlurEffectThreadData;
 
-static void render_effect_execute_init_handle(void *handle_v,
-                                              int start_line,
-                                              int tot_line,
-                                              void *init_data_v)
+static void render_effect_execute_x_task(void *__restrict userdata,
+                                         const int task_index,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  RenderGaussianBlurEffectThread *handle = (RenderGaussianBlurEffectThread *)handle_v;
-  RenderGaussianBlurEffectInitData *init_data = (RenderGaussianBlurEffectInitData *)init_data_v;
+  RenderGaussianBlurEffectThreadData *data = (RenderGaussianBlurEffectThreadData *)userdata;
+  const int start_line = task_index * GAUSSIAN_BLUR_LINES_PER_TASK;
+  const int tot_line = min_ii(GAUSSIAN_BLUR_LINES_PER_TASK, data->out->y - start_line);
 
-  handle->context = init_data->context;
-  handle->seq = init_data->seq;
-  handle->ibuf = init_data->ibuf;
-  handle->out = init_data->out;
-
-  handle->start_line = start_line;
-  handle->tot_line = tot_line;
+  do_gaussian_blur_effect_x_cb(
+      data->context, data->seq, data->ibuf, start_line, tot_line, data->out);
 }
 
-static void *render_effect_execute_do_x_thread(void *thread_data_v)
+static void render_effect_execute_y_task(void *__restrict userdata,
+                                         const int task_index,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  RenderGaussianBlurEffectThread *thread_data = (RenderGaussianBlurEffectThread *)thread_data_v;
-  do_gaussian_blur_effect_x_cb(thread_data->context,
-                               thread_data->seq,
-                               thread_data->ibuf,
-                               thread_data->start_line,
-                               thread_data->tot_line,
-                               thread_data->out);
-  return NULL;
+  RenderGaussianBlurEffectThreadData *data = (RenderGaussianBlurEffectThreadData *)userdata;
+  const int start_line = task_index * GAUSSIAN_BLUR_LINES_PER_TASK;
+  const int tot_line = min_ii(GAUSSIAN_BLUR_LINES_PER_TASK, data->out->y - start_line);
+
+  do_gaussian_blur_effect_y_cb(
+      data->context, data->seq, data->ibuf, start_line, tot_line, data->out);
 }
 
-static void *render_effect_execute_do_y_thread(void *thread_data_v)
+static void render_effect_execute_parallel(RenderGaussianBlurEffectThreadData *data,
+                                           TaskParallelRangeFunc func)
 {
-  RenderGaussianBlurEffectThread *thread_data = (RenderGaussianBlurEffectThread *)thread_data_v;
-  do_gaussian_blur_effect_y_cb(thread_data->context,
-                               thread_data->seq,
-                               thread_data->ibuf,
-                               thread_data->start_line,
-                               thread_data->tot_line,
-                               thread_data->out);
-
-  return NULL;
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = data->out->y > GAUSSIAN_BLUR_LINES_PER_TASK;
+  BLI_task_parallel_range(
+      0, divide_ceil_u(data->out->y, GAUSSIAN_BLUR_LINES_PER_TASK), data, func, &settings);
 }
 
 static ImBuf *do_gaussian_blur_effect(const SeqRenderData *context,
@@ -3736,29 +3724,21 @@ static ImBuf *do_gaussian_blur_effect(const SeqRenderData *context,
 {
   ImBuf *out = prepare_effect_imbufs(context, ibuf1, NULL, NULL);
 
-  RenderGaussianBlurEffectInitData init_data;
+  RenderGaussianBlurEffectThreadData data;
 
-  init_data.context = context;
-  init_data.seq = seq;
-  init_data.ibuf = ibuf1;
-  init_data.out = out;
+  data.context = context;
+  data.seq = seq;
+  data.ibuf = ibuf1;
+  data.out = out;
 
-  IMB_processor_apply_threaded(out->y,
-                               sizeof(RenderGaussianBlurEffectThread),
-                               &init_data,
-                               render_effect_execute_init_handle,
-                               render_effect_execute_do_x_thread);
+  render_effect_execute_parallel(&data, render_effect_execute_x_task);
 
   ibuf1 = out;
-  init_data.ibuf = ibuf1;
+  data.ibuf = ibuf1;
   out = prepare_effect_imbufs(context, ibuf1, NULL, NULL);
-  init_data.out = out;
+  data.out = out;
 
-  IMB_processor_apply_threaded(out->y,
-                               sizeof(RenderGaussianBlurEffectThread),
-                               &init_data,
-                               render_effect_execute_init_handle,
-                               render_effect_execute_do_y_thread);
+  render_effect_execute_parallel(&data, render_effect_execute_y_task);
 
   IMB_freeImBuf(ibuf1);
 
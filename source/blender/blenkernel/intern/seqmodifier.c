@@ -30,6 +30,7 @@
 #include "BLI_math.h"
 #include "BLI_string.h"
 #include "BLI_string_utils.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -60,24 +61,37 @@ typedef void (*modifier_apply_threaded_cb)(int width,
                                            const float *mask_rect_float,
                                            void *data_v);
 
-typedef struct ModifierInitData {
-  ImBuf *ibuf;
-  ImBuf *mask;
-  void *user_data;
-
+/* Per-pixel part of a modifier. Consecutive modifiers which have one are applied in a single
+ * pass over the image: every task runs all of them on its lines while they are still in cache. */
+typedef struct ModifierKernelInfo {
+  /* Prepares modifier data for the pass, optional. */
+  void (*begin)(SequenceModifierData *smd);
+  /* Applies the modifier on a block of lines, the modifier itself is passed as user data. */
   modifier_apply_threaded_cb apply_callback;
-} ModifierInitData;
+  /* Restores modifier data changed by begin(), optional. */
+  void (*end)(SequenceModifierData *smd);
+} ModifierKernelInfo;
 
-typedef struct ModifierThread {
-  int width, height;
+static const ModifierKernelInfo *modifiersKernels[NUM_SEQUENCE_MODIFIER_TYPES];
 
-  unsigned char *rect, *mask_rect;
-  float *rect_float, *mask_rect_float;
+/* Maximum number of kernels applied in one pass over the image. */
+#define MODIFIER_PASS_MAX_KERNELS 16
+/* Size in bytes of the lines processed by one task. */
+#define MODIFIER_PASS_TASK_SIZE (256 * 1024)
 
+typedef struct ModifierPassKernel {
+  modifier_apply_threaded_cb apply_callback;
   void *user_data;
+  ImBuf *mask;
+} ModifierPassKernel;
 
-  modifier_apply_threaded_cb apply_callback;
-} ModifierThread;
+typedef struct ModifierPass {
+  ImBuf *ibuf;
+  int lines_per_task;
+
+  ModifierPassKernel kernels[MODIFIER_PASS_MAX_KERNELS];
+  int totkernel;
+} ModifierPass;
 
 static ImBuf *modifier_mask_get(SequenceModifierData *smd,
                                 const SeqRenderData *context,
@@ -94,58 +108,72 @@ static ImBuf *modifier_mask_get(SequenceModifierData *smd,
                                          make_float);
 }
 
-static void modifier_init_handle(void *handle_v, int start_line, int tot_line, void *init_data_v)
+static void modifier_pass_add(ModifierPass *pass,
+                              modifier_apply_threaded_cb apply_callback,
+                              void *user_data,
+                              ImBuf *mask)
 {
-  ModifierThread *handle = (ModifierThread *)handle_v;
-  ModifierInitData *init_data = (ModifierInitData *)init_data_v;
-  ImBuf *ibuf = init_data->ibuf;
-  ImBuf *mask = init_data->mask;
-
-  int offset = 4 * start_line * ibuf->x;
+  BLI_assert(pass->totkernel < MODIFIER_PASS_MAX_KERNELS);
 
-  memset(handle, 0, sizeof(ModifierThread));
-
-  handle->width = ibuf->x;
-  handle->height = tot_line;
-  handle->apply_callback = init_data->apply_callback;
-  handle->user_data = init_data->user_data;
-
-  if (ibuf->rect) {
-    handle->rect = (unsigned char *)ibuf->rect + offset;
-  }
-
-  if (ibuf->rect_float) {
-    handle->rect_float = ibuf->rect_float + offset;
-  }
+  ModifierPassKernel *kernel = &pass->kernels[pass->totkernel++];
+  kernel->apply_callback = apply_callback;
+  kernel->user_data = user_data;
+  kernel->mask = mask;
+}
 
-  if (mask) {
-    if (mask->rect) {
-      handle->mask_rect = (unsigned char *)mask->rect + offset;
+static void modifier_pass_task(void *__restrict userdata,
+                               const int task_index,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ModifierPass *pass = (ModifierPass *)userdata;
+  ImBuf *ibuf = pass->ibuf;
+  const int start_line = task_index * pass->lines_per_task;
+  const int tot_line = min_ii(pass->lines_per_task, ibuf->y - start_line);
+  const size_t offset = (size_t)4 * start_line * ibuf->x;
+
+  unsigned char *rect = ibuf->rect ? (unsigned char *)ibuf->rect + offset : NULL;
+  float *rect_float = ibuf->rect_float ? ibuf->rect_float + offset : NULL;
+
+  for (int i = 0; i < pass->totkernel; i++) {
+    const ModifierPassKernel *kernel = &pass->kernels[i];
+    ImBuf *mask = kernel->mask;
+    unsigned char *mask_rect = NULL;
+    float *mask_rect_float = NULL;
+
+    if (mask) {
+      if (mask->rect) {
+        mask_rect = (unsigned char *)mask->rect + offset;
+      }
+      if (mask->rect_float) {
+        mask_rect_float = mask->rect_float + offset;
+      }
     }
 
-    if (mask->rect_float) {
-      handle->mask_rect_float = mask->rect_float + offset;
-    }
-  }
-  else {
-    handle->mask_rect = NULL;
-    handle->mask_rect_float = NULL;
+    kernel->apply_callback(
+        ibuf->x, tot_line, rect, rect_float, mask_rect, mask_rect_float, kernel->user_data);
   }
 }
 
-static void *modifier_do_thread(void *thread_data_v)
+static void modifier_pass_execute(ModifierPass *pass)
 {
-  ModifierThread *td = (ModifierThread *)thread_data_v;
+  ImBuf *ibuf = pass->ibuf;
 
-  td->apply_callback(td->width,
-                     td->height,
-                     td->rect,
-                     td->rect_float,
-                     td->mask_rect,
-                     td->mask_rect_float,
-                     td->user_data);
+  if (pass->totkernel == 0 || ibuf->x <= 0 || ibuf->y <= 0) {
+    return;
+  }
 
-  return NULL;
+  const size_t line_size = (size_t)4 * ibuf->x *
+                           (ibuf->rect_float ? sizeof(float) : sizeof(unsigned char));
+  pass->lines_per_task = (int)max_zz(1, MODIFIER_PASS_TASK_SIZE / line_size);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = ibuf->y > pass->lines_per_task;
+  BLI_task_parallel_range(0,
+                          divide_ceil_u(ibuf->y, pass->lines_per_task),
+                          pass,
+                          modifier_pass_task,
+                          &settings);
 }
 
 static void modifier_apply_threaded(ImBuf *ibuf,
@@ -153,16 +181,11 @@ static void modifier_apply_threaded(ImBuf *ibuf,
                                     modifier_apply_threaded_cb apply_callback,
                                     void *user_data)
 {
-  ModifierInitData init_data;
+  ModifierPass pass = {NULL};
 
-  init_data.ibuf = ibuf;
-  init_data.mask = mask;
-  init_data.user_data = user_data;
-
-  init_data.apply_callback = apply_callback;
-
-  IMB_processor_apply_threaded(
-      ibuf->y, sizeof(ModifierThread), &init_data, modifier_init_handle, modifier_do_thread);
+  pass.ibuf = ibuf;
+  modifier_pass_add(&pass, apply_callback, user_data, mask);
+  modifier_pass_execute(&pass);
 }
 
 /** \} */
@@ -214,10 +237,6 @@ static void whiteBalance_init_data(SequenceModifierData *smd)
   copy_v3_fl(cbmd->white_value, 1.0f);
 }
 
-typedef struct WhiteBalanceThreadData {
-  float white[3];
-} WhiteBalanceThreadData;
-
 static void whiteBalance_apply_threaded(int width,
                                         int height,
                                         unsigned char *rect,
@@ -229,11 +248,12 @@ static void whiteBalance_apply_threaded(int width,
   int x, y;
   float multiplier[3];
 
-  WhiteBalanceThreadData *data = (WhiteBalanceThreadData *)data_v;
+  WhiteBalanceModifierData *wbmd = (WhiteBalanceModifierData *)data_v;
+  const float *white = wbmd->white_value;
 
-  multiplier[0] = (data->white[0] != 0.0f) ? 1.0f / data->white[0] : FLT_MAX;
-  multiplier[1] = (data->white[1] != 0.0f) ? 1.0f / data->white[1] : FLT_MAX;
-  multiplier[2] = (data->white[2] != 0.0f) ? 1.0f / data->white[2] : FLT_MAX;
+  multiplier[0] = (white[0] != 0.0f) ? 1.0f / white[0] : FLT_MAX;
+  multiplier[1] = (white[1] != 0.0f) ? 1.0f / white[1] : FLT_MAX;
+  multiplier[2] = (white[2] != 0.0f) ? 1.0f / white[2] : FLT_MAX;
 
   for (y = 0; y < height; y++) {
     for (x = 0; x < width; x++) {
@@ -280,14 +300,15 @@ static void whiteBalance_apply_threaded(int width,
 
 static void whiteBalance_apply(SequenceModifierData *smd, ImBuf *ibuf, ImBuf *mask)
 {
-  WhiteBalanceThreadData data;
-  WhiteBalanceModifierData *wbmd = (WhiteBalanceModifierData *)smd;
-
-  copy_v3_v3(data.white, wbmd->white_value);
-
-  modifier_apply_threaded(ibuf, mask, whiteBalance_apply_threaded, &data);
+  modifier_apply_threaded(ibuf, mask, whiteBalance_apply_threaded, smd);
 }
 
+static const ModifierKernelInfo seqModifierKernel_WhiteBalance = {
+    NULL,                        /* begin */
+    whiteBalance_apply_threaded, /* apply_callback */
+    NULL,                        /* end */
+};
+
 static SequenceModifierTypeInfo seqModifier_WhiteBalance = {
     CTX_N_(BLT_I18NCONTEXT_ID_SEQUENCE, "White Balance"), /* name */
     "WhiteBalanceModifierData",                           /* struct_name */
@@ -334,7 +355,8 @@ static void curves_apply_threaded(int width,
                                   const float *mask_rect_float,
                                   void *data_v)
 {
-  CurveMapping *curve_mapping = (CurveMapping *)data_v;
+  CurvesModifierData *cmd = (CurvesModifierData *)data_v;
+  CurveMapping *curve_mapping = &cmd->curve_mapping;
   int x, y;
 
   for (y = 0; y < height; y++) {
@@ -389,7 +411,7 @@ static void curves_apply_threaded(int width,
   }
 }
 
-static void curves_apply(struct SequenceModifierData *smd, ImBuf *ibuf, ImBuf *mask)
+static void curves_begin(SequenceModifierData *smd)
 {
   CurvesModifierData *cmd = (CurvesModifierData *)smd;
 
@@ -400,12 +422,28 @@ static void curves_apply(struct SequenceModifierData *smd, ImBuf *ibuf, ImBuf *m
 
   BKE_curvemapping_premultiply(&cmd->curve_mapping, 0);
   BKE_curvemapping_set_black_white(&cmd->curve_mapping, black, white);
+}
 
-  modifier_apply_threaded(ibuf, mask, curves_apply_threaded, &cmd->curve_mapping);
+static void curves_end(SequenceModifierData *smd)
+{
+  CurvesModifierData *cmd = (CurvesModifierData *)smd;
 
   BKE_curvemapping_premultiply(&cmd->curve_mapping, 1);
 }
 
+static void curves_apply(struct SequenceModifierData *smd, ImBuf *ibuf, ImBuf *mask)
+{
+  curves_begin(smd);
+  modifier_apply_threaded(ibuf, mask, curves_apply_threaded, smd);
+  curves_end(smd);
+}
+
+static const ModifierKernelInfo seqModifierKernel_Curves = {
+    curves_begin,          /* begin */
+    curves_apply_threaded, /* apply_callback */
+    curves_end,            /* end */
+};
+
 static SequenceModifierTypeInfo seqModifier_Curves = {
     CTX_N_(BLT_I18NCONTEXT_ID_SEQUENCE, "Curves"), /* name */
     "CurvesModifierData",                          /* struct_name */
@@ -464,7 +502,8 @@ static void hue_correct_apply_threaded(int width,
                                        const float *mask_rect_float,
                                        void *data_v)
 {
-  CurveMapping *curve_mapping = (CurveMapping *)data_v;
+  HueCorrectModifierData *hcmd = (HueCorrectModifierData *)data_v;
+  CurveMapping *curve_mapping = &hcmd->curve_mapping;
   int x, y;
 
   for (y = 0; y < height; y++) {
@@ -521,15 +560,25 @@ static void hue_correct_apply_threaded(int width,
   }
 }
 
-static void hue_correct_apply(struct SequenceModifierData *smd, ImBuf *ibuf, ImBuf *mask)
+static void hue_correct_begin(SequenceModifierData *smd)
 {
   HueCorrectModifierData *hcmd = (HueCorrectModifierData *)smd;
 
   BKE_curvemapping_init(&hcmd->curve_mapping);
+}
 
-  modifier_apply_threaded(ibuf, mask, hue_correct_apply_threaded, &hcmd->curve_mapping);
+static void hue_correct_apply(struct SequenceModifierData *smd, ImBuf *ibuf, ImBuf *mask)
+{
+  hue_correct_begin(smd);
+  modifier_apply_threaded(ibuf, mask, hue_correct_apply_threaded, smd);
 }
 
+static const ModifierKernelInfo seqModifierKernel_HueCorrect = {
+    hue_correct_begin,          /* begin */
+    hue_correct_apply_threaded, /* apply_callback */
+    NULL,                       /* end */
+};
+
 static SequenceModifierTypeInfo seqModifier_HueCorrect = {
     CTX_N_(BLT_I18NCONTEXT_ID_SEQUENCE, "Hue Correct"), /* name */
     "HueCorrectModifierData",                           /* struct_name */
@@ -546,11 +595,6 @@ static SequenceModifierTypeInfo seqModifier_HueCorrect = {
 /** \name Bright/Contrast Modifier
  * \{ */
 
-typedef struct BrightContrastThreadData {
-  float bright;
-  float contrast;
-} BrightContrastThreadData;
-
 static void brightcontrast_apply_threaded(int width,
                                           int height,
                                           unsigned char *rect,
@@ -559,14 +603,14 @@ static void brightcontrast_apply_threaded(int width,
                                           const float *mask_rect_float,
                                           void *data_v)
 {
-  BrightContrastThreadData *data = (BrightContrastThreadData *)data_v;
+  BrightContrastModifierData *bcmd = (BrightContrastModifierData *)data_v;
   int x, y;
 
   float i;
   int c;
   float a, b, v;
-  float brightness = data->bright / 100.0f;
-  float contrast = data->contrast;
+  float brightness = bcmd->bright / 100.0f;
+  float contrast = bcmd->contrast;
   float delta = contrast / 200.0f;
   /*
    * The algorithm is by Werner D. Streidt
@@ -628,15 +672,15 @@ static void brightcontrast_apply_threaded(int width,
 
 static void brightcontrast_apply(struct SequenceModifierData *smd, ImBuf *ibuf, ImBuf *mask)
 {
-  BrightContrastModifierData *bcmd = (BrightContrastModifierData *)smd;
-  BrightContrastThreadData data;
-
-  data.bright = bcmd->bright;
-  data.contrast = bcmd->contrast;
-
-  modifier_apply_threaded(ibuf, mask, brightcontrast_apply_threaded, &data);
+  modifier_apply_threaded(ibuf, mask, brightcontrast_apply_threaded, smd);
 }
 
+static const ModifierKernelInfo seqModifierKernel_BrightContrast = {
+    NULL,                          /* begin */
+    brightcontrast_apply_threaded, /* apply_callback */
+    NULL,                          /* end */
+};
+
 static SequenceModifierTypeInfo seqModifier_BrightContrast = {
     CTX_N_(BLT_I18NCONTEXT_ID_SEQUENCE, "Bright/Contrast"), /* name */
     "BrightContrastModifierData",                           /* struct_name */
@@ -710,6 +754,12 @@ static void maskmodifier_apply(struct SequenceModifierData *UNUSED(smd), ImBuf *
   modifier_apply_threaded(ibuf, mask, maskmodifier_apply_threaded, NULL);
 }
 
+static const ModifierKernelInfo seqModifierKernel_Mask = {
+    NULL,                        /* begin */
+    maskmodifier_apply_threaded, /* apply_callback */
+    NULL,                        /* end */
+};
+
 static SequenceModifierTypeInfo seqModifier_Mask = {
     CTX_N_(BLT_I18NCONTEXT_ID_SEQUENCE, "Mask"), /* name */
     "SequencerMaskModifierData",                 /* struct_name */
@@ -955,6 +1005,17 @@ static void sequence_modifier_type_info_init(void)
   INIT_TYPE(Tonemap);
 
 #undef INIT_TYPE
+
+#define INIT_KERNEL(typeName) \
+  (modifiersKernels[seqModifierType_##typeName] = &seqModifierKernel_##typeName)
+
+  INIT_KERNEL(Curves);
+  INIT_KERNEL(HueCorrect);
+  INIT_KERNEL(BrightContrast);
+  INIT_KERNEL(Mask);
+  INIT_KERNEL(WhiteBalance);
+
+#undef INIT_KERNEL
 }
 
 const SequenceModifierTypeInfo *BKE_sequence_modifier_type_info_get(int type)
@@ -1047,6 +1108,25 @@ SequenceModifierData *BKE_sequence_modifier_find_by_name(Sequence *seq, const ch
   return BLI_findstring(&(seq->modifiers), name, offsetof(SequenceModifierData, name));
 }
 
+/* Applies all kernels collected so far in one pass, then frees their masks. */
+static void modifier_stack_pass_flush(ModifierPass *pass, SequenceModifierData **pass_modifiers)
+{
+  modifier_pass_execute(pass);
+
+  for (int i = 0; i < pass->totkernel; i++) {
+    const ModifierKernelInfo *kernel = modifiersKernels[pass_modifiers[i]->type];
+
+    if (kernel->end) {
+      kernel->end(pass_modifiers[i]);
+    }
+    if (pass->kernels[i].mask) {
+      IMB_freeImBuf(pass->kernels[i].mask);
+    }
+  }
+
+  pass->totkernel = 0;
+}
+
 ImBuf *BKE_sequence_modifier_apply_stack(const SeqRenderData *context,
                                          Sequence *seq,
                                          ImBuf *ibuf,
@@ -1054,6 +1134,8 @@ ImBuf *BKE_sequence_modifier_apply_stack(const SeqRenderData *context,
 {
   SequenceModifierData *smd;
   ImBuf *processed_ibuf = ibuf;
+  ModifierPass pass = {NULL};
+  SequenceModifierData *pass_modifiers[MODIFIER_PASS_MAX_KERNELS];
 
   if (seq->modifiers.first && (seq->flag & SEQ_USE_LINEAR_MODIFIERS)) {
     processed_ibuf = IMB_dupImBuf(ibuf);
@@ -1088,6 +1170,25 @@ ImBuf *BKE_sequence_modifier_apply_stack(const SeqRenderData *context,
         processed_ibuf = IMB_dupImBuf(ibuf);
       }
 
+      const ModifierKernelInfo *kernel = modifiersKernels[smd->type];
+
+      if (kernel) {
+        /* Defer per-pixel modifiers, so consecutive ones share a single pass over the image. */
+        if (pass.totkernel == MODIFIER_PASS_MAX_KERNELS) {
+          modifier_stack_pass_flush(&pass, pass_modifiers);
+        }
+        if (kernel->begin) {
+          kernel->begin(smd);
+        }
+        pass.ibuf = processed_ibuf;
+        pass_modifiers[pass.totkernel] = smd;
+        modifier_pass_add(&pass, kernel->apply_callback, smd, mask);
+        continue;
+      }
+
+      /* Modifier works on the whole image, everything before it has to be applied first. */
+      modifier_stack_pass_flush(&pass, pass_modifiers);
+
       smti->apply(smd, processed_ibuf, mask);
 
       if (mask) {
@@ -1096,6 +1197,8 @@ ImBuf *BKE_sequence_modifier_apply_stack(const SeqRenderData *context,
     }
   }
 
+  modifier_stack_pass_flush(&pass, pass_modifiers);
+
   if (seq->modifiers.first && (seq->flag & SEQ_USE_LINEAR_MODIFIERS)) {
     BKE_sequencer_imbuf_to_sequencer_space(context->scene, processed_ibuf, false);
   }
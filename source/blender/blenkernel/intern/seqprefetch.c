@@ -34,6 +34,7 @@
 #include "DNA_windowmanager_types.h"
 
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_threads.h"
 
 #include "IMB_imbuf.h"
@@ -54,29 +55,42 @@
 #include "DEG_depsgraph_debug.h"
 #include "DEG_depsgraph_query.h"
 
+/* Renders one frame at a time, using its own copy of the scene evaluated for that frame. */
+typedef struct PrefetchWorker {
+  struct PrefetchJob *pfjob;
+
+  struct Main *bmain_eval;
+  struct Scene *scene_eval;
+  struct Depsgraph *depsgraph;
+
+  /* context */
+  struct SeqRenderData context;
+  struct SeqRenderData context_cpy;
+
+  /* frame being rendered */
+  float cfra;
+  /* cfra is claimed and not rendered yet */
+  bool rendering;
+} PrefetchWorker;
+
 typedef struct PrefetchJob {
   struct PrefetchJob *next, *prev;
 
   struct Main *bmain;
-  struct Main *bmain_eval;
   struct Scene *scene;
-  struct Scene *scene_eval;
-  struct Depsgraph *depsgraph;
 
   ThreadMutex prefetch_suspend_mutex;
   ThreadCondition prefetch_suspend_cond;
 
   ListBase threads;
+  PrefetchWorker workers[SEQ_PREFETCH_MAX_WORKERS];
+  int num_workers;
+  int num_workers_running;
+  int num_workers_waiting;
 
-  /* context */
-  struct SeqRenderData context;
-  struct SeqRenderData context_cpy;
-  struct ListBase *seqbasep;
-  struct ListBase *seqbasep_cpy;
-
-  /* prefetch area */
+  /* prefetch area, frames up to cfra + num_frames_claimed are rendered or being rendered */
   float cfra;
-  int num_frames_prefetched;
+  int num_frames_claimed;
 
   /* control */
   bool running;
@@ -164,8 +178,9 @@ Sequence *BKE_sequencer_prefetch_get_original_sequence(Sequence *seq, Scene *sce
 SeqRenderData *BKE_sequencer_prefetch_get_original_context(const SeqRenderData *context)
 {
   PrefetchJob *pfjob = seq_prefetch_job_get(context->scene);
+  PrefetchWorker *worker = &pfjob->workers[context->task_id - SEQ_TASK_PREFETCH_RENDER];
 
-  return &pfjob->context;
+  return &worker->context;
 }
 
 static bool seq_prefetch_is_cache_full(Scene *scene)
@@ -179,13 +194,45 @@ static bool seq_prefetch_is_cache_full(Scene *scene)
   return BKE_sequencer_cache_recycle_item(pfjob->scene) == false;
 }
 
+/* First frame that is not rendered or being rendered yet. */
 static float seq_prefetch_cfra(PrefetchJob *pfjob)
 {
-  return pfjob->cfra + pfjob->num_frames_prefetched;
+  return pfjob->cfra + pfjob->num_frames_claimed;
 }
-static AnimationEvalContext seq_prefetch_anim_eval_context(PrefetchJob *pfjob)
+
+/* Number of frames of the prefetch area that are rendered, up to the first one a worker is still
+ * rendering. Must be called with the job mutex held. */
+static int seq_prefetch_num_frames_rendered(PrefetchJob *pfjob)
 {
-  return BKE_animsys_eval_context_construct(pfjob->depsgraph, seq_prefetch_cfra(pfjob));
+  float end = seq_prefetch_cfra(pfjob);
+
+  for (int i = 0; i < pfjob->num_workers; i++) {
+    PrefetchWorker *worker = &pfjob->workers[i];
+    /* Frames left behind by a rebase are not part of the area anymore. */
+    if (worker->rendering && worker->cfra >= pfjob->cfra) {
+      end = min_ff(end, worker->cfra);
+    }
+  }
+
+  return (int)(end - pfjob->cfra);
+}
+
+/* Whether a worker is still rendering the frame. Must be called with the job mutex held. */
+static bool seq_prefetch_frame_is_rendering(PrefetchJob *pfjob, float cfra)
+{
+  for (int i = 0; i < pfjob->num_workers; i++) {
+    PrefetchWorker *worker = &pfjob->workers[i];
+    if (worker->rendering && worker->cfra == cfra) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static int seq_prefetch_num_workers(void)
+{
+  /* Strip rendering is threaded too, leave room for that. */
+  return max_ii(1, min_ii(BLI_system_thread_count() / 2, SEQ_PREFETCH_MAX_WORKERS));
 }
 
 void BKE_sequencer_prefetch_get_time_range(Scene *scene, int *start, int *end)
@@ -196,37 +243,37 @@ void BKE_sequencer_prefetch_get_time_range(Scene *scene, int *start, int *end)
   *end = seq_prefetch_cfra(pfjob);
 }
 
-static void seq_prefetch_free_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_free_depsgraph(PrefetchWorker *worker)
 {
-  if (pfjob->depsgraph != NULL) {
-    DEG_graph_free(pfjob->depsgraph);
+  if (worker->depsgraph != NULL) {
+    DEG_graph_free(worker->depsgraph);
   }
-  pfjob->depsgraph = NULL;
-  pfjob->scene_eval = NULL;
+  worker->depsgraph = NULL;
+  worker->scene_eval = NULL;
 }
 
-static void seq_prefetch_update_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_update_depsgraph(PrefetchWorker *worker)
 {
-  DEG_evaluate_on_framechange(pfjob->depsgraph, seq_prefetch_cfra(pfjob));
+  DEG_evaluate_on_framechange(worker->depsgraph, worker->cfra);
 }
 
-static void seq_prefetch_init_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_init_depsgraph(PrefetchWorker *worker)
 {
-  Main *bmain = pfjob->bmain_eval;
-  Scene *scene = pfjob->scene;
+  Main *bmain = worker->bmain_eval;
+  Scene *scene = worker->pfjob->scene;
   ViewLayer *view_layer = BKE_view_layer_default_render(scene);
 
-  pfjob->depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_RENDER);
-  DEG_debug_name_set(pfjob->depsgraph, "SEQUENCER PREFETCH");
+  worker->depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_RENDER);
+  DEG_debug_name_set(worker->depsgraph, "SEQUENCER PREFETCH");
 
   /* Make sure there is a correct evaluated scene pointer. */
-  DEG_graph_build_for_render_pipeline(pfjob->depsgraph);
+  DEG_graph_build_for_render_pipeline(worker->depsgraph);
 
   /* Update immediately so we have proper evaluated scene. */
-  seq_prefetch_update_depsgraph(pfjob);
+  seq_prefetch_update_depsgraph(worker);
 
-  pfjob->scene_eval = DEG_get_evaluated_scene(pfjob->depsgraph);
-  pfjob->scene_eval->ed->cache_flag = 0;
+  worker->scene_eval = DEG_get_evaluated_scene(worker->depsgraph);
+  worker->scene_eval->ed->cache_flag = 0;
 }
 
 static void seq_prefetch_update_area(PrefetchJob *pfjob)
@@ -237,17 +284,23 @@ static void seq_prefetch_update_area(PrefetchJob *pfjob)
   if (cfra > pfjob->cfra) {
     int delta = cfra - pfjob->cfra;
     pfjob->cfra = cfra;
-    pfjob->num_frames_prefetched -= delta;
+    pfjob->num_frames_claimed -= delta;
 
-    if (pfjob->num_frames_prefetched <= 1) {
-      pfjob->num_frames_prefetched = 1;
+    if (pfjob->num_frames_claimed <= 1) {
+      pfjob->num_frames_claimed = 1;
     }
   }
 
   /* reset */
   if (cfra < pfjob->cfra) {
     pfjob->cfra = cfra;
-    pfjob->num_frames_prefetched = 1;
+    pfjob->num_frames_claimed = 1;
+  }
+
+  /* Workers may still be rendering frames of the old area, which a reset moved the claim below.
+   * Step over those so no frame is claimed twice. */
+  while (seq_prefetch_frame_is_rendering(pfjob, seq_prefetch_cfra(pfjob))) {
+    pfjob->num_frames_claimed++;
   }
 }
 
@@ -274,7 +327,7 @@ void BKE_sequencer_prefetch_stop(Scene *scene)
   pfjob->stop = true;
 
   while (pfjob->running) {
-    BLI_condition_notify_one(&pfjob->prefetch_suspend_cond);
+    BLI_condition_notify_all(&pfjob->prefetch_suspend_cond);
   }
 }
 
@@ -283,32 +336,39 @@ static void seq_prefetch_update_context(const SeqRenderData *context)
   PrefetchJob *pfjob;
   pfjob = seq_prefetch_job_get(context->scene);
 
-  BKE_sequencer_new_render_data(pfjob->bmain_eval,
-                                pfjob->depsgraph,
-                                pfjob->scene_eval,
-                                context->rectx,
-                                context->recty,
-                                context->preview_render_size,
-                                false,
-                                &pfjob->context_cpy);
-  pfjob->context_cpy.is_prefetch_render = true;
-  pfjob->context_cpy.task_id = SEQ_TASK_PREFETCH_RENDER;
-
-  BKE_sequencer_new_render_data(pfjob->bmain,
-                                pfjob->depsgraph,
-                                pfjob->scene,
-                                context->rectx,
-                                context->recty,
-                                context->preview_render_size,
-                                false,
-                                &pfjob->context);
-  pfjob->context.is_prefetch_render = false;
-
-  /* Same ID as prefetch context, because context will be swapped, but we still
-   * want to assign this ID to cache entries created in this thread.
-   * This is to allow "temp cache" work correctly for both threads.
-   */
-  pfjob->context.task_id = SEQ_TASK_PREFETCH_RENDER;
+  for (int i = 0; i < pfjob->num_workers; i++) {
+    PrefetchWorker *worker = &pfjob->workers[i];
+    /* Each worker has its own ID, so temp cache of frames rendered by other workers in the
+     * meantime is left alone. */
+    const eSeqTaskId task_id = (eSeqTaskId)(SEQ_TASK_PREFETCH_RENDER + i);
+
+    BKE_sequencer_new_render_data(worker->bmain_eval,
+                                  worker->depsgraph,
+                                  worker->scene_eval,
+                                  context->rectx,
+                                  context->recty,
+                                  context->preview_render_size,
+                                  false,
+                                  &worker->context_cpy);
+    worker->context_cpy.is_prefetch_render = true;
+    worker->context_cpy.task_id = task_id;
+
+    BKE_sequencer_new_render_data(pfjob->bmain,
+                                  worker->depsgraph,
+                                  pfjob->scene,
+                                  context->rectx,
+                                  context->recty,
+                                  context->preview_render_size,
+                                  false,
+                                  &worker->context);
+    worker->context.is_prefetch_render = false;
+
+    /* Same ID as prefetch context, because context will be swapped, but we still
+     * want to assign this ID to cache entries created in this thread.
+     * This is to allow "temp cache" work correctly for all threads.
+     */
+    worker->context.task_id = task_id;
+  }
 }
 
 static void seq_prefetch_update_scene(Scene *scene)
@@ -319,17 +379,28 @@ static void seq_prefetch_update_scene(Scene *scene)
     return;
   }
 
-  seq_prefetch_free_depsgraph(pfjob);
-  seq_prefetch_init_depsgraph(pfjob);
+  for (int i = 0; i < pfjob->num_workers; i++) {
+    PrefetchWorker *worker = &pfjob->workers[i];
+    worker->cfra = pfjob->scene->r.cfra;
+    seq_prefetch_free_depsgraph(worker);
+    seq_prefetch_init_depsgraph(worker);
+  }
 }
 
 static void seq_prefetch_resume(Scene *scene)
 {
   PrefetchJob *pfjob = seq_prefetch_job_get(scene);
 
-  if (pfjob && pfjob->waiting) {
-    BLI_condition_notify_one(&pfjob->prefetch_suspend_cond);
+  if (!pfjob) {
+    return;
+  }
+
+  /* Wake every suspended worker, not only when all of them are. */
+  BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
+  if (pfjob->num_workers_waiting > 0) {
+    BLI_condition_notify_all(&pfjob->prefetch_suspend_cond);
   }
+  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
 }
 
 void BKE_sequencer_prefetch_free(Scene *scene)
@@ -341,24 +412,24 @@ void BKE_sequencer_prefetch_free(Scene *scene)
 
   BKE_sequencer_prefetch_stop(scene);
 
-  BLI_threadpool_remove(&pfjob->threads, pfjob);
   BLI_threadpool_end(&pfjob->threads);
   BLI_mutex_end(&pfjob->prefetch_suspend_mutex);
   BLI_condition_end(&pfjob->prefetch_suspend_cond);
-  seq_prefetch_free_depsgraph(pfjob);
-  BKE_main_free(pfjob->bmain_eval);
+  for (int i = 0; i < pfjob->num_workers; i++) {
+    seq_prefetch_free_depsgraph(&pfjob->workers[i]);
+    BKE_main_free(pfjob->workers[i].bmain_eval);
+  }
   MEM_freeN(pfjob);
   scene->ed->prefetch_job = NULL;
 }
 
-static bool seq_prefetch_do_skip_frame(Scene *scene)
+static bool seq_prefetch_do_skip_frame(PrefetchWorker *worker)
 {
-  Editing *ed = scene->ed;
-  PrefetchJob *pfjob = seq_prefetch_job_get(scene);
-  float cfra = seq_prefetch_cfra(pfjob);
+  Editing *ed = worker->pfjob->scene->ed;
+  float cfra = worker->cfra;
   Sequence *seq_arr[MAXSEQ + 1];
   int count = BKE_sequencer_get_shown_sequences(ed->seqbasep, cfra, 0, seq_arr);
-  SeqRenderData *ctx = &pfjob->context_cpy;
+  SeqRenderData *ctx = &worker->context_cpy;
   ImBuf *ibuf = NULL;
 
   /* Disable prefetching 3D scene strips, but check for disk cache. */
@@ -414,74 +485,103 @@ static bool seq_prefetch_do_skip_frame(Scene *scene)
 static bool seq_prefetch_need_suspend(PrefetchJob *pfjob)
 {
   return seq_prefetch_is_cache_full(pfjob->scene) || seq_prefetch_is_scrubbing(pfjob->bmain) ||
-         (seq_prefetch_cfra(pfjob) >= pfjob->scene->r.efra);
+         (seq_prefetch_cfra(pfjob) > pfjob->scene->r.efra);
 }
 
-static void seq_prefetch_do_suspend(PrefetchJob *pfjob)
+static bool seq_prefetch_is_stopped(PrefetchJob *pfjob)
 {
+  return !(pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) || pfjob->stop;
+}
+
+/* Assign next frame to render to the worker. Suspends the worker if there is nothing to be
+ * prefetched, returns false when the worker should exit. */
+static bool seq_prefetch_claim_frame(PrefetchWorker *worker)
+{
+  PrefetchJob *pfjob = worker->pfjob;
+  bool claimed = false;
+
   BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
-  while (seq_prefetch_need_suspend(pfjob) &&
-         (pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) && !pfjob->stop) {
-    pfjob->waiting = true;
+  /* The previously claimed frame is rendered now. */
+  worker->rendering = false;
+  seq_prefetch_update_area(pfjob);
+
+  while (seq_prefetch_need_suspend(pfjob) && !seq_prefetch_is_stopped(pfjob)) {
+    /* Whole job is only suspended once no worker is rendering anymore. */
+    pfjob->num_workers_waiting++;
+    pfjob->waiting = (pfjob->num_workers_waiting == pfjob->num_workers_running);
     BLI_condition_wait(&pfjob->prefetch_suspend_cond, &pfjob->prefetch_suspend_mutex);
+    pfjob->num_workers_waiting--;
+    pfjob->waiting = false;
     seq_prefetch_update_area(pfjob);
   }
-  pfjob->waiting = false;
-  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
-}
 
-static void *seq_prefetch_frames(void *job)
-{
-  PrefetchJob *pfjob = (PrefetchJob *)job;
+  /* Avoid "collision" with main thread, but make sure to fetch at least few frames */
+  const bool collision = seq_prefetch_num_frames_rendered(pfjob) > 5 &&
+                         (seq_prefetch_cfra(pfjob) - pfjob->scene->r.cfra) < 2;
 
-  while (seq_prefetch_cfra(pfjob) <= pfjob->scene->r.efra) {
-    pfjob->scene_eval->ed->prefetch_job = NULL;
+  if (!seq_prefetch_is_stopped(pfjob) && !collision &&
+      seq_prefetch_cfra(pfjob) <= pfjob->scene->r.efra) {
+    worker->cfra = seq_prefetch_cfra(pfjob);
+    worker->rendering = true;
+    pfjob->num_frames_claimed++;
+    claimed = true;
+  }
+  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
 
-    seq_prefetch_update_depsgraph(pfjob);
-    AnimData *adt = BKE_animdata_from_id(&pfjob->context_cpy.scene->id);
-    AnimationEvalContext anim_eval_context = seq_prefetch_anim_eval_context(pfjob);
-    BKE_animsys_evaluate_animdata(
-        &pfjob->context_cpy.scene->id, adt, &anim_eval_context, ADT_RECALC_ALL, false);
+  return claimed;
+}
 
-    /* This is quite hacky solution:
-     * We need cross-reference original scene with copy for cache.
-     * However depsgraph must not have this data, because it will try to kill this job.
-     * Scene copy don't reference original scene. Perhaps, this could be done by depsgraph.
-     * Set to NULL before return!
-     */
-    pfjob->scene_eval->ed->prefetch_job = pfjob;
+static void seq_prefetch_render_frame(PrefetchWorker *worker)
+{
+  PrefetchJob *pfjob = worker->pfjob;
+
+  worker->scene_eval->ed->prefetch_job = NULL;
+
+  seq_prefetch_update_depsgraph(worker);
+  AnimData *adt = BKE_animdata_from_id(&worker->context_cpy.scene->id);
+  AnimationEvalContext anim_eval_context = BKE_animsys_eval_context_construct(worker->depsgraph,
+                                                                              worker->cfra);
+  BKE_animsys_evaluate_animdata(
+      &worker->context_cpy.scene->id, adt, &anim_eval_context, ADT_RECALC_ALL, false);
+
+  /* This is quite hacky solution:
+   * We need cross-reference original scene with copy for cache.
+   * However depsgraph must not have this data, because it will try to kill this job.
+   * Scene copy don't reference original scene. Perhaps, this could be done by depsgraph.
+   * Set to NULL before return!
+   */
+  worker->scene_eval->ed->prefetch_job = pfjob;
 
-    if (seq_prefetch_do_skip_frame(pfjob->scene)) {
-      pfjob->num_frames_prefetched++;
-      continue;
-    }
+  if (seq_prefetch_do_skip_frame(worker)) {
+    return;
+  }
 
-    ImBuf *ibuf = BKE_sequencer_give_ibuf(&pfjob->context_cpy, seq_prefetch_cfra(pfjob), 0);
-    BKE_sequencer_cache_free_temp_cache(
-        pfjob->scene, pfjob->context.task_id, seq_prefetch_cfra(pfjob));
-    IMB_freeImBuf(ibuf);
+  ImBuf *ibuf = BKE_sequencer_give_ibuf(&worker->context_cpy, worker->cfra, 0);
+  BKE_sequencer_cache_free_temp_cache(pfjob->scene, worker->context.task_id, worker->cfra);
+  IMB_freeImBuf(ibuf);
+}
 
-    /* Suspend thread if there is nothing to be prefetched. */
-    seq_prefetch_do_suspend(pfjob);
+static void *seq_prefetch_frames(void *data)
+{
+  PrefetchWorker *worker = (PrefetchWorker *)data;
+  PrefetchJob *pfjob = worker->pfjob;
 
-    /* Avoid "collision" with main thread, but make sure to fetch at least few frames */
-    if (pfjob->num_frames_prefetched > 5 &&
-        (seq_prefetch_cfra(pfjob) - pfjob->scene->r.cfra) < 2) {
-      break;
-    }
+  while (seq_prefetch_claim_frame(worker)) {
+    seq_prefetch_render_frame(worker);
+  }
 
-    if (!(pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) || pfjob->stop) {
-      break;
-    }
+  BKE_sequencer_cache_free_temp_cache(pfjob->scene, worker->context.task_id, worker->cfra);
+  worker->scene_eval->ed->prefetch_job = NULL;
 
-    seq_prefetch_update_area(pfjob);
-    pfjob->num_frames_prefetched++;
+  BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
+  pfjob->num_workers_running--;
+  if (pfjob->num_workers_running == 0) {
+    pfjob->running = false;
   }
-
-  BKE_sequencer_cache_free_temp_cache(
-      pfjob->scene, pfjob->context.task_id, seq_prefetch_cfra(pfjob));
-  pfjob->running = false;
-  pfjob->scene_eval->ed->prefetch_job = NULL;
+  else if (pfjob->num_workers_waiting == pfjob->num_workers_running) {
+    pfjob->waiting = true;
+  }
+  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
 
   return NULL;
 }
@@ -495,29 +595,41 @@ static PrefetchJob *seq_prefetch_start(const SeqRenderData *context, float cfra)
       pfjob = (PrefetchJob *)MEM_callocN(sizeof(PrefetchJob), "PrefetchJob");
       context->scene->ed->prefetch_job = pfjob;
 
-      BLI_threadpool_init(&pfjob->threads, seq_prefetch_frames, 1);
+      pfjob->num_workers = seq_prefetch_num_workers();
+      BLI_threadpool_init(&pfjob->threads, seq_prefetch_frames, pfjob->num_workers);
       BLI_mutex_init(&pfjob->prefetch_suspend_mutex);
       BLI_condition_init(&pfjob->prefetch_suspend_cond);
 
       pfjob->bmain = context->bmain;
-      pfjob->bmain_eval = BKE_main_new();
-
       pfjob->scene = context->scene;
-      seq_prefetch_init_depsgraph(pfjob);
+
+      for (int i = 0; i < pfjob->num_workers; i++) {
+        PrefetchWorker *worker = &pfjob->workers[i];
+        worker->pfjob = pfjob;
+        worker->bmain_eval = BKE_main_new();
+      }
     }
   }
   seq_prefetch_update_scene(context->scene);
   seq_prefetch_update_context(context);
 
   pfjob->cfra = cfra;
-  pfjob->num_frames_prefetched = 1;
+  pfjob->num_frames_claimed = 1;
+  for (int i = 0; i < pfjob->num_workers; i++) {
+    pfjob->workers[i].rendering = false;
+  }
 
   pfjob->waiting = false;
   pfjob->stop = false;
   pfjob->running = true;
+  pfjob->num_workers_running = pfjob->num_workers;
+  pfjob->num_workers_waiting = 0;
 
-  BLI_threadpool_remove(&pfjob->threads, pfjob);
-  BLI_threadpool_insert(&pfjob->threads, pfjob);
+  /* Join threads of previous run, they have all finished by now. */
+  BLI_threadpool_clear(&pfjob->threads);
+  for (int i = 0; i < pfjob->num_workers; i++) {
+    BLI_threadpool_insert(&pfjob->threads, &pfjob->workers[i]);
+  }
 
   return pfjob;
 }
@@ -50,9 +50,12 @@
 #include "BLI_session_uuid.h"
 #include "BLI_string.h"
 #include "BLI_string_utf8.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
+#include "PIL_time.h"
+
 #ifdef WIN32
 #  include "BLI_winstuff.h"
 #else
@@ -2239,6 +2242,160 @@ void BKE_sequencer_proxy_rebuild(SeqIndexBuildContext *context,
   }
 }
 
+/* Number of cores a movie proxy build keeps busy, decoding and encoding of the proxy sizes. */
+#define SEQ_PROXY_BUILD_THREADS_PER_MOVIE 4
+
+typedef struct SeqProxyBuildQueue {
+  ThreadMutex mutex;
+  LinkData *next_link;
+  int next_index;
+  int num_running;
+
+  /* Progress of every context in the queue. */
+  float *context_progress;
+  int tot_context;
+
+  short *stop;
+  short *do_update;
+} SeqProxyBuildQueue;
+
+static bool seq_proxy_build_is_movie(const LinkData *link)
+{
+  const SeqIndexBuildContext *context = link->data;
+  return context->seq->type == SEQ_TYPE_MOVIE;
+}
+
+static void seq_proxy_build_queue_progress(SeqProxyBuildQueue *build_queue, float *progress)
+{
+  float total = 0.0f;
+
+  for (int i = 0; i < build_queue->tot_context; i++) {
+    total += build_queue->context_progress[i];
+  }
+
+  *progress = total / build_queue->tot_context;
+  *build_queue->do_update = true;
+}
+
+static void *seq_proxy_build_movie_thread(void *build_queue_v)
+{
+  SeqProxyBuildQueue *build_queue = build_queue_v;
+
+  while (!*build_queue->stop && !G.is_break) {
+    BLI_mutex_lock(&build_queue->mutex);
+    while (build_queue->next_link && !seq_proxy_build_is_movie(build_queue->next_link)) {
+      build_queue->next_link = build_queue->next_link->next;
+      build_queue->next_index++;
+    }
+    LinkData *link = build_queue->next_link;
+    const int index = build_queue->next_index;
+    if (link) {
+      build_queue->next_link = link->next;
+      build_queue->next_index++;
+    }
+    BLI_mutex_unlock(&build_queue->mutex);
+
+    if (link == NULL) {
+      break;
+    }
+
+    BKE_sequencer_proxy_rebuild(link->data,
+                                build_queue->stop,
+                                build_queue->do_update,
+                                &build_queue->context_progress[index]);
+    build_queue->context_progress[index] = 1.0f;
+  }
+
+  BLI_mutex_lock(&build_queue->mutex);
+  build_queue->num_running--;
+  BLI_mutex_unlock(&build_queue->mutex);
+
+  return NULL;
+}
+
+/**
+ * Build all contexts of a queue filled by #BKE_sequencer_proxy_rebuild_context.
+ *
+ * Movies are decoded by their own index build context, so several of them are built at the same
+ * time, as many as the number of cores allows. Other strips are rendered through the sequencer
+ * and are built one after another on the calling thread.
+ */
+void BKE_sequencer_proxy_rebuild_queue(ListBase *queue,
+                                       short *stop,
+                                       short *do_update,
+                                       float *progress)
+{
+  SeqProxyBuildQueue build_queue;
+  ListBase threads;
+  int num_movies = 0;
+
+  memset(&build_queue, 0, sizeof(build_queue));
+  build_queue.tot_context = BLI_listbase_count(queue);
+  if (build_queue.tot_context == 0) {
+    return;
+  }
+
+  BLI_mutex_init(&build_queue.mutex);
+  build_queue.next_link = queue->first;
+  build_queue.context_progress = MEM_calloc_arrayN(
+      build_queue.tot_context, sizeof(float), "proxy build progress");
+  build_queue.stop = stop;
+  build_queue.do_update = do_update;
+
+  LISTBASE_FOREACH (LinkData *, link, queue) {
+    if (seq_proxy_build_is_movie(link)) {
+      num_movies++;
+    }
+  }
+
+  const int num_threads = min_ii(
+      num_movies, max_ii(1, BLI_system_thread_count() / SEQ_PROXY_BUILD_THREADS_PER_MOVIE));
+
+  if (num_threads > 0) {
+    build_queue.num_running = num_threads;
+    BLI_threadpool_init(&threads, seq_proxy_build_movie_thread, num_threads);
+    for (int i = 0; i < num_threads; i++) {
+      BLI_threadpool_insert(&threads, &build_queue);
+    }
+  }
+
+  int index = 0;
+  LISTBASE_FOREACH (LinkData *, link, queue) {
+    if (*stop || G.is_break) {
+      break;
+    }
+    if (!seq_proxy_build_is_movie(link)) {
+      BKE_sequencer_proxy_rebuild(
+          link->data, stop, do_update, &build_queue.context_progress[index]);
+      build_queue.context_progress[index] = 1.0f;
+      seq_proxy_build_queue_progress(&build_queue, progress);
+    }
+    index++;
+  }
+
+  if (num_threads > 0) {
+    while (true) {
+      BLI_mutex_lock(&build_queue.mutex);
+      const bool running = build_queue.num_running > 0;
+      BLI_mutex_unlock(&build_queue.mutex);
+
+      if (!running) {
+        break;
+      }
+
+      seq_proxy_build_queue_progress(&build_queue, progress);
+      PIL_sleep_ms(50);
+    }
+
+    BLI_threadpool_end(&threads);
+  }
+
+  seq_proxy_build_queue_progress(&build_queue, progress);
+
+  MEM_freeN(build_queue.context_progress);
+  BLI_mutex_end(&build_queue.mutex);
+}
+
 void BKE_sequencer_proxy_rebuild_finish(SeqIndexBuildContext *context, bool stop)
 {
   if (context->index_context) {
@@ -2476,91 +2633,52 @@ static void color_balance_float_float(StripColorBalance *cb_,
   }
 }
 
-typedef struct ColorBalanceInitData {
+/* Number of lines of the image processed by one task of threaded strip processing. */
+#define SEQ_LINES_PER_TASK 64
+
+typedef struct ColorBalanceThreadData {
   StripColorBalance *cb;
   ImBuf *ibuf;
   float mul;
   ImBuf *mask;
   bool make_float;
-} ColorBalanceInitData;
-
-typedef struct ColorBalanceThread {
-  StripColorBalance *cb;
-  float mul;
+} ColorBalanceThreadData;
 
-  int width, height;
-
-  unsigned char *rect, *mask_rect;
-  float *rect_float, *mask_rect_float;
-
-  bool make_float;
-} ColorBalanceThread;
-
-static void color_balance_init_handle(void *handle_v,
-                                      int start_line,
-                                      int tot_line,
-                                      void *init_data_v)
+static void color_balance_task(void *__restrict userdata,
+                               const int task_index,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  ColorBalanceThread *handle = (ColorBalanceThread *)handle_v;
-  ColorBalanceInitData *init_data = (ColorBalanceInitData *)init_data_v;
-  ImBuf *ibuf = init_data->ibuf;
-  ImBuf *mask = init_data->mask;
-
-  int offset = 4 * start_line * ibuf->x;
+  ColorBalanceThreadData *data = (ColorBalanceThreadData *)userdata;
+  ImBuf *ibuf = data->ibuf;
+  ImBuf *mask = data->mask;
+  const int start_line = task_index * SEQ_LINES_PER_TASK;
+  const int height = min_ii(SEQ_LINES_PER_TASK, ibuf->y - start_line);
+  const int width = ibuf->x;
+  const size_t offset = (size_t)4 * start_line * width;
 
-  memset(handle, 0, sizeof(ColorBalanceThread));
-
-  handle->cb = init_data->cb;
-  handle->mul = init_data->mul;
-  handle->width = ibuf->x;
-  handle->height = tot_line;
-  handle->make_float = init_data->make_float;
-
-  if (ibuf->rect) {
-    handle->rect = (unsigned char *)ibuf->rect + offset;
-  }
-
-  if (ibuf->rect_float) {
-    handle->rect_float = ibuf->rect_float + offset;
-  }
+  unsigned char *rect = ibuf->rect ? (unsigned char *)ibuf->rect + offset : NULL;
+  float *rect_float = ibuf->rect_float ? ibuf->rect_float + offset : NULL;
+  unsigned char *mask_rect = NULL;
+  float *mask_rect_float = NULL;
 
   if (mask) {
     if (mask->rect) {
-      handle->mask_rect = (unsigned char *)mask->rect + offset;
+      mask_rect = (unsigned char *)mask->rect + offset;
     }
-
     if (mask->rect_float) {
-      handle->mask_rect_float = mask->rect_float + offset;
+      mask_rect_float = mask->rect_float + offset;
     }
   }
-  else {
-    handle->mask_rect = NULL;
-    handle->mask_rect_float = NULL;
-  }
-}
-
-static void *color_balance_do_thread(void *thread_data_v)
-{
-  ColorBalanceThread *thread_data = (ColorBalanceThread *)thread_data_v;
-  StripColorBalance *cb = thread_data->cb;
-  int width = thread_data->width, height = thread_data->height;
-  unsigned char *rect = thread_data->rect;
-  unsigned char *mask_rect = thread_data->mask_rect;
-  float *rect_float = thread_data->rect_float;
-  float *mask_rect_float = thread_data->mask_rect_float;
-  float mul = thread_data->mul;
 
   if (rect_float) {
-    color_balance_float_float(cb, rect_float, mask_rect_float, width, height, mul);
+    color_balance_float_float(data->cb, rect_float, mask_rect_float, width, height, data->mul);
   }
-  else if (thread_data->make_float) {
-    color_balance_byte_float(cb, rect, rect_float, mask_rect, width, height, mul);
+  else if (data->make_float) {
+    color_balance_byte_float(data->cb, rect, rect_float, mask_rect, width, height, data->mul);
   }
   else {
-    color_balance_byte_byte(cb, rect, mask_rect, width, height, mul);
+    color_balance_byte_byte(data->cb, rect, mask_rect, width, height, data->mul);
   }
-
-  return NULL;
 }
 
 /**
@@ -2605,23 +2723,23 @@ ImBuf *BKE_sequencer_render_mask_input(const SeqRenderData *context,
 void BKE_sequencer_color_balance_apply(
     StripColorBalance *cb, ImBuf *ibuf, float mul, bool make_float, ImBuf *mask_input)
 {
-  ColorBalanceInitData init_data;
+  ColorBalanceThreadData data;
 
   if (!ibuf->rect_float && make_float) {
     imb_addrectfloatImBuf(ibuf);
   }
 
-  init_data.cb = cb;
-  init_data.ibuf = ibuf;
-  init_data.mul = mul;
-  init_data.make_float = make_float;
-  init_data.mask = mask_input;
+  data.cb = cb;
+  data.ibuf = ibuf;
+  data.mul = mul;
+  data.make_float = make_float;
+  data.mask = mask_input;
 
-  IMB_processor_apply_threaded(ibuf->y,
-                               sizeof(ColorBalanceThread),
-                               &init_data,
-                               color_balance_init_handle,
-                               color_balance_do_thread);
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = ibuf->y > SEQ_LINES_PER_TASK;
+  BLI_task_parallel_range(
+      0, divide_ceil_u(ibuf->y, SEQ_LINES_PER_TASK), &data, color_balance_task, &settings);
 
   /* color balance either happens on float buffer or byte buffer, but never on both,
    * free byte buffer if there's float buffer since float buffer would be used for
@@ -2822,7 +2940,7 @@ static ImBuf *input_preprocess(const SeqRenderData *context,
 
 /*********************** strip rendering functions  *************************/
 
-typedef struct RenderEffectInitData {
+typedef struct RenderEffectThreadData {
   struct SeqEffectHandle *sh;
   const SeqRenderData *context;
   Sequence *seq;
@@ -2830,59 +2948,27 @@ typedef struct RenderEffectInitData {
   ImBuf *ibuf1, *ibuf2, *ibuf3;
 
   ImBuf *out;
-} RenderEffectInitData;
+} RenderEffectThreadData;
 
-typedef struct RenderEffectThread {
-  struct SeqEffectHandle *sh;
-  const SeqRenderData *context;
-  Sequence *seq;
-  float cfra, facf0, facf1;
-  ImBuf *ibuf1, *ibuf2, *ibuf3;
-
-  ImBuf *out;
-  int start_line, tot_line;
-} RenderEffectThread;
-
-static void render_effect_execute_init_handle(void *handle_v,
-                                              int start_line,
-                                              int tot_line,
-                                              void *init_data_v)
-{
-  RenderEffectThread *handle = (RenderEffectThread *)handle_v;
-  RenderEffectInitData *init_data = (RenderEffectInitData *)init_data_v;
-
-  handle->sh = init_data->sh;
-  handle->context = init_data->context;
-  handle->seq = init_data->seq;
-  handle->cfra = init_data->cfra;
-  handle->facf0 = init_data->facf0;
-  handle->facf1 = init_data->facf1;
-  handle->ibuf1 = init_data->ibuf1;
-  handle->ibuf2 = init_data->ibuf2;
-  handle->ibuf3 = init_data->ibuf3;
-  handle->out = init_data->out;
-
-  handle->start_line = start_line;
-  handle->tot_line = tot_line;
-}
-
-static void *render_effect_execute_do_thread(void *thread_data_v)
-{
-  RenderEffectThread *thread_data = (RenderEffectThread *)thread_data_v;
-
-  thread_data->sh->execute_slice(thread_data->context,
-                                 thread_data->seq,
-                                 thread_data->cfra,
-                                 thread_data->facf0,
-                                 thread_data->facf1,
-                                 thread_data->ibuf1,
-                                 thread_data->ibuf2,
-                                 thread_data->ibuf3,
-                                 thread_data->start_line,
-                                 thread_data->tot_line,
-                                 thread_data->out);
+static void render_effect_execute_task(void *__restrict userdata,
+                                       const int task_index,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  RenderEffectThreadData *data = (RenderEffectThreadData *)userdata;
+  const int start_line = task_index * SEQ_LINES_PER_TASK;
+  const int tot_line = min_ii(SEQ_LINES_PER_TASK, data->out->y - start_line);
 
-  return NULL;
+  data->sh->execute_slice(data->context,
+                          data->seq,
+                          data->cfra,
+                          data->facf0,
+                          data->facf1,
+                          data->ibuf1,
+                          data->ibuf2,
+                          data->ibuf3,
+                          start_line,
+                          tot_line,
+                          data->out);
 }
 
 ImBuf *BKE_sequencer_effect_execute_threaded(struct SeqEffectHandle *sh,
@@ -2895,25 +2981,25 @@ ImBuf *BKE_sequencer_effect_execute_threaded(struct SeqEffectHandle *sh,
                                              ImBuf *ibuf2,
                                              ImBuf *ibuf3)
 {
-  RenderEffectInitData init_data;
+  RenderEffectThreadData data;
   ImBuf *out = sh->init_execution(context, ibuf1, ibuf2, ibuf3);
 
-  init_data.sh = sh;
-  init_data.context = context;
-  init_data.seq = seq;
-  init_data.cfra = cfra;
-  init_data.facf0 = facf0;
-  init_data.facf1 = facf1;
-  init_data.ibuf1 = ibuf1;
-  init_data.ibuf2 = ibuf2;
-  init_data.ibuf3 = ibuf3;
-  init_data.out = out;
-
-  IMB_processor_apply_threaded(out->y,
-                               sizeof(RenderEffectThread),
-                               &init_data,
-                               render_effect_execute_init_handle,
-                               render_effect_execute_do_thread);
+  data.sh = sh;
+  data.context = context;
+  data.seq = seq;
+  data.cfra = cfra;
+  data.facf0 = facf0;
+  data.facf1 = facf1;
+  data.ibuf1 = ibuf1;
+  data.ibuf2 = ibuf2;
+  data.ibuf3 = ibuf3;
+  data.out = out;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = out->y > SEQ_LINES_PER_TASK;
+  BLI_task_parallel_range(
+      0, divide_ceil_u(out->y, SEQ_LINES_PER_TASK), &data, render_effect_execute_task, &settings);
 
   return out;
 }
@@ -209,6 +209,9 @@ MINLINE unsigned short round_fl_to_ushort_clamp(float a);
 MINLINE int round_fl_to_int_clamp(float a);
 MINLINE unsigned int round_fl_to_uint_clamp(float a);
 
+MINLINE unsigned short float_to_half(float f);
+MINLINE float half_to_float(unsigned short h);
+
 MINLINE signed char round_db_to_char_clamp(double a);
 MINLINE unsigned char round_db_to_uchar_clamp(double a);
 MINLINE short round_db_to_short_clamp(double a);
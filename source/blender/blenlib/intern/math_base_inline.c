@@ -341,6 +341,70 @@ MINLINE signed char round_db_to_char_clamp(double a){
 #undef _round_clamp_fl_impl
 #undef _round_clamp_db_impl
 
+/* IEEE 754 half precision conversion, rounding to nearest even.
+ * Values out of range become infinity, NaN stays NaN. */
+MINLINE unsigned short float_to_half(float f)
+{
+  union {
+    float f;
+    unsigned int u;
+  } in, denorm_magic;
+  const unsigned int f32_infinity = 255u << 23;
+  const unsigned int f16_max = (127u + 16u) << 23;
+  unsigned short result;
+
+  in.f = f;
+  const unsigned int sign = in.u & 0x80000000u;
+  in.u ^= sign;
+
+  if (in.u >= f16_max) {
+    /* Infinity or NaN. */
+    result = (in.u > f32_infinity) ? 0x7e00 : 0x7c00;
+  }
+  else if (in.u < (113u << 23)) {
+    /* Denormal or zero, let the FPU do the rounding by adding a magic number. */
+    denorm_magic.u = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    in.f += denorm_magic.f;
+    result = (unsigned short)(in.u - denorm_magic.u);
+  }
+  else {
+    const unsigned int mant_odd = (in.u >> 13) & 1u;
+    /* Rebias the exponent and round. */
+    in.u += ((unsigned int)(15 - 127) << 23) + 0xfffu;
+    in.u += mant_odd;
+    result = (unsigned short)(in.u >> 13);
+  }
+
+  return result | (unsigned short)(sign >> 16);
+}
+
+MINLINE float half_to_float(unsigned short h)
+{
+  union {
+    float f;
+    unsigned int u;
+  } out, magic;
+  const unsigned int shifted_exp = 0x7c00u << 13;
+
+  out.u = (unsigned int)(h & 0x7fff) << 13;
+  const unsigned int exp = shifted_exp & out.u;
+  out.u += (127u - 15u) << 23;
+
+  if (exp == shifted_exp) {
+    /* Infinity or NaN. */
+    out.u += (128u - 16u) << 23;
+  }
+  else if (exp == 0) {
+    /* Denormal or zero, renormalize. */
+    magic.u = 113u << 23;
+    out.u += 1u << 23;
+    out.f -= magic.f;
+  }
+
+  out.u |= (unsigned int)(h & 0x8000) << 16;
+  return out.f;
+}
+
 /* integer division that rounds 0.5 up, particularly useful for color blending
  * with integers, to avoid gradual darkening when rounding down */
 MINLINE int divide_round_i(int a, int b)
@@ -113,3 +113,37 @@ TEST(math_base, Log2CeilU)
   EXPECT_EQ(log2_ceil_u(9), 4);
   EXPECT_EQ(log2_ceil_u(123456), 17);
 }
+
+TEST(math_base, HalfFloatRoundTrip)
+{
+  const float values[] = {0.0f, -0.0f, 1.0f, -2.5f, 0.333251953125f, 1024.0f, 65504.0f};
+  for (const float value : values) {
+    EXPECT_EQ(half_to_float(float_to_half(value)), value);
+  }
+
+  EXPECT_EQ(float_to_half(1.0f), 0x3c00);
+  EXPECT_EQ(float_to_half(-2.0f), 0xc000);
+  EXPECT_EQ(float_to_half(65504.0f), 0x7bff);
+
+  /* Smallest denormal. */
+  EXPECT_EQ(float_to_half(5.9604645e-08f), 0x0001);
+  EXPECT_FLOAT_EQ(half_to_float(0x0001), 5.9604645e-08f);
+
+  /* Out of range values become infinity, NaN is kept. */
+  EXPECT_EQ(float_to_half(1e6f), 0x7c00);
+  EXPECT_EQ(float_to_half(-1e6f), 0xfc00);
+  EXPECT_EQ(half_to_float(0x7c00), INFINITY);
+  EXPECT_TRUE(isnan(half_to_float(float_to_half(NAN))));
+}
+
+TEST(math_base, HalfFloatRounding)
+{
+  /* 1 + 2^-11 lies exactly between two halfs and rounds to even. */
+  EXPECT_EQ(float_to_half(1.00048828125f), 0x3c00);
+  /* 1 + 3 * 2^-11 rounds up to even. */
+  EXPECT_EQ(float_to_half(1.00146484375f), 0x3c02);
+  /* Relative error stays within half precision. */
+  for (float value = 0.001f; value < 60000.0f; value *= 1.37f) {
+    EXPECT_NEAR(half_to_float(float_to_half(value)), value, value * (1.0f / 2048.0f));
+  }
+}
@@ -267,4 +267,8 @@ class CompositorContext {
   {
     return (this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER) != 0;
   }
+  bool isHalfFloatBufferEnabled() const
+  {
+    return (this->getbNodeTree()->flag & NTREE_COM_HALF_FLOAT_BUFFER) != 0;
+  }
 };
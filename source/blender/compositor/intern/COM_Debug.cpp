@@ -38,6 +38,7 @@ extern "C" {
 #  include "COM_ExecutionGroup.h"
 #  include "COM_ExecutionSystem.h"
 #  include "COM_Node.h"
+#  include "COM_WorkScheduler.h"
 
 #  include "COM_ReadBufferOperation.h"
 #  include "COM_ViewerOperation.h"
@@ -88,6 +89,45 @@ void DebugInfo::execute_started(const ExecutionSystem *system)
   }
 }
 
+void DebugInfo::execute_finished(const ExecutionSystem *system)
+{
+  char str[256];
+  for (ExecutionSystem::Groups::const_iterator it = system->m_groups.begin();
+       it != system->m_groups.end();
+       ++it) {
+    const ExecutionGroup *group = *it;
+    if (group->m_chunksFinished == 0) {
+      continue;
+    }
+    group_stats(group, str, sizeof(str));
+    printf("Compositor group %p: %s\n", group, str);
+  }
+}
+
+int DebugInfo::group_stats(const ExecutionGroup *group, char *str, int maxlen)
+{
+  /* Occupancy is the fraction of the available CPU time that was spent executing chunks of the
+   * group between scheduling its first chunk and finishing its last chunk. */
+  const double wall_time = group->m_executionEndTime - group->m_executionStartTime;
+  const int num_threads = WorkScheduler::get_num_cpu_threads();
+  const double occupancy = (wall_time > 0.0 && num_threads > 0) ?
+                               group->m_chunksExecutionTime / (wall_time * num_threads) :
+                               0.0;
+  const double locality = (group->m_chunksWithPreferredThread > 0) ?
+                              (double)group->m_chunksOnPreferredThread /
+                                  group->m_chunksWithPreferredThread :
+                              1.0;
+
+  return snprintf(str,
+                  maxlen,
+                  "%u chunks, %.2f ms wall, %.2f ms busy, %.1f%% occupancy, %.1f%% local",
+                  group->m_chunksFinished,
+                  wall_time * 1000.0,
+                  group->m_chunksExecutionTime * 1000.0,
+                  occupancy * 100.0,
+                  locality * 100.0);
+}
+
 void DebugInfo::node_added(const Node *node)
 {
   m_node_names[node] = std::string(node->getbNode() ? node->getbNode()->name : "");
@@ -354,6 +394,11 @@ bool DebugInfo::graphviz_system(const ExecutionSystem *system, char *str, int ma
       len += snprintf(str + len, maxlen > len ? maxlen - len : 0, "color=black\r\n");
       len += snprintf(str + len, maxlen > len ? maxlen - len : 0, "fillcolor=chartreuse4\r\n");
     }
+    if (group->m_chunksFinished != 0) {
+      len += snprintf(str + len, maxlen > len ? maxlen - len : 0, "label=\"");
+      len += group_stats(group, str + len, maxlen > len ? maxlen - len : 0);
+      len += snprintf(str + len, maxlen > len ? maxlen - len : 0, "\"\r\n");
+    }
 
     for (ExecutionGroup::Operations::const_iterator it = group->m_operations.begin();
          it != group->m_operations.end();
@@ -507,6 +552,9 @@ void DebugInfo::convert_started()
 void DebugInfo::execute_started(const ExecutionSystem * /*system*/)
 {
 }
+void DebugInfo::execute_finished(const ExecutionSystem * /*system*/)
+{
+}
 void DebugInfo::node_added(const Node * /*node*/)
 {
 }
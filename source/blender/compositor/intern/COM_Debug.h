@@ -41,6 +41,7 @@ class DebugInfo {
 
   static void convert_started();
   static void execute_started(const ExecutionSystem *system);
+  static void execute_finished(const ExecutionSystem *system);
 
   static void node_added(const Node *node);
   static void node_to_operations(const Node *node);
@@ -66,6 +67,7 @@ class DebugInfo {
       const char *name, const char *color, const char *style, char *str, int maxlen);
   static int graphviz_legend(char *str, int maxlen);
   static bool graphviz_system(const ExecutionSystem *system, char *str, int maxlen);
+  static int group_stats(const ExecutionGroup *group, char *str, int maxlen);
 
  private:
   static int m_file_index;
@@ -29,6 +29,7 @@
 #include "COM_ExecutionSystem.h"
 #include "COM_ReadBufferOperation.h"
 #include "COM_ViewerOperation.h"
+#include "COM_WorkPackage.h"
 #include "COM_WorkScheduler.h"
 #include "COM_WriteBufferOperation.h"
 #include "COM_defines.h"
@@ -46,6 +47,7 @@ ExecutionGroup::ExecutionGroup()
   this->m_isOutput = false;
   this->m_complex = false;
   this->m_chunkExecutionStates = NULL;
+  this->m_chunkThreads = NULL;
   this->m_bTree = NULL;
   this->m_height = 0;
   this->m_width = 0;
@@ -59,6 +61,16 @@ ExecutionGroup::ExecutionGroup()
   this->m_chunksFinished = 0;
   BLI_rcti_init(&this->m_viewerBorder, 0, 0, 0, 0);
   this->m_executionStartTime = 0;
+  this->m_executionEndTime = 0;
+  this->m_chunksExecutionTime = 0;
+  this->m_chunksWithPreferredThread = 0;
+  this->m_chunksOnPreferredThread = 0;
+  BLI_spin_init(&this->m_statsLock);
+}
+
+ExecutionGroup::~ExecutionGroup()
+{
+  BLI_spin_end(&this->m_statsLock);
 }
 
 CompositorPriority ExecutionGroup::getRenderPriotrity()
@@ -124,18 +136,30 @@ void ExecutionGroup::initExecution()
   if (this->m_chunkExecutionStates != NULL) {
     MEM_freeN(this->m_chunkExecutionStates);
   }
+  if (this->m_chunkThreads != NULL) {
+    MEM_freeN(this->m_chunkThreads);
+  }
   unsigned int index;
   determineNumberOfChunks();
 
   this->m_chunkExecutionStates = NULL;
+  this->m_chunkThreads = NULL;
   if (this->m_numberOfChunks != 0) {
     this->m_chunkExecutionStates = (ChunkExecutionState *)MEM_mallocN(
         sizeof(ChunkExecutionState) * this->m_numberOfChunks, __func__);
+    this->m_chunkThreads = (int *)MEM_mallocN(sizeof(int) * this->m_numberOfChunks, __func__);
     for (index = 0; index < this->m_numberOfChunks; index++) {
       this->m_chunkExecutionStates[index] = COM_ES_NOT_SCHEDULED;
+      this->m_chunkThreads[index] = -1;
     }
   }
 
+  this->m_executionStartTime = 0;
+  this->m_executionEndTime = 0;
+  this->m_chunksExecutionTime = 0;
+  this->m_chunksWithPreferredThread = 0;
+  this->m_chunksOnPreferredThread = 0;
+
   unsigned int maxNumber = 0;
 
   for (index = 0; index < this->m_operations.size(); index++) {
@@ -156,6 +180,10 @@ void ExecutionGroup::deinitExecution()
     MEM_freeN(this->m_chunkExecutionStates);
     this->m_chunkExecutionStates = NULL;
   }
+  if (this->m_chunkThreads != NULL) {
+    MEM_freeN(this->m_chunkThreads);
+    this->m_chunkThreads = NULL;
+  }
   this->m_numberOfChunks = 0;
   this->m_numberOfXChunks = 0;
   this->m_numberOfYChunks = 0;
@@ -207,8 +235,6 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
   } /** \note Early break out. */
   unsigned int chunkNumber;
 
-  this->m_executionStartTime = PIL_check_seconds_timer();
-
   this->m_chunksFinished = 0;
   this->m_bTree = bTree;
   unsigned int index;
@@ -438,6 +464,26 @@ void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memo
   }
 }
 
+void ExecutionGroup::recordChunkExecution(const WorkPackage *work,
+                                          int threadId,
+                                          double startTime,
+                                          double endTime)
+{
+  const int preferredThread = work->getPreferredThread();
+
+  BLI_spin_lock(&this->m_statsLock);
+  this->m_chunkThreads[work->getChunkNumber()] = threadId;
+  this->m_chunksExecutionTime += endTime - startTime;
+  this->m_executionEndTime = max(this->m_executionEndTime, endTime);
+  if (preferredThread != -1) {
+    this->m_chunksWithPreferredThread++;
+    if (preferredThread == threadId) {
+      this->m_chunksOnPreferredThread++;
+    }
+  }
+  BLI_spin_unlock(&this->m_statsLock);
+}
+
 inline void ExecutionGroup::determineChunkRect(rcti *rect,
                                                const unsigned int xChunk,
                                                const unsigned int yChunk) const
@@ -481,15 +527,13 @@ MemoryBuffer *ExecutionGroup::allocateOutputBuffer(int /*chunkNumber*/, rcti *re
   return NULL;
 }
 
-bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area)
+void ExecutionGroup::determineChunksInArea(const rcti *area,
+                                           int *r_minxchunk,
+                                           int *r_maxxchunk,
+                                           int *r_minychunk,
+                                           int *r_maxychunk) const
 {
-  if (this->m_singleThreaded) {
-    return scheduleChunkWhenPossible(graph, 0, 0);
-  }
-  // find all chunks inside the rect
   // determine minxchunk, minychunk, maxxchunk, maxychunk where x and y are chunknumbers
-
-  int indexx, indexy;
   int minx = max_ii(area->xmin - m_viewerBorder.xmin, 0);
   int maxx = min_ii(area->xmax - m_viewerBorder.xmin, m_viewerBorder.xmax - m_viewerBorder.xmin);
   int miny = max_ii(area->ymin - m_viewerBorder.ymin, 0);
@@ -498,10 +542,21 @@ bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area
   int maxxchunk = (maxx + (int)m_chunkSize - 1) / (int)m_chunkSize;
   int minychunk = miny / (int)m_chunkSize;
   int maxychunk = (maxy + (int)m_chunkSize - 1) / (int)m_chunkSize;
-  minxchunk = max_ii(minxchunk, 0);
-  minychunk = max_ii(minychunk, 0);
-  maxxchunk = min_ii(maxxchunk, (int)m_numberOfXChunks);
-  maxychunk = min_ii(maxychunk, (int)m_numberOfYChunks);
+  *r_minxchunk = max_ii(minxchunk, 0);
+  *r_minychunk = max_ii(minychunk, 0);
+  *r_maxxchunk = min_ii(maxxchunk, (int)m_numberOfXChunks);
+  *r_maxychunk = min_ii(maxychunk, (int)m_numberOfYChunks);
+}
+
+bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area)
+{
+  if (this->m_singleThreaded) {
+    return scheduleChunkWhenPossible(graph, 0, 0);
+  }
+  // find all chunks inside the rect
+  int indexx, indexy;
+  int minxchunk, maxxchunk, minychunk, maxychunk;
+  determineChunksInArea(area, &minxchunk, &maxxchunk, &minychunk, &maxychunk);
 
   bool result = true;
   for (indexx = minxchunk; indexx < maxxchunk; indexx++) {
@@ -515,11 +570,66 @@ bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area
   return result;
 }
 
-bool ExecutionGroup::scheduleChunk(unsigned int chunkNumber)
+void ExecutionGroup::countChunkThreads(const rcti *area, vector<int> &threadCount)
+{
+  int minxchunk = 0, maxxchunk = 1, minychunk = 0, maxychunk = 1;
+  if (!this->m_singleThreaded) {
+    determineChunksInArea(area, &minxchunk, &maxxchunk, &minychunk, &maxychunk);
+  }
+
+  /* Chunks of the group may still be executing. */
+  BLI_spin_lock(&this->m_statsLock);
+  for (int indexy = minychunk; indexy < maxychunk; indexy++) {
+    for (int indexx = minxchunk; indexx < maxxchunk; indexx++) {
+      const int threadId = this->m_chunkThreads[indexy * this->m_numberOfXChunks + indexx];
+      if (threadId >= 0 && threadId < (int)threadCount.size()) {
+        threadCount[threadId]++;
+      }
+    }
+  }
+  BLI_spin_unlock(&this->m_statsLock);
+}
+
+int ExecutionGroup::determinePreferredThread(rcti *rect,
+                                             const vector<MemoryProxy *> &memoryProxies)
+{
+  if (this->m_cachedReadOperations.empty()) {
+    return -1;
+  }
+
+  vector<int> threadCount(WorkScheduler::get_num_cpu_threads(), 0);
+  rcti area;
+  for (unsigned int index = 0; index < this->m_cachedReadOperations.size(); index++) {
+    ReadBufferOperation *readOperation =
+        (ReadBufferOperation *)this->m_cachedReadOperations[index];
+    ExecutionGroup *group = memoryProxies[index]->getExecutor();
+    if (group->m_chunkThreads == NULL) {
+      continue;
+    }
+    BLI_rcti_init(&area, 0, 0, 0, 0);
+    determineDependingAreaOfInterest(rect, readOperation, &area);
+    group->countChunkThreads(&area, threadCount);
+  }
+
+  int preferredThread = -1;
+  int maxCount = 0;
+  for (unsigned int threadId = 0; threadId < threadCount.size(); threadId++) {
+    if (threadCount[threadId] > maxCount) {
+      maxCount = threadCount[threadId];
+      preferredThread = threadId;
+    }
+  }
+  return preferredThread;
+}
+
+bool ExecutionGroup::scheduleChunk(unsigned int chunkNumber, int preferredThread)
 {
   if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_NOT_SCHEDULED) {
+    if (this->m_executionStartTime == 0) {
+      this->m_executionStartTime = PIL_check_seconds_timer();
+    }
     this->m_chunkExecutionStates[chunkNumber] = COM_ES_SCHEDULED;
-    WorkScheduler::schedule(this, chunkNumber);
+    WorkScheduler::schedule(this, chunkNumber, preferredThread);
     return true;
   }
   return false;
@@ -573,7 +683,7 @@ bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChun
   }
 
   if (canBeExecuted) {
-    scheduleChunk(chunkNumber);
+    scheduleChunk(chunkNumber, determinePreferredThread(&rect, memoryProxies));
   }
 
   return false;
@@ -23,6 +23,7 @@
 #endif
 
 #include "BLI_rect.h"
+#include "BLI_threads.h"
 #include "COM_CompositorContext.h"
 #include "COM_Device.h"
 #include "COM_MemoryProxy.h"
@@ -36,6 +37,7 @@ class ExecutionSystem;
 class MemoryProxy;
 class ReadBufferOperation;
 class Device;
+class WorkPackage;
 
 /**
  * \brief the execution state of a chunk in an ExecutionGroup
@@ -158,6 +160,13 @@ class ExecutionGroup {
    */
   ChunkExecutionState *m_chunkExecutionStates;
 
+  /**
+   * \brief the CPU thread that executed the chunk, -1 when not executed on a CPUDevice.
+   * \note used to schedule depending chunks on the thread that still has the input in its cache.
+   * Written by the devices and read while scheduling, with m_statsLock held.
+   */
+  int *m_chunkThreads;
+
   /**
    * \brief indicator when this ExecutionGroup has valid Operations in its vector for Execution
    * \note When building the ExecutionGroup Operations are added via recursion.
@@ -177,10 +186,35 @@ class ExecutionGroup {
   rcti m_viewerBorder;
 
   /**
-   * \brief start time of execution
+   * \brief start time of execution, set when the first chunk is scheduled
    */
   double m_executionStartTime;
 
+  /**
+   * \brief time the last chunk of this ExecutionGroup finished
+   */
+  double m_executionEndTime;
+
+  /**
+   * \brief accumulated time the devices spent executing chunks of this ExecutionGroup
+   */
+  double m_chunksExecutionTime;
+
+  /**
+   * \brief number of chunks that were scheduled with a preferred CPU thread
+   */
+  unsigned int m_chunksWithPreferredThread;
+
+  /**
+   * \brief number of chunks that were executed by their preferred CPU thread
+   */
+  unsigned int m_chunksOnPreferredThread;
+
+  /**
+   * \brief protects the execution statistics and m_chunkThreads, they are updated by all devices
+   */
+  SpinLock m_statsLock;
+
   // methods
   /**
    * \brief check whether parameter operation can be added to the execution group
@@ -203,6 +237,15 @@ class ExecutionGroup {
    */
   void determineChunkRect(rcti *rect, const unsigned int xChunk, const unsigned int yChunk) const;
 
+  /**
+   * \brief Determine the range of chunks (inclusive min, exclusive max) covering an area.
+   */
+  void determineChunksInArea(const rcti *area,
+                             int *r_minxchunk,
+                             int *r_maxxchunk,
+                             int *r_minychunk,
+                             int *r_maxychunk) const;
+
   /**
    * \brief determine the number of chunks, based on the chunkSize, width and height.
    * \note The result are stored in the fields numberOfChunks, numberOfXChunks, numberOfYChunks
@@ -237,8 +280,25 @@ class ExecutionGroup {
   /**
    * \brief add a chunk to the WorkScheduler.
    * \param chunknumber:
+   * \param preferredThread: CPU thread that has the input data of the chunk in its cache
    */
-  bool scheduleChunk(unsigned int chunkNumber);
+  bool scheduleChunk(unsigned int chunkNumber, int preferredThread);
+
+  /**
+   * \brief determine the CPU thread that executed most of the input chunks of a chunk.
+   * \note all input chunks must be executed.
+   * \param rect: the rect of the chunk
+   * \param memoryProxies: the MemoryProxy's this ExecutionGroup depends on
+   * \return the thread index, or -1 when there is no preference
+   */
+  int determinePreferredThread(rcti *rect, const vector<MemoryProxy *> &memoryProxies);
+
+  /**
+   * \brief count per CPU thread how many chunks of an area it executed.
+   * \param area: the area, in the same space as the chunk rects
+   * \param threadCount: one counter per CPU thread
+   */
+  void countChunkThreads(const rcti *area, vector<int> &threadCount);
 
   /**
    * \brief determine the area of interest of a certain input area
@@ -254,6 +314,7 @@ class ExecutionGroup {
  public:
   // constructors
   ExecutionGroup();
+  ~ExecutionGroup();
 
   // methods
   /**
@@ -375,6 +436,19 @@ class ExecutionGroup {
    */
   void finalizeChunkExecution(int chunkNumber, MemoryBuffer **memoryBuffers);
 
+  /**
+   * \brief update the execution statistics after a chunk is executed by a device.
+   * \note this method is called from the device threads.
+   * \param work: the executed WorkPackage
+   * \param threadId: the CPU thread that executed the chunk, -1 for OpenCL devices
+   * \param startTime: time the execution of the chunk started
+   * \param endTime: time the execution of the chunk ended
+   */
+  void recordChunkExecution(const WorkPackage *work,
+                            int threadId,
+                            double startTime,
+                            double endTime);
+
   /**
    * \brief deinitExecution is called just after execution the whole graph.
    * \note It will release all needed resources
@@ -188,6 +188,8 @@ void ExecutionSystem::execute()
   WorkScheduler::finish();
   WorkScheduler::stop();
 
+  DebugInfo::execute_finished(this);
+
   editingtree->stats_draw(editingtree->sdh, TIP_("Compositing | De-initializing execution"));
   for (index = 0; index < this->m_operations.size(); index++) {
     NodeOperation *operation = this->m_operations[index];
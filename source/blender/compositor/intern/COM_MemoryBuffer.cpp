@@ -41,6 +41,21 @@ unsigned int MemoryBuffer::determineBufferSize()
   return getWidth() * getHeight();
 }
 
+void MemoryBuffer::allocateBuffer(bool use_half_float)
+{
+  const size_t num_values = (size_t)determineBufferSize() * this->m_num_channels;
+  if (use_half_float) {
+    this->m_buffer = NULL;
+    this->m_halfBuffer = (unsigned short *)MEM_mallocN_aligned(
+        sizeof(unsigned short) * num_values, 16, "COM_MemoryBuffer");
+  }
+  else {
+    this->m_buffer = (float *)MEM_mallocN_aligned(
+        sizeof(float) * num_values, 16, "COM_MemoryBuffer");
+    this->m_halfBuffer = NULL;
+  }
+}
+
 int MemoryBuffer::getWidth() const
 {
   return this->m_width;
@@ -58,8 +73,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, r
   this->m_memoryProxy = memoryProxy;
   this->m_chunkNumber = chunkNumber;
   this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
-  this->m_buffer = (float *)MEM_mallocN_aligned(
-      sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  allocateBuffer(memoryProxy->isHalfFloat());
   this->m_state = COM_MB_ALLOCATED;
   this->m_datatype = memoryProxy->getDataType();
 }
@@ -72,8 +86,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
   this->m_memoryProxy = memoryProxy;
   this->m_chunkNumber = -1;
   this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
-  this->m_buffer = (float *)MEM_mallocN_aligned(
-      sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  allocateBuffer(false);
   this->m_state = COM_MB_TEMPORARILY;
   this->m_datatype = memoryProxy->getDataType();
 }
@@ -86,30 +99,53 @@ MemoryBuffer::MemoryBuffer(DataType dataType, rcti *rect)
   this->m_memoryProxy = NULL;
   this->m_chunkNumber = -1;
   this->m_num_channels = determine_num_channels(dataType);
-  this->m_buffer = (float *)MEM_mallocN_aligned(
-      sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  allocateBuffer(false);
   this->m_state = COM_MB_TEMPORARILY;
   this->m_datatype = dataType;
 }
 MemoryBuffer *MemoryBuffer::duplicate()
 {
   MemoryBuffer *result = new MemoryBuffer(this->m_memoryProxy, &this->m_rect);
-  memcpy(result->m_buffer,
-         this->m_buffer,
-         this->determineBufferSize() * this->m_num_channels * sizeof(float));
+  if (this->m_halfBuffer) {
+    result->copyContentFrom(this);
+  }
+  else {
+    memcpy(result->m_buffer,
+           this->m_buffer,
+           this->determineBufferSize() * this->m_num_channels * sizeof(float));
+  }
   return result;
 }
 void MemoryBuffer::clear()
 {
-  memset(this->m_buffer, 0, this->determineBufferSize() * this->m_num_channels * sizeof(float));
+  if (this->m_halfBuffer) {
+    /* Positive zero is all bits zero for half floats as well. */
+    memset(this->m_halfBuffer,
+           0,
+           this->determineBufferSize() * this->m_num_channels * sizeof(unsigned short));
+  }
+  else {
+    memset(
+        this->m_buffer, 0, this->determineBufferSize() * this->m_num_channels * sizeof(float));
+  }
 }
 
 float MemoryBuffer::getMaximumValue()
 {
-  float result = this->m_buffer[0];
   const unsigned int size = this->determineBufferSize();
   unsigned int i;
 
+  if (this->m_halfBuffer) {
+    float result = half_to_float(this->m_halfBuffer[0]);
+    const unsigned short *hp_src = this->m_halfBuffer;
+    for (i = 0; i < size; i++, hp_src += this->m_num_channels) {
+      result = max_ff(result, half_to_float(*hp_src));
+    }
+    return result;
+  }
+
+  float result = this->m_buffer[0];
+
   const float *fp_src = this->m_buffer;
 
   for (i = 0; i < size; i++, fp_src += this->m_num_channels) {
@@ -147,6 +183,10 @@ MemoryBuffer::~MemoryBuffer()
     MEM_freeN(this->m_buffer);
     this->m_buffer = NULL;
   }
+  if (this->m_halfBuffer) {
+    MEM_freeN(this->m_halfBuffer);
+    this->m_halfBuffer = NULL;
+  }
 }
 
 void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
@@ -169,9 +209,31 @@ void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
                   this->m_num_channels;
     offset = ((otherY - this->m_rect.ymin) * this->m_width + minX - this->m_rect.xmin) *
              this->m_num_channels;
-    memcpy(&this->m_buffer[offset],
-           &otherBuffer->m_buffer[otherOffset],
-           (maxX - minX) * this->m_num_channels * sizeof(float));
+    const unsigned int num_values = (maxX - minX) * this->m_num_channels;
+    if (this->m_halfBuffer && otherBuffer->m_halfBuffer) {
+      memcpy(&this->m_halfBuffer[offset],
+             &otherBuffer->m_halfBuffer[otherOffset],
+             num_values * sizeof(unsigned short));
+    }
+    else if (this->m_halfBuffer) {
+      unsigned short *dst = &this->m_halfBuffer[offset];
+      const float *src = &otherBuffer->m_buffer[otherOffset];
+      for (unsigned int i = 0; i < num_values; i++) {
+        dst[i] = float_to_half(src[i]);
+      }
+    }
+    else if (otherBuffer->m_halfBuffer) {
+      float *dst = &this->m_buffer[offset];
+      const unsigned short *src = &otherBuffer->m_halfBuffer[otherOffset];
+      for (unsigned int i = 0; i < num_values; i++) {
+        dst[i] = half_to_float(src[i]);
+      }
+    }
+    else {
+      memcpy(&this->m_buffer[offset],
+             &otherBuffer->m_buffer[otherOffset],
+             num_values * sizeof(float));
+    }
   }
 }
 
@@ -181,7 +243,15 @@ void MemoryBuffer::writePixel(int x, int y, const float color[4])
       y < this->m_rect.ymax) {
     const int offset = (this->m_width * (y - this->m_rect.ymin) + x - this->m_rect.xmin) *
                        this->m_num_channels;
-    memcpy(&this->m_buffer[offset], color, sizeof(float) * this->m_num_channels);
+    if (this->m_halfBuffer) {
+      unsigned short *dst = &this->m_halfBuffer[offset];
+      for (unsigned int i = 0; i < this->m_num_channels; i++) {
+        dst[i] = float_to_half(color[i]);
+      }
+    }
+    else {
+      memcpy(&this->m_buffer[offset], color, sizeof(float) * this->m_num_channels);
+    }
   }
 }
 
@@ -191,10 +261,76 @@ void MemoryBuffer::addPixel(int x, int y, const float color[4])
       y < this->m_rect.ymax) {
     const int offset = (this->m_width * (y - this->m_rect.ymin) + x - this->m_rect.xmin) *
                        this->m_num_channels;
-    float *dst = &this->m_buffer[offset];
-    const float *src = color;
-    for (int i = 0; i < this->m_num_channels; i++, dst++, src++) {
-      *dst += *src;
+    if (this->m_halfBuffer) {
+      unsigned short *dst = &this->m_halfBuffer[offset];
+      for (unsigned int i = 0; i < this->m_num_channels; i++) {
+        dst[i] = float_to_half(half_to_float(dst[i]) + color[i]);
+      }
+    }
+    else {
+      float *dst = &this->m_buffer[offset];
+      const float *src = color;
+      for (int i = 0; i < this->m_num_channels; i++, dst++, src++) {
+        *dst += *src;
+      }
+    }
+  }
+}
+
+void MemoryBuffer::readBilinearHalf(float *result, float u, float v, bool wrap_x, bool wrap_y)
+{
+  /* Same sampling as BLI_bilinear_interpolation_wrap_fl, pixels outside are black. */
+  const int width = this->m_width;
+  const int height = this->m_height;
+  const int num_channels = this->m_num_channels;
+  int x1 = (int)floorf(u);
+  int x2 = (int)ceilf(u);
+  int y1 = (int)floorf(v);
+  int y2 = (int)ceilf(v);
+
+  if (wrap_x) {
+    if (x1 < 0) {
+      x1 = width - 1;
+    }
+    if (x2 >= width) {
+      x2 = 0;
+    }
+  }
+  else if (x2 < 0 || x1 >= width) {
+    copy_vn_fl(result, num_channels, 0.0f);
+    return;
+  }
+
+  if (wrap_y) {
+    if (y1 < 0) {
+      y1 = height - 1;
+    }
+    if (y2 >= height) {
+      y2 = 0;
+    }
+  }
+  else if (y2 < 0 || y1 >= height) {
+    copy_vn_fl(result, num_channels, 0.0f);
+    return;
+  }
+
+  const int xs[4] = {x1, x1, x2, x2};
+  const int ys[4] = {y1, y2, y1, y2};
+  const float a = u - floorf(u);
+  const float b = v - floorf(v);
+  const float weights[4] = {
+      (1.0f - a) * (1.0f - b), (1.0f - a) * b, a * (1.0f - b), a * b};
+
+  copy_vn_fl(result, num_channels, 0.0f);
+  for (int corner = 0; corner < 4; corner++) {
+    const int x = xs[corner];
+    const int y = ys[corner];
+    if (x < 0 || y < 0 || x > width - 1 || y > height - 1) {
+      continue;
+    }
+    const unsigned short *pixel = &this->m_halfBuffer[(width * y + x) * num_channels];
+    for (int i = 0; i < num_channels; i++) {
+      result[i] += weights[corner] * half_to_float(pixel[i]);
     }
   }
 }
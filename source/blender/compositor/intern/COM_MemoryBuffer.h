@@ -82,9 +82,16 @@ class MemoryBuffer {
 
   /**
    * \brief the actual float buffer/data
+   * \note NULL when the buffer uses half float storage
    */
   float *m_buffer;
 
+  /**
+   * \brief half float storage of the data, used instead of m_buffer to halve memory usage.
+   * \see MemoryProxy.setHalfFloat
+   */
+  unsigned short *m_halfBuffer;
+
   /**
    * \brief the number of channels of a single value in the buffer.
    * For value buffers this is 1, vector 3 and color 4
@@ -128,12 +135,23 @@ class MemoryBuffer {
     return this->m_num_channels;
   }
 
+  /**
+   * \brief does this MemoryBuffer store its data as half floats
+   * \note half float buffers can only be accessed with the read and write methods
+   */
+  bool isHalfFloat() const
+  {
+    return this->m_halfBuffer != NULL;
+  }
+
   /**
    * \brief get the data of this MemoryBuffer
    * \note buffer should already be available in memory
+   * \note not available for half float buffers
    */
   float *getBuffer()
   {
+    BLI_assert(this->m_halfBuffer == NULL);
     return this->m_buffer;
   }
 
@@ -245,8 +263,7 @@ class MemoryBuffer {
       int v = y;
       this->wrap_pixel(u, v, extend_x, extend_y);
       const int offset = (this->m_width * y + x) * this->m_num_channels;
-      float *buffer = &this->m_buffer[offset];
-      memcpy(result, buffer, sizeof(float) * this->m_num_channels);
+      readOffset(result, offset);
     }
   }
 
@@ -271,8 +288,7 @@ class MemoryBuffer {
     BLI_assert((int)(MEM_allocN_len(this->m_buffer) / sizeof(*this->m_buffer)) ==
                (int)(this->determineBufferSize() * COM_NUMBER_OF_CHANNELS));
 #endif
-    float *buffer = &this->m_buffer[offset];
-    memcpy(result, buffer, sizeof(float) * this->m_num_channels);
+    readOffset(result, offset);
   }
 
   void writePixel(int x, int y, const float color[4]);
@@ -291,6 +307,11 @@ class MemoryBuffer {
       copy_vn_fl(result, this->m_num_channels, 0.0f);
       return;
     }
+    if (this->m_halfBuffer) {
+      readBilinearHalf(
+          result, u, v, extend_x == COM_MB_REPEAT, extend_y == COM_MB_REPEAT);
+      return;
+    }
     BLI_bilinear_interpolation_wrap_fl(this->m_buffer,
                                        result,
                                        this->m_width,
@@ -352,6 +373,26 @@ class MemoryBuffer {
  private:
   unsigned int determineBufferSize();
 
+  void allocateBuffer(bool use_half_float);
+
+  /**
+   * \brief read a single pixel at an offset into the buffer, converting half floats.
+   */
+  inline void readOffset(float *result, int offset)
+  {
+    if (this->m_halfBuffer) {
+      const unsigned short *buffer = &this->m_halfBuffer[offset];
+      for (unsigned int i = 0; i < this->m_num_channels; i++) {
+        result[i] = half_to_float(buffer[i]);
+      }
+    }
+    else {
+      memcpy(result, &this->m_buffer[offset], sizeof(float) * this->m_num_channels);
+    }
+  }
+
+  void readBilinearHalf(float *result, float u, float v, bool wrap_x, bool wrap_y);
+
 #ifdef WITH_CXX_GUARDEDALLOC
   MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryBuffer")
 #endif
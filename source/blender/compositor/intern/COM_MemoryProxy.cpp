@@ -23,6 +23,7 @@ MemoryProxy::MemoryProxy(DataType datatype)
   this->m_writeBufferOperation = NULL;
   this->m_executor = NULL;
   this->m_datatype = datatype;
+  this->m_halfFloat = false;
 }
 
 void MemoryProxy::allocate(unsigned int width, unsigned int height)
@@ -64,6 +64,11 @@ class MemoryProxy {
    */
   DataType m_datatype;
 
+  /**
+   * \brief store the buffer as half floats
+   */
+  bool m_halfFloat;
+
  public:
   MemoryProxy(DataType type);
 
@@ -125,6 +130,21 @@ class MemoryProxy {
     return this->m_datatype;
   }
 
+  /**
+   * \brief store the allocated memory as half floats.
+   * \note only valid when all readers access the buffer through MemoryBuffer.read and
+   * MemoryBuffer.readBilinear, complex operations use the float data directly.
+   */
+  void setHalfFloat(bool halfFloat)
+  {
+    this->m_halfFloat = halfFloat;
+  }
+
+  inline bool isHalfFloat() const
+  {
+    return this->m_halfFloat;
+  }
+
 #ifdef WITH_CXX_GUARDEDALLOC
   MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryProxy")
 #endif
@@ -107,6 +107,9 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
   /* surround complex ops with read/write buffer */
   add_complex_operation_buffers();
 
+  /* use half float storage for buffers that are only sampled */
+  determine_buffer_storage();
+
   /* links not available from here on */
   /* XXX make m_links a local variable to avoid confusion! */
   m_links.clear();
@@ -543,7 +546,7 @@ void NodeOperationBuilder::add_output_buffers(NodeOperation *operation,
 
   /* if no write buffer operation exists yet, create a new one */
   if (!writeOperation) {
-    writeOperation = new WriteBufferOperation(operation->getOutputSocket()->getDataType());
+    writeOperation = new WriteBufferOperation(output->getDataType());
     writeOperation->setbNodeTree(m_context->getbNodeTree());
     addOperation(writeOperation);
 
@@ -559,8 +562,7 @@ void NodeOperationBuilder::add_output_buffers(NodeOperation *operation,
       continue; /* skip existing write op links */
     }
 
-    ReadBufferOperation *readoperation = new ReadBufferOperation(
-        operation->getOutputSocket()->getDataType());
+    ReadBufferOperation *readoperation = new ReadBufferOperation(output->getDataType());
     readoperation->setMemoryProxy(writeOperation->getMemoryProxy());
     addOperation(readoperation);
 
@@ -621,6 +623,33 @@ static void find_reachable_operations_recursive(Tags &reachable, NodeOperation *
   }
 }
 
+void NodeOperationBuilder::determine_buffer_storage()
+{
+  if (!m_context->isHalfFloatBufferEnabled()) {
+    return;
+  }
+
+  /* Complex and OpenCL operations access the float data of their input buffers directly,
+   * all other operations sample buffers through the MemoryBuffer read functions. */
+  std::set<MemoryProxy *> float_proxies;
+  for (Links::const_iterator it = m_links.begin(); it != m_links.end(); ++it) {
+    const Link &link = *it;
+    NodeOperation &from_op = link.from()->getOperation();
+    NodeOperation &to_op = link.to()->getOperation();
+    if (from_op.isReadBufferOperation() && (to_op.isComplex() || to_op.isOpenCL())) {
+      float_proxies.insert(((ReadBufferOperation &)from_op).getMemoryProxy());
+    }
+  }
+
+  for (Operations::const_iterator it = m_operations.begin(); it != m_operations.end(); ++it) {
+    NodeOperation *op = *it;
+    if (op->isWriteBufferOperation()) {
+      MemoryProxy *proxy = ((WriteBufferOperation *)op)->getMemoryProxy();
+      proxy->setHalfFloat(float_proxies.find(proxy) == float_proxies.end());
+    }
+  }
+}
+
 void NodeOperationBuilder::prune_operations()
 {
   Tags reachable;
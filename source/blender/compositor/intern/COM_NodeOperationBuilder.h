@@ -158,6 +158,9 @@ class NodeOperationBuilder {
   void add_input_buffers(NodeOperation *operation, NodeOperationInput *input);
   void add_output_buffers(NodeOperation *operation, NodeOperationOutput *output);
 
+  /** Choose half float storage for buffers that are only sampled, when enabled */
+  void determine_buffer_storage();
+
   /** Remove unreachable operations */
   void prune_operations();
 
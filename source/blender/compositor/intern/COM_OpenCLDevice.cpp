@@ -19,6 +19,8 @@
 #include "COM_OpenCLDevice.h"
 #include "COM_WorkScheduler.h"
 
+#include "PIL_time.h"
+
 typedef enum COM_VendorID { NVIDIA = 0x10DE, AMD = 0x1002 } COM_VendorID;
 const cl_image_format IMAGE_FORMAT_COLOR = {
     CL_RGBA,
@@ -69,8 +71,10 @@ void OpenCLDevice::execute(WorkPackage *work)
   MemoryBuffer **inputBuffers = executionGroup->getInputBuffersOpenCL(chunkNumber);
   MemoryBuffer *outputBuffer = executionGroup->allocateOutputBuffer(chunkNumber, &rect);
 
+  const double start_time = PIL_check_seconds_timer();
   executionGroup->getOutputOperation()->executeOpenCLRegion(
       this, &rect, chunkNumber, inputBuffers, outputBuffer);
+  executionGroup->recordChunkExecution(work, -1, start_time, PIL_check_seconds_timer());
 
   delete outputBuffer;
 
@@ -18,8 +18,9 @@
 
 #include "COM_WorkPackage.h"
 
-WorkPackage::WorkPackage(ExecutionGroup *group, unsigned int chunkNumber)
+WorkPackage::WorkPackage(ExecutionGroup *group, unsigned int chunkNumber, int preferredThread)
 {
   this->m_executionGroup = group;
   this->m_chunkNumber = chunkNumber;
+  this->m_preferredThread = preferredThread;
 }
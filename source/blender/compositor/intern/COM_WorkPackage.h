@@ -39,13 +39,19 @@ class WorkPackage {
    */
   unsigned int m_chunkNumber;
 
+  /**
+   * \brief CPU thread that computed most of the input chunks, -1 when there is no preference
+   */
+  int m_preferredThread;
+
  public:
   /**
    * constructor
    * \param group: the ExecutionGroup
    * \param chunkNumber: the number of the chunk
+   * \param preferredThread: the CPU thread that should execute the chunk when it is idle
    */
-  WorkPackage(ExecutionGroup *group, unsigned int chunkNumber);
+  WorkPackage(ExecutionGroup *group, unsigned int chunkNumber, int preferredThread = -1);
 
   /**
    * \brief get the ExecutionGroup
@@ -63,6 +69,15 @@ class WorkPackage {
     return this->m_chunkNumber;
   }
 
+  /**
+   * \brief get the CPU thread the chunk has affinity with
+   * \see ExecutionGroup.determinePreferredThread
+   */
+  int getPreferredThread() const
+  {
+    return this->m_preferredThread;
+  }
+
 #ifdef WITH_CXX_GUARDEDALLOC
   MEM_CXX_CLASS_ALLOC_FUNCS("COM:WorkPackage")
 #endif
@@ -16,6 +16,7 @@
  * Copyright 2011, Blender Foundation.
  */
 
+#include <deque>
 #include <list>
 #include <stdio.h>
 
@@ -29,6 +30,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_threads.h"
 #include "PIL_time.h"
 
@@ -52,8 +55,30 @@ static ThreadLocal(CPUDevice *) g_thread_device;
 /** \brief list of all thread for every CPUDevice in cpudevices a thread exists. */
 static ListBase g_cputhreads;
 static bool g_cpuInitialized = false;
-/** \brief all scheduled work for the cpu */
-static ThreadQueue *g_cpuqueue;
+
+/**
+ * \brief scheduled work of a single CPUDevice.
+ * The owning thread pops work from the front, idle threads steal work from the back.
+ */
+typedef struct CPUWorkQueue {
+  std::deque<WorkPackage *> packages;
+  SpinLock lock;
+} CPUWorkQueue;
+
+/** \brief all scheduled work for the cpu, one queue for every CPUDevice */
+static vector<CPUWorkQueue *> g_cpuqueues;
+/** \brief protects waiting for work and waiting for all work to be finished */
+static ThreadMutex g_cpumutex;
+static ThreadCondition g_cpu_work_condition;
+static ThreadCondition g_cpu_finished_condition;
+/** \brief number of work packages in the cpu queues */
+static int32_t g_cpu_num_queued;
+/** \brief number of work packages that are scheduled but not yet executed */
+static int32_t g_cpu_num_pending;
+static bool g_cpu_stopping;
+/** \brief queue to use for work without a preferred thread */
+static unsigned int g_cpu_next_queue;
+
 static ThreadQueue *g_gpuqueue;
 #  ifdef COM_OPENCL_ENABLED
 static cl_context g_context;
@@ -70,14 +95,93 @@ static bool g_openclInitialized = false;
 #endif
 
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+static void cpu_work_push(WorkPackage *package)
+{
+  const unsigned int num_queues = g_cpuqueues.size();
+  const int preferred_thread = package->getPreferredThread();
+  unsigned int index;
+  if (preferred_thread >= 0 && preferred_thread < (int)num_queues) {
+    index = preferred_thread;
+  }
+  else {
+    /* Only called from the thread executing the ExecutionGroups. */
+    index = g_cpu_next_queue++ % num_queues;
+  }
+
+  CPUWorkQueue *queue = g_cpuqueues[index];
+  atomic_add_and_fetch_int32(&g_cpu_num_pending, 1);
+  BLI_spin_lock(&queue->lock);
+  /* Count the package before it can be popped, so the count never drops below zero. Idle
+   * threads would otherwise not wait for work while it is negative. */
+  atomic_add_and_fetch_int32(&g_cpu_num_queued, 1);
+  queue->packages.push_back(package);
+  BLI_spin_unlock(&queue->lock);
+
+  BLI_mutex_lock(&g_cpumutex);
+  BLI_condition_notify_one(&g_cpu_work_condition);
+  BLI_mutex_unlock(&g_cpumutex);
+}
+
+static WorkPackage *cpu_work_pop(unsigned int index)
+{
+  WorkPackage *work = NULL;
+
+  /* First look at our own work, its input is most likely in our cache. */
+  CPUWorkQueue *queue = g_cpuqueues[index];
+  BLI_spin_lock(&queue->lock);
+  if (!queue->packages.empty()) {
+    work = queue->packages.front();
+    queue->packages.pop_front();
+  }
+  BLI_spin_unlock(&queue->lock);
+
+  /* Steal from the other threads, starting at our neighbor so idle threads spread out. */
+  const unsigned int num_queues = g_cpuqueues.size();
+  for (unsigned int offset = 1; work == NULL && offset < num_queues; offset++) {
+    CPUWorkQueue *victim = g_cpuqueues[(index + offset) % num_queues];
+    BLI_spin_lock(&victim->lock);
+    if (!victim->packages.empty()) {
+      work = victim->packages.back();
+      victim->packages.pop_back();
+    }
+    BLI_spin_unlock(&victim->lock);
+  }
+
+  if (work) {
+    atomic_sub_and_fetch_int32(&g_cpu_num_queued, 1);
+  }
+  return work;
+}
+
 void *WorkScheduler::thread_execute_cpu(void *data)
 {
   CPUDevice *device = (CPUDevice *)data;
   WorkPackage *work;
   BLI_thread_local_set(g_thread_device, device);
-  while ((work = (WorkPackage *)BLI_thread_queue_pop(g_cpuqueue))) {
+  while (true) {
+    work = cpu_work_pop(device->thread_id());
+    if (work == NULL) {
+      BLI_mutex_lock(&g_cpumutex);
+      while (g_cpu_num_queued == 0 && !g_cpu_stopping) {
+        BLI_condition_wait(&g_cpu_work_condition, &g_cpumutex);
+      }
+      /* Remaining work is still executed when stopping. */
+      const bool finished = g_cpu_num_queued == 0;
+      BLI_mutex_unlock(&g_cpumutex);
+      if (finished) {
+        break;
+      }
+      continue;
+    }
+
     device->execute(work);
     delete work;
+
+    if (atomic_sub_and_fetch_int32(&g_cpu_num_pending, 1) == 0) {
+      BLI_mutex_lock(&g_cpumutex);
+      BLI_condition_notify_all(&g_cpu_finished_condition);
+      BLI_mutex_unlock(&g_cpumutex);
+    }
   }
 
   return NULL;
@@ -97,9 +201,9 @@ void *WorkScheduler::thread_execute_gpu(void *data)
 }
 #endif
 
-void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
+void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber, int preferredThread)
 {
-  WorkPackage *package = new WorkPackage(group, chunkNumber);
+  WorkPackage *package = new WorkPackage(group, chunkNumber, preferredThread);
 #if COM_CURRENT_THREADING_MODEL == COM_TM_NOTHREAD
   CPUDevice device(0);
   device.execute(package);
@@ -110,10 +214,10 @@ void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
     BLI_thread_queue_push(g_gpuqueue, package);
   }
   else {
-    BLI_thread_queue_push(g_cpuqueue, package);
+    cpu_work_push(package);
   }
 #  else
-  BLI_thread_queue_push(g_cpuqueue, package);
+  cpu_work_push(package);
 #  endif
 #endif
 }
@@ -122,7 +226,18 @@ void WorkScheduler::start(CompositorContext &context)
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
   unsigned int index;
-  g_cpuqueue = BLI_thread_queue_init();
+  BLI_mutex_init(&g_cpumutex);
+  BLI_condition_init(&g_cpu_work_condition);
+  BLI_condition_init(&g_cpu_finished_condition);
+  g_cpu_num_queued = 0;
+  g_cpu_num_pending = 0;
+  g_cpu_stopping = false;
+  g_cpu_next_queue = 0;
+  for (index = 0; index < g_cpudevices.size(); index++) {
+    CPUWorkQueue *queue = new CPUWorkQueue();
+    BLI_spin_init(&queue->lock);
+    g_cpuqueues.push_back(queue);
+  }
   BLI_threadpool_init(&g_cputhreads, thread_execute_cpu, g_cpudevices.size());
   for (index = 0; index < g_cpudevices.size(); index++) {
     Device *device = g_cpudevices[index];
@@ -150,23 +265,32 @@ void WorkScheduler::finish()
 #  ifdef COM_OPENCL_ENABLED
   if (g_openclActive) {
     BLI_thread_queue_wait_finish(g_gpuqueue);
-    BLI_thread_queue_wait_finish(g_cpuqueue);
   }
-  else {
-    BLI_thread_queue_wait_finish(g_cpuqueue);
-  }
-#  else
-  BLI_thread_queue_wait_finish(cpuqueue);
 #  endif
+  BLI_mutex_lock(&g_cpumutex);
+  while (g_cpu_num_pending != 0) {
+    BLI_condition_wait(&g_cpu_finished_condition, &g_cpumutex);
+  }
+  BLI_mutex_unlock(&g_cpumutex);
 #endif
 }
 void WorkScheduler::stop()
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-  BLI_thread_queue_nowait(g_cpuqueue);
+  BLI_mutex_lock(&g_cpumutex);
+  g_cpu_stopping = true;
+  BLI_condition_notify_all(&g_cpu_work_condition);
+  BLI_mutex_unlock(&g_cpumutex);
   BLI_threadpool_end(&g_cputhreads);
-  BLI_thread_queue_free(g_cpuqueue);
-  g_cpuqueue = NULL;
+  while (!g_cpuqueues.empty()) {
+    CPUWorkQueue *queue = g_cpuqueues.back();
+    g_cpuqueues.pop_back();
+    BLI_spin_end(&queue->lock);
+    delete queue;
+  }
+  BLI_condition_end(&g_cpu_work_condition);
+  BLI_condition_end(&g_cpu_finished_condition);
+  BLI_mutex_end(&g_cpumutex);
 #  ifdef COM_OPENCL_ENABLED
   if (g_openclActive) {
     BLI_thread_queue_nowait(g_gpuqueue);
@@ -364,6 +488,15 @@ void WorkScheduler::deinitialize()
 #endif
 }
 
+int WorkScheduler::get_num_cpu_threads()
+{
+#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+  return g_cpudevices.size();
+#else
+  return 1;
+#endif
+}
+
 int WorkScheduler::current_thread_id()
 {
   CPUDevice *device = (CPUDevice *)BLI_thread_local_get(g_thread_device);
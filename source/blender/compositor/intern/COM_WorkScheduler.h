@@ -58,8 +58,11 @@ class WorkScheduler {
    * \see ExecutionGroup.execute
    * \param group: the execution group
    * \param chunkNumber: the number of the chunk in the group to be executed
+   * \param preferredThread: the CPU thread that executed most of the input chunks.
+   * The chunk is queued on that thread, other threads only steal it when they run out of work.
+   * -1 distributes the chunk round robin.
    */
-  static void schedule(ExecutionGroup *group, int chunkNumber);
+  static void schedule(ExecutionGroup *group, int chunkNumber, int preferredThread = -1);
 
   /**
    * \brief initialize the WorkScheduler
@@ -109,6 +112,11 @@ class WorkScheduler {
    */
   static bool hasGPUDevices();
 
+  /**
+   * \brief number of CPUDevices, thread ids of the CPUDevices are in the range [0, count)
+   */
+  static int get_num_cpu_threads();
+
   static int current_thread_id();
 
 #ifdef WITH_CXX_GUARDEDALLOC
@@ -17,6 +17,7 @@
  */
 
 #include "COM_ImageNode.h"
+#include "BKE_image.h"
 #include "BKE_node.h"
 #include "BLI_utildefines.h"
 #include "COM_ConvertOperation.h"
@@ -29,6 +30,8 @@
 #include "COM_SetValueOperation.h"
 #include "COM_SetVectorOperation.h"
 
+#include <vector>
+
 ImageNode::ImageNode(bNode *editorNode) : Node(editorNode)
 {
   /* pass */
@@ -93,6 +96,24 @@ void ImageNode::convertToOperations(NodeConverter &converter,
 
         is_multilayer_ok = true;
 
+        /* Read the passes of all linked outputs at once, instead of reading the file again for
+         * every output. */
+        std::vector<RenderPass *> used_passes;
+        LISTBASE_FOREACH (RenderPass *, used_pass, &rl->passes) {
+          for (index = 0; index < numberOfOutputs; index++) {
+            bNodeSocket *bnodeSocket = this->getOutputSocket(index)->getbNodeSocket();
+            NodeImageLayer *storage = (NodeImageLayer *)bnodeSocket->storage;
+            if ((bnodeSocket->flag & SOCK_IN_USE) && STREQ(storage->pass_name, used_pass->name)) {
+              used_passes.push_back(used_pass);
+              break;
+            }
+          }
+        }
+        if (!used_passes.empty()) {
+          BKE_image_multilayer_passes_ensure_loaded(
+              image, used_passes.data(), (int)used_passes.size());
+        }
+
         for (index = 0; index < numberOfOutputs; index++) {
           NodeOperation *operation = NULL;
           socket = this->getOutputSocket(index);
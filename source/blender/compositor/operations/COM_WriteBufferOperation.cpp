@@ -59,6 +59,10 @@ void WriteBufferOperation::deinitExecution()
 void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
 {
   MemoryBuffer *memoryBuffer = this->m_memoryProxy->getBuffer();
+  if (memoryBuffer->isHalfFloat()) {
+    executeRegionHalfFloat(memoryBuffer, rect);
+    return;
+  }
   float *buffer = memoryBuffer->getBuffer();
   const int num_channels = memoryBuffer->get_num_channels();
   if (this->m_input->isComplex()) {
@@ -108,6 +112,31 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/
   memoryBuffer->setCreatedState();
 }
 
+void WriteBufferOperation::executeRegionHalfFloat(MemoryBuffer *memoryBuffer, rcti *rect)
+{
+  void *data = this->m_input->isComplex() ? this->m_input->initializeTileData(rect) : NULL;
+  float color[4];
+  bool breaked = false;
+  for (int y = rect->ymin; y < rect->ymax && (!breaked); y++) {
+    for (int x = rect->xmin; x < rect->xmax; x++) {
+      if (this->m_input->isComplex()) {
+        this->m_input->read(color, x, y, data);
+      }
+      else {
+        this->m_input->readSampled(color, x, y, COM_PS_NEAREST);
+      }
+      memoryBuffer->writePixel(x, y, color);
+    }
+    if (isBraked()) {
+      breaked = true;
+    }
+  }
+  if (data) {
+    this->m_input->deinitializeTileData(rect, data);
+  }
+  memoryBuffer->setCreatedState();
+}
+
 void WriteBufferOperation::executeOpenCLRegion(OpenCLDevice *device,
                                                rcti * /*rect*/,
                                                unsigned int /*chunkNumber*/,
@@ -30,6 +30,8 @@ class WriteBufferOperation : public NodeOperation {
   bool m_single_value; /* single value stored in buffer */
   NodeOperation *m_input;
 
+  void executeRegionHalfFloat(MemoryBuffer *memoryBuffer, rcti *rect);
+
  public:
   WriteBufferOperation(DataType datatype);
   ~WriteBufferOperation();
@@ -0,0 +1,312 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+/* Headless compositor benchmarks.
+ *
+ * Every test builds a reference node tree on a synthetic float image and runs it through
+ * COM_execute(), the same entry point a render uses, then prints the time per frame and the peak
+ * memory used during execution. With the default flags the workload is small enough to run as
+ * part of the regular test suite; pass for example
+ *
+ *   blender_test --gtest_filter=compositor_benchmark.* --compositor_benchmark_width=1920
+ *                --compositor_benchmark_height=1080 --compositor_benchmark_frames=10
+ *                --compositor_benchmark_threads=8
+ *
+ * to get meaningful numbers. */
+
+#include <cfloat>
+
+#include "tests/blendfile_loading_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_image_types.h"
+#include "DNA_node_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_global.h"
+#include "BKE_image.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_node.h"
+#include "BKE_scene.h"
+
+#include "NOD_composite.h"
+
+#include "COM_compositor.h"
+
+#include "PIL_time.h"
+
+DEFINE_int32(compositor_benchmark_width, 640, "Width of the synthetic compositor input.");
+DEFINE_int32(compositor_benchmark_height, 360, "Height of the synthetic compositor input.");
+DEFINE_int32(compositor_benchmark_frames, 1, "Number of times each node tree is executed.");
+DEFINE_int32(compositor_benchmark_threads,
+             0,
+             "Number of compositor threads, 0 uses the number of system threads.");
+
+static int benchmark_test_break(void *UNUSED(handle))
+{
+  return false;
+}
+
+static void benchmark_progress(void *UNUSED(handle), float UNUSED(progress))
+{
+}
+
+static void benchmark_stats_draw(void *UNUSED(handle), const char *UNUSED(str))
+{
+}
+
+class compositor_benchmark : public BlendfileLoadingBaseTest {
+ protected:
+  Scene *scene = nullptr;
+  Image *image = nullptr;
+  bNodeTree *ntree = nullptr;
+
+  static void TearDownTestCase()
+  {
+    /* Stops the compositor threads, they are kept alive between executions otherwise. */
+    COM_deinitialize();
+    BlendfileLoadingBaseTest::TearDownTestCase();
+  }
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+
+    scene = BKE_scene_add(G.main, "Compositor Benchmark");
+    scene->r.xsch = FLAGS_compositor_benchmark_width;
+    scene->r.ysch = FLAGS_compositor_benchmark_height;
+    scene->r.size = 100;
+    if (FLAGS_compositor_benchmark_threads > 0) {
+      scene->r.mode |= R_FIXED_THREADS;
+      scene->r.threads = FLAGS_compositor_benchmark_threads;
+    }
+    else {
+      scene->r.mode &= ~R_FIXED_THREADS;
+    }
+
+    /* A float buffer is what an EXR sequence ends up as once loaded, so the compositor sees the
+     * same input without the benchmark depending on files or on file IO speed. */
+    const float color[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    image = BKE_image_add_generated(G.main,
+                                    FLAGS_compositor_benchmark_width,
+                                    FLAGS_compositor_benchmark_height,
+                                    "Benchmark Input",
+                                    32,
+                                    true,
+                                    IMA_GENTYPE_GRID_COLOR,
+                                    color,
+                                    false,
+                                    false,
+                                    false);
+
+    scene->use_nodes = true;
+    scene->nodetree = ntreeAddTree(nullptr, "Compositing Nodetree", ntreeType_Composite->idname);
+    ntree = scene->nodetree;
+    ntree->test_break = benchmark_test_break;
+    ntree->progress = benchmark_progress;
+    ntree->stats_draw = benchmark_stats_draw;
+  }
+
+  void TearDown() override
+  {
+    /* Also frees the embedded compositing node tree. */
+    BKE_id_delete(G.main, scene);
+    BKE_id_delete(G.main, image);
+    scene = nullptr;
+    image = nullptr;
+    ntree = nullptr;
+
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  bNode *add_node(int type)
+  {
+    bNode *node = nodeAddStaticNode(nullptr, ntree, type);
+    EXPECT_NE(node, nullptr);
+    return node;
+  }
+
+  bNode *add_input_node()
+  {
+    bNode *node = add_node(CMP_NODE_IMAGE);
+    node->id = &image->id;
+    id_us_plus(&image->id);
+    nodeUpdate(ntree, node);
+    return node;
+  }
+
+  bNode *add_output_node(bNode *from, const char *from_identifier)
+  {
+    bNode *node = add_node(CMP_NODE_COMPOSITE);
+    link(from, from_identifier, node, "Image");
+    return node;
+  }
+
+  void link(bNode *from, const char *from_identifier, bNode *to, const char *to_identifier)
+  {
+    bNodeSocket *from_sock = nodeFindSocket(from, SOCK_OUT, from_identifier);
+    bNodeSocket *to_sock = nodeFindSocket(to, SOCK_IN, to_identifier);
+    ASSERT_NE(from_sock, nullptr);
+    ASSERT_NE(to_sock, nullptr);
+    nodeAddLink(ntree, from, from_sock, to, to_sock);
+  }
+
+  /* Executes the node tree as a render would and reports timing and memory statistics. */
+  void run(const char *name)
+  {
+    ntreeUpdateTree(G.main, ntree);
+
+    const int frames = max_ii(FLAGS_compositor_benchmark_frames, 1);
+    double total_time = 0.0;
+    double best_time = DBL_MAX;
+    size_t peak_memory = 0;
+
+    for (int frame = 0; frame < frames; frame++) {
+      const size_t memory_before = MEM_get_memory_in_use();
+      MEM_reset_peak_memory();
+
+      const double start_time = PIL_check_seconds_timer();
+      COM_execute(&scene->r,
+                  scene,
+                  ntree,
+                  true,
+                  &scene->view_settings,
+                  &scene->display_settings,
+                  "");
+      const double frame_time = PIL_check_seconds_timer() - start_time;
+
+      total_time += frame_time;
+      best_time = min_dd(best_time, frame_time);
+      peak_memory = max_zz(peak_memory, MEM_get_peak_memory() - memory_before);
+    }
+
+    printf("%s: %dx%d, %d frame(s), %d threads: "
+           "%.2f ms/frame (best %.2f ms), peak memory %.2f MB\n",
+           name,
+           FLAGS_compositor_benchmark_width,
+           FLAGS_compositor_benchmark_height,
+           frames,
+           BKE_render_num_threads(&scene->r),
+           total_time * 1000.0 / frames,
+           best_time * 1000.0,
+           peak_memory / (1024.0 * 1024.0));
+  }
+};
+
+TEST_F(compositor_benchmark, blur_chain)
+{
+  const short filter_types[] = {R_FILTER_GAUSS, R_FILTER_FAST_GAUSS, R_FILTER_TENT, R_FILTER_BOX};
+
+  bNode *prev = add_input_node();
+  for (int i = 0; i < ARRAY_SIZE(filter_types); i++) {
+    bNode *blur = add_node(CMP_NODE_BLUR);
+    NodeBlurData *data = (NodeBlurData *)blur->storage;
+    data->filtertype = filter_types[i];
+    data->sizex = data->sizey = 8 * (i + 1);
+    link(prev, "Image", blur, "Image");
+    prev = blur;
+  }
+  add_output_node(prev, "Image");
+
+  run("blur_chain");
+}
+
+TEST_F(compositor_benchmark, defocus)
+{
+  bNode *input = add_input_node();
+  bNode *separate = add_node(CMP_NODE_SEPRGBA);
+  bNode *defocus = add_node(CMP_NODE_DEFOCUS);
+  NodeDefocus *data = (NodeDefocus *)defocus->storage;
+  data->maxblur = 32.0f;
+  data->scale = 32.0f;
+
+  /* Use the red channel of the grid as blur radius, so the kernel size varies over the image. */
+  link(input, "Image", separate, "Image");
+  link(input, "Image", defocus, "Image");
+  link(separate, "R", defocus, "Z");
+  add_output_node(defocus, "Image");
+
+  run("defocus");
+}
+
+TEST_F(compositor_benchmark, keying)
+{
+  bNode *input = add_input_node();
+  bNode *keying = add_node(CMP_NODE_KEYING);
+
+  bNodeSocket *key_color = nodeFindSocket(keying, SOCK_IN, "Key Color");
+  ASSERT_NE(key_color, nullptr);
+  const float green[4] = {0.0f, 1.0f, 0.0f, 1.0f};
+  copy_v4_v4(((bNodeSocketValueRGBA *)key_color->default_value)->value, green);
+
+  NodeKeyingData *data = (NodeKeyingData *)keying->storage;
+  data->blur_pre = 4;
+  data->blur_post = 4;
+  data->dilate_distance = 2;
+  data->feather_distance = 2;
+
+  link(input, "Image", keying, "Image");
+  add_output_node(keying, "Image");
+
+  run("keying");
+}
+
+TEST_F(compositor_benchmark, glare)
+{
+  bNode *input = add_input_node();
+  bNode *streaks = add_node(CMP_NODE_GLARE);
+  bNode *fog_glow = add_node(CMP_NODE_GLARE);
+
+  NodeGlare *streaks_data = (NodeGlare *)streaks->storage;
+  streaks_data->threshold = 0.5f;
+  NodeGlare *fog_glow_data = (NodeGlare *)fog_glow->storage;
+  fog_glow_data->type = 1;
+  fog_glow_data->threshold = 0.5f;
+
+  link(input, "Image", streaks, "Image");
+  link(streaks, "Image", fog_glow, "Image");
+  add_output_node(fog_glow, "Image");
+
+  run("glare");
+}
+
+TEST_F(compositor_benchmark, cryptomatte)
+{
+  bNode *input = add_input_node();
+  bNode *cryptomatte = add_node(CMP_NODE_CRYPTOMATTE);
+
+  /* Select a few object id's, the synthetic layers hold arbitrary values so only the cost of the
+   * lookup matters here. */
+  NodeCryptomatte *data = (NodeCryptomatte *)cryptomatte->storage;
+  data->matte_id = BLI_strdup("<0.25>, <0.5>, <0.75>, Suzanne");
+
+  /* The image itself and all crypto layers are fed from the same input. */
+  LISTBASE_FOREACH (bNodeSocket *, sock, &cryptomatte->inputs) {
+    link(input, "Image", cryptomatte, sock->identifier);
+  }
+  add_output_node(cryptomatte, "Matte");
+
+  run("cryptomatte");
+}
@@ -42,6 +42,7 @@
 #include "BLI_fileops_types.h"
 #include "BLI_fnmatch.h"
 #include "BLI_ghash.h"
+#include "BLI_heap.h"
 #include "BLI_linklist.h"
 #include "BLI_math.h"
 #include "BLI_stack.h"
@@ -254,6 +255,11 @@ typedef struct FileListEntryCache {
   /* Previews handling. */
   TaskPool *previews_pool;
   ThreadQueue *previews_done;
+  /* Previews waiting to be generated, closest to the visible center first.
+   * Shared by the worker tasks, protected by previews_todo_lock. */
+  Heap *previews_todo;
+  ThreadMutex previews_todo_lock;
+  int previews_workers;
 } FileListEntryCache;
 
 /* FileListCache.flags */
@@ -269,12 +275,6 @@ typedef struct FileListEntryPreview {
   ImBuf *img;
 } FileListEntryPreview;
 
-/* Dummy wrapper around FileListEntryPreview to ensure we do not access freed memory when freeing
- * tasks' data (see T74609). */
-typedef struct FileListEntryPreviewTaskData {
-  FileListEntryPreview *preview;
-} FileListEntryPreviewTaskData;
-
 typedef struct FileListFilter {
   uint64_t filter;
   uint64_t filter_id;
@@ -1273,15 +1273,19 @@ static void filelist_intern_free(FileListIntern *filelist_intern)
   MEM_SAFE_FREE(filelist_intern->filtered);
 }
 
-static void filelist_cache_preview_runf(TaskPool *__restrict pool, void *taskdata)
+static void filelist_cache_preview_free(void *preview_v)
 {
-  FileListEntryCache *cache = BLI_task_pool_user_data(pool);
-  FileListEntryPreviewTaskData *preview_taskdata = taskdata;
-  FileListEntryPreview *preview = preview_taskdata->preview;
+  FileListEntryPreview *preview = preview_v;
 
-  ThumbSource source = 0;
+  if (preview->img) {
+    IMB_freeImBuf(preview->img);
+  }
+  MEM_freeN(preview);
+}
 
-  //  printf("%s: Start (%d)...\n", __func__, threadid);
+static void filelist_cache_preview_generate(FileListEntryPreview *preview)
+{
+  ThumbSource source = 0;
 
   //  printf("%s: %d - %s - %p\n", __func__, preview->index, preview->path, preview->img);
   BLI_assert(preview->flags &
@@ -1305,28 +1309,39 @@ static void filelist_cache_preview_runf(TaskPool *__restrict pool, void *taskdat
   IMB_thumb_path_lock(preview->path);
   preview->img = IMB_thumb_manage(preview->path, THB_LARGE, source);
   IMB_thumb_path_unlock(preview->path);
-
-  /* That way task freeing function won't free th preview, since it does not own it anymore. */
-  atomic_cas_ptr((void **)&preview_taskdata->preview, preview, NULL);
-  BLI_thread_queue_push(cache->previews_done, preview);
-
-  //  printf("%s: End (%d)...\n", __func__, threadid);
 }
 
-static void filelist_cache_preview_freef(TaskPool *__restrict UNUSED(pool), void *taskdata)
+/* Worker task, generates previews from the shared todo heap until it is empty. Popping from the
+ * heap instead of having one task per preview means previews closest to the visible center are
+ * always done first, and re-prioritizing after scrolling does not need to wait for (or throw
+ * away) previews which are being generated. */
+static void filelist_cache_preview_runf(TaskPool *__restrict pool, void *UNUSED(taskdata))
 {
-  FileListEntryPreviewTaskData *preview_taskdata = taskdata;
-  FileListEntryPreview *preview = preview_taskdata->preview;
+  FileListEntryCache *cache = BLI_task_pool_user_data(pool);
 
-  /* preview_taskdata->preview is atomically set to NULL once preview has been processed and sent
-   * to previews_done queue. */
-  if (preview != NULL) {
-    if (preview->img) {
-      IMB_freeImBuf(preview->img);
+  //  printf("%s: Start (%d)...\n", __func__, threadid);
+
+  while (true) {
+    FileListEntryPreview *preview = NULL;
+
+    BLI_mutex_lock(&cache->previews_todo_lock);
+    if (!BLI_task_pool_canceled(pool) && !BLI_heap_is_empty(cache->previews_todo)) {
+      preview = BLI_heap_pop_min(cache->previews_todo);
     }
-    MEM_freeN(preview);
+    else {
+      cache->previews_workers--;
+    }
+    BLI_mutex_unlock(&cache->previews_todo_lock);
+
+    if (preview == NULL) {
+      break;
+    }
+
+    filelist_cache_preview_generate(preview);
+    BLI_thread_queue_push(cache->previews_done, preview);
   }
-  MEM_freeN(preview_taskdata);
+
+  //  printf("%s: End (%d)...\n", __func__, threadid);
 }
 
 static void filelist_cache_preview_ensure_running(FileListEntryCache *cache)
@@ -1334,24 +1349,38 @@ static void filelist_cache_preview_ensure_running(FileListEntryCache *cache)
   if (!cache->previews_pool) {
     cache->previews_pool = BLI_task_pool_create_background(cache, TASK_PRIORITY_LOW);
     cache->previews_done = BLI_thread_queue_init();
+    cache->previews_todo = BLI_heap_new();
+    BLI_mutex_init(&cache->previews_todo_lock);
+    cache->previews_workers = 0;
 
     IMB_thumb_locks_acquire();
   }
 }
 
+/* Forget about previews which are not being generated yet, they are pushed again in the order of
+ * the new visible range. Previews being generated are kept and will end up in previews_done. */
+static void filelist_cache_previews_todo_clear(FileListEntryCache *cache)
+{
+  if (cache->previews_pool) {
+    BLI_mutex_lock(&cache->previews_todo_lock);
+    BLI_heap_clear(cache->previews_todo, filelist_cache_preview_free);
+    BLI_mutex_unlock(&cache->previews_todo_lock);
+  }
+}
+
 static void filelist_cache_previews_clear(FileListEntryCache *cache)
 {
   if (cache->previews_pool) {
+    filelist_cache_previews_todo_clear(cache);
     BLI_task_pool_cancel(cache->previews_pool);
+    /* Workers which did not start yet are dropped without running. */
+    cache->previews_workers = 0;
 
     FileListEntryPreview *preview;
     while ((preview = BLI_thread_queue_pop_timeout(cache->previews_done, 0))) {
       // printf("%s: DONE %d - %s - %p\n", __func__, preview->index, preview->path,
       // preview->img);
-      if (preview->img) {
-        IMB_freeImBuf(preview->img);
-      }
-      MEM_freeN(preview);
+      filelist_cache_preview_free(preview);
     }
   }
 }
@@ -1365,8 +1394,11 @@ static void filelist_cache_previews_free(FileListEntryCache *cache)
 
     BLI_thread_queue_free(cache->previews_done);
     BLI_task_pool_free(cache->previews_pool);
+    BLI_heap_free(cache->previews_todo, filelist_cache_preview_free);
+    BLI_mutex_end(&cache->previews_todo_lock);
     cache->previews_pool = NULL;
     cache->previews_done = NULL;
+    cache->previews_todo = NULL;
 
     IMB_thumb_locks_release();
   }
@@ -1374,7 +1406,13 @@ static void filelist_cache_previews_free(FileListEntryCache *cache)
   cache->flags &= ~FLC_PREVIEWS_ACTIVE;
 }
 
-static void filelist_cache_previews_push(FileList *filelist, FileDirEntry *entry, const int index)
+/**
+ * Queue the preview of \a entry, previews with a lower \a priority are generated first.
+ */
+static void filelist_cache_previews_push(FileList *filelist,
+                                         FileDirEntry *entry,
+                                         const int index,
+                                         const int priority)
 {
   FileListEntryCache *cache = &filelist->filelist_cache;
 
@@ -1400,14 +1438,18 @@ static void filelist_cache_previews_push(FileList *filelist, FileDirEntry *entry
 
     filelist_cache_preview_ensure_running(cache);
 
-    FileListEntryPreviewTaskData *preview_taskdata = MEM_mallocN(sizeof(*preview_taskdata),
-                                                                 __func__);
-    preview_taskdata->preview = preview;
-    BLI_task_pool_push(cache->previews_pool,
-                       filelist_cache_preview_runf,
-                       preview_taskdata,
-                       true,
-                       filelist_cache_preview_freef);
+    bool add_worker = false;
+    BLI_mutex_lock(&cache->previews_todo_lock);
+    BLI_heap_insert(cache->previews_todo, (float)priority, preview);
+    if (cache->previews_workers < BLI_task_scheduler_num_threads()) {
+      cache->previews_workers++;
+      add_worker = true;
+    }
+    BLI_mutex_unlock(&cache->previews_todo_lock);
+
+    if (add_worker) {
+      BLI_task_pool_push(cache->previews_pool, filelist_cache_preview_runf, NULL, false, NULL);
+    }
   }
 }
 
@@ -1761,7 +1803,7 @@ static FileDirEntry *filelist_file_ex(struct FileList *filelist,
 
 #if 0 /* Actually no, only block cached entries should have preview imho. */
   if (cache->previews_pool) {
-    filelist_cache_previews_push(filelist, ret, index);
+    filelist_cache_previews_push(filelist, ret, index, 0);
   }
 #endif
 
@@ -1962,7 +2004,7 @@ bool filelist_file_cache_block(struct FileList *filelist, const int index)
        * entries at the end. */
       if (cache->flags & FLC_PREVIEWS_ACTIVE) {
         filelist_cache_previews_update(filelist);
-        filelist_cache_previews_clear(cache);
+        filelist_cache_previews_todo_clear(cache);
       }
 
       //          printf("\tpreview cleaned up...\n");
@@ -2075,9 +2117,9 @@ bool filelist_file_cache_block(struct FileList *filelist, const int index)
     }
   }
   else if ((cache->block_center_index != index) && (cache->flags & FLC_PREVIEWS_ACTIVE)) {
-    /* We try to always preview visible entries first, so 'restart' preview background task. */
+    /* We try to always preview visible entries first, so re-prioritize the waiting previews. */
     filelist_cache_previews_update(filelist);
-    filelist_cache_previews_clear(cache);
+    filelist_cache_previews_todo_clear(cache);
   }
 
   //  printf("Re-queueing previews...\n");
@@ -2087,11 +2129,11 @@ bool filelist_file_cache_block(struct FileList *filelist, const int index)
     for (i = 0; ((index + i) < end_index) || ((index - i) >= start_index); i++) {
       if ((index - i) >= start_index) {
         const int idx = (cache->block_cursor + (index - start_index) - i) % cache_size;
-        filelist_cache_previews_push(filelist, cache->block_entries[idx], index - i);
+        filelist_cache_previews_push(filelist, cache->block_entries[idx], index - i, i);
       }
       if ((index + i) < end_index) {
         const int idx = (cache->block_cursor + (index - start_index) + i) % cache_size;
-        filelist_cache_previews_push(filelist, cache->block_entries[idx], index + i);
+        filelist_cache_previews_push(filelist, cache->block_entries[idx], index + i, i);
       }
     }
   }
@@ -481,10 +481,16 @@ static void prepare(Render *re, ViewLayer *view_layer, Depsgraph *depsgraph)
     cout << endl;
   }
 
-  // set diffuse and z depth passes
+  // set diffuse and z depth passes, with Save Buffers they are read from the files
   RenderLayer *rl = RE_GetRenderLayer(re->result, view_layer->name);
   bool diffuse = false, z = false;
   for (RenderPass *rpass = (RenderPass *)rl->passes.first; rpass; rpass = rpass->next) {
+    if (!STREQ(rpass->name, RE_PASSNAME_DIFFUSE_COLOR) && !STREQ(rpass->name, RE_PASSNAME_Z)) {
+      continue;
+    }
+    if (!RE_RenderPassEnsureLoaded(re->result, rpass)) {
+      continue;
+    }
     if (STREQ(rpass->name, RE_PASSNAME_DIFFUSE_COLOR)) {
       controller->setPassDiffuse(rpass->rect, rpass->rectx, rpass->recty);
       diffuse = true;
@@ -122,6 +122,16 @@ struct ImBuf *IMB_testiffname(const char *filepath, int flags);
  */
 struct ImBuf *IMB_loadiffname(const char *filepath, int flags, char colorspace[IM_MAX_SPACE]);
 
+/**
+ *
+ * \attention Defined in readimage.c
+ */
+struct ImBuf *IMB_thumb_load_image(const char *filepath,
+                                   size_t max_thumb_size,
+                                   char colorspace[IM_MAX_SPACE],
+                                   size_t *r_width,
+                                   size_t *r_height);
+
 /**
  *
  * \attention Defined in allocimbuf.c
@@ -432,6 +442,10 @@ void IMB_tile_cache_params(int totthread, int maxmem);
 unsigned int *IMB_gettile(struct ImBuf *ibuf, int tx, int ty, int thread);
 void IMB_tiles_to_rect(struct ImBuf *ibuf);
 
+typedef void (*TileCacheFunc)(
+    void *custom_data, const unsigned int *rect, int x, int y, int w, int h, int stride);
+void IMB_tiles_foreach(struct ImBuf *ibuf, TileCacheFunc func, void *custom_data);
+
 /**
  *
  * \attention Defined in filter.c
@@ -450,6 +464,26 @@ struct ImBuf *IMB_onehalf(struct ImBuf *ibuf1);
  */
 bool IMB_scaleImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy);
 
+typedef enum eIMBScaleFilter {
+  /** Average of the covered pixels when shrinking, linear interpolation when enlarging. */
+  IMB_SCALE_FILTER_BOX = 0,
+  /** Triangle filter, widened when shrinking so it does not alias. */
+  IMB_SCALE_FILTER_BILINEAR = 1,
+  /** Mitchell-Netravali cubic, sharper than bilinear with little ringing. */
+  IMB_SCALE_FILTER_MITCHELL = 2,
+  /** Three lobe Lanczos, the sharpest, may ring around hard edges. */
+  IMB_SCALE_FILTER_LANCZOS = 3,
+} eIMBScaleFilter;
+
+/**
+ *
+ * \attention Defined in scaling.c
+ */
+bool IMB_scaleImBuf_ex(struct ImBuf *ibuf,
+                       unsigned int newx,
+                       unsigned int newy,
+                       eIMBScaleFilter filter);
+
 /**
  *
  * \attention Defined in scaling.c
@@ -751,6 +785,15 @@ void IMB_update_gpu_texture_sub(struct GPUTexture *tex,
                                 int h,
                                 bool use_high_bitdepth,
                                 bool use_premult);
+void IMB_update_gpu_texture_tiles(struct GPUTexture *tex,
+                                  struct ImBuf *ibuf,
+                                  int x,
+                                  int y,
+                                  int z,
+                                  int w,
+                                  int h,
+                                  bool use_high_bitdepth,
+                                  bool use_premult);
 
 /**
  *
@@ -40,6 +40,16 @@ typedef struct ImFileType {
                         int flags,
                         char colorspace[IM_MAX_SPACE]);
   struct ImBuf *(*load_filepath)(const char *filepath, int flags, char colorspace[IM_MAX_SPACE]);
+  /** Load a reduced image for thumbnails, at least \a max_thumb_size pixels large when the file
+   * allows for it, without decoding the full resolution. The size of the full image is
+   * returned in \a r_width and \a r_height. */
+  struct ImBuf *(*load_thumbnail)(const unsigned char *mem,
+                                  size_t size,
+                                  int flags,
+                                  size_t max_thumb_size,
+                                  char colorspace[IM_MAX_SPACE],
+                                  size_t *r_width,
+                                  size_t *r_height);
   int (*save)(struct ImBuf *ibuf, const char *filepath, int flags);
   void (*load_tile)(struct ImBuf *ibuf,
                     const unsigned char *mem,
@@ -109,6 +119,13 @@ struct ImBuf *imb_load_jpeg(const unsigned char *buffer,
                             size_t size,
                             int flags,
                             char colorspace[IM_MAX_SPACE]);
+struct ImBuf *imb_load_jpeg_thumbnail(const unsigned char *buffer,
+                                      size_t size,
+                                      int flags,
+                                      size_t max_thumb_size,
+                                      char colorspace[IM_MAX_SPACE],
+                                      size_t *r_width,
+                                      size_t *r_height);
 
 /* bmp */
 int imb_is_a_bmp(const unsigned char *buf);
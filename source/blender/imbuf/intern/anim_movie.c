@@ -74,8 +74,6 @@
 #include "IMB_metadata.h"
 
 #ifdef WITH_FFMPEG
-#  include "BKE_global.h" /* ENDIAN_ORDER */
-
 #  include <libavcodec/avcodec.h>
 #  include <libavformat/avformat.h>
 #  include <libavutil/rational.h>
@@ -573,6 +571,11 @@ static int startffmpeg(struct anim *anim)
 
   pCodecCtx->workaround_bugs = 1;
 
+  /* Let the decoder use all cores: frame threading where the codec supports it (H.264, ProRes,
+   * ...), slice threading otherwise. Same automatic thread count as used for encoding. */
+  pCodecCtx->thread_count = 0;
+  pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
   if (avcodec_open2(pCodecCtx, pCodec, NULL) < 0) {
     avformat_close_input(&pFormatCtx);
     return -1;
@@ -800,66 +803,19 @@ static void ffmpeg_postprocess(struct anim *anim)
                    anim->y);
   }
 
-  if (ENDIAN_ORDER == B_ENDIAN) {
-    int *dstStride = anim->pFrameRGB->linesize;
-    uint8_t **dst = anim->pFrameRGB->data;
-    const int dstStride2[4] = {dstStride[0], 0, 0, 0};
-    uint8_t *dst2[4] = {dst[0], 0, 0, 0};
-    int x, y, h, w;
-    unsigned char *bottom;
-    unsigned char *top;
-
-    sws_scale(anim->img_convert_ctx,
-              (const uint8_t *const *)input->data,
-              input->linesize,
-              0,
-              anim->y,
-              dst2,
-              dstStride2);
-
-    bottom = (unsigned char *)ibuf->rect;
-    top = bottom + ibuf->x * (ibuf->y - 1) * 4;
-
-    h = (ibuf->y + 1) / 2;
-    w = ibuf->x;
-
-    for (y = 0; y < h; y++) {
-      unsigned char tmp[4];
-      unsigned int *tmp_l = (unsigned int *)tmp;
-
-      for (x = 0; x < w; x++) {
-        tmp[0] = bottom[0];
-        tmp[1] = bottom[1];
-        tmp[2] = bottom[2];
-        tmp[3] = bottom[3];
-
-        bottom[0] = top[0];
-        bottom[1] = top[1];
-        bottom[2] = top[2];
-        bottom[3] = top[3];
-
-        *(unsigned int *)top = *tmp_l;
-
-        bottom += 4;
-        top += 4;
-      }
-      top -= 8 * w;
-    }
-  }
-  else {
-    int *dstStride = anim->pFrameRGB->linesize;
-    uint8_t **dst = anim->pFrameRGB->data;
-    const int dstStride2[4] = {-dstStride[0], 0, 0, 0};
-    uint8_t *dst2[4] = {dst[0] + (anim->y - 1) * dstStride[0], 0, 0, 0};
-
-    sws_scale(anim->img_convert_ctx,
-              (const uint8_t *const *)input->data,
-              input->linesize,
-              0,
-              anim->y,
-              dst2,
-              dstStride2);
-  }
+  /* ImBuf rows are stored bottom to top, let swscale write them in that order by starting at the
+   * last row with a negative stride, so no separate flip pass over the image is needed. */
+  const int dst_stride[4] = {-anim->pFrameRGB->linesize[0], 0, 0, 0};
+  uint8_t *dst_rows[4] = {
+      anim->pFrameRGB->data[0] + (anim->y - 1) * anim->pFrameRGB->linesize[0], 0, 0, 0};
+
+  sws_scale(anim->img_convert_ctx,
+            (const uint8_t *const *)input->data,
+            input->linesize,
+            0,
+            anim->y,
+            dst_rows,
+            dst_stride);
 
   if (need_aligned_ffmpeg_buffer(anim)) {
     uint8_t *src = anim->pFrameRGB->data[0];
@@ -257,7 +257,8 @@ void IMB_tile_cache_params(int totthread, int maxmem)
   totthread++;
 
   /* lazy initialize cache */
-  if (GLOBAL_CACHE.totthread == totthread && GLOBAL_CACHE.maxmem == maxmem) {
+  if (GLOBAL_CACHE.totthread == totthread &&
+      GLOBAL_CACHE.maxmem == (uintptr_t)maxmem * 1024 * 1024) {
     return;
   }
 
@@ -271,7 +272,7 @@ void IMB_tile_cache_params(int totthread, int maxmem)
   GLOBAL_CACHE.memarena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, "ImTileCache arena");
   BLI_memarena_use_calloc(GLOBAL_CACHE.memarena);
 
-  GLOBAL_CACHE.maxmem = maxmem * 1024 * 1024;
+  GLOBAL_CACHE.maxmem = (uintptr_t)maxmem * 1024 * 1024;
 
   GLOBAL_CACHE.totthread = totthread;
   for (a = 0; a < totthread; a++) {
@@ -312,6 +313,10 @@ static ImGlobalTile *imb_global_cache_get_tile(ImBuf *ibuf,
      * for the other thread to load the tile */
     gtile->refcount++;
 
+    /* keep the list in least recently used order, so the tail is unloaded first */
+    BLI_remlink(&GLOBAL_CACHE.tiles, gtile);
+    BLI_addhead(&GLOBAL_CACHE.tiles, gtile);
+
     BLI_mutex_unlock(&GLOBAL_CACHE.mutex);
 
     while (gtile->loading) {
@@ -439,12 +444,58 @@ unsigned int *IMB_gettile(ImBuf *ibuf, int tx, int ty, int thread)
   return imb_thread_cache_get_tile(&GLOBAL_CACHE.thread_cache[thread + 1], ibuf, tx, ty);
 }
 
+/* Calls func for each tile of a single mipmap level. Tiles are loaded through the global cache
+ * and can be unloaded again once func returns, so only the tiles that fit within the memory
+ * limit are kept in memory. */
+void IMB_tiles_foreach(ImBuf *ibuf, TileCacheFunc func, void *custom_data)
+{
+  ImGlobalTile *gtile;
+  int tx, ty, w, h;
+
+  for (ty = 0; ty < ibuf->ytiles; ty++) {
+    for (tx = 0; tx < ibuf->xtiles; tx++) {
+      /* acquire tile through cache, this assumes cache is initialized,
+       * which it is always now but it's a weak assumption ... */
+      gtile = imb_global_cache_get_tile(ibuf, tx, ty, NULL);
+
+      /* exception in tile width/height for tiles at end of image */
+      w = (tx == ibuf->xtiles - 1) ? ibuf->x - tx * ibuf->tilex : ibuf->tilex;
+      h = (ty == ibuf->ytiles - 1) ? ibuf->y - ty * ibuf->tiley : ibuf->tiley;
+
+      func(custom_data,
+           ibuf->tiles[ibuf->xtiles * ty + tx],
+           tx * ibuf->tilex,
+           ty * ibuf->tiley,
+           w,
+           h,
+           ibuf->tilex);
+
+      /* decrease refcount for tile again */
+      BLI_mutex_lock(&GLOBAL_CACHE.mutex);
+      gtile->refcount--;
+      BLI_mutex_unlock(&GLOBAL_CACHE.mutex);
+    }
+  }
+}
+
+static void imb_tile_to_rect(
+    void *custom_data, const unsigned int *rect, int x, int y, int w, int h, int stride)
+{
+  ImBuf *mipbuf = custom_data;
+  const unsigned int *from = rect;
+  unsigned int *to = mipbuf->rect + mipbuf->x * y + x;
+
+  for (int i = 0; i < h; i++) {
+    memcpy(to, from, sizeof(unsigned int) * w);
+    from += stride;
+    to += mipbuf->x;
+  }
+}
+
 void IMB_tiles_to_rect(ImBuf *ibuf)
 {
   ImBuf *mipbuf;
-  ImGlobalTile *gtile;
-  unsigned int *to, *from;
-  int a, tx, ty, y, w, h;
+  int a;
 
   for (a = 0; a < ibuf->miptot; a++) {
     mipbuf = IMB_getmipmap(ibuf, a);
@@ -461,32 +512,7 @@ void IMB_tiles_to_rect(ImBuf *ibuf)
       }
     }
 
-    for (ty = 0; ty < mipbuf->ytiles; ty++) {
-      for (tx = 0; tx < mipbuf->xtiles; tx++) {
-        /* acquire tile through cache, this assumes cache is initialized,
-         * which it is always now but it's a weak assumption ... */
-        gtile = imb_global_cache_get_tile(mipbuf, tx, ty, NULL);
-
-        /* setup pointers */
-        from = mipbuf->tiles[mipbuf->xtiles * ty + tx];
-        to = mipbuf->rect + mipbuf->x * ty * mipbuf->tiley + tx * mipbuf->tilex;
-
-        /* exception in tile width/height for tiles at end of image */
-        w = (tx == mipbuf->xtiles - 1) ? mipbuf->x - tx * mipbuf->tilex : mipbuf->tilex;
-        h = (ty == mipbuf->ytiles - 1) ? mipbuf->y - ty * mipbuf->tiley : mipbuf->tiley;
-
-        for (y = 0; y < h; y++) {
-          memcpy(to, from, sizeof(unsigned int) * w);
-          from += mipbuf->tilex;
-          to += mipbuf->x;
-        }
-
-        /* decrease refcount for tile again */
-        BLI_mutex_lock(&GLOBAL_CACHE.mutex);
-        gtile->refcount--;
-        BLI_mutex_unlock(&GLOBAL_CACHE.mutex);
-      }
-    }
+    IMB_tiles_foreach(mipbuf, imb_tile_to_rect, mipbuf);
   }
 }
 
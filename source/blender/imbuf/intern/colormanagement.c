@@ -27,6 +27,10 @@
 #include <math.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 #include "DNA_color_types.h"
 #include "DNA_image_types.h"
 #include "DNA_movieclip_types.h"
@@ -47,6 +51,7 @@
 #include "BLI_math_color.h"
 #include "BLI_rect.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_appdir.h"
@@ -99,10 +104,23 @@ static float imbuf_linear_srgb_to_xyz[3][3] = {{0.0f}};
  */
 static pthread_mutex_t processor_lock = BLI_MUTEX_INITIALIZER;
 
+/* Cache of byte buffer LUTs, most recently used first. Guarded by its own lock since baking uses
+ * pre-cached processors. */
+static ListBase global_byte_luts = {NULL, NULL};
+static pthread_mutex_t byte_lut_lock = BLI_MUTEX_INITIALIZER;
+
+static void colormanage_byte_lut_cache_free(void);
+
+/* Identifies the transform of a processor for the byte LUT cache, long enough for the look, view
+ * and display names plus exposure and gamma. */
+#define COLORMANAGE_BYTE_LUT_KEY_LEN (MAX_COLORSPACE_NAME * 6)
+
 typedef struct ColormanageProcessor {
   OCIO_ConstProcessorRcPtr *processor;
   CurveMapping *curve_mapping;
   bool is_data_result;
+  /* Empty when the transform can't be baked into a byte LUT (curve mapping is used). */
+  char byte_lut_key[COLORMANAGE_BYTE_LUT_KEY_LEN];
 } ColormanageProcessor;
 
 static struct global_glsl_state {
@@ -757,6 +775,8 @@ void colormanagement_exit(void)
   memset(&global_glsl_state, 0, sizeof(global_glsl_state));
   memset(&global_color_picking_state, 0, sizeof(global_color_picking_state));
 
+  colormanage_byte_lut_cache_free();
+
   colormanage_free_config();
 }
 
@@ -1480,12 +1500,315 @@ const float *IMB_colormangement_get_xyz_to_rgb()
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Byte Buffer LUT
+ *
+ * Transforming a byte buffer through OCIO converts every pixel to float, runs it through the CPU
+ * processor and converts it back. For byte input the result only depends on the 8 bit RGB value,
+ * so the transform is baked once into a 3D LUT and evaluated with tetrahedral interpolation.
+ * Baked LUTs are cached by transform, so sequencer playback and image editor redraws reuse them.
+ * \{ */
+
+/* Number of grid points along every axis of the LUT. */
+#define BYTE_LUT_SIZE 65
+/* Maximum number of LUTs kept in the cache, each of them takes about 4.4 MB. */
+#define BYTE_LUT_CACHE_MAX 4
+/* Smaller buffers are transformed exactly, baking would cost more than it saves. */
+#define BYTE_LUT_MIN_PIXELS (256 * 256)
+
+typedef struct ColormanageByteLUT {
+  struct ColormanageByteLUT *next, *prev;
+
+  /* Source color space followed by the processor key. */
+  char key[MAX_COLORSPACE_NAME + COLORMANAGE_BYTE_LUT_KEY_LEN];
+
+  int users;
+  bool is_cached;
+
+  /* RGBA grid points with red varying fastest, RGB is in the [0, 255] range. */
+  float *table;
+
+  /* Grid cell and position inside of the cell for every byte value. */
+  int cell[256];
+  float fac[256];
+} ColormanageByteLUT;
+
+typedef struct ByteLUTBakeData {
+  ColormanageProcessor *cm_processor;
+  const char *from_colorspace;
+  float *table;
+} ByteLUTBakeData;
+
+static void byte_lut_bake_slice(void *__restrict userdata,
+                                const int b,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ByteLUTBakeData *data = (ByteLUTBakeData *)userdata;
+  const int size = BYTE_LUT_SIZE;
+  float *slice = data->table + (size_t)b * size * size * 4;
+  float *point = slice;
+
+  for (int g = 0; g < size; g++) {
+    for (int r = 0; r < size; r++, point += 4) {
+      point[0] = (float)r / (size - 1);
+      point[1] = (float)g / (size - 1);
+      point[2] = (float)b / (size - 1);
+      point[3] = 1.0f;
+    }
+  }
+
+  /* Same steps as the exact transform of straight alpha byte pixels. */
+  if (data->from_colorspace != NULL) {
+    IMB_colormanagement_transform(
+        slice, size, size, 4, data->from_colorspace, global_role_scene_linear, false);
+  }
+  IMB_colormanagement_processor_apply(data->cm_processor, slice, size, size, 4, false);
+
+  point = slice;
+  for (int i = 0; i < size * size; i++, point += 4) {
+    point[0] = clamp_f(point[0], 0.0f, 1.0f) * 255.0f;
+    point[1] = clamp_f(point[1], 0.0f, 1.0f) * 255.0f;
+    point[2] = clamp_f(point[2], 0.0f, 1.0f) * 255.0f;
+    point[3] = 0.0f;
+  }
+}
+
+static void colormanage_byte_lut_bake(ColormanageByteLUT *lut,
+                                      ColormanageProcessor *cm_processor,
+                                      const char *from_colorspace)
+{
+  const int size = BYTE_LUT_SIZE;
+  ByteLUTBakeData data;
+
+  lut->table = MEM_mallocN_aligned(
+      sizeof(float[4]) * size * size * size, 16, "colormanage byte lut table");
+
+  data.cm_processor = cm_processor;
+  data.from_colorspace = from_colorspace;
+  data.table = lut->table;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, size, &data, byte_lut_bake_slice, &settings);
+
+  for (int v = 0; v < 256; v++) {
+    const float position = (float)v * (size - 1) / 255.0f;
+    const int cell = min_ii((int)position, size - 2);
+    lut->cell[v] = cell;
+    lut->fac[v] = position - (float)cell;
+  }
+}
+
+static void colormanage_byte_lut_free(ColormanageByteLUT *lut)
+{
+  MEM_freeN(lut->table);
+  MEM_freeN(lut);
+}
+
+static void colormanage_byte_lut_cache_free(void)
+{
+  ColormanageByteLUT *lut, *lut_next;
+
+  for (lut = global_byte_luts.first; lut; lut = lut_next) {
+    lut_next = lut->next;
+    BLI_assert(lut->users == 0);
+    colormanage_byte_lut_free(lut);
+  }
+
+  BLI_listbase_clear(&global_byte_luts);
+}
+
+/* Get LUT for the transform of the processor, applied to bytes in from_colorspace. NULL color
+ * space means bytes are passed to the processor as is. Returns NULL if the transform can't be
+ * baked. */
+static ColormanageByteLUT *colormanage_byte_lut_acquire(ColormanageProcessor *cm_processor,
+                                                        const char *from_colorspace)
+{
+  char key[MAX_COLORSPACE_NAME + COLORMANAGE_BYTE_LUT_KEY_LEN];
+  ColormanageByteLUT *lut;
+
+  if (cm_processor->byte_lut_key[0] == '\0') {
+    return NULL;
+  }
+
+  BLI_snprintf(key,
+               sizeof(key),
+               "%s|%s",
+               from_colorspace ? from_colorspace : "",
+               cm_processor->byte_lut_key);
+
+  BLI_mutex_lock(&byte_lut_lock);
+  lut = BLI_findstring(&global_byte_luts, key, offsetof(ColormanageByteLUT, key));
+  if (lut) {
+    /* Keep most recently used LUT first, the last one is evicted. */
+    BLI_remlink(&global_byte_luts, lut);
+    BLI_addhead(&global_byte_luts, lut);
+    lut->users++;
+  }
+  BLI_mutex_unlock(&byte_lut_lock);
+
+  if (lut) {
+    return lut;
+  }
+
+  /* Bake without holding the lock, baking runs parallel tasks and a thread waiting for the lock
+   * could be the one that has to run them. */
+  ColormanageByteLUT *lut_new = MEM_callocN(sizeof(ColormanageByteLUT), "colormanage byte lut");
+  STRNCPY(lut_new->key, key);
+  colormanage_byte_lut_bake(lut_new, cm_processor, from_colorspace);
+
+  BLI_mutex_lock(&byte_lut_lock);
+
+  /* Another thread may have baked the same LUT in the meantime. */
+  lut = BLI_findstring(&global_byte_luts, key, offsetof(ColormanageByteLUT, key));
+
+  if (lut) {
+    BLI_remlink(&global_byte_luts, lut);
+    BLI_addhead(&global_byte_luts, lut);
+  }
+  else {
+    lut = lut_new;
+    lut_new = NULL;
+
+    lut->is_cached = true;
+    BLI_addhead(&global_byte_luts, lut);
+
+    if (BLI_listbase_count_at_most(&global_byte_luts, BYTE_LUT_CACHE_MAX + 1) >
+        BYTE_LUT_CACHE_MAX) {
+      ColormanageByteLUT *lut_last = global_byte_luts.last;
+
+      BLI_remlink(&global_byte_luts, lut_last);
+      lut_last->is_cached = false;
+
+      /* LUTs which are still used are freed on release. */
+      if (lut_last->users == 0) {
+        colormanage_byte_lut_free(lut_last);
+      }
+    }
+  }
+
+  lut->users++;
+
+  BLI_mutex_unlock(&byte_lut_lock);
+
+  if (lut_new) {
+    colormanage_byte_lut_free(lut_new);
+  }
+
+  return lut;
+}
+
+static void colormanage_byte_lut_release(ColormanageByteLUT *lut)
+{
+  bool do_free;
+
+  BLI_mutex_lock(&byte_lut_lock);
+  lut->users--;
+  do_free = (lut->users == 0 && !lut->is_cached);
+  BLI_mutex_unlock(&byte_lut_lock);
+
+  if (do_free) {
+    colormanage_byte_lut_free(lut);
+  }
+}
+
+BLI_INLINE void colormanage_byte_lut_evaluate(const ColormanageByteLUT *lut,
+                                              const unsigned char in[4],
+                                              unsigned char out[4])
+{
+  const int step_r = 4;
+  const int step_g = BYTE_LUT_SIZE * 4;
+  const int step_b = BYTE_LUT_SIZE * BYTE_LUT_SIZE * 4;
+
+  const float fr = lut->fac[in[0]];
+  const float fg = lut->fac[in[1]];
+  const float fb = lut->fac[in[2]];
+  const float *c0 = lut->table + lut->cell[in[0]] * step_r + lut->cell[in[1]] * step_g +
+                    lut->cell[in[2]] * step_b;
+  const float *c3 = c0 + step_r + step_g + step_b;
+  const float *c1, *c2;
+  float w0, w1, w2, w3;
+
+  /* Pick the tetrahedron of the cell which holds the point, it goes from the first corner to the
+   * opposite one along the axes sorted by position inside the cell. */
+  if (fr > fg) {
+    if (fg > fb) {
+      c1 = c0 + step_r;
+      c2 = c0 + step_r + step_g;
+      w0 = 1.0f - fr, w1 = fr - fg, w2 = fg - fb, w3 = fb;
+    }
+    else if (fr > fb) {
+      c1 = c0 + step_r;
+      c2 = c0 + step_r + step_b;
+      w0 = 1.0f - fr, w1 = fr - fb, w2 = fb - fg, w3 = fg;
+    }
+    else {
+      c1 = c0 + step_b;
+      c2 = c0 + step_r + step_b;
+      w0 = 1.0f - fb, w1 = fb - fr, w2 = fr - fg, w3 = fg;
+    }
+  }
+  else {
+    if (fb > fg) {
+      c1 = c0 + step_b;
+      c2 = c0 + step_g + step_b;
+      w0 = 1.0f - fb, w1 = fb - fg, w2 = fg - fr, w3 = fr;
+    }
+    else if (fb > fr) {
+      c1 = c0 + step_g;
+      c2 = c0 + step_g + step_b;
+      w0 = 1.0f - fg, w1 = fg - fb, w2 = fb - fr, w3 = fr;
+    }
+    else {
+      c1 = c0 + step_g;
+      c2 = c0 + step_r + step_g;
+      w0 = 1.0f - fg, w1 = fg - fr, w2 = fr - fb, w3 = fb;
+    }
+  }
+
+#ifdef __SSE2__
+  __m128 result = _mm_mul_ps(_mm_load_ps(c0), _mm_set1_ps(w0));
+  result = _mm_add_ps(result, _mm_mul_ps(_mm_load_ps(c1), _mm_set1_ps(w1)));
+  result = _mm_add_ps(result, _mm_mul_ps(_mm_load_ps(c2), _mm_set1_ps(w2)));
+  result = _mm_add_ps(result, _mm_mul_ps(_mm_load_ps(c3), _mm_set1_ps(w3)));
+
+  /* Values are in [0, 255] already, so rounding and packing is all what is left. */
+  __m128i result_i = _mm_cvttps_epi32(_mm_add_ps(result, _mm_set1_ps(0.5f)));
+  result_i = _mm_packs_epi32(result_i, result_i);
+  result_i = _mm_packus_epi16(result_i, result_i);
+  const int packed = _mm_cvtsi128_si32(result_i);
+
+  memcpy(out, &packed, 3);
+#else
+  for (int i = 0; i < 3; i++) {
+    const float value = c0[i] * w0 + c1[i] * w1 + c2[i] * w2 + c3[i] * w3;
+    out[i] = (unsigned char)(value + 0.5f);
+  }
+#endif
+
+  out[3] = in[3];
+}
+
+/* Transform RGBA byte pixels, in and out may point to the same buffer. Alpha is kept as is. */
+static void colormanage_byte_lut_apply(const ColormanageByteLUT *lut,
+                                       const unsigned char *in,
+                                       unsigned char *out,
+                                       size_t num_pixels)
+{
+  for (size_t i = 0; i < num_pixels; i++, in += 4, out += 4) {
+    colormanage_byte_lut_evaluate(lut, in, out);
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Threaded Display Buffer Transform Routines
  * \{ */
 
 typedef struct DisplayBufferThread {
   ColormanageProcessor *cm_processor;
+  const ColormanageByteLUT *byte_lut;
 
   const float *buffer;
   unsigned char *byte_buffer;
@@ -1509,6 +1832,7 @@ typedef struct DisplayBufferThread {
 typedef struct DisplayBufferInitData {
   ImBuf *ibuf;
   ColormanageProcessor *cm_processor;
+  const ColormanageByteLUT *byte_lut;
   const float *buffer;
   unsigned char *byte_buffer;
 
@@ -1540,6 +1864,7 @@ static void display_buffer_init_handle(void *handle_v,
   memset(handle, 0, sizeof(DisplayBufferThread));
 
   handle->cm_processor = init_data->cm_processor;
+  handle->byte_lut = init_data->byte_lut;
 
   if (init_data->buffer) {
     handle->buffer = init_data->buffer + offset;
@@ -1687,6 +2012,10 @@ static void *do_display_buffer_apply_thread(void *handle_v)
                                  width);
     }
   }
+  else if (handle->byte_lut) {
+    colormanage_byte_lut_apply(
+        handle->byte_lut, handle->byte_buffer, display_buffer_byte, ((size_t)width) * height);
+  }
   else {
     bool is_straight_alpha;
     float *linear_buffer = MEM_mallocN(((size_t)channels) * width * height * sizeof(float),
@@ -1777,11 +2106,27 @@ static void display_buffer_apply_threaded(ImBuf *ibuf,
     init_data.float_colorspace = NULL;
   }
 
+  /* Byte buffers which are only needed as display bytes are transformed with a LUT, unless
+   * dithering or data passes make the result depend on more than the pixel value. */
+  ColormanageByteLUT *byte_lut = NULL;
+  if (cm_processor && buffer == NULL && byte_buffer && display_buffer_byte &&
+      display_buffer == NULL && ibuf->channels == 4 && ibuf->dither == 0.0f &&
+      (ibuf->colormanage_flag & IMB_COLORMANAGE_IS_DATA) == 0 &&
+      cm_processor->is_data_result == false &&
+      ((size_t)ibuf->x) * ibuf->y >= BYTE_LUT_MIN_PIXELS) {
+    byte_lut = colormanage_byte_lut_acquire(cm_processor, init_data.byte_colorspace);
+  }
+  init_data.byte_lut = byte_lut;
+
   IMB_processor_apply_threaded(ibuf->y,
                                sizeof(DisplayBufferThread),
                                &init_data,
                                display_buffer_init_handle,
                                do_display_buffer_apply_thread);
+
+  if (byte_lut) {
+    colormanage_byte_lut_release(byte_lut);
+  }
 }
 
 static bool is_ibuf_rect_in_display_space(ImBuf *ibuf,
@@ -1858,6 +2203,7 @@ static void colormanage_display_buffer_process(ImBuf *ibuf,
 
 typedef struct ProcessorTransformThread {
   ColormanageProcessor *cm_processor;
+  const ColormanageByteLUT *byte_lut;
   unsigned char *byte_buffer;
   float *float_buffer;
   int width;
@@ -1870,6 +2216,7 @@ typedef struct ProcessorTransformThread {
 
 typedef struct ProcessorTransformInit {
   ColormanageProcessor *cm_processor;
+  const ColormanageByteLUT *byte_lut;
   unsigned char *byte_buffer;
   float *float_buffer;
   int width;
@@ -1897,6 +2244,7 @@ static void processor_transform_init_handle(void *handle_v,
   memset(handle, 0, sizeof(ProcessorTransformThread));
 
   handle->cm_processor = init_data->cm_processor;
+  handle->byte_lut = init_data->byte_lut;
 
   if (init_data->byte_buffer != NULL) {
     /* TODO(serge): Offset might be different for byte and float buffers. */
@@ -1942,7 +2290,11 @@ static void *do_processor_transform_thread(void *handle_v)
     IMB_premultiply_rect_float(float_buffer, 4, width, height);
   }
   else {
-    if (byte_buffer != NULL) {
+    if (handle->byte_lut != NULL) {
+      colormanage_byte_lut_apply(
+          handle->byte_lut, byte_buffer, byte_buffer, ((size_t)width) * height);
+    }
+    else if (byte_buffer != NULL) {
       IMB_colormanagement_processor_apply_byte(
           handle->cm_processor, byte_buffer, width, height, channels);
     }
@@ -1975,11 +2327,22 @@ static void processor_transform_apply_threaded(unsigned char *byte_buffer,
   init_data.predivide = predivide;
   init_data.float_from_byte = float_from_byte;
 
+  ColormanageByteLUT *byte_lut = NULL;
+  if (byte_buffer != NULL && float_buffer == NULL && float_from_byte == false && channels == 4 &&
+      ((size_t)width) * height >= BYTE_LUT_MIN_PIXELS) {
+    byte_lut = colormanage_byte_lut_acquire(cm_processor, NULL);
+  }
+  init_data.byte_lut = byte_lut;
+
   IMB_processor_apply_threaded(height,
                                sizeof(ProcessorTransformThread),
                                &init_data,
                                processor_transform_init_handle,
                                do_processor_transform_thread);
+
+  if (byte_lut) {
+    colormanage_byte_lut_release(byte_lut);
+  }
 }
 
 /** \} */
@@ -3851,6 +4214,16 @@ ColormanageProcessor *IMB_colormanagement_display_processor_new(
     cm_processor->curve_mapping = BKE_curvemapping_copy(applied_view_settings->curve_mapping);
     BKE_curvemapping_premultiply(cm_processor->curve_mapping, false);
   }
+  else {
+    BLI_snprintf(cm_processor->byte_lut_key,
+                 sizeof(cm_processor->byte_lut_key),
+                 "display|%s|%s|%s|%.9g|%.9g",
+                 applied_view_settings->look,
+                 applied_view_settings->view_transform,
+                 display_settings->display_device,
+                 applied_view_settings->exposure,
+                 applied_view_settings->gamma);
+  }
 
   return cm_processor;
 }
@@ -3868,6 +4241,12 @@ ColormanageProcessor *IMB_colormanagement_colorspace_processor_new(const char *f
 
   cm_processor->processor = create_colorspace_transform_processor(from_colorspace, to_colorspace);
 
+  BLI_snprintf(cm_processor->byte_lut_key,
+               sizeof(cm_processor->byte_lut_key),
+               "colorspace|%s|%s",
+               from_colorspace,
+               to_colorspace);
+
   return cm_processor;
 }
 
@@ -29,6 +29,7 @@
 #include "BLI_ghash.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #ifdef _WIN32
 #  include "BLI_winstuff.h"
@@ -774,6 +775,12 @@ static IndexBuildContext *index_ffmpeg_create_context(struct anim *anim,
 
   context->iCodecCtx->workaround_bugs = 1;
 
+  /* Frame threading delays decoded frames by a few packets, which breaks matching frames to the
+   * seek positions of the packets read so far. Only use it when no timecode is built. */
+  context->iCodecCtx->thread_count = 0;
+  context->iCodecCtx->thread_type = tcs_in_use ? FF_THREAD_SLICE :
+                                                 FF_THREAD_FRAME | FF_THREAD_SLICE;
+
   if (avcodec_open2(context->iCodecCtx, context->iCodec, NULL) < 0) {
     avformat_close_input(&context->iFormatCtx);
     MEM_freeN(context);
@@ -833,7 +840,16 @@ static void index_rebuild_ffmpeg_finish(FFmpegIndexBuilderContext *context, int
   MEM_freeN(context);
 }
 
+static void index_rebuild_ffmpeg_proxy_task(TaskPool *__restrict pool, void *taskdata)
+{
+  AVFrame *in_frame = BLI_task_pool_user_data(pool);
+  struct proxy_output_ctx *proxy_ctx = taskdata;
+
+  add_to_proxy_output_ffmpeg(proxy_ctx, in_frame);
+}
+
 static void index_rebuild_ffmpeg_proc_decoded_frame(FFmpegIndexBuilderContext *context,
+                                                    TaskPool *proxy_pool,
                                                     AVPacket *curr_packet,
                                                     AVFrame *in_frame)
 {
@@ -842,8 +858,21 @@ static void index_rebuild_ffmpeg_proc_decoded_frame(FFmpegIndexBuilderContext *c
   unsigned long long s_dts = context->seek_pos_dts;
   unsigned long long pts = av_get_pts_from_frame(context->iFormatCtx, in_frame);
 
-  for (i = 0; i < context->num_proxy_sizes; i++) {
-    add_to_proxy_output_ffmpeg(context->proxy_ctx[i], in_frame);
+  /* Every proxy size has its own encoder, scale and encode the frame for all of them at once.
+   * The decoder reuses the frame, so wait for them before decoding the next one. */
+  if (proxy_pool) {
+    for (i = 0; i < context->num_proxy_sizes; i++) {
+      if (context->proxy_ctx[i]) {
+        BLI_task_pool_push(
+            proxy_pool, index_rebuild_ffmpeg_proxy_task, context->proxy_ctx[i], false, NULL);
+      }
+    }
+    BLI_task_pool_work_and_wait(proxy_pool);
+  }
+  else {
+    for (i = 0; i < context->num_proxy_sizes; i++) {
+      add_to_proxy_output_ffmpeg(context->proxy_ctx[i], in_frame);
+    }
   }
 
   if (!context->start_pts_set) {
@@ -895,11 +924,22 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
   AVFrame *in_frame = 0;
   AVPacket next_packet;
   uint64_t stream_size;
+  TaskPool *proxy_pool = NULL;
+  int num_proxy_outputs = 0;
 
   memset(&next_packet, 0, sizeof(AVPacket));
 
   in_frame = av_frame_alloc();
 
+  for (int i = 0; i < context->num_proxy_sizes; i++) {
+    if (context->proxy_ctx[i]) {
+      num_proxy_outputs++;
+    }
+  }
+  if (num_proxy_outputs > 1) {
+    proxy_pool = BLI_task_pool_create(in_frame, TASK_PRIORITY_LOW);
+  }
+
   stream_size = avio_size(context->iFormatCtx->pb);
 
   context->frame_rate = av_q2d(av_guess_frame_rate(context->iFormatCtx, context->iStream, NULL));
@@ -933,7 +973,7 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
     }
 
     if (frame_finished) {
-      index_rebuild_ffmpeg_proc_decoded_frame(context, &next_packet, in_frame);
+      index_rebuild_ffmpeg_proc_decoded_frame(context, proxy_pool, &next_packet, in_frame);
     }
     av_free_packet(&next_packet);
   }
@@ -955,11 +995,15 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
       avcodec_decode_video2(context->iCodecCtx, in_frame, &frame_finished, &next_packet);
 
       if (frame_finished) {
-        index_rebuild_ffmpeg_proc_decoded_frame(context, &next_packet, in_frame);
+        index_rebuild_ffmpeg_proc_decoded_frame(context, proxy_pool, &next_packet, in_frame);
       }
     } while (frame_finished);
   }
 
+  if (proxy_pool) {
+    BLI_task_pool_free(proxy_pool);
+  }
+
   av_free(in_frame);
 
   return 1;
@@ -416,6 +416,10 @@ ImBuf *IMB_moviecache_get(MovieCache *cache, void *userkey)
     }
   }
 
+  BLI_mutex_lock(&limitor_lock);
+  MEM_CacheLimiter_miss(limitor);
+  BLI_mutex_unlock(&limitor_lock);
+
   return NULL;
 }
 
@@ -42,6 +42,7 @@
 #include <ImfInputFile.h>
 #include <ImfOutputFile.h>
 #include <ImfPixelType.h>
+#include <ImfPreviewImage.h>
 #include <ImfStandardAttributes.h>
 #include <ImfStringAttribute.h>
 #include <ImfVersion.h>
@@ -102,6 +103,7 @@ static bool exr_has_multiview(MultiPartInputFile &file);
 static bool exr_has_multipart_file(MultiPartInputFile &file);
 static bool exr_has_alpha(MultiPartInputFile &file);
 static bool exr_has_zbuffer(MultiPartInputFile &file);
+static bool imb_exr_is_multi(MultiPartInputFile &file);
 static void exr_printf(const char *__restrict fmt, ...);
 static void imb_exr_type_by_channels(ChannelList &channels,
                                      StringVector &views,
@@ -1089,16 +1091,23 @@ void IMB_exr_clear_channels(void *handle)
   BLI_freelistN(&data->channels);
 }
 
-void IMB_exr_write_channels(void *handle)
+/* Write rows [ymin, ymax) of the image, in Blender's bottom to top row order. The rect of every
+ * channel points to the first pixel of row ymin, so only these rows need to be in memory. Files
+ * are written from the top down: the first call must end at the image height and every next call
+ * continue where the previous one started. */
+void IMB_exr_write_channels_rows(void *handle, int ymin, int ymax)
 {
   ExrHandle *data = (ExrHandle *)handle;
   FrameBuffer frameBuffer;
   ExrChannel *echan;
 
   if (data->channels.first) {
-    const size_t num_pixels = ((size_t)data->width) * data->height;
+    const int num_rows = ymax - ymin;
+    const size_t num_pixels = ((size_t)data->width) * num_rows;
     half *rect_half = NULL, *current_rect_half = NULL;
 
+    BLI_assert(data->ofile->currentScanLine() == data->height - ymax);
+
     /* We allocate teporary storage for half pixels for all the channels at once. */
     if (data->num_half_channels != 0) {
       rect_half = (half *)MEM_mallocN(sizeof(half) * data->num_half_channels * num_pixels,
@@ -1107,21 +1116,25 @@ void IMB_exr_write_channels(void *handle)
     }
 
     for (echan = (ExrChannel *)data->channels.first; echan; echan = echan->next) {
-      /* Writing starts from last scanline, stride negative. */
+      /* Writing starts from last scanline, stride negative. Slices are addressed with file
+       * scanline numbers, which start at the top of the image. */
       if (echan->use_half_float) {
-        float *rect = echan->rect;
+        const size_t ystride = echan->ystride;
         half *cur = current_rect_half;
-        for (size_t i = 0; i < num_pixels; i++, cur++) {
-          *cur = rect[i * echan->xstride];
+        for (int y = 0; y < num_rows; y++) {
+          const float *rect = echan->rect + ystride * y;
+          for (int x = 0; x < data->width; x++, cur++) {
+            *cur = rect[(size_t)x * echan->xstride];
+          }
         }
-        half *rect_to_write = current_rect_half + (data->height - 1L) * data->width;
+        half *rect_to_write = current_rect_half + (data->height - 1L - ymin) * data->width;
         frameBuffer.insert(
             echan->name,
             Slice(Imf::HALF, (char *)rect_to_write, sizeof(half), -data->width * sizeof(half)));
         current_rect_half += num_pixels;
       }
       else {
-        float *rect = echan->rect + echan->xstride * (data->height - 1L) * data->width;
+        float *rect = echan->rect + echan->ystride * (data->height - 1L - ymin);
         frameBuffer.insert(echan->name,
                            Slice(Imf::FLOAT,
                                  (char *)rect,
@@ -1132,7 +1145,7 @@ void IMB_exr_write_channels(void *handle)
 
     data->ofile->setFrameBuffer(frameBuffer);
     try {
-      data->ofile->writePixels(data->height);
+      data->ofile->writePixels(num_rows);
     }
     catch (const std::exception &exc) {
       std::cerr << "OpenEXR-writePixels: ERROR: " << exc.what() << std::endl;
@@ -1147,6 +1160,12 @@ void IMB_exr_write_channels(void *handle)
   }
 }
 
+void IMB_exr_write_channels(void *handle)
+{
+  ExrHandle *data = (ExrHandle *)handle;
+  IMB_exr_write_channels_rows(data, 0, data->height);
+}
+
 /* temporary function, used for FSA and Save Buffers */
 /* called once per tile * view */
 void IMB_exrtile_write_channels(
@@ -1200,7 +1219,11 @@ void IMB_exrtile_write_channels(
   }
 }
 
-void IMB_exr_read_channels(void *handle)
+/* Read rows [ymin, ymax) of the image, in Blender's bottom to top row order, into the channels
+ * which have a rect set. The rect of every channel points to the first pixel of row ymin, so only
+ * these rows need to be in memory. Reading rows of tiled files decompresses the tiles covering
+ * them only. */
+void IMB_exr_read_channels_rows(void *handle, int ymin, int ymax)
 {
   ExrHandle *data = (ExrHandle *)handle;
   int numparts = data->ifile->parts();
@@ -1229,6 +1252,7 @@ void IMB_exr_read_channels(void *handle)
     /* Insert all matching channel into framebuffer. */
     FrameBuffer frameBuffer;
     ExrChannel *echan;
+    int num_slices = 0;
 
     for (echan = (ExrChannel *)data->channels.first; echan; echan = echan->next) {
       if (echan->m->part_number != i) {
@@ -1248,29 +1272,47 @@ void IMB_exr_read_channels(void *handle)
 
         if (!flip) {
           /* Inverse correct first pixel for data-window coordinates. */
-          rect -= echan->xstride * (dw.min.x - dw.min.y * data->width);
+          rect -= echan->xstride * dw.min.x - echan->ystride * dw.min.y;
           /* move to last scanline to flip to Blender convention */
-          rect += echan->xstride * (data->height - 1) * data->width;
+          rect += echan->ystride * (data->height - 1L - ymin);
           ystride = -ystride;
         }
         else {
           /* Inverse correct first pixel for data-window coordinates. */
-          rect -= echan->xstride * (dw.min.x + dw.min.y * data->width);
+          rect -= echan->xstride * dw.min.x + echan->ystride * (dw.min.y + (long)ymin);
         }
 
         frameBuffer.insert(echan->m->internal_name,
                            Slice(Imf::FLOAT, (char *)rect, xstride, ystride));
+        num_slices++;
       }
       else {
-        printf("warning, channel with no rect set %s\n", echan->m->internal_name.c_str());
+        /* Not requested, e.g. when only reading a single pass. */
+        exr_printf("channel with no rect set %s\n", echan->m->internal_name.c_str());
       }
     }
 
+    /* Don't decompress parts nobody asked for. */
+    if (num_slices == 0) {
+      continue;
+    }
+
+    /* Scanlines of the requested rows, in file order. */
+    int scan_min, scan_max;
+    if (!flip) {
+      scan_min = dw.min.y + (data->height - ymax);
+      scan_max = dw.min.y + (data->height - 1 - ymin);
+    }
+    else {
+      scan_min = dw.min.y + ymin;
+      scan_max = dw.min.y + ymax - 1;
+    }
+
     /* Read pixels. */
     try {
       in.setFrameBuffer(frameBuffer);
-      exr_printf("readPixels:readPixels[%d]: min.y: %d, max.y: %d\n", i, dw.min.y, dw.max.y);
-      in.readPixels(dw.min.y, dw.max.y);
+      exr_printf("readPixels:readPixels[%d]: min.y: %d, max.y: %d\n", i, scan_min, scan_max);
+      in.readPixels(scan_min, scan_max);
     }
     catch (const std::exception &exc) {
       std::cerr << "OpenEXR-readPixels: ERROR: " << exc.what() << std::endl;
@@ -1279,6 +1321,12 @@ void IMB_exr_read_channels(void *handle)
   }
 }
 
+void IMB_exr_read_channels(void *handle)
+{
+  ExrHandle *data = (ExrHandle *)handle;
+  IMB_exr_read_channels_rows(data, 0, data->height);
+}
+
 void IMB_exr_multilayer_convert(void *handle,
                                 void *base,
                                 void *(*addview)(void *base, const char *str),
@@ -1520,43 +1568,58 @@ static ExrPass *imb_exr_get_pass(ListBase *lb, char *passname)
   return pass;
 }
 
-/* creates channels, makes a hierarchy and assigns memory to channels */
-static ExrHandle *imb_exr_begin_read_mem(IStream &file_stream,
-                                         MultiPartInputFile &file,
-                                         int width,
-                                         int height)
+/* Offset of a channel in the interleaved buffer of its pass,
+ * so channels end up ordered as RGB(A), XYZ(W) or UVA. */
+static int imb_exr_pass_channel_offset(const ExrPass *pass, int a)
 {
-  ExrLayer *lay;
-  ExrPass *pass;
-  ExrChannel *echan;
-  ExrHandle *data = (ExrHandle *)IMB_exr_get_handle();
-  int a;
-  char layname[EXR_TOT_MAXNAME], passname[EXR_TOT_MAXNAME];
-
-  data->ifile_stream = &file_stream;
-  data->ifile = &file;
+  if (pass->totchan == 3 || pass->totchan == 4) {
+    char lookup[256];
 
-  data->width = width;
-  data->height = height;
+    memset(lookup, 0, sizeof(lookup));
 
-  std::vector<MultiViewChannelName> channels;
-  GetChannelsInMultiPartFile(*data->ifile, channels);
-
-  imb_exr_get_views(*data->ifile, *data->multiView);
+    if (pass->chan[0]->chan_id == 'B' || pass->chan[1]->chan_id == 'B' ||
+        pass->chan[2]->chan_id == 'B') {
+      lookup[(unsigned int)'R'] = 0;
+      lookup[(unsigned int)'G'] = 1;
+      lookup[(unsigned int)'B'] = 2;
+      lookup[(unsigned int)'A'] = 3;
+    }
+    else if (pass->chan[0]->chan_id == 'Y' || pass->chan[1]->chan_id == 'Y' ||
+             pass->chan[2]->chan_id == 'Y') {
+      lookup[(unsigned int)'X'] = 0;
+      lookup[(unsigned int)'Y'] = 1;
+      lookup[(unsigned int)'Z'] = 2;
+      lookup[(unsigned int)'W'] = 3;
+    }
+    else {
+      lookup[(unsigned int)'U'] = 0;
+      lookup[(unsigned int)'V'] = 1;
+      lookup[(unsigned int)'A'] = 2;
+    }
+    return lookup[(unsigned int)pass->chan[a]->chan_id];
+  }
 
-  for (size_t i = 0; i < channels.size(); i++) {
-    IMB_exr_add_channel(
-        data, NULL, channels[i].name.c_str(), channels[i].view.c_str(), 0, 0, NULL, false);
+  /* Single channel or unknown. */
+  return a;
+}
 
-    echan = (ExrChannel *)data->channels.last;
-    echan->m->name = channels[i].name;
-    echan->m->view = channels[i].view;
-    echan->m->part_number = channels[i].part_number;
-    echan->m->internal_name = channels[i].internal_name;
+/* Let the channels of a pass read into rect, or into nothing when rect is NULL. */
+static void imb_exr_pass_set_rect(ExrHandle *data, ExrPass *pass, float *rect)
+{
+  for (int a = 0; a < pass->totchan; a++) {
+    ExrChannel *echan = pass->chan[a];
+    echan->rect = rect ? rect + imb_exr_pass_channel_offset(pass, a) : NULL;
+    echan->xstride = pass->totchan;
+    echan->ystride = data->width * pass->totchan;
   }
+}
+
+/* Build the hierarchical layer list from the flat channel list, without allocating buffers. */
+static bool imb_exr_build_layers(ExrHandle *data)
+{
+  ExrChannel *echan;
+  char layname[EXR_TOT_MAXNAME], passname[EXR_TOT_MAXNAME];
 
-  /* now try to sort out how to assign memory to the channels */
-  /* first build hierarchical layer list */
   for (echan = (ExrChannel *)data->channels.first; echan; echan = echan->next) {
     if (imb_exr_split_channel_name(echan, layname, passname)) {
 
@@ -1587,67 +1650,133 @@ static ExrHandle *imb_exr_begin_read_mem(IStream &file_stream,
   }
   if (echan) {
     printf("error, too many channels in one pass: %s\n", echan->m->name.c_str());
+    return false;
+  }
+
+  LISTBASE_FOREACH (ExrLayer *, lay, &data->layers) {
+    LISTBASE_FOREACH (ExrPass *, pass, &lay->passes) {
+      for (int a = 0; a < pass->totchan; a++) {
+        pass->chan_id[imb_exr_pass_channel_offset(pass, a)] = pass->chan[a]->chan_id;
+      }
+    }
+  }
+
+  return true;
+}
+
+/* Open a multilayer file without reading any pixels, passes are read on demand with
+ * IMB_exr_set_pass() and IMB_exr_read_channels(). Fails when the file is not a multilayer or multiview file. */
+int IMB_exr_begin_read_multilayer(void *handle, const char *filename, int *width, int *height)
+{
+  ExrHandle *data = (ExrHandle *)handle;
+
+  if (!IMB_exr_begin_read(handle, filename, width, height)) {
+    return 0;
+  }
+  if (!imb_exr_is_multi(*data->ifile)) {
+    return 0;
+  }
+
+  return imb_exr_build_layers(data);
+}
+
+/* Set the buffer a pass of a file opened with IMB_exr_begin_read_multilayer() is read into by
+ * IMB_exr_read_channels(), rect holds totchan interleaved floats per pixel. Set the buffers of all
+ * passes needed before reading, every part of the file is decompressed once for all of them and
+ * parts without any of them are skipped. */
+bool IMB_exr_set_pass(
+    void *handle, const char *layname, const char *passname, const char *view, float *rect)
+{
+  ExrHandle *data = (ExrHandle *)handle;
+  ExrLayer *lay = (ExrLayer *)BLI_findstring(&data->layers, layname, offsetof(ExrLayer, name));
+  ExrPass *pass = NULL;
+
+  if (lay == NULL) {
+    return false;
+  }
+
+  for (pass = (ExrPass *)lay->passes.first; pass; pass = pass->next) {
+    if (STREQ(pass->internal_name, passname) && STREQ(pass->view, view)) {
+      break;
+    }
+  }
+
+  if (pass == NULL || pass->totchan == 0) {
+    return false;
+  }
+
+  imb_exr_pass_set_rect(data, pass, rect);
+
+  return true;
+}
+
+static void imb_exr_header_metadata(const Header &header, IDProperty **metadata)
+{
+  IMB_metadata_ensure(metadata);
+  for (Header::ConstIterator iter = header.begin(); iter != header.end(); iter++) {
+    const StringAttribute *attr = header.findTypedAttribute<StringAttribute>(iter.name());
+
+    /* not all attributes are string attributes so we might get some NULLs here */
+    if (attr) {
+      IMB_metadata_set_field(*metadata, iter.name(), attr->value().c_str());
+    }
+  }
+}
+
+void IMB_exr_get_metadata(void *handle, IDProperty **metadata)
+{
+  ExrHandle *data = (ExrHandle *)handle;
+
+  if (data->ifile) {
+    imb_exr_header_metadata(data->ifile->header(0), metadata);
+  }
+}
+
+/* creates channels, makes a hierarchy and assigns memory to channels */
+static ExrHandle *imb_exr_begin_read_mem(IStream &file_stream,
+                                         MultiPartInputFile &file,
+                                         int width,
+                                         int height)
+{
+  ExrLayer *lay;
+  ExrPass *pass;
+  ExrChannel *echan;
+  ExrHandle *data = (ExrHandle *)IMB_exr_get_handle();
+
+  data->ifile_stream = &file_stream;
+  data->ifile = &file;
+
+  data->width = width;
+  data->height = height;
+
+  std::vector<MultiViewChannelName> channels;
+  GetChannelsInMultiPartFile(*data->ifile, channels);
+
+  imb_exr_get_views(*data->ifile, *data->multiView);
+
+  for (size_t i = 0; i < channels.size(); i++) {
+    IMB_exr_add_channel(
+        data, NULL, channels[i].name.c_str(), channels[i].view.c_str(), 0, 0, NULL, false);
+
+    echan = (ExrChannel *)data->channels.last;
+    echan->m->name = channels[i].name;
+    echan->m->view = channels[i].view;
+    echan->m->part_number = channels[i].part_number;
+    echan->m->internal_name = channels[i].internal_name;
+  }
+
+  if (!imb_exr_build_layers(data)) {
     IMB_exr_close(data);
     return NULL;
   }
 
-  /* with some heuristics, try to merge the channels in buffers */
+  /* The whole file is in memory already, read all passes. */
   for (lay = (ExrLayer *)data->layers.first; lay; lay = lay->next) {
     for (pass = (ExrPass *)lay->passes.first; pass; pass = pass->next) {
       if (pass->totchan) {
         pass->rect = (float *)MEM_callocN(width * height * pass->totchan * sizeof(float),
                                           "pass rect");
-        if (pass->totchan == 1) {
-          echan = pass->chan[0];
-          echan->rect = pass->rect;
-          echan->xstride = 1;
-          echan->ystride = width;
-          pass->chan_id[0] = echan->chan_id;
-        }
-        else {
-          char lookup[256];
-
-          memset(lookup, 0, sizeof(lookup));
-
-          /* we can have RGB(A), XYZ(W), UVA */
-          if (pass->totchan == 3 || pass->totchan == 4) {
-            if (pass->chan[0]->chan_id == 'B' || pass->chan[1]->chan_id == 'B' ||
-                pass->chan[2]->chan_id == 'B') {
-              lookup[(unsigned int)'R'] = 0;
-              lookup[(unsigned int)'G'] = 1;
-              lookup[(unsigned int)'B'] = 2;
-              lookup[(unsigned int)'A'] = 3;
-            }
-            else if (pass->chan[0]->chan_id == 'Y' || pass->chan[1]->chan_id == 'Y' ||
-                     pass->chan[2]->chan_id == 'Y') {
-              lookup[(unsigned int)'X'] = 0;
-              lookup[(unsigned int)'Y'] = 1;
-              lookup[(unsigned int)'Z'] = 2;
-              lookup[(unsigned int)'W'] = 3;
-            }
-            else {
-              lookup[(unsigned int)'U'] = 0;
-              lookup[(unsigned int)'V'] = 1;
-              lookup[(unsigned int)'A'] = 2;
-            }
-            for (a = 0; a < pass->totchan; a++) {
-              echan = pass->chan[a];
-              echan->rect = pass->rect + lookup[(unsigned int)echan->chan_id];
-              echan->xstride = pass->totchan;
-              echan->ystride = width * pass->totchan;
-              pass->chan_id[(unsigned int)lookup[(unsigned int)echan->chan_id]] = echan->chan_id;
-            }
-          }
-          else { /* unknown */
-            for (a = 0; a < pass->totchan; a++) {
-              echan = pass->chan[a];
-              echan->rect = pass->rect + a;
-              echan->xstride = pass->totchan;
-              echan->ystride = width * pass->totchan;
-              pass->chan_id[a] = echan->chan_id;
-            }
-          }
-        }
+        imb_exr_pass_set_rect(data, pass, pass->rect);
       }
     }
   }
@@ -1945,19 +2074,9 @@ struct ImBuf *imb_load_openexr(const unsigned char *mem,
       if (!(flags & IB_test)) {
 
         if (flags & IB_metadata) {
-          const Header &header = file->header(0);
-          Header::ConstIterator iter;
-
-          IMB_metadata_ensure(&ibuf->metadata);
-          for (iter = header.begin(); iter != header.end(); iter++) {
-            const StringAttribute *attr = file->header(0).findTypedAttribute<StringAttribute>(
-                iter.name());
-
-            /* not all attributes are string attributes so we might get some NULLs here */
-            if (attr) {
-              IMB_metadata_set_field(ibuf->metadata, iter.name(), attr->value().c_str());
-              ibuf->flags |= IB_metadata;
-            }
+          imb_exr_header_metadata(file->header(0), &ibuf->metadata);
+          if (ibuf->metadata->data.group.first) {
+            ibuf->flags |= IB_metadata;
           }
         }
 
@@ -2087,6 +2206,152 @@ struct ImBuf *imb_load_openexr(const unsigned char *mem,
   }
 }
 
+struct ImBuf *imb_load_openexr_thumbnail(const unsigned char *mem,
+                                        size_t size,
+                                        int flags,
+                                        size_t max_thumb_size,
+                                        char colorspace[IM_MAX_SPACE],
+                                        size_t *r_width,
+                                        size_t *r_height)
+{
+  struct ImBuf *ibuf = NULL;
+  IMemStream *membuf = NULL;
+  MultiPartInputFile *file = NULL;
+  float *row = NULL;
+
+  if (imb_is_a_openexr(mem) == 0) {
+    return NULL;
+  }
+
+  try {
+    membuf = new IMemStream((unsigned char *)mem, size);
+    file = new MultiPartInputFile(*membuf);
+
+    const Header &header = file->header(0);
+    Box2i dw = header.dataWindow();
+    const int width = dw.max.x - dw.min.x + 1;
+    const int height = dw.max.y - dw.min.y + 1;
+
+    *r_width = width;
+    *r_height = height;
+
+    /* Use the embedded preview when it is not much smaller than the thumbnail. */
+    if (header.hasPreviewImage()) {
+      const PreviewImage &preview = header.previewImage();
+      if (std::max(preview.width(), preview.height()) * 2 >= max_thumb_size) {
+        colorspace_set_default_role(colorspace, IM_MAX_SPACE, COLOR_ROLE_DEFAULT_BYTE);
+
+        ibuf = IMB_allocImBuf(preview.width(), preview.height(), 32, IB_rect);
+        if (ibuf) {
+          const PreviewRgba *pixels = preview.pixels();
+          for (unsigned int y = 0; y < preview.height(); y++) {
+            /* Preview scan-lines are stored top to bottom. */
+            const PreviewRgba *src = pixels + (size_t)(preview.height() - 1 - y) * preview.width();
+            unsigned char *dst = (unsigned char *)(ibuf->rect + (size_t)y * preview.width());
+            for (unsigned int x = 0; x < preview.width(); x++, src++, dst += 4) {
+              dst[0] = src->r;
+              dst[1] = src->g;
+              dst[2] = src->b;
+              dst[3] = src->a;
+            }
+          }
+          ibuf->ftype = IMB_FTYPE_OPENEXR;
+        }
+
+        delete file;
+        delete membuf;
+        return ibuf;
+      }
+    }
+
+    colorspace_set_default_role(colorspace, IM_MAX_SPACE, COLOR_ROLE_DEFAULT_FLOAT);
+
+    /* Only decode every step-th scan-line and pixel, at twice the thumbnail resolution so that
+     * scaling down to the final size still filters out most aliasing. Line blocks in between are
+     * not decompressed at all. */
+    const int step = std::max(std::max(width, height) / (int)(2 * max_thumb_size), 1);
+    const int thumb_width = (width + step - 1) / step;
+    const int thumb_height = (height + step - 1) / step;
+
+    ibuf = IMB_allocImBuf(thumb_width, thumb_height, exr_has_alpha(*file) ? 32 : 24, IB_rectfloat);
+    if (ibuf == NULL) {
+      delete file;
+      delete membuf;
+      return NULL;
+    }
+    ibuf->ftype = IMB_FTYPE_OPENEXR;
+
+    const char *rgb_channels[3];
+    int num_rgb_channels = exr_has_rgb(*file, rgb_channels);
+    if (num_rgb_channels == 0 && !exr_has_luma(*file)) {
+      /* Multi-layer files, use the first layer that has color channels. */
+      rgb_channels[0] = "R";
+      rgb_channels[1] = "G";
+      rgb_channels[2] = "B";
+      num_rgb_channels = 3;
+    }
+
+    /* A single scan-line is read at a time, a zero y-stride maps all of them to the same row. */
+    row = (float *)MEM_mallocN(sizeof(float[4]) * width, __func__);
+    float *first = row - 4 * dw.min.x;
+    const int xstride = sizeof(float[4]);
+    FrameBuffer frameBuffer;
+
+    if (num_rgb_channels > 0) {
+      for (int i = 0; i < num_rgb_channels; i++) {
+        frameBuffer.insert(exr_rgba_channelname(*file, rgb_channels[i]),
+                           Slice(Imf::FLOAT, (char *)(first + i), xstride, 0));
+      }
+    }
+    else {
+      frameBuffer.insert(exr_rgba_channelname(*file, "Y"),
+                         Slice(Imf::FLOAT, (char *)first, xstride, 0));
+    }
+    frameBuffer.insert(exr_rgba_channelname(*file, "A"),
+                       Slice(Imf::FLOAT, (char *)(first + 3), xstride, 0, 1, 1, 1.0f));
+
+    InputPart in(*file, 0);
+    in.setFrameBuffer(frameBuffer);
+
+    for (int ty = 0; ty < thumb_height; ty++) {
+      in.readPixels(dw.min.y + ty * step);
+
+      /* ImBuf rows go bottom to top. */
+      float *dst = ibuf->rect_float + (size_t)(thumb_height - 1 - ty) * thumb_width * 4;
+      for (int tx = 0; tx < thumb_width; tx++, dst += 4) {
+        const float *src = row + (size_t)tx * step * 4;
+        dst[0] = src[0];
+        dst[1] = (num_rgb_channels > 1) ? src[1] : src[0];
+        dst[2] = (num_rgb_channels > 2) ? src[2] : src[0];
+        dst[3] = src[3];
+      }
+    }
+
+    MEM_freeN(row);
+    delete file;
+    delete membuf;
+
+    if (flags & IB_alphamode_detect) {
+      ibuf->flags |= IB_alphamode_premul;
+    }
+
+    return ibuf;
+  }
+  catch (const std::exception &exc) {
+    std::cerr << exc.what() << std::endl;
+    if (ibuf) {
+      IMB_freeImBuf(ibuf);
+    }
+    if (row) {
+      MEM_freeN(row);
+    }
+    delete file;
+    delete membuf;
+
+    return NULL;
+  }
+}
+
 void imb_initopenexr(void)
 {
   int num_threads = BLI_system_thread_count();
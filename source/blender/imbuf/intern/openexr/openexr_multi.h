@@ -37,6 +37,7 @@
 extern "C" {
 #endif
 
+struct IDProperty;
 struct StampData;
 
 void *IMB_exr_get_handle(void);
@@ -51,6 +52,7 @@ void IMB_exr_add_channel(void *handle,
                          bool use_half_float);
 
 int IMB_exr_begin_read(void *handle, const char *filename, int *width, int *height);
+int IMB_exr_begin_read_multilayer(void *handle, const char *filename, int *width, int *height);
 int IMB_exr_begin_write(void *handle,
                         const char *filename,
                         int width,
@@ -72,7 +74,12 @@ float *IMB_exr_channel_rect(void *handle,
                             const char *view);
 
 void IMB_exr_read_channels(void *handle);
+void IMB_exr_read_channels_rows(void *handle, int ymin, int ymax);
+bool IMB_exr_set_pass(
+    void *handle, const char *layname, const char *passname, const char *view, float *rect);
+void IMB_exr_get_metadata(void *handle, struct IDProperty **metadata);
 void IMB_exr_write_channels(void *handle);
+void IMB_exr_write_channels_rows(void *handle, int ymin, int ymax);
 void IMB_exrtile_write_channels(
     void *handle, int partx, int party, int level, const char *viewname, bool empty);
 void IMB_exr_clear_channels(void *handle);
@@ -50,6 +50,13 @@ int IMB_exr_begin_read(void * /*handle*/,
 {
   return 0;
 }
+int IMB_exr_begin_read_multilayer(void * /*handle*/,
+                                  const char * /*filename*/,
+                                  int * /*width*/,
+                                  int * /*height*/)
+{
+  return 0;
+}
 int IMB_exr_begin_write(void * /*handle*/,
                         const char * /*filename*/,
                         int /*width*/,
@@ -88,9 +95,26 @@ float *IMB_exr_channel_rect(void * /*handle*/,
 void IMB_exr_read_channels(void * /*handle*/)
 {
 }
+void IMB_exr_read_channels_rows(void * /*handle*/, int /*ymin*/, int /*ymax*/)
+{
+}
+bool IMB_exr_set_pass(void * /*handle*/,
+                      const char * /*layname*/,
+                      const char * /*passname*/,
+                      const char * /*view*/,
+                      float * /*rect*/)
+{
+  return false;
+}
+void IMB_exr_get_metadata(void * /*handle*/, struct IDProperty ** /*metadata*/)
+{
+}
 void IMB_exr_write_channels(void * /*handle*/)
 {
 }
+void IMB_exr_write_channels_rows(void * /*handle*/, int /*ymin*/, int /*ymax*/)
+{
+}
 void IMB_exrtile_write_channels(void * /*handle*/,
                                 int /*partx*/,
                                 int /*party*/,
@@ -39,6 +39,7 @@
 #include "IMB_filetype.h"
 #include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
+#include "IMB_thumbs.h"
 #include "imbuf.h"
 
 #include "IMB_colormanagement.h"
@@ -205,6 +206,95 @@ ImBuf *IMB_loadifffile(
   return ibuf;
 }
 
+/**
+ * Load \a filepath to make a thumbnail of \a max_thumb_size pixels from it. File types that can
+ * decode a reduced image (embedded previews, DCT scaling, skipping scan-lines) do so, others are
+ * loaded in full unless the file is too big. The size of the full image is returned in
+ * \a r_width and \a r_height.
+ */
+ImBuf *IMB_thumb_load_image(const char *filepath,
+                            size_t max_thumb_size,
+                            char colorspace[IM_MAX_SPACE],
+                            size_t *r_width,
+                            size_t *r_height)
+{
+  const int flags = IB_rect | IB_metadata | IB_thumbnail;
+  const ImFileType *type;
+  char effective_colorspace[IM_MAX_SPACE] = "";
+  ImBuf *ibuf = NULL;
+  unsigned char *mem;
+  size_t size;
+  int file;
+
+  BLI_assert(!BLI_path_is_rel(filepath));
+
+  *r_width = *r_height = 0;
+
+  if (imb_is_filepath_format(filepath)) {
+    ibuf = IMB_loadiffname(filepath, flags, colorspace);
+    if (ibuf) {
+      *r_width = ibuf->x;
+      *r_height = ibuf->y;
+    }
+    return ibuf;
+  }
+
+  file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+  if (file == -1) {
+    return NULL;
+  }
+
+  size = BLI_file_descriptor_size(file);
+
+  imb_mmap_lock();
+  mem = mmap(NULL, size, PROT_READ, MAP_SHARED, file, 0);
+  imb_mmap_unlock();
+
+  if (mem == (unsigned char *)-1) {
+    fprintf(stderr, "%s: couldn't get mapping %s\n", __func__, filepath);
+    close(file);
+    return NULL;
+  }
+
+  if (colorspace) {
+    BLI_strncpy(effective_colorspace, colorspace, sizeof(effective_colorspace));
+  }
+
+  for (type = IMB_FILE_TYPES; type < IMB_FILE_TYPES_LAST; type++) {
+    if (type->load_thumbnail) {
+      ibuf = type->load_thumbnail(
+          mem, size, flags, max_thumb_size, effective_colorspace, r_width, r_height);
+      if (ibuf) {
+        imb_handle_alpha(ibuf, flags, colorspace, effective_colorspace);
+        break;
+      }
+    }
+  }
+
+  /* Full decode, except for very big files. */
+  if (ibuf == NULL && size <= THUMB_SIZE_MAX) {
+    ibuf = IMB_ibImageFromMemory(mem, size, flags, colorspace, filepath);
+    if (ibuf) {
+      *r_width = ibuf->x;
+      *r_height = ibuf->y;
+    }
+  }
+
+  imb_mmap_lock();
+  if (munmap(mem, size)) {
+    fprintf(stderr, "%s: couldn't unmap file %s\n", __func__, filepath);
+  }
+  imb_mmap_unlock();
+
+  close(file);
+
+  if (ibuf) {
+    BLI_strncpy(ibuf->name, filepath, sizeof(ibuf->name));
+  }
+
+  return ibuf;
+}
+
 static void imb_cache_filename(char *filename, const char *name, int flags)
 {
   /* read .tx instead if it exists and is not older */
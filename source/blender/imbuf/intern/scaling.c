@@ -24,8 +24,10 @@
 
 #include <math.h>
 
+#include "BLI_math_base.h"
 #include "BLI_math_color.h"
-#include "BLI_math_interp.h"
+#include "BLI_math_vector.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "MEM_guardedalloc.h"
 
@@ -37,6 +39,10 @@
 
 #include "BLI_sys_types.h"  // for intptr_t support
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 static void imb_half_x_no_alloc(struct ImBuf *ibuf2, struct ImBuf *ibuf1)
 {
   uchar *p1, *_p1, *dest;
@@ -908,646 +914,416 @@ static bool q_scale_linear_interpolation(struct ImBuf *ibuf, int newx, int newy)
   return true;
 }
 
-static ImBuf *scaledownx(struct ImBuf *ibuf, int newx)
-{
-  const int do_rect = (ibuf->rect != NULL);
-  const int do_float = (ibuf->rect_float != NULL);
-  const size_t rect_size = ibuf->x * ibuf->y * 4;
+/* ******** separable resampling ******** */
 
-  uchar *rect, *_newrect, *newrect;
-  float *rectf, *_newrectf, *newrectf;
-  float sample, add, val[4], nval[4], valf[4], nvalf[4];
-  int x, y;
+/* Images are resampled in two passes, first along rows into a float buffer of newx * y pixels,
+ * then along columns into the final buffer. Every destination pixel of a pass is a weighted sum
+ * of a run of neighboring source pixels, the weights are computed once per axis. Both passes are
+ * threaded over rows, and the per pixel sums use SSE when available. */
 
-  rectf = _newrectf = newrectf = NULL;
-  rect = _newrect = newrect = NULL;
-  nval[0] = nval[1] = nval[2] = nval[3] = 0.0f;
-  nvalf[0] = nvalf[1] = nvalf[2] = nvalf[3] = 0.0f;
-
-  if (!do_rect && !do_float) {
-    return ibuf;
-  }
+/* Kernels are evaluated in units of source pixels. When shrinking they are stretched by the
+ * reduction factor so that they act as a low-pass filter as well. */
 
-  if (do_rect) {
-    _newrect = MEM_mallocN(sizeof(uchar[4]) * newx * ibuf->y, "scaledownx");
-    if (_newrect == NULL) {
-      return ibuf;
-    }
-  }
-  if (do_float) {
-    _newrectf = MEM_mallocN(sizeof(float[4]) * newx * ibuf->y, "scaledownxf");
-    if (_newrectf == NULL) {
-      if (_newrect) {
-        MEM_freeN(_newrect);
-      }
-      return ibuf;
-    }
-  }
+static float scale_filter_triangle(float x)
+{
+  x = fabsf(x);
+  return (x < 1.0f) ? 1.0f - x : 0.0f;
+}
 
-  add = (ibuf->x - 0.01) / newx;
+static float scale_filter_mitchell(float x)
+{
+  /* Mitchell-Netravali with B = C = 1/3. */
+  const float b = 1.0f / 3.0f;
+  const float c = 1.0f / 3.0f;
+
+  x = fabsf(x);
+  if (x < 1.0f) {
+    return ((12.0f - 9.0f * b - 6.0f * c) * x * x * x + (-18.0f + 12.0f * b + 6.0f * c) * x * x +
+            (6.0f - 2.0f * b)) /
+           6.0f;
+  }
+  if (x < 2.0f) {
+    return ((-b - 6.0f * c) * x * x * x + (6.0f * b + 30.0f * c) * x * x +
+            (-12.0f * b - 48.0f * c) * x + (8.0f * b + 24.0f * c)) /
+           6.0f;
+  }
+  return 0.0f;
+}
 
-  if (do_rect) {
-    rect = (uchar *)ibuf->rect;
-    newrect = _newrect;
+static float scale_filter_lanczos3(float x)
+{
+  x = fabsf(x);
+  if (x < 1e-6f) {
+    return 1.0f;
   }
-  if (do_float) {
-    rectf = ibuf->rect_float;
-    newrectf = _newrectf;
+  if (x >= 3.0f) {
+    return 0.0f;
   }
+  const float px = (float)M_PI * x;
+  return 3.0f * sinf(px) * sinf(px / 3.0f) / (px * px);
+}
 
-  for (y = ibuf->y; y > 0; y--) {
-    sample = 0.0f;
-    val[0] = val[1] = val[2] = val[3] = 0.0f;
-    valf[0] = valf[1] = valf[2] = valf[3] = 0.0f;
+typedef struct ScaleAxis {
+  /** First source pixel and number of source pixels contributing to each destination pixel. */
+  int *start;
+  int *taps;
+  /** Normalized weights, `max_taps` for each destination pixel. */
+  float *weights;
+  int max_taps;
+} ScaleAxis;
 
-    for (x = newx; x > 0; x--) {
-      if (do_rect) {
-        nval[0] = -val[0] * sample;
-        nval[1] = -val[1] * sample;
-        nval[2] = -val[2] * sample;
-        nval[3] = -val[3] * sample;
-      }
-      if (do_float) {
-        nvalf[0] = -valf[0] * sample;
-        nvalf[1] = -valf[1] * sample;
-        nvalf[2] = -valf[2] * sample;
-        nvalf[3] = -valf[3] * sample;
-      }
+static void scale_axis_free(ScaleAxis *axis)
+{
+  MEM_SAFE_FREE(axis->start);
+  MEM_SAFE_FREE(axis->taps);
+  MEM_SAFE_FREE(axis->weights);
+}
 
-      sample += add;
+static void scale_axis_alloc(ScaleAxis *axis, int dst_size, int max_taps)
+{
+  axis->max_taps = max_taps;
+  axis->start = MEM_mallocN(sizeof(int) * dst_size, "scale axis start");
+  axis->taps = MEM_mallocN(sizeof(int) * dst_size, "scale axis taps");
+  axis->weights = MEM_calloc_arrayN(
+      (size_t)dst_size * max_taps, sizeof(float), "scale axis weights");
+}
 
-      while (sample >= 1.0f) {
-        sample -= 1.0f;
+static void scale_axis_init(ScaleAxis *axis, int src_size, int dst_size, eIMBScaleFilter filter)
+{
+  const double scale = (double)src_size / dst_size;
+
+  if (src_size == dst_size) {
+    /* Leave this axis untouched, like the other filters do for integer positions. */
+    scale_axis_alloc(axis, dst_size, 1);
+    for (int i = 0; i < dst_size; i++) {
+      axis->start[i] = i;
+      axis->taps[i] = 1;
+      axis->weights[i] = 1.0f;
+    }
+    return;
+  }
 
-        if (do_rect) {
-          nval[0] += rect[0];
-          nval[1] += rect[1];
-          nval[2] += rect[2];
-          nval[3] += rect[3];
-          rect += 4;
-        }
-        if (do_float) {
-          nvalf[0] += rectf[0];
-          nvalf[1] += rectf[1];
-          nvalf[2] += rectf[2];
-          nvalf[3] += rectf[3];
-          rectf += 4;
+  if (filter == IMB_SCALE_FILTER_BOX) {
+    if (dst_size < src_size) {
+      /* Average of the source pixels covered by the destination pixel, partially covered
+       * pixels at both ends are weighted by their coverage. */
+      scale_axis_alloc(axis, dst_size, (int)ceil(scale) + 1);
+      for (int i = 0; i < dst_size; i++) {
+        const double a = i * scale;
+        const double b = min_dd((i + 1) * scale, src_size);
+        const int start = (int)a;
+        const int end = min_ii((int)ceil(b), src_size);
+        float *w = axis->weights + (size_t)i * axis->max_taps;
+
+        axis->start[i] = start;
+        axis->taps[i] = end - start;
+        for (int j = start; j < end; j++) {
+          w[j - start] = (float)((min_dd(j + 1, b) - max_dd(j, a)) / (b - a));
         }
       }
-
-      if (do_rect) {
-        val[0] = rect[0];
-        val[1] = rect[1];
-        val[2] = rect[2];
-        val[3] = rect[3];
-        rect += 4;
-
-        newrect[0] = roundf((nval[0] + sample * val[0]) / add);
-        newrect[1] = roundf((nval[1] + sample * val[1]) / add);
-        newrect[2] = roundf((nval[2] + sample * val[2]) / add);
-        newrect[3] = roundf((nval[3] + sample * val[3]) / add);
-
-        newrect += 4;
+    }
+    else {
+      /* Linear interpolation with the corner pixels aligned, so the border pixels keep their
+       * color. */
+      const double step = (dst_size > 1) ? (double)(src_size - 1) / (dst_size - 1) : 0.0;
+
+      scale_axis_alloc(axis, dst_size, 2);
+      for (int i = 0; i < dst_size; i++) {
+        const double pos = i * step;
+        const int start = min_ii((int)pos, src_size - 1);
+        const float fac = (float)(pos - start);
+        float *w = axis->weights + (size_t)i * 2;
+
+        axis->start[i] = start;
+        if (start + 1 < src_size && fac > 0.0f) {
+          axis->taps[i] = 2;
+          w[0] = 1.0f - fac;
+          w[1] = fac;
+        }
+        else {
+          axis->taps[i] = 1;
+          w[0] = 1.0f;
+        }
       }
-      if (do_float) {
-
-        valf[0] = rectf[0];
-        valf[1] = rectf[1];
-        valf[2] = rectf[2];
-        valf[3] = rectf[3];
-        rectf += 4;
+    }
+    return;
+  }
 
-        newrectf[0] = ((nvalf[0] + sample * valf[0]) / add);
-        newrectf[1] = ((nvalf[1] + sample * valf[1]) / add);
-        newrectf[2] = ((nvalf[2] + sample * valf[2]) / add);
-        newrectf[3] = ((nvalf[3] + sample * valf[3]) / add);
+  float (*kernel)(float);
+  float radius;
+  switch (filter) {
+    case IMB_SCALE_FILTER_MITCHELL:
+      kernel = scale_filter_mitchell;
+      radius = 2.0f;
+      break;
+    case IMB_SCALE_FILTER_LANCZOS:
+      kernel = scale_filter_lanczos3;
+      radius = 3.0f;
+      break;
+    case IMB_SCALE_FILTER_BILINEAR:
+    default:
+      kernel = scale_filter_triangle;
+      radius = 1.0f;
+      break;
+  }
+
+  const double filter_scale = max_dd(scale, 1.0);
+  const double support = radius * filter_scale;
+
+  scale_axis_alloc(axis, dst_size, (int)ceil(support) * 2 + 1);
+  for (int i = 0; i < dst_size; i++) {
+    const double center = (i + 0.5) * scale;
+    const int start = max_ii((int)floor(center - support + 0.5), 0);
+    const int end = min_ii((int)floor(center + support + 0.5), src_size);
+    float *w = axis->weights + (size_t)i * axis->max_taps;
+    float total = 0.0f;
+
+    for (int j = start; j < end; j++) {
+      w[j - start] = kernel((float)((j + 0.5 - center) / filter_scale));
+      total += w[j - start];
+    }
 
-        newrectf += 4;
+    axis->start[i] = start;
+    axis->taps[i] = end - start;
+    if (total != 0.0f) {
+      for (int j = 0; j < end - start; j++) {
+        w[j] /= total;
       }
-
-      sample -= 1.0f;
+    }
+    else {
+      /* Can only happen for very small images, fall back to the nearest pixel. */
+      axis->start[i] = min_ii((int)center, src_size - 1);
+      axis->taps[i] = 1;
+      w[0] = 1.0f;
     }
   }
+}
 
-  if (do_rect) {
-    // printf("%ld %ld\n", (uchar *)rect - ((uchar *)ibuf->rect), rect_size);
-    BLI_assert((uchar *)rect - ((uchar *)ibuf->rect) == rect_size); /* see bug T26502. */
-    imb_freerectImBuf(ibuf);
-    ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)_newrect;
-  }
-  if (do_float) {
-    // printf("%ld %ld\n", rectf - ibuf->rect_float, rect_size);
-    BLI_assert((rectf - ibuf->rect_float) == rect_size); /* see bug T26502. */
-    imb_freerectfloatImBuf(ibuf);
-    ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = _newrectf;
-  }
-  (void)rect_size; /* UNUSED in release builds */
+/* Weighted sum of 4 channel pixels which are `stride` floats apart. */
+BLI_INLINE void scale_sum_float4(
+    const float *src, size_t stride, const float *weights, int taps, float *dst)
+{
+#ifdef __SSE2__
+  __m128 sum = _mm_setzero_ps();
+  for (int k = 0; k < taps; k++, src += stride) {
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(src), _mm_set1_ps(weights[k])));
+  }
+  _mm_storeu_ps(dst, sum);
+#else
+  float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  for (int k = 0; k < taps; k++, src += stride) {
+    madd_v4_v4fl(sum, src, weights[k]);
+  }
+  copy_v4_v4(dst, sum);
+#endif
+}
 
-  ibuf->x = newx;
-  return ibuf;
+/* Weighted sum of byte pixels which are next to each other. */
+BLI_INLINE void scale_sum_byte4(const uchar *src, const float *weights, int taps, float *dst)
+{
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  __m128 sum = _mm_setzero_ps();
+  for (int k = 0; k < taps; k++, src += 4) {
+    __m128i pixel = _mm_cvtsi32_si128(*(const int *)src);
+    pixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(pixel, zero), zero);
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(pixel), _mm_set1_ps(weights[k])));
+  }
+  _mm_storeu_ps(dst, sum);
+#else
+  float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  for (int k = 0; k < taps; k++, src += 4) {
+    sum[0] += src[0] * weights[k];
+    sum[1] += src[1] * weights[k];
+    sum[2] += src[2] * weights[k];
+    sum[3] += src[3] * weights[k];
+  }
+  copy_v4_v4(dst, sum);
+#endif
 }
 
-static ImBuf *scaledowny(struct ImBuf *ibuf, int newy)
+BLI_INLINE void scale_store_byte4(const float *src, uchar *dst)
 {
-  const int do_rect = (ibuf->rect != NULL);
-  const int do_float = (ibuf->rect_float != NULL);
-  const size_t rect_size = ibuf->x * ibuf->y * 4;
+#ifdef __SSE2__
+  /* Rounds to nearest and saturates, lobes of the Mitchell and Lanczos filters overshoot. */
+  __m128i pixel = _mm_cvtps_epi32(_mm_loadu_ps(src));
+  pixel = _mm_packus_epi16(_mm_packs_epi32(pixel, pixel), pixel);
+  *(int *)dst = _mm_cvtsi128_si32(pixel);
+#else
+  dst[0] = (uchar)clamp_f(src[0] + 0.5f, 0.0f, 255.0f);
+  dst[1] = (uchar)clamp_f(src[1] + 0.5f, 0.0f, 255.0f);
+  dst[2] = (uchar)clamp_f(src[2] + 0.5f, 0.0f, 255.0f);
+  dst[3] = (uchar)clamp_f(src[3] + 0.5f, 0.0f, 255.0f);
+#endif
+}
 
-  uchar *rect, *_newrect, *newrect;
-  float *rectf, *_newrectf, *newrectf;
-  float sample, add, val[4], nval[4], valf[4], nvalf[4];
-  int x, y, skipx;
+typedef struct ScaleResampleData {
+  const ScaleAxis *axis;
+  int channels;
+  int src_width;
+  int dst_width;
 
-  rectf = _newrectf = newrectf = NULL;
-  rect = _newrect = newrect = NULL;
-  nval[0] = nval[1] = nval[2] = nval[3] = 0.0f;
-  nvalf[0] = nvalf[1] = nvalf[2] = nvalf[3] = 0.0f;
+  /* Source of the horizontal pass, one of them is set. */
+  const uchar *src_byte;
+  const float *src_float;
 
-  if (!do_rect && !do_float) {
-    return ibuf;
-  }
+  /* Result of the horizontal pass, source of the vertical one. */
+  float *tmp_float;
 
-  if (do_rect) {
-    _newrect = MEM_mallocN(sizeof(uchar[4]) * newy * ibuf->x, "scaledowny");
-    if (_newrect == NULL) {
-      return ibuf;
-    }
-  }
-  if (do_float) {
-    _newrectf = MEM_mallocN(sizeof(float[4]) * newy * ibuf->x, "scaledownyf");
-    if (_newrectf == NULL) {
-      if (_newrect) {
-        MEM_freeN(_newrect);
-      }
-      return ibuf;
-    }
-  }
+  /* Destination of the vertical pass, one of them is set. */
+  uchar *dst_byte;
+  float *dst_float;
+} ScaleResampleData;
 
-  add = (ibuf->y - 0.01) / newy;
-  skipx = 4 * ibuf->x;
+static void scale_resample_row_x(void *__restrict userdata,
+                                 const int y,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ScaleResampleData *data = userdata;
+  const ScaleAxis *axis = data->axis;
+  const int channels = data->channels;
+  float *dst = data->tmp_float + (size_t)y * data->dst_width * channels;
 
-  for (x = skipx - 4; x >= 0; x -= 4) {
-    if (do_rect) {
-      rect = ((uchar *)ibuf->rect) + x;
-      newrect = _newrect + x;
+  for (int x = 0; x < data->dst_width; x++, dst += channels) {
+    const float *weights = axis->weights + (size_t)x * axis->max_taps;
+    const size_t src_offset = ((size_t)y * data->src_width + axis->start[x]) * channels;
+
+    if (data->src_byte) {
+      scale_sum_byte4(data->src_byte + src_offset, weights, axis->taps[x], dst);
     }
-    if (do_float) {
-      rectf = ibuf->rect_float + x;
-      newrectf = _newrectf + x;
+    else if (channels == 4) {
+      scale_sum_float4(data->src_float + src_offset, 4, weights, axis->taps[x], dst);
     }
-
-    sample = 0.0f;
-    val[0] = val[1] = val[2] = val[3] = 0.0f;
-    valf[0] = valf[1] = valf[2] = valf[3] = 0.0f;
-
-    for (y = newy; y > 0; y--) {
-      if (do_rect) {
-        nval[0] = -val[0] * sample;
-        nval[1] = -val[1] * sample;
-        nval[2] = -val[2] * sample;
-        nval[3] = -val[3] * sample;
+    else {
+      const float *src = data->src_float + src_offset;
+      for (int c = 0; c < channels; c++) {
+        dst[c] = 0.0f;
       }
-      if (do_float) {
-        nvalf[0] = -valf[0] * sample;
-        nvalf[1] = -valf[1] * sample;
-        nvalf[2] = -valf[2] * sample;
-        nvalf[3] = -valf[3] * sample;
-      }
-
-      sample += add;
-
-      while (sample >= 1.0f) {
-        sample -= 1.0f;
-
-        if (do_rect) {
-          nval[0] += rect[0];
-          nval[1] += rect[1];
-          nval[2] += rect[2];
-          nval[3] += rect[3];
-          rect += skipx;
-        }
-        if (do_float) {
-          nvalf[0] += rectf[0];
-          nvalf[1] += rectf[1];
-          nvalf[2] += rectf[2];
-          nvalf[3] += rectf[3];
-          rectf += skipx;
+      for (int k = 0; k < axis->taps[x]; k++, src += channels) {
+        for (int c = 0; c < channels; c++) {
+          dst[c] += src[c] * weights[k];
         }
       }
-
-      if (do_rect) {
-        val[0] = rect[0];
-        val[1] = rect[1];
-        val[2] = rect[2];
-        val[3] = rect[3];
-        rect += skipx;
-
-        newrect[0] = roundf((nval[0] + sample * val[0]) / add);
-        newrect[1] = roundf((nval[1] + sample * val[1]) / add);
-        newrect[2] = roundf((nval[2] + sample * val[2]) / add);
-        newrect[3] = roundf((nval[3] + sample * val[3]) / add);
-
-        newrect += skipx;
-      }
-      if (do_float) {
-
-        valf[0] = rectf[0];
-        valf[1] = rectf[1];
-        valf[2] = rectf[2];
-        valf[3] = rectf[3];
-        rectf += skipx;
-
-        newrectf[0] = ((nvalf[0] + sample * valf[0]) / add);
-        newrectf[1] = ((nvalf[1] + sample * valf[1]) / add);
-        newrectf[2] = ((nvalf[2] + sample * valf[2]) / add);
-        newrectf[3] = ((nvalf[3] + sample * valf[3]) / add);
-
-        newrectf += skipx;
-      }
-
-      sample -= 1.0f;
     }
   }
-
-  if (do_rect) {
-    // printf("%ld %ld\n", (uchar *)rect - ((uchar *)ibuf->rect), rect_size);
-    BLI_assert((uchar *)rect - ((uchar *)ibuf->rect) == rect_size); /* see bug T26502. */
-    imb_freerectImBuf(ibuf);
-    ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)_newrect;
-  }
-  if (do_float) {
-    // printf("%ld %ld\n", rectf - ibuf->rect_float, rect_size);
-    BLI_assert((rectf - ibuf->rect_float) == rect_size); /* see bug T26502. */
-    imb_freerectfloatImBuf(ibuf);
-    ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = (float *)_newrectf;
-  }
-  (void)rect_size; /* UNUSED in release builds */
-
-  ibuf->y = newy;
-  return ibuf;
 }
 
-static ImBuf *scaleupx(struct ImBuf *ibuf, int newx)
+static void scale_resample_row_y(void *__restrict userdata,
+                                 const int y,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  uchar *rect, *_newrect = NULL, *newrect;
-  float *rectf, *_newrectf = NULL, *newrectf;
-  float sample, add;
-  float val_a, nval_a, diff_a;
-  float val_b, nval_b, diff_b;
-  float val_g, nval_g, diff_g;
-  float val_r, nval_r, diff_r;
-  float val_af, nval_af, diff_af;
-  float val_bf, nval_bf, diff_bf;
-  float val_gf, nval_gf, diff_gf;
-  float val_rf, nval_rf, diff_rf;
-  int x, y;
-  bool do_rect = false, do_float = false;
-
-  val_a = nval_a = diff_a = val_b = nval_b = diff_b = 0;
-  val_g = nval_g = diff_g = val_r = nval_r = diff_r = 0;
-  val_af = nval_af = diff_af = val_bf = nval_bf = diff_bf = 0;
-  val_gf = nval_gf = diff_gf = val_rf = nval_rf = diff_rf = 0;
-  if (ibuf == NULL) {
-    return NULL;
-  }
-  if (ibuf->rect == NULL && ibuf->rect_float == NULL) {
-    return ibuf;
+  const ScaleResampleData *data = userdata;
+  const ScaleAxis *axis = data->axis;
+  const int channels = data->channels;
+  const int width = data->dst_width;
+  const size_t stride = (size_t)width * channels;
+  const float *weights = axis->weights + (size_t)y * axis->max_taps;
+  const float *src = data->tmp_float + axis->start[y] * stride;
+  const int taps = axis->taps[y];
+
+  if (data->dst_byte) {
+    uchar *dst = data->dst_byte + (size_t)y * stride;
+    float pixel[4];
+
+    for (int x = 0; x < width; x++, src += 4, dst += 4) {
+      scale_sum_float4(src, stride, weights, taps, pixel);
+      scale_store_byte4(pixel, dst);
+    }
   }
+  else if (channels == 4) {
+    float *dst = data->dst_float + (size_t)y * stride;
 
-  if (ibuf->rect) {
-    do_rect = true;
-    _newrect = MEM_mallocN(newx * ibuf->y * sizeof(int), "scaleupx");
-    if (_newrect == NULL) {
-      return ibuf;
+    for (int x = 0; x < width; x++, src += 4, dst += 4) {
+      scale_sum_float4(src, stride, weights, taps, dst);
     }
   }
-  if (ibuf->rect_float) {
-    do_float = true;
-    _newrectf = MEM_mallocN(sizeof(float[4]) * newx * ibuf->y, "scaleupxf");
-    if (_newrectf == NULL) {
-      if (_newrect) {
-        MEM_freeN(_newrect);
+  else {
+    float *dst = data->dst_float + (size_t)y * stride;
+
+    for (size_t i = 0; i < stride; i++) {
+      float sum = 0.0f;
+      for (int k = 0; k < taps; k++) {
+        sum += src[i + k * stride] * weights[k];
       }
-      return ibuf;
+      dst[i] = sum;
     }
   }
+}
 
-  add = (ibuf->x - 1.001) / (newx - 1.0);
-
-  rect = (uchar *)ibuf->rect;
-  rectf = (float *)ibuf->rect_float;
-  newrect = _newrect;
-  newrectf = _newrectf;
-
-  for (y = ibuf->y; y > 0; y--) {
-
-    sample = 0;
-
-    if (do_rect) {
-      val_a = rect[0];
-      nval_a = rect[4];
-      diff_a = nval_a - val_a;
-      val_a += 0.5f;
-
-      val_b = rect[1];
-      nval_b = rect[5];
-      diff_b = nval_b - val_b;
-      val_b += 0.5f;
-
-      val_g = rect[2];
-      nval_g = rect[6];
-      diff_g = nval_g - val_g;
-      val_g += 0.5f;
-
-      val_r = rect[3];
-      nval_r = rect[7];
-      diff_r = nval_r - val_r;
-      val_r += 0.5f;
-
-      rect += 8;
-    }
-    if (do_float) {
-      val_af = rectf[0];
-      nval_af = rectf[4];
-      diff_af = nval_af - val_af;
-
-      val_bf = rectf[1];
-      nval_bf = rectf[5];
-      diff_bf = nval_bf - val_bf;
-
-      val_gf = rectf[2];
-      nval_gf = rectf[6];
-      diff_gf = nval_gf - val_gf;
+static void scale_resample_rows(ScaleResampleData *data, int rows, TaskParallelRangeFunc func)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = ((size_t)rows * data->dst_width > 64 * 64);
+  BLI_task_parallel_range(0, rows, data, func, &settings);
+}
 
-      val_rf = rectf[3];
-      nval_rf = rectf[7];
-      diff_rf = nval_rf - val_rf;
+/* Resamples one buffer of `ibuf`, returns the new buffer or NULL when out of memory. */
+static void *scale_resample_buffer(const ImBuf *ibuf,
+                                   const uchar *src_byte,
+                                   const float *src_float,
+                                   int channels,
+                                   int newx,
+                                   int newy,
+                                   const ScaleAxis *axis_x,
+                                   const ScaleAxis *axis_y)
+{
+  const size_t new_pixels = (size_t)newx * newy;
+  ScaleResampleData data = {NULL};
+  void *result;
 
-      rectf += 8;
-    }
-    for (x = newx; x > 0; x--) {
-      if (sample >= 1.0f) {
-        sample -= 1.0f;
-
-        if (do_rect) {
-          val_a = nval_a;
-          nval_a = rect[0];
-          diff_a = nval_a - val_a;
-          val_a += 0.5f;
-
-          val_b = nval_b;
-          nval_b = rect[1];
-          diff_b = nval_b - val_b;
-          val_b += 0.5f;
-
-          val_g = nval_g;
-          nval_g = rect[2];
-          diff_g = nval_g - val_g;
-          val_g += 0.5f;
-
-          val_r = nval_r;
-          nval_r = rect[3];
-          diff_r = nval_r - val_r;
-          val_r += 0.5f;
-          rect += 4;
-        }
-        if (do_float) {
-          val_af = nval_af;
-          nval_af = rectf[0];
-          diff_af = nval_af - val_af;
-
-          val_bf = nval_bf;
-          nval_bf = rectf[1];
-          diff_bf = nval_bf - val_bf;
-
-          val_gf = nval_gf;
-          nval_gf = rectf[2];
-          diff_gf = nval_gf - val_gf;
-
-          val_rf = nval_rf;
-          nval_rf = rectf[3];
-          diff_rf = nval_rf - val_rf;
-          rectf += 4;
-        }
-      }
-      if (do_rect) {
-        newrect[0] = val_a + sample * diff_a;
-        newrect[1] = val_b + sample * diff_b;
-        newrect[2] = val_g + sample * diff_g;
-        newrect[3] = val_r + sample * diff_r;
-        newrect += 4;
-      }
-      if (do_float) {
-        newrectf[0] = val_af + sample * diff_af;
-        newrectf[1] = val_bf + sample * diff_bf;
-        newrectf[2] = val_gf + sample * diff_gf;
-        newrectf[3] = val_rf + sample * diff_rf;
-        newrectf += 4;
-      }
-      sample += add;
-    }
+  if (src_byte) {
+    result = MEM_mallocN(sizeof(uchar[4]) * new_pixels, "scaled byte buffer");
   }
-
-  if (do_rect) {
-    imb_freerectImBuf(ibuf);
-    ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)_newrect;
+  else {
+    result = MEM_mallocN(sizeof(float) * channels * new_pixels, "scaled float buffer");
   }
-  if (do_float) {
-    imb_freerectfloatImBuf(ibuf);
-    ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = (float *)_newrectf;
+  if (result == NULL) {
+    return NULL;
   }
 
-  ibuf->x = newx;
-  return ibuf;
-}
+  data.channels = channels;
+  data.src_width = ibuf->x;
+  data.dst_width = newx;
+  data.src_byte = src_byte;
+  data.src_float = src_float;
 
-static ImBuf *scaleupy(struct ImBuf *ibuf, int newy)
-{
-  uchar *rect, *_newrect = NULL, *newrect;
-  float *rectf, *_newrectf = NULL, *newrectf;
-  float sample, add;
-  float val_a, nval_a, diff_a;
-  float val_b, nval_b, diff_b;
-  float val_g, nval_g, diff_g;
-  float val_r, nval_r, diff_r;
-  float val_af, nval_af, diff_af;
-  float val_bf, nval_bf, diff_bf;
-  float val_gf, nval_gf, diff_gf;
-  float val_rf, nval_rf, diff_rf;
-  int x, y, skipx;
-  bool do_rect = false, do_float = false;
-
-  val_a = nval_a = diff_a = val_b = nval_b = diff_b = 0;
-  val_g = nval_g = diff_g = val_r = nval_r = diff_r = 0;
-  val_af = nval_af = diff_af = val_bf = nval_bf = diff_bf = 0;
-  val_gf = nval_gf = diff_gf = val_rf = nval_rf = diff_rf = 0;
-  if (ibuf == NULL) {
-    return NULL;
+  /* Float buffers skip the passes along axes which keep their size. */
+  if (src_float && newx == ibuf->x) {
+    data.tmp_float = (float *)src_float;
   }
-  if (ibuf->rect == NULL && ibuf->rect_float == NULL) {
-    return ibuf;
+  else if (src_float && newy == ibuf->y) {
+    data.tmp_float = result;
   }
-
-  if (ibuf->rect) {
-    do_rect = true;
-    _newrect = MEM_mallocN(ibuf->x * newy * sizeof(int), "scaleupy");
-    if (_newrect == NULL) {
-      return ibuf;
-    }
-  }
-  if (ibuf->rect_float) {
-    do_float = true;
-    _newrectf = MEM_mallocN(sizeof(float[4]) * ibuf->x * newy, "scaleupyf");
-    if (_newrectf == NULL) {
-      if (_newrect) {
-        MEM_freeN(_newrect);
-      }
-      return ibuf;
+  else {
+    data.tmp_float = MEM_mallocN(sizeof(float) * channels * newx * ibuf->y, "scale rows");
+    if (data.tmp_float == NULL) {
+      MEM_freeN(result);
+      return NULL;
     }
   }
 
-  add = (ibuf->y - 1.001) / (newy - 1.0);
-  skipx = 4 * ibuf->x;
-
-  rect = (uchar *)ibuf->rect;
-  rectf = (float *)ibuf->rect_float;
-  newrect = _newrect;
-  newrectf = _newrectf;
-
-  for (x = ibuf->x; x > 0; x--) {
+  if (data.tmp_float != src_float) {
+    data.axis = axis_x;
+    scale_resample_rows(&data, ibuf->y, scale_resample_row_x);
+  }
 
-    sample = 0;
-    if (do_rect) {
-      rect = ((uchar *)ibuf->rect) + 4 * (x - 1);
-      newrect = _newrect + 4 * (x - 1);
-
-      val_a = rect[0];
-      nval_a = rect[skipx];
-      diff_a = nval_a - val_a;
-      val_a += 0.5f;
-
-      val_b = rect[1];
-      nval_b = rect[skipx + 1];
-      diff_b = nval_b - val_b;
-      val_b += 0.5f;
-
-      val_g = rect[2];
-      nval_g = rect[skipx + 2];
-      diff_g = nval_g - val_g;
-      val_g += 0.5f;
-
-      val_r = rect[3];
-      nval_r = rect[skipx + 3];
-      diff_r = nval_r - val_r;
-      val_r += 0.5f;
-
-      rect += 2 * skipx;
+  if (data.tmp_float != result) {
+    data.axis = axis_y;
+    if (src_byte) {
+      data.dst_byte = result;
     }
-    if (do_float) {
-      rectf = ibuf->rect_float + 4 * (x - 1);
-      newrectf = _newrectf + 4 * (x - 1);
-
-      val_af = rectf[0];
-      nval_af = rectf[skipx];
-      diff_af = nval_af - val_af;
-
-      val_bf = rectf[1];
-      nval_bf = rectf[skipx + 1];
-      diff_bf = nval_bf - val_bf;
-
-      val_gf = rectf[2];
-      nval_gf = rectf[skipx + 2];
-      diff_gf = nval_gf - val_gf;
-
-      val_rf = rectf[3];
-      nval_rf = rectf[skipx + 3];
-      diff_rf = nval_rf - val_rf;
-
-      rectf += 2 * skipx;
+    else {
+      data.dst_float = result;
     }
+    scale_resample_rows(&data, newy, scale_resample_row_y);
 
-    for (y = newy; y > 0; y--) {
-      if (sample >= 1.0f) {
-        sample -= 1.0f;
-
-        if (do_rect) {
-          val_a = nval_a;
-          nval_a = rect[0];
-          diff_a = nval_a - val_a;
-          val_a += 0.5f;
-
-          val_b = nval_b;
-          nval_b = rect[1];
-          diff_b = nval_b - val_b;
-          val_b += 0.5f;
-
-          val_g = nval_g;
-          nval_g = rect[2];
-          diff_g = nval_g - val_g;
-          val_g += 0.5f;
-
-          val_r = nval_r;
-          nval_r = rect[3];
-          diff_r = nval_r - val_r;
-          val_r += 0.5f;
-          rect += skipx;
-        }
-        if (do_float) {
-          val_af = nval_af;
-          nval_af = rectf[0];
-          diff_af = nval_af - val_af;
-
-          val_bf = nval_bf;
-          nval_bf = rectf[1];
-          diff_bf = nval_bf - val_bf;
-
-          val_gf = nval_gf;
-          nval_gf = rectf[2];
-          diff_gf = nval_gf - val_gf;
-
-          val_rf = nval_rf;
-          nval_rf = rectf[3];
-          diff_rf = nval_rf - val_rf;
-          rectf += skipx;
-        }
-      }
-      if (do_rect) {
-        newrect[0] = val_a + sample * diff_a;
-        newrect[1] = val_b + sample * diff_b;
-        newrect[2] = val_g + sample * diff_g;
-        newrect[3] = val_r + sample * diff_r;
-        newrect += skipx;
-      }
-      if (do_float) {
-        newrectf[0] = val_af + sample * diff_af;
-        newrectf[1] = val_bf + sample * diff_bf;
-        newrectf[2] = val_gf + sample * diff_gf;
-        newrectf[3] = val_rf + sample * diff_rf;
-        newrectf += skipx;
-      }
-      sample += add;
+    if (data.tmp_float != src_float) {
+      MEM_freeN(data.tmp_float);
     }
   }
 
-  if (do_rect) {
-    imb_freerectImBuf(ibuf);
-    ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)_newrect;
-  }
-  if (do_float) {
-    imb_freerectfloatImBuf(ibuf);
-    ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = (float *)_newrectf;
-  }
-
-  ibuf->y = newy;
-  return ibuf;
+  return result;
 }
 
 static void scalefast_Z_ImBuf(ImBuf *ibuf, int newx, int newy)
@@ -1616,10 +1392,19 @@ static void scalefast_Z_ImBuf(ImBuf *ibuf, int newx, int newy)
 }
 
 /**
+ * Resample \a ibuf to \a newx by \a newy pixels with \a filter, passing zero keeps the size
+ * of that axis. Byte, float and Z buffers are all scaled.
  * Return true if \a ibuf is modified.
  */
-bool IMB_scaleImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy)
+bool IMB_scaleImBuf_ex(struct ImBuf *ibuf,
+                       unsigned int newx,
+                       unsigned int newy,
+                       eIMBScaleFilter filter)
 {
+  ScaleAxis axis_x = {NULL}, axis_y = {NULL};
+  uchar *new_rect = NULL;
+  float *new_rect_float = NULL;
+
   if (ibuf == NULL) {
     return false;
   }
@@ -1627,36 +1412,70 @@ bool IMB_scaleImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy)
     return false;
   }
 
+  if (newx == 0) {
+    newx = ibuf->x;
+  }
+  if (newy == 0) {
+    newy = ibuf->y;
+  }
   if (newx == ibuf->x && newy == ibuf->y) {
     return false;
   }
 
-  /* Scale-up / scale-down functions below change ibuf->x and ibuf->y
-   * so we first scale the Z-buffer (if any). */
-  scalefast_Z_ImBuf(ibuf, newx, newy);
+  scale_axis_init(&axis_x, ibuf->x, newx, filter);
+  scale_axis_init(&axis_y, ibuf->y, newy, filter);
 
-  /* try to scale common cases in a fast way */
-  /* disabled, quality loss is unacceptable, see report T18609  (ton) */
-  if (0 && q_scale_linear_interpolation(ibuf, newx, newy)) {
-    return true;
+  if (ibuf->rect) {
+    new_rect = scale_resample_buffer(
+        ibuf, (const uchar *)ibuf->rect, NULL, 4, newx, newy, &axis_x, &axis_y);
   }
-
-  if (newx && (newx < ibuf->x)) {
-    scaledownx(ibuf, newx);
+  if (ibuf->rect_float) {
+    new_rect_float = scale_resample_buffer(
+        ibuf, NULL, ibuf->rect_float, ibuf->channels, newx, newy, &axis_x, &axis_y);
   }
-  if (newy && (newy < ibuf->y)) {
-    scaledowny(ibuf, newy);
+
+  scale_axis_free(&axis_x);
+  scale_axis_free(&axis_y);
+
+  if ((ibuf->rect && new_rect == NULL) || (ibuf->rect_float && new_rect_float == NULL)) {
+    MEM_SAFE_FREE(new_rect);
+    MEM_SAFE_FREE(new_rect_float);
+    return false;
   }
-  if (newx && (newx > ibuf->x)) {
-    scaleupx(ibuf, newx);
+
+  /* Uses the current size, so before ibuf->x and ibuf->y change. */
+  scalefast_Z_ImBuf(ibuf, newx, newy);
+
+  if (new_rect) {
+    imb_freerectImBuf(ibuf);
+    ibuf->mall |= IB_rect;
+    ibuf->rect = (unsigned int *)new_rect;
   }
-  if (newy && (newy > ibuf->y)) {
-    scaleupy(ibuf, newy);
+  if (new_rect_float) {
+    imb_freerectfloatImBuf(ibuf);
+    ibuf->mall |= IB_rectfloat;
+    ibuf->rect_float = new_rect_float;
   }
 
+  ibuf->x = newx;
+  ibuf->y = newy;
   return true;
 }
 
+/**
+ * Return true if \a ibuf is modified.
+ */
+bool IMB_scaleImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy)
+{
+  /* try to scale common cases in a fast way */
+  /* disabled, quality loss is unacceptable, see report T18609  (ton) */
+  if (0 && q_scale_linear_interpolation(ibuf, newx, newy)) {
+    return true;
+  }
+
+  return IMB_scaleImBuf_ex(ibuf, newx, newy, IMB_SCALE_FILTER_BOX);
+}
+
 struct imbufRGBA {
   float r, g, b, a;
 };
@@ -1760,119 +1579,7 @@ bool IMB_scalefastImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy
   return true;
 }
 
-/* ******** threaded scaling ******** */
-
-typedef struct ScaleTreadInitData {
-  ImBuf *ibuf;
-
-  unsigned int newx;
-  unsigned int newy;
-
-  unsigned char *byte_buffer;
-  float *float_buffer;
-} ScaleTreadInitData;
-
-typedef struct ScaleThreadData {
-  ImBuf *ibuf;
-
-  unsigned int newx;
-  unsigned int newy;
-
-  int start_line;
-  int tot_line;
-
-  unsigned char *byte_buffer;
-  float *float_buffer;
-} ScaleThreadData;
-
-static void scale_thread_init(void *data_v, int start_line, int tot_line, void *init_data_v)
-{
-  ScaleThreadData *data = (ScaleThreadData *)data_v;
-  ScaleTreadInitData *init_data = (ScaleTreadInitData *)init_data_v;
-
-  data->ibuf = init_data->ibuf;
-
-  data->newx = init_data->newx;
-  data->newy = init_data->newy;
-
-  data->start_line = start_line;
-  data->tot_line = tot_line;
-
-  data->byte_buffer = init_data->byte_buffer;
-  data->float_buffer = init_data->float_buffer;
-}
-
-static void *do_scale_thread(void *data_v)
-{
-  ScaleThreadData *data = (ScaleThreadData *)data_v;
-  ImBuf *ibuf = data->ibuf;
-  int i;
-  float factor_x = (float)ibuf->x / data->newx;
-  float factor_y = (float)ibuf->y / data->newy;
-
-  for (i = 0; i < data->tot_line; i++) {
-    int y = data->start_line + i;
-    int x;
-
-    for (x = 0; x < data->newx; x++) {
-      float u = (float)x * factor_x;
-      float v = (float)y * factor_y;
-      int offset = y * data->newx + x;
-
-      if (data->byte_buffer) {
-        unsigned char *pixel = data->byte_buffer + 4 * offset;
-        BLI_bilinear_interpolation_char(
-            (unsigned char *)ibuf->rect, pixel, ibuf->x, ibuf->y, 4, u, v);
-      }
-
-      if (data->float_buffer) {
-        float *pixel = data->float_buffer + ibuf->channels * offset;
-        BLI_bilinear_interpolation_fl(
-            ibuf->rect_float, pixel, ibuf->x, ibuf->y, ibuf->channels, u, v);
-      }
-    }
-  }
-
-  return NULL;
-}
-
 void IMB_scaleImBuf_threaded(ImBuf *ibuf, unsigned int newx, unsigned int newy)
 {
-  ScaleTreadInitData init_data = {NULL};
-
-  /* prepare initialization data */
-  init_data.ibuf = ibuf;
-
-  init_data.newx = newx;
-  init_data.newy = newy;
-
-  if (ibuf->rect) {
-    init_data.byte_buffer = MEM_mallocN(4 * newx * newy * sizeof(char),
-                                        "threaded scale byte buffer");
-  }
-
-  if (ibuf->rect_float) {
-    init_data.float_buffer = MEM_mallocN(ibuf->channels * newx * newy * sizeof(float),
-                                         "threaded scale float buffer");
-  }
-
-  /* actual scaling threads */
-  IMB_processor_apply_threaded(
-      newy, sizeof(ScaleThreadData), &init_data, scale_thread_init, do_scale_thread);
-
-  /* alter image buffer */
-  ibuf->x = newx;
-  ibuf->y = newy;
-
-  if (ibuf->rect) {
-    imb_freerectImBuf(ibuf);
-    ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)init_data.byte_buffer;
-  }
-
-  if (ibuf->rect_float) {
-    imb_freerectfloatImBuf(ibuf);
-    ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = init_data.float_buffer;
-  }
+  IMB_scaleImBuf_ex(ibuf, newx, newy, IMB_SCALE_FILTER_BILINEAR);
 }
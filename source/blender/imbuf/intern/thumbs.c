@@ -29,9 +29,11 @@
 #include "BLI_fileops.h"
 #include "BLI_ghash.h"
 #include "BLI_hash_md5.h"
+#include "BLI_listbase.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_system.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 #include BLI_SYSTEM_PID_H
@@ -318,6 +320,8 @@ void IMB_thumb_makedirs(void)
   }
 }
 
+static void thumb_write(ImBuf *img, const char *temp, const char *tpath);
+
 /* create thumbnail for file and returns new imbuf for thumbnail */
 static ImBuf *thumb_create_ex(const char *file_path,
                               const char *uri,
@@ -356,15 +360,6 @@ static ImBuf *thumb_create_ex(const char *file_path,
       return NULL; /* unknown size */
   }
 
-  /* exception, skip images over 100mb */
-  if (source == THB_SOURCE_IMAGE) {
-    const size_t file_size = BLI_file_size(file_path);
-    if (file_size != -1 && file_size > THUMB_SIZE_MAX) {
-      // printf("file too big: %d, skipping %s\n", (int)size, file_path);
-      return NULL;
-    }
-  }
-
   if (get_thumb_dir(tdir, size)) {
     BLI_snprintf(tpath, FILE_MAX, "%s%s", tdir, thumb);
     //      thumb[8] = '\0'; /* shorten for tempname, not needed anymore */
@@ -380,11 +375,15 @@ static ImBuf *thumb_create_ex(const char *file_path,
     }
     else {
       if (ELEM(source, THB_SOURCE_IMAGE, THB_SOURCE_BLEND, THB_SOURCE_FONT)) {
+        /* Size of the original image, the thumbnail may be decoded at a lower resolution. */
+        size_t width = 0, height = 0;
+
         /* only load if we didn't give an image */
         if (img == NULL) {
           switch (source) {
             case THB_SOURCE_IMAGE:
-              img = IMB_loadiffname(file_path, IB_rect | IB_metadata, NULL);
+              /* Skips images over 100mb, unless their type can load a reduced version. */
+              img = IMB_thumb_load_image(file_path, tsize, NULL, &width, &height);
               break;
             case THB_SOURCE_BLEND:
               img = IMB_thumb_load_blend(file_path, blen_group, blen_id);
@@ -401,8 +400,12 @@ static ImBuf *thumb_create_ex(const char *file_path,
           if (BLI_stat(file_path, &info) != -1) {
             BLI_snprintf(mtime, sizeof(mtime), "%ld", (long int)info.st_mtime);
           }
-          BLI_snprintf(cwidth, sizeof(cwidth), "%d", img->x);
-          BLI_snprintf(cheight, sizeof(cheight), "%d", img->y);
+          if (width == 0 || height == 0) {
+            width = img->x;
+            height = img->y;
+          }
+          BLI_snprintf(cwidth, sizeof(cwidth), "%zu", width);
+          BLI_snprintf(cheight, sizeof(cheight), "%zu", height);
         }
       }
       else if (THB_SOURCE_MOVIE == source) {
@@ -469,14 +472,7 @@ static ImBuf *thumb_create_ex(const char *file_path,
     IMB_rect_from_float(img);
     imb_freerectfloatImBuf(img);
 
-    if (IMB_saveiff(img, temp, IB_rect | IB_metadata)) {
-#ifndef WIN32
-      chmod(temp, S_IRUSR | S_IWUSR);
-#endif
-      // printf("%s saving thumb: '%s'\n", __func__, tpath);
-
-      BLI_rename(temp, tpath);
-    }
+    thumb_write(img, temp, tpath);
   }
   return img;
 }
@@ -680,8 +676,89 @@ static struct IMBThumbLocks {
   GSet *locked_paths;
   int lock_counter;
   ThreadCondition cond;
+
+  /* Thumbnails waiting to be saved, see thumb_write(). */
+  ListBase write_queue;
+  TaskPool *write_pool;
+  bool write_task_running;
 } thumb_locks = {0};
 
+typedef struct ThumbWrite {
+  struct ThumbWrite *next, *prev;
+  ImBuf *img;
+  char temp[FILE_MAX];
+  char tpath[FILE_MAX];
+} ThumbWrite;
+
+static void thumb_write_file(ImBuf *img, const char *temp, const char *tpath)
+{
+  if (IMB_saveiff(img, temp, IB_rect | IB_metadata)) {
+#ifndef WIN32
+    chmod(temp, S_IRUSR | S_IWUSR);
+#endif
+    // printf("%s saving thumb: '%s'\n", __func__, tpath);
+
+    BLI_rename(temp, tpath);
+  }
+}
+
+static void thumb_write_task(TaskPool *__restrict UNUSED(pool), void *UNUSED(taskdata))
+{
+  /* Write everything queued so far in one go, until the queue stays empty. */
+  while (true) {
+    ListBase batch;
+
+    BLI_thread_lock(LOCK_IMAGE);
+    batch = thumb_locks.write_queue;
+    BLI_listbase_clear(&thumb_locks.write_queue);
+    if (BLI_listbase_is_empty(&batch)) {
+      thumb_locks.write_task_running = false;
+      BLI_thread_unlock(LOCK_IMAGE);
+      break;
+    }
+    BLI_thread_unlock(LOCK_IMAGE);
+
+    LISTBASE_FOREACH_MUTABLE (ThumbWrite *, item, &batch) {
+      thumb_write_file(item->img, item->temp, item->tpath);
+      IMB_freeImBuf(item->img);
+      MEM_freeN(item);
+    }
+  }
+}
+
+/**
+ * Save \a img as thumbnail file \a tpath, through the temporary file \a temp.
+ *
+ * While thumbnails are generated in the background (between #IMB_thumb_locks_acquire and
+ * #IMB_thumb_locks_release) a copy is queued instead, and a single task writes the queued files
+ * in batches. Generating threads then don't wait on PNG compression and file system access.
+ */
+static void thumb_write(ImBuf *img, const char *temp, const char *tpath)
+{
+  BLI_thread_lock(LOCK_IMAGE);
+
+  ImBuf *img_copy = (thumb_locks.write_pool != NULL) ? IMB_dupImBuf(img) : NULL;
+  if (img_copy == NULL) {
+    BLI_thread_unlock(LOCK_IMAGE);
+    thumb_write_file(img, temp, tpath);
+    return;
+  }
+
+  ThumbWrite *item = MEM_callocN(sizeof(*item), __func__);
+  item->img = img_copy;
+  IMB_metadata_copy(item->img, img);
+  BLI_strncpy(item->temp, temp, sizeof(item->temp));
+  BLI_strncpy(item->tpath, tpath, sizeof(item->tpath));
+  BLI_addtail(&thumb_locks.write_queue, item);
+
+  if (!thumb_locks.write_task_running) {
+    thumb_locks.write_task_running = true;
+    BLI_task_pool_push(thumb_locks.write_pool, thumb_write_task, NULL, false, NULL);
+  }
+
+  BLI_thread_unlock(LOCK_IMAGE);
+}
+
 void IMB_thumb_locks_acquire(void)
 {
   BLI_thread_lock(LOCK_IMAGE);
@@ -690,6 +767,7 @@ void IMB_thumb_locks_acquire(void)
     BLI_assert(thumb_locks.locked_paths == NULL);
     thumb_locks.locked_paths = BLI_gset_str_new(__func__);
     BLI_condition_init(&thumb_locks.cond);
+    thumb_locks.write_pool = BLI_task_pool_create_background(NULL, TASK_PRIORITY_LOW);
   }
   thumb_locks.lock_counter++;
 
@@ -700,6 +778,8 @@ void IMB_thumb_locks_acquire(void)
 
 void IMB_thumb_locks_release(void)
 {
+  TaskPool *write_pool = NULL;
+
   BLI_thread_lock(LOCK_IMAGE);
   BLI_assert((thumb_locks.locked_paths != NULL) && (thumb_locks.lock_counter > 0));
 
@@ -708,9 +788,18 @@ void IMB_thumb_locks_release(void)
     BLI_gset_free(thumb_locks.locked_paths, MEM_freeN);
     thumb_locks.locked_paths = NULL;
     BLI_condition_end(&thumb_locks.cond);
+
+    write_pool = thumb_locks.write_pool;
+    thumb_locks.write_pool = NULL;
   }
 
   BLI_thread_unlock(LOCK_IMAGE);
+
+  /* Flush pending thumbnails, the write task needs the lock to get them. */
+  if (write_pool) {
+    BLI_task_pool_work_and_wait(write_pool);
+    BLI_task_pool_free(write_pool);
+  }
 }
 
 void IMB_thumb_path_lock(const char *path)
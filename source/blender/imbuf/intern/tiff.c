@@ -554,7 +554,8 @@ void imb_inittiff(void)
  * \param mem: Memory containing the TIFF file.
  * \param size: Size of the mem buffer.
  * \param flags: If flags has IB_test set then the file is not actually loaded,
- * but all other operations take place.
+ * but all other operations take place. Together with IB_tilecache, IB_tilecache is set on the
+ * result when the file is a tiled texture that can be read through the tile cache.
  *
  * \return A newly allocated #ImBuf structure if successful, otherwise NULL.
  */
@@ -570,8 +571,10 @@ ImBuf *imb_loadtiff(const unsigned char *mem,
   char *format = NULL;
   int level;
   short spp;
+  short bitspersample = 8;
   int ib_depth;
   int found;
+  bool is_tiled_texture = false;
 
   /* check whether or not we have a TIFF file */
   if (size < IMB_TIFF_NCB) {
@@ -624,52 +627,60 @@ ImBuf *imb_loadtiff(const unsigned char *mem,
     }
   }
 
-  /* if testing, we're done */
-  if (flags & IB_test) {
-    TIFFClose(image);
-    return ibuf;
-  }
-
   /* detect if we are reading a tiled/mipmapped texture, in that case
-   * we don't read pixels but leave it to the cache to load tiles */
+   * we don't read pixels but leave it to the cache to load tiles. The tile
+   * cache only holds byte pixels, 16 bit and float textures are read whole
+   * so they keep their precision. */
   if (flags & IB_tilecache) {
     format = NULL;
     TIFFGetField(image, TIFFTAG_PIXAR_TEXTUREFORMAT, &format);
+    TIFFGetField(image, TIFFTAG_BITSPERSAMPLE, &bitspersample);
+    is_tiled_texture = format && STREQ(format, "Plain Texture") && TIFFIsTiled(image) &&
+                       bitspersample == 8;
+  }
 
-    if (format && STREQ(format, "Plain Texture") && TIFFIsTiled(image)) {
-      int numlevel = TIFFNumberOfDirectories(image);
+  /* if testing, we're done, the tile cache flag tells whether tiles could be used */
+  if (flags & IB_test) {
+    if (is_tiled_texture) {
+      ibuf->flags |= IB_tilecache;
+    }
+    TIFFClose(image);
+    return ibuf;
+  }
 
-      /* create empty mipmap levels in advance */
-      for (level = 0; level < numlevel; level++) {
-        if (!TIFFSetDirectory(image, level)) {
-          break;
-        }
+  if (is_tiled_texture) {
+    int numlevel = TIFFNumberOfDirectories(image);
 
-        if (level > 0) {
-          width = (width > 1) ? width / 2 : 1;
-          height = (height > 1) ? height / 2 : 1;
+    /* create empty mipmap levels in advance */
+    for (level = 0; level < numlevel; level++) {
+      if (!TIFFSetDirectory(image, level)) {
+        break;
+      }
 
-          hbuf = IMB_allocImBuf(width, height, 32, 0);
-          hbuf->miplevel = level;
-          hbuf->ftype = ibuf->ftype;
-          ibuf->mipmap[level - 1] = hbuf;
-        }
-        else {
-          hbuf = ibuf;
-        }
+      if (level > 0) {
+        width = (width > 1) ? width / 2 : 1;
+        height = (height > 1) ? height / 2 : 1;
 
-        hbuf->flags |= IB_tilecache;
+        hbuf = IMB_allocImBuf(width, height, 32, 0);
+        hbuf->miplevel = level;
+        hbuf->ftype = ibuf->ftype;
+        ibuf->mipmap[level - 1] = hbuf;
+      }
+      else {
+        hbuf = ibuf;
+      }
 
-        TIFFGetField(image, TIFFTAG_TILEWIDTH, &hbuf->tilex);
-        TIFFGetField(image, TIFFTAG_TILELENGTH, &hbuf->tiley);
+      hbuf->flags |= IB_tilecache;
 
-        hbuf->xtiles = ceil(hbuf->x / (float)hbuf->tilex);
-        hbuf->ytiles = ceil(hbuf->y / (float)hbuf->tiley);
+      TIFFGetField(image, TIFFTAG_TILEWIDTH, &hbuf->tilex);
+      TIFFGetField(image, TIFFTAG_TILELENGTH, &hbuf->tiley);
 
-        imb_addtilesImBuf(hbuf);
+      hbuf->xtiles = ceil(hbuf->x / (float)hbuf->tilex);
+      hbuf->ytiles = ceil(hbuf->y / (float)hbuf->tiley);
 
-        ibuf->miptot++;
-      }
+      imb_addtilesImBuf(hbuf);
+
+      ibuf->miptot++;
     }
   }
 
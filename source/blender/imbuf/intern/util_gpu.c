@@ -211,6 +211,109 @@ void IMB_update_gpu_texture_sub(GPUTexture *tex,
   }
 }
 
+typedef struct GPUTileUpload {
+  GPUTexture *tex;
+  const ImBuf *ibuf;
+  ImBuf *tilebuf;
+  int x, y, z;
+  /* Size of the texture region, and of the mipmap level that is uploaded into it. */
+  int w, h;
+  int level_w, level_h;
+  bool use_high_bitdepth;
+  bool use_premult;
+} GPUTileUpload;
+
+static void imb_gpu_tile_copy(
+    ImBuf *dst, const unsigned int *rect, int x, int y, int w, int h, int stride)
+{
+  unsigned int *to = dst->rect + (size_t)dst->x * y + x;
+
+  for (int i = 0; i < h; i++) {
+    memcpy(to, rect, sizeof(unsigned int) * w);
+    rect += stride;
+    to += dst->x;
+  }
+}
+
+static void imb_gpu_tile_upload(
+    void *custom_data, const unsigned int *rect, int x, int y, int w, int h, int stride)
+{
+  GPUTileUpload *data = (GPUTileUpload *)custom_data;
+  ImBuf *tilebuf = data->tilebuf;
+
+  /* Part of the texture region covered by the tile, when the level is larger than the region
+   * the tile is scaled down to it. */
+  const int dst_x = (int)(((int64_t)x * data->w) / data->level_w);
+  const int dst_y = (int)(((int64_t)y * data->h) / data->level_h);
+  const int dst_w = (int)(((int64_t)(x + w) * data->w) / data->level_w) - dst_x;
+  const int dst_h = (int)(((int64_t)(y + h) * data->h) / data->level_h) - dst_y;
+
+  if (dst_w <= 0 || dst_h <= 0) {
+    return;
+  }
+
+  /* Tiles at the end of the image are smaller, reuse the same buffer for all. */
+  tilebuf->x = w;
+  tilebuf->y = h;
+  imb_gpu_tile_copy(tilebuf, rect, 0, 0, w, h, stride);
+
+  IMB_update_gpu_texture_sub(data->tex,
+                             tilebuf,
+                             data->x + dst_x,
+                             data->y + dst_y,
+                             data->z,
+                             dst_w,
+                             dst_h,
+                             data->use_high_bitdepth,
+                             data->use_premult);
+}
+
+/* Will update a GPUTexture using an ImBuf that has its pixels in the tile cache (IB_tilecache).
+ * The smallest mipmap level stored in the file that still covers the texture size is uploaded
+ * tile by tile, so that the full image never has to be in memory at once. When that level is
+ * larger than the texture, every tile is scaled down to its part of the texture. */
+void IMB_update_gpu_texture_tiles(GPUTexture *tex,
+                                  ImBuf *ibuf,
+                                  int x,
+                                  int y,
+                                  int z,
+                                  int w,
+                                  int h,
+                                  bool use_high_bitdepth,
+                                  bool use_premult)
+{
+  ImBuf *mipbuf = ibuf;
+
+  for (int level = 1; level < ibuf->miptot; level++) {
+    ImBuf *levelbuf = IMB_getmipmap(ibuf, level);
+    if (levelbuf->x < w || levelbuf->y < h) {
+      break;
+    }
+    mipbuf = levelbuf;
+  }
+
+  GPUTileUpload data = {
+      .tex = tex,
+      .ibuf = ibuf,
+      .x = x,
+      .y = y,
+      .z = z,
+      .w = w,
+      .h = h,
+      .level_w = mipbuf->x,
+      .level_h = mipbuf->y,
+      .use_high_bitdepth = use_high_bitdepth,
+      .use_premult = use_premult,
+  };
+
+  data.tilebuf = IMB_allocImBuf(mipbuf->tilex, mipbuf->tiley, 32, IB_rect);
+  data.tilebuf->rect_colorspace = ibuf->rect_colorspace;
+
+  IMB_tiles_foreach(mipbuf, imb_gpu_tile_upload, &data);
+
+  IMB_freeImBuf(data.tilebuf);
+}
+
 GPUTexture *IMB_create_gpu_texture(const char *name,
                                    ImBuf *ibuf,
                                    bool use_high_bitdepth,
@@ -0,0 +1,147 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+/* Byte buffers big enough to be transformed through a baked LUT are compared against the exact
+ * OCIO transform of every pixel. */
+
+#include <cstdlib>
+#include <cstring>
+
+#include "tests/blendfile_loading_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math_base.h"
+#include "BLI_math_color.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+
+#include "DNA_color_types.h"
+
+#include "IMB_colormanagement.h"
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+/* Interpolation error allowed, in byte levels. */
+static const int byte_lut_tolerance = 2;
+
+class colormanagement_byte_lut : public BlendfileLoadingBaseTest {
+ protected:
+  static const int size = 512;
+  ImBuf *ibuf = nullptr;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+
+    ibuf = IMB_allocImBuf(size, size, 32, IB_rect);
+    ASSERT_NE(ibuf, nullptr);
+
+    RNG *rng = BLI_rng_new(0);
+    unsigned char *rect = (unsigned char *)ibuf->rect;
+    for (size_t i = 0; i < (size_t)size * size * 4; i++) {
+      rect[i] = BLI_rng_get_uint(rng) & 0xff;
+    }
+    BLI_rng_free(rng);
+  }
+
+  void TearDown() override
+  {
+    IMB_freeImBuf(ibuf);
+    ibuf = nullptr;
+
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  /* Largest difference in RGB, alpha is expected to be kept as is. */
+  int max_error(const unsigned char *result, const unsigned char *expected)
+  {
+    int error = 0;
+    for (size_t i = 0; i < (size_t)size * size * 4; i += 4) {
+      for (int j = 0; j < 3; j++) {
+        error = max_ii(error, abs((int)result[i + j] - (int)expected[i + j]));
+      }
+      EXPECT_EQ(result[i + 3], expected[i + 3]);
+    }
+    return error;
+  }
+};
+
+TEST_F(colormanagement_byte_lut, display_buffer)
+{
+  ColorManagedDisplaySettings display_settings;
+  ColorManagedViewSettings view_settings;
+
+  STRNCPY(display_settings.display_device, IMB_colormanagement_display_get_default_name());
+  IMB_colormanagement_init_default_view_settings(&view_settings, &display_settings);
+  /* Otherwise the byte buffer is already in display space and not transformed at all. */
+  view_settings.exposure = 0.5f;
+  view_settings.gamma = 0.8f;
+
+  void *cache_handle = nullptr;
+  unsigned char *display_buffer = IMB_display_buffer_acquire(
+      ibuf, &view_settings, &display_settings, &cache_handle);
+  ASSERT_NE(display_buffer, nullptr);
+
+  ColormanageProcessor *cm_processor = IMB_colormanagement_display_processor_new(
+      &view_settings, &display_settings);
+  const unsigned char *rect = (unsigned char *)ibuf->rect;
+  unsigned char *expected = (unsigned char *)MEM_mallocN((size_t)size * size * 4, __func__);
+
+  for (size_t i = 0; i < (size_t)size * size * 4; i += 4) {
+    float pixel[4];
+    rgba_uchar_to_float(pixel, rect + i);
+    IMB_colormanagement_colorspace_to_scene_linear_v3(pixel, ibuf->rect_colorspace);
+    IMB_colormanagement_processor_apply_v4(cm_processor, pixel);
+    rgba_float_to_uchar(expected + i, pixel);
+  }
+
+  EXPECT_LE(max_error(display_buffer, expected), byte_lut_tolerance);
+
+  MEM_freeN(expected);
+  IMB_colormanagement_processor_free(cm_processor);
+  IMB_display_buffer_release(cache_handle);
+}
+
+TEST_F(colormanagement_byte_lut, transform_byte)
+{
+  const char *from_colorspace = IMB_colormanagement_role_colorspace_name_get(
+      COLOR_ROLE_DEFAULT_BYTE);
+  const char *to_colorspace = IMB_colormanagement_role_colorspace_name_get(
+      COLOR_ROLE_SCENE_LINEAR);
+  const size_t buffer_size = (size_t)size * size * 4;
+
+  /* Only the threaded transform uses the LUT. */
+  unsigned char *result = (unsigned char *)MEM_dupallocN(ibuf->rect);
+  unsigned char *expected = (unsigned char *)MEM_dupallocN(ibuf->rect);
+  IMB_colormanagement_transform_byte_threaded(
+      result, size, size, 4, from_colorspace, to_colorspace);
+  IMB_colormanagement_transform_byte(expected, size, size, 4, from_colorspace, to_colorspace);
+
+  EXPECT_LE(max_error(result, expected), byte_lut_tolerance);
+
+  /* Transforming again hits the cached LUT and gives the same result. */
+  unsigned char *result_cached = (unsigned char *)MEM_dupallocN(ibuf->rect);
+  IMB_colormanagement_transform_byte_threaded(
+      result_cached, size, size, 4, from_colorspace, to_colorspace);
+  EXPECT_EQ(memcmp(result, result_cached, buffer_size), 0);
+
+  MEM_freeN(result_cached);
+  MEM_freeN(expected);
+  MEM_freeN(result);
+}
@@ -0,0 +1,317 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+/* The box filter of IMB_scaleImBuf() is compared against the output of the scaledownx,
+ * scaledowny, scaleupx and scaleupy functions it replaced, for a test pattern. The bilinear
+ * filter of IMB_scaleImBuf_threaded() deliberately differs from the point sampling it replaced,
+ * so it is checked for keeping flat areas and gradients, and for not aliasing when shrinking.
+ * The Mitchell and Lanczos filters are checked for ringing at edges, which byte images clamp. */
+
+#include "testing/testing.h"
+
+#include "BLI_math_base.h"
+#include "BLI_utildefines.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+/* Difference to the previous code allowed, in byte levels. */
+static const int box_tolerance = 2;
+
+/* Output of the previous code for the test pattern. */
+static const unsigned char box_shrink_byte[80] = {
+    95, 128, 156, 116, 145, 139, 146, 144, 124, 134, 133, 123, 135, 164, 120, 92,
+    117, 108, 152, 138, 129, 119, 105, 151, 133, 118, 134, 124, 161, 138, 128, 127,
+    112, 124, 148, 112, 99, 106, 125, 161, 143, 103, 152, 100, 144, 83, 154, 101,
+    121, 128, 131, 108, 120, 131, 130, 158, 163, 111, 130, 137, 92, 137, 144, 134,
+    132, 104, 141, 122, 107, 132, 125, 145, 130, 116, 132, 143, 119, 126, 128, 161,
+};
+
+static const float box_shrink_float[80] = {
+    0.3734f, 0.5018f, 0.6126f, 0.4558f, 0.5686f, 0.5463f, 0.5737f, 0.5676f,
+    0.4842f, 0.5276f, 0.5225f, 0.4832f, 0.5316f, 0.6435f, 0.4706f, 0.3629f,
+    0.4619f, 0.4209f, 0.5969f, 0.5435f, 0.5079f, 0.4686f, 0.4126f, 0.5911f,
+    0.5210f, 0.4647f, 0.5254f, 0.4851f, 0.6304f, 0.5408f, 0.5015f, 0.4957f,
+    0.4404f, 0.4841f, 0.5776f, 0.4394f, 0.3864f, 0.4130f, 0.4903f, 0.6323f,
+    0.5597f, 0.4025f, 0.5975f, 0.3911f, 0.5625f, 0.3227f, 0.6012f, 0.3946f,
+    0.4758f, 0.5022f, 0.5136f, 0.4224f, 0.4703f, 0.5136f, 0.5090f, 0.6186f,
+    0.6391f, 0.4355f, 0.5118f, 0.5397f, 0.3597f, 0.5382f, 0.5640f, 0.5247f,
+    0.5158f, 0.4078f, 0.5528f, 0.4793f, 0.4207f, 0.5159f, 0.4909f, 0.5709f,
+    0.5108f, 0.4556f, 0.5159f, 0.5610f, 0.4654f, 0.4936f, 0.5047f, 0.6303f,
+};
+
+static const unsigned char box_enlarge_byte[180] = {
+    0, 71, 142, 213, 20, 91, 162, 137, 40, 111, 182, 61, 60, 131, 202, 17,
+    79, 150, 221, 36, 99, 170, 241, 56, 119, 190, 197, 76, 139, 210, 121, 96,
+    159, 230, 45, 116, 48, 119, 190, 134, 71, 142, 165, 108, 93, 164, 140, 82,
+    115, 170, 130, 72, 137, 145, 152, 94, 160, 119, 174, 117, 150, 125, 164, 139,
+    125, 148, 138, 161, 99, 170, 113, 184, 97, 168, 239, 54, 122, 193, 168, 79,
+    146, 217, 97, 103, 171, 210, 57, 128, 196, 139, 82, 153, 221, 68, 107, 178,
+    182, 60, 131, 202, 110, 85, 156, 227, 39, 110, 181, 252, 145, 89, 160, 102,
+    125, 116, 139, 130, 104, 143, 118, 156, 99, 154, 113, 168, 126, 133, 140, 148,
+    154, 112, 167, 127, 149, 123, 162, 138, 127, 150, 142, 165, 107, 178, 121, 192,
+    194, 9, 80, 151, 128, 39, 110, 181, 61, 68, 139, 210, 27, 98, 169, 208,
+    56, 127, 198, 142, 86, 157, 228, 75, 116, 187, 194, 73, 145, 216, 128, 102,
+    175, 246, 61, 132,
+};
+
+static const float box_enlarge_float[180] = {
+    0.0000f, 0.2784f, 0.5569f, 0.8353f, 0.0779f, 0.3563f, 0.6348f, 0.5369f,
+    0.1558f, 0.4343f, 0.7127f, 0.2384f, 0.2337f, 0.5122f, 0.7906f, 0.0651f,
+    0.3117f, 0.5901f, 0.8685f, 0.1430f, 0.3896f, 0.6680f, 0.9464f, 0.2209f,
+    0.4675f, 0.7459f, 0.7741f, 0.2989f, 0.5454f, 0.8238f, 0.4757f, 0.3768f,
+    0.6233f, 0.9018f, 0.1773f, 0.4547f, 0.1901f, 0.4685f, 0.7470f, 0.5237f,
+    0.2776f, 0.5560f, 0.6464f, 0.4229f, 0.3650f, 0.6435f, 0.5457f, 0.3221f,
+    0.4525f, 0.6684f, 0.5077f, 0.2839f, 0.5400f, 0.5678f, 0.5951f, 0.3713f,
+    0.6274f, 0.4672f, 0.6826f, 0.4588f, 0.5898f, 0.4916f, 0.6449f, 0.5463f,
+    0.4892f, 0.5791f, 0.5441f, 0.6337f, 0.3886f, 0.6666f, 0.4433f, 0.7212f,
+    0.3802f, 0.6586f, 0.9371f, 0.2121f, 0.4772f, 0.7557f, 0.6579f, 0.3089f,
+    0.5742f, 0.8527f, 0.3788f, 0.4057f, 0.6713f, 0.8246f, 0.2247f, 0.5026f,
+    0.7683f, 0.5455f, 0.3217f, 0.5996f, 0.8653f, 0.2664f, 0.4187f, 0.6967f,
+    0.7122f, 0.2373f, 0.5156f, 0.7937f, 0.4331f, 0.3343f, 0.6125f, 0.8907f,
+    0.1539f, 0.4313f, 0.7093f, 0.9877f, 0.5703f, 0.3475f, 0.6260f, 0.4017f,
+    0.4890f, 0.4541f, 0.5441f, 0.5082f, 0.4077f, 0.5607f, 0.4622f, 0.6148f,
+    0.3888f, 0.6046f, 0.4429f, 0.6589f, 0.4954f, 0.5227f, 0.5495f, 0.5776f,
+    0.6019f, 0.4408f, 0.6561f, 0.4963f, 0.5832f, 0.4842f, 0.6377f, 0.5399f,
+    0.5013f, 0.5908f, 0.5564f, 0.6464f, 0.4194f, 0.6974f, 0.4751f, 0.7530f,
+    0.7604f, 0.0359f, 0.3143f, 0.5918f, 0.5006f, 0.1520f, 0.4301f, 0.7079f,
+    0.2407f, 0.2682f, 0.5458f, 0.8240f, 0.1058f, 0.3841f, 0.6617f, 0.8151f,
+    0.2220f, 0.4999f, 0.7778f, 0.5553f, 0.3381f, 0.6156f, 0.8939f, 0.2954f,
+    0.4539f, 0.7316f, 0.7601f, 0.2856f, 0.5697f, 0.8477f, 0.5002f, 0.4017f,
+    0.6854f, 0.9639f, 0.2404f, 0.5178f,
+};
+static int pattern(int x, int y, int c)
+{
+  return (x * 53 + y * 97 + c * 71 + x * y * 13) % 256;
+}
+
+static ImBuf *pattern_ibuf(int width, int height, bool is_float)
+{
+  ImBuf *ibuf = IMB_allocImBuf(width, height, 32, is_float ? IB_rectfloat : IB_rect);
+  unsigned char *rect = (unsigned char *)ibuf->rect;
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      for (int c = 0; c < 4; c++) {
+        const size_t i = ((size_t)y * width + x) * 4 + c;
+        if (is_float) {
+          ibuf->rect_float[i] = pattern(x, y, c) / 255.0f;
+        }
+        else {
+          rect[i] = pattern(x, y, c);
+        }
+      }
+    }
+  }
+
+  return ibuf;
+}
+
+/* Image with the same value in all channels, from a function of the pixel position. */
+template<typename F> static ImBuf *function_ibuf(int width, int height, bool is_float, F f)
+{
+  ImBuf *ibuf = IMB_allocImBuf(width, height, 32, is_float ? IB_rectfloat : IB_rect);
+  unsigned char *rect = (unsigned char *)ibuf->rect;
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      const float value = f(x, y);
+      for (int c = 0; c < 4; c++) {
+        const size_t i = ((size_t)y * width + x) * 4 + c;
+        if (is_float) {
+          ibuf->rect_float[i] = value;
+        }
+        else {
+          rect[i] = unit_float_to_uchar_clamp(value);
+        }
+      }
+    }
+  }
+
+  return ibuf;
+}
+
+/* Value of a channel as float, whichever buffer the image has. */
+static float pixel_value(const ImBuf *ibuf, int x, int y, int c)
+{
+  const size_t i = ((size_t)y * ibuf->x + x) * 4 + c;
+  if (ibuf->rect_float) {
+    return ibuf->rect_float[i];
+  }
+  return ((const unsigned char *)ibuf->rect)[i] / 255.0f;
+}
+
+static void expect_box_scale(
+    int width, int height, int newx, int newy, const unsigned char *expected_byte)
+{
+  ImBuf *ibuf = pattern_ibuf(width, height, false);
+  EXPECT_TRUE(IMB_scaleImBuf(ibuf, newx, newy));
+  ASSERT_EQ(ibuf->x, newx);
+  ASSERT_EQ(ibuf->y, newy);
+
+  const unsigned char *rect = (const unsigned char *)ibuf->rect;
+  for (int i = 0; i < newx * newy * 4; i++) {
+    EXPECT_NEAR(rect[i], expected_byte[i], box_tolerance) << "at " << i;
+  }
+
+  IMB_freeImBuf(ibuf);
+}
+
+static void expect_box_scale(
+    int width, int height, int newx, int newy, const float *expected_float)
+{
+  ImBuf *ibuf = pattern_ibuf(width, height, true);
+  EXPECT_TRUE(IMB_scaleImBuf(ibuf, newx, newy));
+  ASSERT_EQ(ibuf->x, newx);
+  ASSERT_EQ(ibuf->y, newy);
+
+  for (int i = 0; i < newx * newy * 4; i++) {
+    EXPECT_NEAR(ibuf->rect_float[i], expected_float[i], box_tolerance / 255.0f) << "at " << i;
+  }
+
+  IMB_freeImBuf(ibuf);
+}
+
+TEST(imbuf_scaling, box_shrink_byte)
+{
+  expect_box_scale(12, 10, 5, 4, box_shrink_byte);
+}
+
+TEST(imbuf_scaling, box_shrink_float)
+{
+  expect_box_scale(12, 10, 5, 4, box_shrink_float);
+}
+
+TEST(imbuf_scaling, box_enlarge_byte)
+{
+  expect_box_scale(4, 3, 9, 5, box_enlarge_byte);
+}
+
+TEST(imbuf_scaling, box_enlarge_float)
+{
+  expect_box_scale(4, 3, 9, 5, box_enlarge_float);
+}
+
+TEST(imbuf_scaling, flat_stays_flat)
+{
+  const eIMBScaleFilter filters[] = {IMB_SCALE_FILTER_BOX,
+                                     IMB_SCALE_FILTER_BILINEAR,
+                                     IMB_SCALE_FILTER_MITCHELL,
+                                     IMB_SCALE_FILTER_LANCZOS};
+  const int sizes[][2] = {{5, 4}, {31, 23}, {5, 23}};
+
+  for (eIMBScaleFilter filter : filters) {
+    for (const int *size : sizes) {
+      for (bool is_float : {false, true}) {
+        ImBuf *ibuf = function_ibuf(12, 10, is_float, [](int, int) { return 0.6f; });
+        EXPECT_TRUE(IMB_scaleImBuf_ex(ibuf, size[0], size[1], filter));
+
+        for (int y = 0; y < ibuf->y; y++) {
+          for (int x = 0; x < ibuf->x; x++) {
+            EXPECT_NEAR(pixel_value(ibuf, x, y, 0), is_float ? 0.6f : 153 / 255.0f, 1e-5f);
+          }
+        }
+
+        IMB_freeImBuf(ibuf);
+      }
+    }
+  }
+}
+
+TEST(imbuf_scaling, bilinear_enlarge_gradient)
+{
+  for (bool is_float : {false, true}) {
+    /* Horizontal gradient from 0 to 1 over the pixel centers. */
+    ImBuf *ibuf = function_ibuf(6, 3, is_float, [](int x, int) { return x / 5.0f; });
+    IMB_scaleImBuf_threaded(ibuf, 17, 7);
+    ASSERT_EQ(ibuf->x, 17);
+    ASSERT_EQ(ibuf->y, 7);
+
+    /* Pixel centers map onto the source pixel centers, and the gradient is extended as a
+     * constant beyond the outer ones. */
+    for (int y = 0; y < ibuf->y; y++) {
+      for (int x = 0; x < ibuf->x; x++) {
+        const float source_x = clamp_f((x + 0.5f) * 6.0f / 17.0f - 0.5f, 0.0f, 5.0f);
+        EXPECT_NEAR(pixel_value(ibuf, x, y, 0), source_x / 5.0f, 1.0f / 255.0f);
+      }
+    }
+
+    IMB_freeImBuf(ibuf);
+  }
+}
+
+TEST(imbuf_scaling, bilinear_shrink_antialiased)
+{
+  for (bool is_float : {false, true}) {
+    /* Point sampling a checkerboard of single pixels gives black or white, filtering it gives
+     * close to middle gray. */
+    ImBuf *ibuf = function_ibuf(
+        64, 48, is_float, [](int x, int y) { return ((x + y) & 1) ? 1.0f : 0.0f; });
+    IMB_scaleImBuf_threaded(ibuf, 13, 9);
+    ASSERT_EQ(ibuf->x, 13);
+    ASSERT_EQ(ibuf->y, 9);
+
+    for (int y = 0; y < ibuf->y; y++) {
+      for (int x = 0; x < ibuf->x; x++) {
+        EXPECT_NEAR(pixel_value(ibuf, x, y, 0), 0.5f, 0.05f);
+      }
+    }
+
+    IMB_freeImBuf(ibuf);
+  }
+}
+
+TEST(imbuf_scaling, sharp_filters_enlarge_edge)
+{
+  const eIMBScaleFilter filters[] = {IMB_SCALE_FILTER_MITCHELL, IMB_SCALE_FILTER_LANCZOS};
+
+  for (eIMBScaleFilter filter : filters) {
+    for (bool is_float : {false, true}) {
+      /* Vertical edge between black and white in the middle. */
+      ImBuf *ibuf = function_ibuf(
+          16, 4, is_float, [](int x, int) { return x < 8 ? 0.0f : 1.0f; });
+      EXPECT_TRUE(IMB_scaleImBuf_ex(ibuf, 64, 4, filter));
+      ASSERT_EQ(ibuf->x, 64);
+      ASSERT_EQ(ibuf->y, 4);
+
+      float min_value = FLT_MAX, max_value = -FLT_MAX;
+      for (int x = 0; x < ibuf->x; x++) {
+        const float value = pixel_value(ibuf, x, 0, 0);
+        min_value = min_ff(min_value, value);
+        max_value = max_ff(max_value, value);
+
+        /* The edge stays in place, symmetric around the middle. */
+        EXPECT_NEAR(value + pixel_value(ibuf, ibuf->x - 1 - x, 0, 0), 1.0f, 2.0f / 255.0f);
+        EXPECT_EQ(value < 0.5f, x < 32) << "at " << x;
+      }
+
+      if (is_float) {
+        /* Negative lobes of the kernels ring next to the edge. */
+        EXPECT_LT(min_value, -0.02f);
+        EXPECT_GT(max_value, 1.02f);
+      }
+      else {
+        /* Bytes saturate instead of wrapping around. */
+        EXPECT_EQ(min_value, 0.0f);
+        EXPECT_EQ(max_value, 1.0f);
+      }
+
+      IMB_freeImBuf(ibuf);
+    }
+  }
+}
@@ -9918,6 +9918,13 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
   RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_GROUPNODE_BUFFER);
   RNA_def_property_ui_text(prop, "Buffer Groups", "Enable buffering of group nodes");
 
+  prop = RNA_def_property(srna, "use_half_float_buffers", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_HALF_FLOAT_BUFFER);
+  RNA_def_property_ui_text(prop,
+                           "Half Float Buffers",
+                           "Store intermediate buffers with half float precision, halving their "
+                           "memory usage at the cost of precision");
+
   prop = RNA_def_property(srna, "use_two_pass", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_TWO_PASS);
   RNA_def_property_ui_text(prop,
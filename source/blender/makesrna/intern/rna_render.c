@@ -461,13 +461,28 @@ static int rna_RenderPass_rect_get_length(PointerRNA *ptr, int length[RNA_MAX_AR
 static void rna_RenderPass_rect_get(PointerRNA *ptr, float *values)
 {
   RenderPass *rpass = (RenderPass *)ptr->data;
-  memcpy(values, rpass->rect, sizeof(float) * rpass->rectx * rpass->recty * rpass->channels);
+  const size_t size = sizeof(float) * rpass->rectx * rpass->recty * rpass->channels;
+
+  /* Passes of save buffers renders and multilayer images which were not read yet. */
+  if (rpass->rect == NULL) {
+    memset(values, 0, size);
+    return;
+  }
+
+  memcpy(values, rpass->rect, size);
 }
 
 void rna_RenderPass_rect_set(PointerRNA *ptr, const float *values)
 {
   RenderPass *rpass = (RenderPass *)ptr->data;
-  memcpy(rpass->rect, values, sizeof(float) * rpass->rectx * rpass->recty * rpass->channels);
+  const size_t size = sizeof(float) * rpass->rectx * rpass->recty * rpass->channels;
+
+  /* Replaces the whole pass, so a pass which was not read yet doesn't need to be. */
+  if (rpass->rect == NULL) {
+    rpass->rect = MEM_mallocN(size, "render pass rect");
+  }
+
+  memcpy(rpass->rect, values, size);
 }
 
 static RenderPass *rna_RenderPass_find_by_type(RenderLayer *rl, int passtype, const char *view)
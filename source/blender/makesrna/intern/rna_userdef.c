@@ -192,6 +192,8 @@ static const EnumPropertyItem rna_enum_userdef_viewport_aa_items[] = {
 #  include "GPU_select.h"
 #  include "GPU_texture.h"
 
+#  include "IMB_imbuf.h"
+
 #  include "BLF_api.h"
 
 #  include "BLI_path_util.h"
@@ -551,6 +553,7 @@ static void rna_Userdef_memcache_update(Main *UNUSED(bmain),
                                         PointerRNA *UNUSED(ptr))
 {
   MEM_CacheLimiter_set_maximum(((size_t)U.memcachelimit) * 1024 * 1024);
+  IMB_tile_cache_params(0, U.memcachelimit);
   USERDEF_TAG_DIRTY;
 }
 
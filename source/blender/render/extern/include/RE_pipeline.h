@@ -104,6 +104,8 @@ typedef struct RenderLayer {
 
   /** Optional saved endresult on disk. */
   void *exrhandle;
+  /** Save buffers file passes which are not in memory are read from, after rendering. */
+  void *exrhandle_read;
 
   ListBase passes;
 
@@ -155,6 +157,14 @@ typedef struct RenderResult {
   char *error;
 
   struct StampData *stamp_data;
+
+  /* multilayer file for passes which are not read yet, see #RE_MultilayerOpen, the file is
+   * reopened for every read and its modification time and size are checked to match */
+  char *exr_filepath;
+  int64_t exr_file_mtime;
+  int64_t exr_file_size;
+  char exr_colorspace[64];
+  bool exr_predivide;
 } RenderResult;
 
 typedef struct RenderStats {
@@ -321,6 +331,12 @@ bool RE_WriteRenderResult(struct ReportList *reports,
                           int layer);
 struct RenderResult *RE_MultilayerConvert(
     void *exrhandle, const char *colorspace, bool predivide, int rectx, int recty);
+struct RenderResult *RE_MultilayerOpen(const char *filepath,
+                                       const char *colorspace,
+                                       bool predivide);
+bool RE_RenderPassEnsureLoaded(RenderResult *rr, RenderPass *rpass);
+void RE_RenderPassesEnsureLoaded(RenderResult *rr, RenderPass **passes, int tot);
+bool RE_RenderResultEnsureLoaded(RenderResult *rr, struct ReportList *reports);
 
 /* display and event callbacks */
 void RE_display_init_cb(struct Render *re,
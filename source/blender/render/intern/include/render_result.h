@@ -27,6 +27,8 @@
 
 #define RR_USE_MEM 0
 #define RR_USE_EXR 1
+/* Only Combined is allocated, other passes are read from the save buffers files when used. */
+#define RR_USE_EXR_READ 2
 
 #define RR_ALL_LAYERS NULL
 #define RR_ALL_VIEWS NULL
@@ -58,6 +60,9 @@ struct RenderResult *render_result_new(struct Render *re,
 
 struct RenderResult *render_result_new_from_exr(
     void *exrhandle, const char *colorspace, bool predivide, int rectx, int recty);
+struct RenderResult *render_result_new_from_exr_lazy(const char *filepath,
+                                                     const char *colorspace,
+                                                     bool predivide);
 
 void render_result_view_new(struct RenderResult *rr, const char *viewname);
 void render_result_views_new(struct RenderResult *rr, const struct RenderData *rd);
@@ -105,6 +110,7 @@ void render_result_exr_file_path(struct Scene *scene,
 int render_result_exr_file_read_path(struct RenderResult *rr,
                                      struct RenderLayer *rl_single,
                                      const char *filepath);
+bool render_layer_exr_pass_ensure_loaded(struct RenderLayer *rl, struct RenderPass *rpass);
 
 /* EXR cache */
 
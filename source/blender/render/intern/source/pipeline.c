@@ -274,7 +274,14 @@ void RE_FreeRenderResult(RenderResult *rr)
 float *RE_RenderLayerGetPass(volatile RenderLayer *rl, const char *name, const char *viewname)
 {
   RenderPass *rpass = RE_pass_find_by_name(rl, name, viewname);
-  return rpass ? rpass->rect : NULL;
+  if (rpass == NULL) {
+    return NULL;
+  }
+  /* Passes of save buffers renders are read from the files when first used. */
+  if (rpass->rect == NULL && rl->exrhandle_read) {
+    render_layer_exr_pass_ensure_loaded((RenderLayer *)rl, rpass);
+  }
+  return rpass->rect;
 }
 
 RenderLayer *RE_GetRenderLayer(RenderResult *rr, const char *name)
@@ -297,6 +304,11 @@ RenderResult *RE_MultilayerConvert(
   return render_result_new_from_exr(exrhandle, colorspace, predivide, rectx, recty);
 }
 
+RenderResult *RE_MultilayerOpen(const char *filepath, const char *colorspace, bool predivide)
+{
+  return render_result_new_from_exr_lazy(filepath, colorspace, predivide);
+}
+
 RenderLayer *render_get_active_layer(Render *re, RenderResult *rr)
 {
   ViewLayer *view_layer = BLI_findlink(&re->view_layers, re->active_view_layer);
@@ -376,6 +388,10 @@ void RE_SwapResult(Render *re, RenderResult **rr)
 {
   /* for keeping render buffers */
   if (re) {
+    /* The save buffers files get overwritten by the next render. */
+    if (re->result) {
+      RE_RenderResultEnsureLoaded(re->result, NULL);
+    }
     SWAP(RenderResult *, re->result, *rr);
   }
 }
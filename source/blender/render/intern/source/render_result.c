@@ -28,9 +28,11 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_fileops.h"
 #include "BLI_ghash.h"
 #include "BLI_hash_md5.h"
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_path_util.h"
 #include "BLI_rect.h"
 #include "BLI_string.h"
@@ -99,6 +101,9 @@ void render_result_free(RenderResult *rr)
       BLI_remlink(&rl->passes, rpass);
       MEM_freeN(rpass);
     }
+    if (rl->exrhandle_read) {
+      IMB_exr_close(rl->exrhandle_read);
+    }
     BLI_remlink(&rr->layers, rl);
     MEM_freeN(rl);
   }
@@ -123,6 +128,10 @@ void render_result_free(RenderResult *rr)
 
   BKE_stamp_data_free(rr->stamp_data);
 
+  if (rr->exr_filepath) {
+    MEM_freeN(rr->exr_filepath);
+  }
+
   MEM_freeN(rr);
 }
 
@@ -250,8 +259,10 @@ RenderPass *render_layer_add_pass(RenderResult *rr,
   }
 
   /* Always allocate combined for display, in case of save buffers
-   * other passes are not allocated and only saved to the EXR file. */
-  if (rl->exrhandle == NULL || STREQ(rpass->name, RE_PASSNAME_COMBINED)) {
+   * other passes are not allocated and only saved to the EXR file.
+   * After rendering they are read back from the file when used. */
+  if ((rl->exrhandle == NULL && rl->exrhandle_read == NULL) ||
+      STREQ(rpass->name, RE_PASSNAME_COMBINED)) {
     float *rect;
     int x;
 
@@ -281,6 +292,25 @@ RenderPass *render_layer_add_pass(RenderResult *rr,
   return rpass;
 }
 
+/* Open the save buffers file of the layer, to read passes from when they are used. */
+static void render_layer_exr_open_read(Render *re, RenderResult *rr, RenderLayer *rl)
+{
+  char str[FILE_MAX];
+  void *exrhandle = IMB_exr_get_handle();
+  int rectx, recty;
+
+  render_result_exr_file_path(re->scene, rl->name, 0, str);
+
+  if (IMB_exr_begin_read(exrhandle, str, &rectx, &recty) && rectx == rr->rectx &&
+      recty == rr->recty) {
+    rl->exrhandle_read = exrhandle;
+  }
+  else {
+    /* All passes get allocated and are read at once, as before. */
+    IMB_exr_close(exrhandle);
+  }
+}
+
 /* called by main render as well for parts */
 /* will read info from Render *re to define layers */
 /* called in threads */
@@ -318,7 +348,7 @@ RenderResult *render_result_new(Render *re,
   rr->tilerect.ymin = partrct->ymin - re->disprect.ymin;
   rr->tilerect.ymax = partrct->ymax - re->disprect.ymin;
 
-  if (savebuffers) {
+  if (savebuffers == RR_USE_EXR) {
     rr->do_exr_tile = true;
   }
 
@@ -347,6 +377,9 @@ RenderResult *render_result_new(Render *re,
     if (rr->do_exr_tile) {
       rl->exrhandle = IMB_exr_get_handle();
     }
+    else if (savebuffers == RR_USE_EXR_READ) {
+      render_layer_exr_open_read(re, rr, rl);
+    }
 
     for (rv = rr->views.first; rv; rv = rv->next) {
       const char *view = rv->name;
@@ -772,7 +805,8 @@ RenderResult *render_result_new_from_exr(
       rpass->rectx = rectx;
       rpass->recty = recty;
 
-      if (rpass->channels >= 3) {
+      /* Passes of a lazily opened file are converted once they are read. */
+      if (rpass->rect && rpass->channels >= 3) {
         IMB_colormanagement_transform(rpass->rect,
                                       rpass->rectx,
                                       rpass->recty,
@@ -787,6 +821,319 @@ RenderResult *render_result_new_from_exr(
   return rr;
 }
 
+/* Only reads the layout of a multilayer file, the passes are read from the file the first time
+ * they are used, see #RE_RenderPassEnsureLoaded. Returns NULL for any other file. */
+RenderResult *render_result_new_from_exr_lazy(const char *filepath,
+                                              const char *colorspace,
+                                              bool predivide)
+{
+  BLI_stat_t st;
+  if (BLI_stat(filepath, &st) != 0) {
+    return NULL;
+  }
+
+  void *exrhandle = IMB_exr_get_handle();
+  int rectx, recty;
+
+  if (!IMB_exr_begin_read_multilayer(exrhandle, filepath, &rectx, &recty)) {
+    IMB_exr_close(exrhandle);
+    return NULL;
+  }
+
+  RenderResult *rr = render_result_new_from_exr(exrhandle, colorspace, predivide, rectx, recty);
+
+  ImBuf *ibuf = IMB_allocImBuf(rectx, recty, 32, 0);
+  IMB_exr_get_metadata(exrhandle, &ibuf->metadata);
+  BKE_stamp_info_from_imbuf(rr, ibuf);
+  IMB_freeImBuf(ibuf);
+
+  /* Don't keep the file open, it's reopened for reading the passes. */
+  IMB_exr_close(exrhandle);
+
+  rr->exr_filepath = BLI_strdup(filepath);
+  rr->exr_file_mtime = (int64_t)st.st_mtime;
+  rr->exr_file_size = (int64_t)st.st_size;
+  BLI_strncpy(rr->exr_colorspace, colorspace, sizeof(rr->exr_colorspace));
+  rr->exr_predivide = predivide;
+
+  return rr;
+}
+
+/* Save buffers files are shared between the compositor, the image editor and output writing. */
+static ThreadMutex exr_read_lock = BLI_MUTEX_INITIALIZER;
+
+/* Reads rows ymin to ymax of the passes from the save buffers file of the layer, into buffers
+ * starting at row ymin. Must be called with exr_read_lock held. */
+static void render_layer_exr_read_rows(
+    RenderLayer *rl, RenderPass **passes, float **rects, int tot, int ymin, int ymax)
+{
+  char fullname[EXR_PASS_MAXNAME];
+
+  for (int i = 0; i < tot; i++) {
+    RenderPass *rpass = passes[i];
+    for (int a = 0; a < rpass->channels; a++) {
+      set_pass_full_name(fullname, rpass->name, a, rpass->view, rpass->chan_id);
+      IMB_exr_set_channel(rl->exrhandle_read,
+                          rl->name,
+                          fullname,
+                          rpass->channels,
+                          rpass->channels * rpass->rectx,
+                          rects[i] + a);
+    }
+  }
+
+  IMB_exr_read_channels_rows(rl->exrhandle_read, ymin, ymax);
+
+  /* Don't read these again along with the next passes. */
+  for (int i = 0; i < tot; i++) {
+    RenderPass *rpass = passes[i];
+    for (int a = 0; a < rpass->channels; a++) {
+      set_pass_full_name(fullname, rpass->name, a, rpass->view, rpass->chan_id);
+      IMB_exr_set_channel(rl->exrhandle_read, rl->name, fullname, 0, 0, NULL);
+    }
+  }
+}
+
+/* Reads a pass which was left in the save buffers file after rendering, safe to call from
+ * multiple threads. */
+bool render_layer_exr_pass_ensure_loaded(RenderLayer *rl, RenderPass *rpass)
+{
+  if (rpass->rect) {
+    return true;
+  }
+
+  BLI_mutex_lock(&exr_read_lock);
+
+  if (rpass->rect == NULL && rl->exrhandle_read) {
+    float *rect = MEM_callocN(sizeof(float) * rpass->rectx * rpass->recty * rpass->channels,
+                              "save buffers pass rect");
+    render_layer_exr_read_rows(rl, &rpass, &rect, 1, 0, rpass->recty);
+    rpass->rect = rect;
+  }
+
+  BLI_mutex_unlock(&exr_read_lock);
+
+  return rpass->rect != NULL;
+}
+
+/* Reopens the file of a render result made by #RE_MultilayerOpen, NULL when it was changed on
+ * disk since, its passes no longer match the layout that was read then. */
+static void *render_result_exr_reopen(RenderResult *rr, ReportList *reports)
+{
+  BLI_stat_t st;
+  if (BLI_stat(rr->exr_filepath, &st) != 0 || (int64_t)st.st_mtime != rr->exr_file_mtime ||
+      (int64_t)st.st_size != rr->exr_file_size) {
+    BKE_reportf(reports,
+                RPT_ERROR,
+                "\"%s\" was changed on disk, reload the image to read its passes",
+                rr->exr_filepath);
+    return NULL;
+  }
+
+  void *exrhandle = IMB_exr_get_handle();
+  int rectx, recty;
+
+  if (!IMB_exr_begin_read_multilayer(exrhandle, rr->exr_filepath, &rectx, &recty) ||
+      rectx != rr->rectx || recty != rr->recty) {
+    BKE_reportf(reports, RPT_ERROR, "Cannot read passes from \"%s\"", rr->exr_filepath);
+    IMB_exr_close(exrhandle);
+    return NULL;
+  }
+
+  return exrhandle;
+}
+
+static RenderLayer *render_result_pass_layer(RenderResult *rr, RenderPass *rpass)
+{
+  LISTBASE_FOREACH (RenderLayer *, rl, &rr->layers) {
+    if (BLI_findindex(&rl->passes, rpass) != -1) {
+      return rl;
+    }
+  }
+  return NULL;
+}
+
+/* Reads passes from the file of a render result made by #RE_MultilayerOpen, all of them in a
+ * single read so every part of the file is decompressed only once. Returns false when the file
+ * can't be read anymore. */
+static bool render_result_passes_load(RenderResult *rr,
+                                      ReportList *reports,
+                                      RenderLayer **layers,
+                                      RenderPass **passes,
+                                      int tot)
+{
+  void *exrhandle = render_result_exr_reopen(rr, reports);
+
+  if (exrhandle == NULL) {
+    return false;
+  }
+
+  float **rects = MEM_callocN(sizeof(float *) * tot, "loaded pass rects");
+  int totread = 0;
+
+  for (int i = 0; i < tot; i++) {
+    RenderPass *rpass = passes[i];
+    float *rect = MEM_callocN(sizeof(float) * rpass->rectx * rpass->recty * rpass->channels,
+                              "loaded pass rect");
+
+    if (IMB_exr_set_pass(exrhandle, layers[i]->name, rpass->name, rpass->view, rect)) {
+      rects[i] = rect;
+      totread++;
+    }
+    else {
+      MEM_freeN(rect);
+    }
+  }
+
+  if (totread) {
+    IMB_exr_read_channels(exrhandle);
+  }
+  IMB_exr_close(exrhandle);
+
+  const char *to_colorspace = IMB_colormanagement_role_colorspace_name_get(
+      COLOR_ROLE_SCENE_LINEAR);
+
+  for (int i = 0; i < tot; i++) {
+    RenderPass *rpass = passes[i];
+
+    if (rects[i] == NULL) {
+      continue;
+    }
+
+    if (rpass->channels >= 3) {
+      IMB_colormanagement_transform(rects[i],
+                                    rpass->rectx,
+                                    rpass->recty,
+                                    rpass->channels,
+                                    rr->exr_colorspace,
+                                    to_colorspace,
+                                    rr->exr_predivide);
+    }
+
+    rpass->rect = rects[i];
+  }
+
+  MEM_freeN(rects);
+
+  return true;
+}
+
+/* Reads the pixels of passes from a render result made by #RE_MultilayerOpen, or from the save
+ * buffers file of their layer. Consumers needing several passes should ask for all of them at
+ * once, passes from a multilayer file are then read together. Callers sharing a render result
+ * made by #RE_MultilayerOpen between threads are responsible for locking. */
+void RE_RenderPassesEnsureLoaded(RenderResult *rr, RenderPass **passes, int tot)
+{
+  RenderLayer **file_layers = MEM_callocN(sizeof(RenderLayer *) * tot, __func__);
+  RenderPass **file_passes = MEM_callocN(sizeof(RenderPass *) * tot, __func__);
+  int totfile = 0;
+
+  for (int i = 0; i < tot; i++) {
+    RenderPass *rpass = passes[i];
+
+    if (rpass->rect) {
+      continue;
+    }
+
+    RenderLayer *rl = render_result_pass_layer(rr, rpass);
+
+    if (rl == NULL) {
+      continue;
+    }
+    if (rl->exrhandle_read) {
+      render_layer_exr_pass_ensure_loaded(rl, rpass);
+    }
+    else if (rr->exr_filepath) {
+      file_layers[totfile] = rl;
+      file_passes[totfile] = rpass;
+      totfile++;
+    }
+  }
+
+  if (totfile) {
+    render_result_passes_load(rr, NULL, file_layers, file_passes, totfile);
+  }
+
+  MEM_freeN(file_layers);
+  MEM_freeN(file_passes);
+}
+
+bool RE_RenderPassEnsureLoaded(RenderResult *rr, RenderPass *rpass)
+{
+  if (rpass->rect == NULL) {
+    RE_RenderPassesEnsureLoaded(rr, &rpass, 1);
+  }
+
+  return rpass->rect != NULL;
+}
+
+/* Reads all passes which are not loaded yet and closes the files, for when the render result is
+ * used as a whole, e.g. for copying or keeping it in a render slot. Returns false when some of
+ * the passes could not be read, their rect stays NULL. */
+bool RE_RenderResultEnsureLoaded(RenderResult *rr, ReportList *reports)
+{
+  bool success = true;
+
+  LISTBASE_FOREACH (RenderLayer *, rl, &rr->layers) {
+    if (rl->exrhandle_read) {
+      LISTBASE_FOREACH (RenderPass *, rpass, &rl->passes) {
+        if (!render_layer_exr_pass_ensure_loaded(rl, rpass)) {
+          BKE_reportf(reports,
+                      RPT_ERROR,
+                      "Cannot read pass \"%s\" of \"%s\"",
+                      rpass->name,
+                      rl->name);
+          success = false;
+        }
+      }
+
+      /* Strips of save buffers may still be read from the handle in another thread. */
+      BLI_mutex_lock(&exr_read_lock);
+      IMB_exr_close(rl->exrhandle_read);
+      rl->exrhandle_read = NULL;
+      BLI_mutex_unlock(&exr_read_lock);
+    }
+  }
+
+  if (rr->exr_filepath == NULL) {
+    return success;
+  }
+
+  int tot = 0;
+  LISTBASE_FOREACH (RenderLayer *, rl, &rr->layers) {
+    tot += BLI_listbase_count(&rl->passes);
+  }
+
+  RenderLayer **layers = MEM_callocN(sizeof(RenderLayer *) * tot, __func__);
+  RenderPass **passes = MEM_callocN(sizeof(RenderPass *) * tot, __func__);
+  int totload = 0;
+
+  LISTBASE_FOREACH (RenderLayer *, rl, &rr->layers) {
+    LISTBASE_FOREACH (RenderPass *, rpass, &rl->passes) {
+      if (rpass->rect == NULL) {
+        layers[totload] = rl;
+        passes[totload] = rpass;
+        totload++;
+      }
+    }
+  }
+
+  if (totload && !render_result_passes_load(rr, reports, layers, passes, totload)) {
+    success = false;
+  }
+
+  MEM_freeN(layers);
+  MEM_freeN(passes);
+
+  /* Keep the file for another attempt after reading failed. */
+  if (success) {
+    MEM_freeN(rr->exr_filepath);
+    rr->exr_filepath = NULL;
+  }
+
+  return success;
+}
+
 void render_result_view_new(RenderResult *rr, const char *viewname)
 {
   RenderView *rv = MEM_callocN(sizeof(RenderView), "new render view");
@@ -892,8 +1239,109 @@ void render_result_merge(RenderResult *rr, RenderResult *rrpart)
   }
 }
 
+/* Number of rows written at once when passes are streamed from save buffers files. */
+#define WRITE_STRIP_ROWS 32
+
+/* Rows of a pass or composite buffer which are being written, see #RE_WriteRenderResult. */
+typedef struct WriteStrip {
+  struct WriteStrip *next, *prev;
+  /* Full buffer in memory, or NULL to read from the save buffers file of the layer. */
+  const float *rect;
+  RenderLayer *rl;
+  RenderPass *rpass;
+  int channels;
+  float *strip;
+} WriteStrip;
+
+static bool render_result_has_exr_read_passes(RenderResult *rr)
+{
+  LISTBASE_FOREACH (RenderLayer *, rl, &rr->layers) {
+    if (rl->exrhandle_read) {
+      LISTBASE_FOREACH (RenderPass *, rpass, &rl->passes) {
+        if (rpass->rect == NULL) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/* Returns the buffer to add channels with: the full buffer, or a strip when streaming. */
+static float *write_strip_get(ListBase *strips,
+                              RenderResult *rr,
+                              RenderLayer *rl,
+                              RenderPass *rpass,
+                              float *rect,
+                              int channels)
+{
+  if (strips == NULL) {
+    return rect;
+  }
+
+  WriteStrip *ws = MEM_callocN(sizeof(WriteStrip), "WriteStrip");
+  ws->rect = rect;
+  ws->rl = (rect == NULL) ? rl : NULL;
+  ws->rpass = rpass;
+  ws->channels = channels;
+  ws->strip = MEM_callocN(sizeof(float) * channels * rr->rectx * WRITE_STRIP_ROWS,
+                          "render result write strip");
+  BLI_addtail(strips, ws);
+
+  return ws->strip;
+}
+
+/* Fills the strips with rows ymin to ymax, from memory or from the save buffers files. */
+static void write_strips_fill(ListBase *strips, RenderResult *rr, int ymin, int ymax)
+{
+  const int tot_strips = BLI_listbase_count(strips);
+  RenderPass **passes = MEM_mallocN(sizeof(RenderPass *) * tot_strips, __func__);
+  float **rects = MEM_mallocN(sizeof(float *) * tot_strips, __func__);
+
+  LISTBASE_FOREACH (WriteStrip *, ws, strips) {
+    if (ws->rect) {
+      const size_t row_size = (size_t)ws->channels * rr->rectx;
+      memcpy(ws->strip, ws->rect + row_size * ymin, sizeof(float) * row_size * (ymax - ymin));
+    }
+  }
+
+  /* Read all passes of a layer at once, so the file is decompressed once per strip. */
+  LISTBASE_FOREACH (RenderLayer *, rl, &rr->layers) {
+    int tot = 0;
+    LISTBASE_FOREACH (WriteStrip *, ws, strips) {
+      if (ws->rl == rl) {
+        passes[tot] = ws->rpass;
+        rects[tot] = ws->strip;
+        tot++;
+      }
+    }
+
+    if (tot) {
+      BLI_mutex_lock(&exr_read_lock);
+      if (rl->exrhandle_read) {
+        render_layer_exr_read_rows(rl, passes, rects, tot, ymin, ymax);
+      }
+      BLI_mutex_unlock(&exr_read_lock);
+    }
+  }
+
+  MEM_freeN(passes);
+  MEM_freeN(rects);
+}
+
+static void write_strips_free(ListBase *strips)
+{
+  LISTBASE_FOREACH (WriteStrip *, ws, strips) {
+    MEM_freeN(ws->strip);
+  }
+  BLI_freelistN(strips);
+}
+
 /* Called from the UI and render pipeline, to save multilayer and multiview
- * images, optionally isolating a specific, view, layer or RGBA/Z pass. */
+ * images, optionally isolating a specific, view, layer or RGBA/Z pass.
+ *
+ * Passes left in save buffers files are streamed to the file in strips of rows, so the full
+ * passes are never in memory at once. */
 bool RE_WriteRenderResult(ReportList *reports,
                           RenderResult *rr,
                           const char *filename,
@@ -905,6 +1353,8 @@ bool RE_WriteRenderResult(ReportList *reports,
   const bool half_float = (imf && imf->depth == R_IMF_CHAN_DEPTH_16);
   const bool multi_layer = !(imf && imf->imtype == R_IMF_IMTYPE_OPENEXR);
   const bool write_z = !multi_layer && (imf && (imf->flag & R_IMF_FLAG_ZBUF));
+  ListBase strips = {NULL, NULL};
+  ListBase *strips_p = render_result_has_exr_read_passes(rr) ? &strips : NULL;
 
   /* Write first layer if not multilayer and no layer was specified. */
   if (!multi_layer && layer == -1) {
@@ -941,6 +1391,7 @@ bool RE_WriteRenderResult(ReportList *reports,
         continue;
       }
 
+      float *rectf = write_strip_get(strips_p, rr, NULL, NULL, rview->rectf, 4);
       for (int a = 0; a < 4; a++) {
         char passname[EXR_PASS_MAXNAME];
         char layname[EXR_PASS_MAXNAME];
@@ -962,13 +1413,14 @@ bool RE_WriteRenderResult(ReportList *reports,
                             viewname,
                             4,
                             4 * rr->rectx,
-                            rview->rectf + a,
+                            rectf + a,
                             half_float);
       }
 
       if (write_z && rview->rectz) {
         const char *layname = (multi_layer) ? "Composite" : "";
-        IMB_exr_add_channel(exrhandle, layname, "Z", viewname, 1, rr->rectx, rview->rectz, false);
+        float *rectz = write_strip_get(strips_p, rr, NULL, NULL, rview->rectz, 1);
+        IMB_exr_add_channel(exrhandle, layname, "Z", viewname, 1, rr->rectx, rectz, false);
       }
     }
   }
@@ -998,6 +1450,11 @@ bool RE_WriteRenderResult(ReportList *reports,
         viewname = "";
       }
 
+      /* Passes which could not be read from their file, see #RE_RenderResultEnsureLoaded. */
+      if (rp->rect == NULL && rl->exrhandle_read == NULL) {
+        continue;
+      }
+
       /* We only store RGBA passes as half float, for
        * others precision loss can be problematic. */
       bool pass_half_float = half_float &&
@@ -1005,6 +1462,7 @@ bool RE_WriteRenderResult(ReportList *reports,
                               STREQ(rp->chan_id, "R") || STREQ(rp->chan_id, "G") ||
                               STREQ(rp->chan_id, "B") || STREQ(rp->chan_id, "A"));
 
+      float *rect = write_strip_get(strips_p, rr, rl, rp, rp->rect, rp->channels);
       for (int a = 0; a < rp->channels; a++) {
         /* Save Combined as RGBA if single layer save. */
         char passname[EXR_PASS_MAXNAME];
@@ -1026,7 +1484,7 @@ bool RE_WriteRenderResult(ReportList *reports,
                             viewname,
                             rp->channels,
                             rp->channels * rr->rectx,
-                            rp->rect + a,
+                            rect + a,
                             pass_half_float);
       }
     }
@@ -1039,7 +1497,15 @@ bool RE_WriteRenderResult(ReportList *reports,
   int compress = (imf ? imf->exr_codec : 0);
   bool success = IMB_exr_begin_write(
       exrhandle, filename, rr->rectx, rr->recty, compress, rr->stamp_data);
-  if (success) {
+  if (success && strips_p) {
+    /* Files are written from the top down. */
+    for (int ymax = rr->recty; ymax > 0; ymax -= WRITE_STRIP_ROWS) {
+      const int ymin = max_ii(ymax - WRITE_STRIP_ROWS, 0);
+      write_strips_fill(&strips, rr, ymin, ymax);
+      IMB_exr_write_channels_rows(exrhandle, ymin, ymax);
+    }
+  }
+  else if (success) {
     IMB_exr_write_channels(exrhandle);
   }
   else {
@@ -1049,6 +1515,7 @@ bool RE_WriteRenderResult(ReportList *reports,
   }
 
   IMB_exr_close(exrhandle);
+  write_strips_free(&strips);
   return success;
 }
 
@@ -1061,6 +1528,11 @@ void render_result_single_layer_begin(Render *re)
   /* officially pushed result should be NULL... error can happen with do_seq */
   RE_FreeRenderResult(re->pushedresult);
 
+  /* The save buffers files get overwritten by the next render. */
+  if (re->result) {
+    RE_RenderResultEnsureLoaded(re->result, NULL);
+  }
+
   re->pushedresult = re->result;
   re->result = NULL;
 }
@@ -1260,7 +1732,8 @@ void render_result_exr_file_begin(Render *re, RenderEngine *engine)
   }
 }
 
-/* end write of exr tile file, read back first sample */
+/* End write of exr tile file, read back combined. Other passes stay in the files and are read
+ * when used, see #render_layer_exr_pass_ensure_loaded. */
 void render_result_exr_file_end(Render *re, RenderEngine *engine)
 {
   /* Close EXR files. */
@@ -1273,10 +1746,11 @@ void render_result_exr_file_end(Render *re, RenderEngine *engine)
     rr->do_exr_tile = false;
   }
 
-  /* Create new render result in memory instead of on disk. */
+  /* Create new render result reading from the files. */
   BLI_rw_mutex_lock(&re->resultmutex, THREAD_LOCK_WRITE);
   render_result_free_list(&re->fullresult, re->result);
-  re->result = render_result_new(re, &re->disprect, 0, RR_USE_MEM, RR_ALL_LAYERS, RR_ALL_VIEWS);
+  re->result = render_result_new(
+      re, &re->disprect, 0, RR_USE_EXR_READ, RR_ALL_LAYERS, RR_ALL_VIEWS);
   BLI_rw_mutex_unlock(&re->resultmutex);
 
   LISTBASE_FOREACH (RenderLayer *, rl, &re->result->layers) {
@@ -1293,13 +1767,25 @@ void render_result_exr_file_end(Render *re, RenderEngine *engine)
 
     BLI_freelistN(&templates);
 
-    /* Render passes contents from file. */
-    char str[FILE_MAXFILE + MAX_ID_NAME + MAX_ID_NAME + 100] = "";
-    render_result_exr_file_path(re->scene, rl->name, 0, str);
-    printf("read exr tmp file: %s\n", str);
+    if (rl->exrhandle_read) {
+      /* Only the allocated passes, the others are read when used. */
+      LISTBASE_FOREACH (RenderPass *, rpass, &rl->passes) {
+        if (rpass->rect) {
+          BLI_mutex_lock(&exr_read_lock);
+          render_layer_exr_read_rows(rl, &rpass, &rpass->rect, 1, 0, rpass->recty);
+          BLI_mutex_unlock(&exr_read_lock);
+        }
+      }
+    }
+    else {
+      /* Render passes contents from file. */
+      char str[FILE_MAXFILE + MAX_ID_NAME + MAX_ID_NAME + 100] = "";
+      render_result_exr_file_path(re->scene, rl->name, 0, str);
+      printf("read exr tmp file: %s\n", str);
 
-    if (!render_result_exr_file_read_path(re->result, rl, str)) {
-      printf("cannot read: %s\n", str);
+      if (!render_result_exr_file_read_path(re->result, rl, str)) {
+        printf("cannot read: %s\n", str);
+      }
     }
     BLI_rw_mutex_unlock(&re->resultmutex);
   }
@@ -1677,6 +2163,8 @@ static RenderView *duplicate_render_view(RenderView *rview)
 
 RenderResult *RE_DuplicateRenderResult(RenderResult *rr)
 {
+  RE_RenderResultEnsureLoaded(rr, NULL);
+
   RenderResult *new_rr = MEM_mallocN(sizeof(RenderResult), "new duplicated render result");
   *new_rr = *rr;
   new_rr->next = new_rr->prev = NULL;
@@ -1699,6 +2187,10 @@ RenderResult *RE_DuplicateRenderResult(RenderResult *rr)
   if (new_rr->rectz != NULL) {
     new_rr->rectz = MEM_dupallocN(new_rr->rectz);
   }
+  /* Set when some passes could not be read. */
+  if (new_rr->exr_filepath != NULL) {
+    new_rr->exr_filepath = BLI_strdup(new_rr->exr_filepath);
+  }
   new_rr->stamp_data = BKE_stamp_data_copy(new_rr->stamp_data);
   return new_rr;
 }
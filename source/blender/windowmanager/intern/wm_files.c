@@ -413,6 +413,7 @@ static void wm_init_userdef(Main *bmain)
   }
 
   MEM_CacheLimiter_set_maximum(((size_t)U.memcachelimit) * 1024 * 1024);
+  IMB_tile_cache_params(0, U.memcachelimit);
   BKE_sound_init(bmain);
 
   /* Update `U.tempdir` from user preferences. */